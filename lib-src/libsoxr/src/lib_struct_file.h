@@ -2,6 +2,9 @@
 
    Used to tell RLBox the layout of the structs in soxr.h
 
+   The classes go by their typedefs, because soxr_quality_spec and the
+   rest also name the functions that make them.
+
 **********************************************************************/
 
 #ifndef _LIB_STRUCT_FILE_H
@@ -11,7 +14,7 @@
 #include "soxr.h"
 // #include "soxr.c"
 
-#define sandbox_fields_reflection_soxr_class_soxr_quality_spec(f, g, ...) \
+#define sandbox_fields_reflection_soxr_class_soxr_quality_spec_t(f, g, ...) \
     f(double, precision, FIELD_NORMAL, ##__VA_ARGS__) g() \
     f(double, phase_response, FIELD_NORMAL, ##__VA_ARGS__) g() \
     f(double, passband_end, FIELD_NORMAL, ##__VA_ARGS__) g() \
@@ -19,14 +22,14 @@
     f(void *, e, FIELD_NORMAL, ##__VA_ARGS__) g() \
     f(unsigned long, flags, FIELD_NORMAL, ##__VA_ARGS__) g() \
 
-#define sandbox_fields_reflection_soxr_class_soxr_io_spec(f, g, ...) \
+#define sandbox_fields_reflection_soxr_class_soxr_io_spec_t(f, g, ...) \
     f(soxr_datatype_t, itype, FIELD_NORMAL, ##__VA_ARGS__) g() \
     f(soxr_datatype_t, otype, FIELD_NORMAL, ##__VA_ARGS__) g() \
     f(double, scale, FIELD_NORMAL, ##__VA_ARGS__) g() \
     f(void *, e, FIELD_NORMAL, ##__VA_ARGS__) g() \
     f(unsigned long, flags, FIELD_NORMAL, ##__VA_ARGS__) g() \
 
-#define sandbox_fields_reflection_soxr_class_soxr_runtime_spec(f, g, ...) \
+#define sandbox_fields_reflection_soxr_class_soxr_runtime_spec_t(f, g, ...) \
     f(unsigned, log2_min_dft_size, FIELD_NORMAL, ##__VA_ARGS__) g() \
     f(unsigned, log2_large_dft_size, FIELD_NORMAL, ##__VA_ARGS__) g() \
     f(unsigned, coef_size_kbytes, FIELD_NORMAL, ##__VA_ARGS__) g() \
@@ -56,8 +59,8 @@
     f(int, flushing, FIELD_NORMAL, ##__VA_ARGS__) g() \
 
 #define sandbox_fields_reflection_soxr_allClasses(f, ...)  \
-    f(soxr_quality_spec, soxr, ##__VA_ARGS__) \
-    f(soxr_io_spec, soxr, ##__VA_ARGS__) \
-    f(soxr_runtime_spec, soxr, ##__VA_ARGS__)
+    f(soxr_quality_spec_t, soxr, ##__VA_ARGS__) \
+    f(soxr_io_spec_t, soxr, ##__VA_ARGS__) \
+    f(soxr_runtime_spec_t, soxr, ##__VA_ARGS__)
 
 #endif // _LIB_STRUCT_FILE_H
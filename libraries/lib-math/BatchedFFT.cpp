@@ -0,0 +1,264 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   BatchedFFT.cpp
+
+   The lanes of each level are in their own file, marked with their target
+   as in MixKernels, and share the code of BatchedFFTLanes.h.  Windows are
+   interleaved into scratch, a sample of each window in turn, filtered
+   there, and copied back.  A last group of fewer windows than lanes is
+   padded with silence.
+
+   CMakeLists.txt turns off floating point contraction for these files and
+   for RealFFTf.cpp, so that no level fuses products that another rounds.
+
+**********************************************************************/
+
+#include "BatchedFFT.h"
+#include "BatchedFFTLanes.h"
+#include "RealFFTf.h"
+
+#include <algorithm>
+#include <atomic>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BATCHED_FFT_X86
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+namespace BatchedFFT {
+
+namespace {
+
+using namespace Detail;
+
+//! Lanes of the widest level
+constexpr size_t MaxLanes = 16;
+
+size_t LanesOf(Level level)
+{
+   switch (level) {
+   case Level::SSE2:
+      return 4;
+   case Level::AVX2:
+      return 8;
+   case Level::AVX512:
+      return 16;
+   case Level::Scalar:
+   default:
+      return 1;
+   }
+}
+
+FilterFunction FilterOf(Level level)
+{
+   switch (level) {
+   case Level::SSE2:
+      return FilterSSE2();
+   case Level::AVX2:
+      return FilterAVX2();
+   case Level::AVX512:
+      return FilterAVX512();
+   case Level::Scalar:
+   default:
+      return nullptr;
+   }
+}
+
+#ifdef BATCHED_FFT_X86
+
+bool HasSSE2()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+   return true;
+#elif defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 1);
+   return (info[3] >> 26) & 1;
+#else
+   return __builtin_cpu_supports("sse2");
+#endif
+}
+
+#ifdef _MSC_VER
+//! Whether the processor has the feature bit of leaf 7, and the operating
+//! system saves the registers of the given mask of XCR0
+bool HasExtended(int bit, unsigned long long xcr0)
+{
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7)
+      return false;
+   __cpuid(info, 1);
+   const bool osxsave = (info[2] >> 27) & 1;
+   if (!osxsave || (_xgetbv(0) & xcr0) != xcr0)
+      return false;
+   __cpuidex(info, 7, 0);
+   return (info[1] >> bit) & 1;
+}
+#endif
+
+bool HasAVX2()
+{
+#ifdef _MSC_VER
+   // xmm and ymm state
+   return HasExtended(5, 0x6);
+#else
+   return __builtin_cpu_supports("avx2");
+#endif
+}
+
+bool HasAVX512()
+{
+#ifdef _MSC_VER
+   // xmm, ymm, opmask and zmm state
+   return HasExtended(16, 0xe6);
+#else
+   return __builtin_cpu_supports("avx512f");
+#endif
+}
+
+#endif
+
+std::atomic<Level> &Current()
+{
+   static std::atomic<Level> current{ BestLevel() };
+   return current;
+}
+
+//! The scalar functions, as EffectEqualization::Filter() calls them
+void FilterScalar(const FFTParam &fft,
+   const float *filterR, const float *filterI, float *buffer, float *spectrum)
+{
+   const auto points = fft.Points;
+   RealFFTf(buffer, &fft);
+   spectrum[0] = buffer[0] * filterR[0];
+   for (size_t i = 1; i < points; ++i) {
+      const auto re = buffer[fft.BitReversed[i]];
+      const auto im = buffer[fft.BitReversed[i] + 1];
+      spectrum[2 * i] = re * filterR[i] - im * filterI[i];
+      spectrum[2 * i + 1] = re * filterI[i] + im * filterR[i];
+   }
+   spectrum[1] = buffer[1] * filterR[points];
+   InverseRealFFTf(spectrum, &fft);
+   ReorderToTime(&fft, spectrum, buffer);
+}
+
+}
+
+const char *LevelName(Level level)
+{
+   switch (level) {
+   case Level::SSE2:
+      return "SSE2";
+   case Level::AVX2:
+      return "AVX2";
+   case Level::AVX512:
+      return "AVX-512";
+   case Level::Scalar:
+   default:
+      return "scalar";
+   }
+}
+
+bool IsSupported(Level level)
+{
+   if (level == Level::Scalar)
+      return true;
+   if (!FilterOf(level))
+      return false;
+#ifdef BATCHED_FFT_X86
+   switch (level) {
+   case Level::SSE2:
+      return HasSSE2();
+   case Level::AVX2:
+      return HasSSE2() && HasAVX2();
+   case Level::AVX512:
+      return HasSSE2() && HasAVX2() && HasAVX512();
+   default:
+      break;
+   }
+#endif
+   return false;
+}
+
+Level BestLevel()
+{
+   // Not AVX-512, which measured slower than AVX2 at windows of 2048 and
+   // 16384, as sixteen interleaved windows crowd the cache
+   static const Level best = []{
+      for (auto level : { Level::AVX2, Level::SSE2 })
+         if (IsSupported(level))
+            return level;
+      return Level::Scalar;
+   }();
+   return best;
+}
+
+Level GetLevel()
+{
+   return Current().load(std::memory_order_relaxed);
+}
+
+bool SetLevel(Level level)
+{
+   if (!IsSupported(level))
+      return false;
+   Current().store(level, std::memory_order_relaxed);
+   return true;
+}
+
+size_t Lanes()
+{
+   return LanesOf(GetLevel());
+}
+
+size_t ScratchSize(size_t fftLen)
+{
+   // Interleaved windows, and as many for their spectra
+   return 2 * fftLen * MaxLanes;
+}
+
+void Filter(const FFTParam &fft,
+   const float *filterR, const float *filterI,
+   float *const *windows, size_t nWindows, float *scratch)
+{
+   const auto level = GetLevel();
+   const auto fftLen = 2 * fft.Points;
+   const auto filter = FilterOf(level);
+   if (!filter) {
+      for (size_t iWindow = 0; iWindow < nWindows; ++iWindow)
+         FilterScalar(fft, filterR, filterI, windows[iWindow], scratch);
+      return;
+   }
+
+   const Tables tables{
+      fft.BitReversed.get(), fft.SinTable.get(), fft.Points };
+   const auto lanes = LanesOf(level);
+   const auto data = scratch;
+   const auto spectrum = scratch + fftLen * lanes;
+   for (size_t first = 0; first < nWindows; first += lanes) {
+      const auto count = std::min(lanes, nWindows - first);
+      const auto group = windows + first;
+      for (size_t k = 0; k < fftLen; ++k) {
+         const auto samples = data + k * lanes;
+         for (size_t lane = 0; lane < count; ++lane)
+            samples[lane] = group[lane][k];
+         std::fill(samples + count, samples + lanes, 0.0f);
+      }
+      filter(tables, filterR, filterI, data, spectrum);
+      for (size_t k = 0; k < fftLen; ++k) {
+         const auto samples = data + k * lanes;
+         for (size_t lane = 0; lane < count; ++lane)
+            group[lane][k] = samples[lane];
+      }
+   }
+}
+
+}
@@ -0,0 +1,70 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   BatchedFFT.h
+
+   Filtering of many windows by fast convolution, several windows at once
+   in the lanes of SSE2, AVX2 or AVX-512 registers, chosen at run time.
+
+**********************************************************************/
+
+#ifndef __AUDACITY_BATCHED_FFT__
+#define __AUDACITY_BATCHED_FFT__
+
+#include <cstddef>
+
+struct FFTParam;
+
+/*!
+ Each window is filtered as EffectEqualization::Filter() filters one:
+ RealFFTf(), multiplication by the complex frequency response, then
+ InverseRealFFTf() and ReorderToTime().  Every level gives results identical
+ to the bit to those of the scalar functions, because each lane repeats
+ their operations in their order, and products are never fused with sums.
+ */
+namespace BatchedFFT {
+
+//! Instruction sets that the filter is written for
+enum class Level : unsigned {
+   Scalar,
+   SSE2,
+   AVX2,
+   AVX512,
+};
+
+MATH_API const char *LevelName(Level level);
+
+//! Whether this build and this processor can use the level
+MATH_API bool IsSupported(Level level);
+
+//! The fastest supported level, chosen on first use; never AVX-512, which
+//! only SetLevel() chooses
+MATH_API Level BestLevel();
+
+MATH_API Level GetLevel();
+
+//! Use a lower level, for comparisons in tests and benchmarks
+/*! @return false, and no change, if the level is not supported */
+MATH_API bool SetLevel(Level level);
+
+//! How many windows the current level filters at once
+MATH_API size_t Lanes();
+
+//! Floats of scratch that Filter() needs for windows of fftLen samples, at
+//! any level
+MATH_API size_t ScratchSize(size_t fftLen);
+
+//! Filters nWindows windows of 2 * fft.Points samples, each in place
+/*!
+ @param filterR, filterI the frequency response, fft.Points + 1 bins
+ @param scratch ScratchSize(2 * fft.Points) floats
+ */
+MATH_API void Filter(const FFTParam &fft,
+   const float *filterR, const float *filterI,
+   float *const *windows, size_t nWindows, float *scratch);
+
+}
+
+#endif
@@ -0,0 +1,56 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   BatchedFFTAVX2.cpp
+
+   The lanes of BatchedFFT, eight windows at a time.
+
+**********************************************************************/
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BATCHED_FFT_TARGET __attribute__((target("avx2")))
+#else
+#define BATCHED_FFT_TARGET
+#endif
+
+#include "BatchedFFTLanes.h"
+
+namespace {
+struct AVX2 {
+   using T = __m256;
+   static constexpr size_t Width = 8;
+   static BATCHED_FFT_TARGET T Load(const float *p)
+   { return _mm256_loadu_ps(p); }
+   static BATCHED_FFT_TARGET void Store(float *p, T x)
+   { _mm256_storeu_ps(p, x); }
+   static BATCHED_FFT_TARGET T Set(float x) { return _mm256_set1_ps(x); }
+   static BATCHED_FFT_TARGET T Add(T x, T y) { return _mm256_add_ps(x, y); }
+   static BATCHED_FFT_TARGET T Sub(T x, T y) { return _mm256_sub_ps(x, y); }
+   static BATCHED_FFT_TARGET T Mul(T x, T y) { return _mm256_mul_ps(x, y); }
+   // Flip the sign bit, as unary minus does, even of zero
+   static BATCHED_FFT_TARGET T Negate(T x)
+   { return _mm256_xor_ps(x, _mm256_set1_ps(-0.0f)); }
+};
+}
+
+auto BatchedFFT::Detail::FilterAVX2() -> FilterFunction
+{
+   return Filter<AVX2>;
+}
+
+#else
+
+#include "BatchedFFTLanes.h"
+
+auto BatchedFFT::Detail::FilterAVX2() -> FilterFunction
+{
+   return nullptr;
+}
+
+#endif
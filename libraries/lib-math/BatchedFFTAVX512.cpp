@@ -0,0 +1,60 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   BatchedFFTAVX512.cpp
+
+   The lanes of BatchedFFT, sixteen windows at a time.
+
+**********************************************************************/
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BATCHED_FFT_TARGET __attribute__((target("avx512f")))
+#else
+#define BATCHED_FFT_TARGET
+#endif
+
+#include "BatchedFFTLanes.h"
+
+namespace {
+struct AVX512 {
+   using T = __m512;
+   static constexpr size_t Width = 16;
+   static BATCHED_FFT_TARGET T Load(const float *p)
+   { return _mm512_loadu_ps(p); }
+   static BATCHED_FFT_TARGET void Store(float *p, T x)
+   { _mm512_storeu_ps(p, x); }
+   static BATCHED_FFT_TARGET T Set(float x) { return _mm512_set1_ps(x); }
+   static BATCHED_FFT_TARGET T Add(T x, T y) { return _mm512_add_ps(x, y); }
+   static BATCHED_FFT_TARGET T Sub(T x, T y) { return _mm512_sub_ps(x, y); }
+   static BATCHED_FFT_TARGET T Mul(T x, T y) { return _mm512_mul_ps(x, y); }
+   // Flip the sign bit, as unary minus does, even of zero; _mm512_xor_ps
+   // would need AVX-512DQ
+   static BATCHED_FFT_TARGET T Negate(T x)
+   {
+      return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(x),
+         _mm512_set1_epi32(static_cast<int>(0x80000000u))));
+   }
+};
+}
+
+auto BatchedFFT::Detail::FilterAVX512() -> FilterFunction
+{
+   return Filter<AVX512>;
+}
+
+#else
+
+#include "BatchedFFTLanes.h"
+
+auto BatchedFFT::Detail::FilterAVX512() -> FilterFunction
+{
+   return nullptr;
+}
+
+#endif
@@ -0,0 +1,231 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   BatchedFFTLanes.h
+
+   Private to BatchedFFT:  RealFFTf(), the filter multiplication of
+   EffectEqualization::Filter(), InverseRealFFTf() and ReorderToTime(),
+   written once for a vector type V whose lanes hold the same sample of
+   V::Width windows.  Each lane does the operations of the scalar code in
+   the same order, so each window comes out identical to the bit.
+
+   A file that includes this defines BATCHED_FFT_TARGET first, as the
+   attribute that lets its functions use the instructions of V.
+
+**********************************************************************/
+
+#ifndef __AUDACITY_BATCHED_FFT_LANES__
+#define __AUDACITY_BATCHED_FFT_LANES__
+
+#include <cstddef>
+
+namespace BatchedFFT {
+namespace Detail {
+
+//! What the lanes need of an FFTParam
+struct Tables {
+   const int *bitReversed;
+   const float *sinTable;
+   size_t points;
+};
+
+//! Filters V::Width windows, interleaved so that sample k of window l is
+//! data[k * V::Width + l], in place; spectrum is scratch of the same size
+using FilterFunction = void (*)(const Tables &tables,
+   const float *filterR, const float *filterI, float *data, float *spectrum);
+
+//! Each is null if the build has no code for the processor
+FilterFunction FilterSSE2();
+FilterFunction FilterAVX2();
+FilterFunction FilterAVX512();
+
+}
+}
+
+#endif
+
+#ifdef BATCHED_FFT_TARGET
+
+namespace {
+
+using BatchedFFT::Detail::Tables;
+
+template<typename V> BATCHED_FFT_TARGET
+void Forward(const Tables &h, float *buffer)
+{
+   using T = typename V::T;
+   constexpr auto W = V::Width;
+   const T two = V::Set(2.0f);
+   const T half = V::Set(0.5f);
+
+   auto butterfliesPerGroup = h.points / 2;
+   const auto end1 = buffer + h.points * 2 * W;
+   while (butterfliesPerGroup > 0) {
+      auto A = buffer;
+      auto B = buffer + butterfliesPerGroup * 2 * W;
+      auto sptr = h.sinTable;
+      while (A < end1) {
+         const T sin = V::Set(sptr[0]);
+         const T cos = V::Set(sptr[1]);
+         const auto end2 = B;
+         while (A < end2) {
+            const T b0 = V::Load(B), b1 = V::Load(B + W);
+            const T v1 = V::Add(V::Mul(b0, cos), V::Mul(b1, sin));
+            const T v2 = V::Sub(V::Mul(b0, sin), V::Mul(b1, cos));
+            const T newB0 = V::Add(V::Load(A), v1);
+            V::Store(B, newB0);
+            V::Store(A, V::Sub(newB0, V::Mul(two, v1)));
+            const T newB1 = V::Sub(V::Load(A + W), v2);
+            V::Store(B + W, newB1);
+            V::Store(A + W, V::Add(newB1, V::Mul(two, v2)));
+            A += 2 * W;
+            B += 2 * W;
+         }
+         A = B;
+         B += butterfliesPerGroup * 2 * W;
+         sptr += 2;
+      }
+      butterfliesPerGroup >>= 1;
+   }
+
+   // Massage output to get the output for a real input sequence
+   auto br1 = h.bitReversed + 1;
+   auto br2 = h.bitReversed + h.points - 1;
+   while (br1 < br2) {
+      const T sin = V::Set(h.sinTable[*br1]);
+      const T cos = V::Set(h.sinTable[*br1 + 1]);
+      const auto A = buffer + *br1 * W;
+      const auto B = buffer + *br2 * W;
+      const T b0 = V::Load(B), b1 = V::Load(B + W);
+      const T hrMinus = V::Sub(V::Load(A), b0);
+      const T hrPlus = V::Add(hrMinus, V::Mul(b0, two));
+      const T hiMinus = V::Sub(V::Load(A + W), b1);
+      const T hiPlus = V::Add(hiMinus, V::Mul(b1, two));
+      const T v1 = V::Sub(V::Mul(sin, hrMinus), V::Mul(cos, hiPlus));
+      const T v2 = V::Add(V::Mul(cos, hrMinus), V::Mul(sin, hiPlus));
+      const T a0 = V::Mul(V::Add(hrPlus, v1), half);
+      V::Store(A, a0);
+      V::Store(B, V::Sub(a0, v1));
+      const T a1 = V::Mul(V::Add(hiMinus, v2), half);
+      V::Store(A + W, a1);
+      V::Store(B + W, V::Sub(a1, hiMinus));
+      ++br1;
+      --br2;
+   }
+   // Handle the center bin (just need a conjugate)
+   const auto center = buffer + (*br1 + 1) * W;
+   V::Store(center, V::Negate(V::Load(center)));
+   // Put the Fs/2 value into the imaginary part of the DC bin
+   const T dc = V::Load(buffer), nyquist = V::Load(buffer + W);
+   V::Store(buffer, V::Add(dc, nyquist));
+   V::Store(buffer + W, V::Sub(dc, nyquist));
+}
+
+template<typename V> BATCHED_FFT_TARGET
+void Inverse(const Tables &h, float *buffer)
+{
+   using T = typename V::T;
+   constexpr auto W = V::Width;
+   const T two = V::Set(2.0f);
+   const T half = V::Set(0.5f);
+
+   // Massage input to get the input for a real output sequence
+   auto A = buffer + 2 * W;
+   auto B = buffer + (h.points * 2 - 2) * W;
+   auto br1 = h.bitReversed + 1;
+   while (A < B) {
+      const T sin = V::Set(h.sinTable[*br1]);
+      const T cos = V::Set(h.sinTable[*br1 + 1]);
+      const T b0 = V::Load(B), b1 = V::Load(B + W);
+      const T hrMinus = V::Sub(V::Load(A), b0);
+      const T hrPlus = V::Add(hrMinus, V::Mul(b0, two));
+      const T hiMinus = V::Sub(V::Load(A + W), b1);
+      const T hiPlus = V::Add(hiMinus, V::Mul(b1, two));
+      const T v1 = V::Add(V::Mul(sin, hrMinus), V::Mul(cos, hiPlus));
+      const T v2 = V::Sub(V::Mul(cos, hrMinus), V::Mul(sin, hiPlus));
+      const T a0 = V::Mul(V::Add(hrPlus, v1), half);
+      V::Store(A, a0);
+      V::Store(B, V::Sub(a0, v1));
+      const T a1 = V::Mul(V::Sub(hiMinus, v2), half);
+      V::Store(A + W, a1);
+      V::Store(B + W, V::Sub(a1, hiMinus));
+      A += 2 * W;
+      B -= 2 * W;
+      ++br1;
+   }
+   // Handle center bin (just need conjugate)
+   V::Store(A + W, V::Negate(V::Load(A + W)));
+   // The DC bin holds the DC and Fs/2 components
+   const T dc = V::Load(buffer), nyquist = V::Load(buffer + W);
+   V::Store(buffer, V::Mul(half, V::Add(dc, nyquist)));
+   V::Store(buffer + W, V::Mul(half, V::Sub(dc, nyquist)));
+
+   auto butterfliesPerGroup = h.points / 2;
+   const auto end1 = buffer + h.points * 2 * W;
+   while (butterfliesPerGroup > 0) {
+      A = buffer;
+      B = buffer + butterfliesPerGroup * 2 * W;
+      auto sptr = h.sinTable;
+      while (A < end1) {
+         const T sin = V::Set(sptr[0]);
+         const T cos = V::Set(sptr[1]);
+         sptr += 2;
+         const auto end2 = B;
+         while (A < end2) {
+            const T b0 = V::Load(B), b1 = V::Load(B + W);
+            const T v1 = V::Sub(V::Mul(b0, cos), V::Mul(b1, sin));
+            const T v2 = V::Add(V::Mul(b0, sin), V::Mul(b1, cos));
+            const T newB0 = V::Mul(V::Add(V::Load(A), v1), half);
+            V::Store(B, newB0);
+            V::Store(A, V::Sub(newB0, v1));
+            const T newB1 = V::Mul(V::Add(V::Load(A + W), v2), half);
+            V::Store(B + W, newB1);
+            V::Store(A + W, V::Sub(newB1, v2));
+            A += 2 * W;
+            B += 2 * W;
+         }
+         A = B;
+         B += butterfliesPerGroup * 2 * W;
+      }
+      butterfliesPerGroup >>= 1;
+   }
+}
+
+template<typename V> BATCHED_FFT_TARGET
+void Filter(const Tables &h, const float *filterR, const float *filterI,
+   float *data, float *spectrum)
+{
+   using T = typename V::T;
+   constexpr auto W = V::Width;
+   const auto points = h.points;
+
+   Forward<V>(h, data);
+
+   // DC component is purely real
+   V::Store(spectrum, V::Mul(V::Load(data), V::Set(filterR[0])));
+   for (size_t i = 1; i < points; ++i) {
+      const auto bin = data + h.bitReversed[i] * W;
+      const T re = V::Load(bin), im = V::Load(bin + W);
+      const T r = V::Set(filterR[i]), ii = V::Set(filterI[i]);
+      V::Store(spectrum + 2 * i * W, V::Sub(V::Mul(re, r), V::Mul(im, ii)));
+      V::Store(spectrum + (2 * i + 1) * W,
+         V::Add(V::Mul(re, ii), V::Mul(im, r)));
+   }
+   // Fs/2 component is purely real
+   V::Store(spectrum + W, V::Mul(V::Load(data + W), V::Set(filterR[points])));
+
+   Inverse<V>(h, spectrum);
+
+   // Reorder to time
+   for (size_t i = 0; i < points; ++i) {
+      const auto bin = spectrum + h.bitReversed[i] * W;
+      V::Store(data + 2 * i * W, V::Load(bin));
+      V::Store(data + (2 * i + 1) * W, V::Load(bin + W));
+   }
+}
+
+}
+
+#endif
@@ -0,0 +1,54 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   BatchedFFTSSE2.cpp
+
+   The lanes of BatchedFFT, four windows at a time.
+
+**********************************************************************/
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BATCHED_FFT_TARGET __attribute__((target("sse2")))
+#else
+#define BATCHED_FFT_TARGET
+#endif
+
+#include "BatchedFFTLanes.h"
+
+namespace {
+struct SSE2 {
+   using T = __m128;
+   static constexpr size_t Width = 4;
+   static BATCHED_FFT_TARGET T Load(const float *p) { return _mm_loadu_ps(p); }
+   static BATCHED_FFT_TARGET void Store(float *p, T x) { _mm_storeu_ps(p, x); }
+   static BATCHED_FFT_TARGET T Set(float x) { return _mm_set1_ps(x); }
+   static BATCHED_FFT_TARGET T Add(T x, T y) { return _mm_add_ps(x, y); }
+   static BATCHED_FFT_TARGET T Sub(T x, T y) { return _mm_sub_ps(x, y); }
+   static BATCHED_FFT_TARGET T Mul(T x, T y) { return _mm_mul_ps(x, y); }
+   // Flip the sign bit, as unary minus does, even of zero
+   static BATCHED_FFT_TARGET T Negate(T x)
+   { return _mm_xor_ps(x, _mm_set1_ps(-0.0f)); }
+};
+}
+
+auto BatchedFFT::Detail::FilterSSE2() -> FilterFunction
+{
+   return Filter<SSE2>;
+}
+
+#else
+
+#include "BatchedFFTLanes.h"
+
+auto BatchedFFT::Detail::FilterSSE2() -> FilterFunction
+{
+   return nullptr;
+}
+
+#endif
@@ -50,6 +50,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <vector>
 
 #include "RealFFTf.h"
 
@@ -221,6 +222,19 @@ void FFT(size_t NumSamples,
    }
 }
 
+/*
+ * Processing buffer of the wrappers of RealFFTf() below, one per thread, so
+ * that concurrent callers neither allocate on every call nor contend.
+ * The wrappers don't call each other, so one buffer per thread suffices.
+ */
+static float *Scratch(size_t NumSamples)
+{
+   thread_local std::vector<float> buffer;
+   if (buffer.size() < NumSamples)
+      buffer.resize(NumSamples);
+   return buffer.data();
+}
+
 /*
  * Real Fast Fourier Transform
  *
@@ -230,13 +244,13 @@ void FFT(size_t NumSamples,
 void RealFFT(size_t NumSamples, const float *RealIn, float *RealOut, float *ImagOut)
 {
    auto hFFT = GetFFT(NumSamples);
-   Floats pFFT{ NumSamples };
+   const auto pFFT = Scratch(NumSamples);
    // Copy the data into the processing buffer
    for(size_t i = 0; i < NumSamples; i++)
       pFFT[i] = RealIn[i];
 
    // Perform the FFT
-   RealFFTf(pFFT.get(), hFFT.get());
+   RealFFTf(pFFT, hFFT.get());
 
    // Copy the data into the real and imaginary outputs
    for (size_t i = 1; i<(NumSamples / 2); i++) {
@@ -269,7 +283,7 @@ void InverseRealFFT(size_t NumSamples, const float *RealIn, const float *ImagIn,
 		    float *RealOut)
 {
    auto hFFT = GetFFT(NumSamples);
-   Floats pFFT{ NumSamples };
+   const auto pFFT = Scratch(NumSamples);
    // Copy the data into the processing buffer
    for (size_t i = 0; i < (NumSamples / 2); i++)
       pFFT[2*i  ] = RealIn[i];
@@ -284,10 +298,10 @@ void InverseRealFFT(size_t NumSamples, const float *RealIn, const float *ImagIn,
    pFFT[1] = RealIn[NumSamples / 2];
 
    // Perform the FFT
-   InverseRealFFTf(pFFT.get(), hFFT.get());
+   InverseRealFFTf(pFFT, hFFT.get());
 
    // Copy the data to the (purely real) output buffer
-   ReorderToTime(hFFT.get(), pFFT.get(), RealOut);
+   ReorderToTime(hFFT.get(), pFFT, RealOut);
 }
 
 /*
@@ -304,13 +318,13 @@ void InverseRealFFT(size_t NumSamples, const float *RealIn, const float *ImagIn,
 void PowerSpectrum(size_t NumSamples, const float *In, float *Out)
 {
    auto hFFT = GetFFT(NumSamples);
-   Floats pFFT{ NumSamples };
+   const auto pFFT = Scratch(NumSamples);
    // Copy the data into the processing buffer
    for (size_t i = 0; i<NumSamples; i++)
       pFFT[i] = In[i];
 
    // Perform the FFT
-   RealFFTf(pFFT.get(), hFFT.get());
+   RealFFTf(pFFT, hFFT.get());
 
    // Copy the data into the real and imaginary outputs
    for (size_t i = 1; i<NumSamples / 2; i++) {
@@ -0,0 +1,108 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   FFTPlanBench.cpp
+
+   Measures GetFFT() called concurrently from many threads, as parallel
+   spectrogram, noise reduction and analysis workers call it, in millions
+   of handles per second over all threads; and PowerSpectrum(), which also
+   finds a plan and a processing buffer on each call, in thousands of
+   transforms per second.
+
+   usage: fft-plan-bench [seconds [threads...]]
+
+**********************************************************************/
+
+#include "FFT.h"
+#include "RealFFTf.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// More sizes than the old pool of ten plans could hold
+constexpr size_t MinLog2 = 4, MaxLog2 = 17;
+
+//! Runs function(iThread, iCall) on each of nThreads threads until the time
+//! is up, and returns calls per second over all threads
+template<typename Function>
+double Rate(unsigned nThreads, double seconds, const Function &function)
+{
+   using Clock = std::chrono::steady_clock;
+   std::atomic<bool> go{ false }, stop{ false };
+   std::atomic<unsigned long long> total{ 0 };
+   std::vector<std::thread> threads;
+   for (unsigned iThread = 0; iThread < nThreads; ++iThread)
+      threads.emplace_back([&, iThread]{
+         while (!go.load(std::memory_order_acquire))
+            std::this_thread::yield();
+         unsigned long long iCall = 0;
+         while (!stop.load(std::memory_order_relaxed))
+            function(iThread, iCall++);
+         total += iCall;
+      });
+
+   const auto start = Clock::now();
+   go.store(true, std::memory_order_release);
+   std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+   stop.store(true);
+   for (auto &thread : threads)
+      thread.join();
+   const std::chrono::duration<double> elapsed = Clock::now() - start;
+   return total / elapsed.count();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+   const double seconds = argc > 1 ? std::strtod(argv[1], nullptr) : 1.0;
+   std::vector<unsigned> threadCounts;
+   for (int ii = 2; ii < argc; ++ii)
+      threadCounts.push_back(std::strtoul(argv[ii], nullptr, 10));
+   if (threadCounts.empty())
+      threadCounts = { 1, 8, 32 };
+
+   // Build every plan first, so that only finding them is measured
+   for (auto log2 = MinLog2; log2 <= MaxLog2; ++log2)
+      GetFFT(size_t(1) << log2);
+
+   std::vector<float> input(1 << 12);
+   for (size_t i = 0; i < input.size(); ++i)
+      input[i] = static_cast<float>(sin(2 * M_PI * 440.0 * i / 44100.0));
+
+   printf("%.1f seconds per measurement, sizes 2^%zu to 2^%zu\n",
+      seconds, MinLog2, MaxLog2);
+   printf("%-8s %16s %20s\n", "threads", "GetFFT M/s", "PowerSpectrum k/s");
+   for (auto nThreads : threadCounts) {
+      std::atomic<size_t> sink{ 0 };
+      const auto getRate = Rate(nThreads, seconds,
+         [&](unsigned iThread, unsigned long long iCall){
+            const auto log2 =
+               MinLog2 + (iThread + iCall) % (MaxLog2 - MinLog2 + 1);
+            const auto hFFT = GetFFT(size_t(1) << log2);
+            if (hFFT->Points == 0)
+               ++sink;
+         });
+
+      const auto spectrumRate = Rate(nThreads, seconds,
+         [&](unsigned iThread, unsigned long long iCall){
+            thread_local std::vector<float> output(input.size() / 2 + 1);
+            // Sizes 2^8 to 2^12
+            const auto size = size_t(256) << ((iThread + iCall) % 5);
+            PowerSpectrum(size, input.data(), output.data());
+         });
+
+      printf("%-8u %16.2f %20.1f\n",
+         nThreads, getRate / 1e6, spectrumRate / 1e3);
+   }
+   return 0;
+}
@@ -0,0 +1,514 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   MixKernels.cpp
+
+   The vector versions need no special compiler options:  on x86 the
+   functions of each level are marked with their target instead, and NEON
+   is always present on 64-bit ARM.  Which level runs is decided once, by
+   asking the processor.
+
+   CMakeLists.txt turns off floating point contraction for this file, or
+   else the scalar loops might be compiled with fused multiply-add on some
+   machines and not others.
+
+**********************************************************************/
+
+#include "MixKernels.h"
+
+#include <atomic>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MIX_KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define MIX_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(MIX_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MIX_KERNELS_TARGET(name) __attribute__((target(name)))
+#else
+#define MIX_KERNELS_TARGET(name)
+#endif
+
+namespace MixKernels {
+
+namespace {
+
+using ApplyEnvelopeFunction =
+   void (*)(float *buffer, const double *envelope, size_t len);
+using MixAddFunction = void (*)(float *dest, size_t stride,
+   const float *src, float gain, size_t len);
+using RampFunction =
+   void (*)(double *buffer, double start, double step, size_t len);
+
+struct Kernels {
+   Level level;
+   ApplyEnvelopeFunction applyEnvelope;
+   MixAddFunction mixAdd;
+   RampFunction linearRamp;
+   RampFunction exponentialRamp;
+};
+
+//! Exponential ramps work in blocks of this many samples
+constexpr size_t RampBlock = 8;
+
+//! powers[j] = ratio^j for j in [0, RampBlock]
+void RampPowers(double ratio, double *powers)
+{
+   powers[0] = 1.0;
+   for (size_t j = 1; j <= RampBlock; ++j)
+      powers[j] = powers[j - 1] * ratio;
+}
+
+void ApplyEnvelopeScalar(float *buffer, const double *envelope, size_t len)
+{
+   for (size_t i = 0; i < len; ++i)
+      buffer[i] *= envelope[i];
+}
+
+void MixAddScalar(float *dest, size_t stride,
+   const float *src, float gain, size_t len)
+{
+   for (size_t i = 0; i < len; ++i) {
+      *dest += src[i] * gain;
+      dest += stride;
+   }
+}
+
+void LinearRampScalar(double *buffer, double start, double step, size_t len)
+{
+   for (size_t i = 0; i < len; ++i)
+      buffer[i] = start + static_cast<double>(i) * step;
+}
+
+//! Finish a ramp, given the product for the block that buffer starts
+void ExponentialRampTail(
+   double *buffer, double product, const double *powers, size_t len)
+{
+   for (size_t i = 0; i < len; ++i) {
+      if (i > 0 && i % RampBlock == 0)
+         product *= powers[RampBlock];
+      buffer[i] = product * powers[i % RampBlock];
+   }
+}
+
+void ExponentialRampScalar(
+   double *buffer, double start, double ratio, size_t len)
+{
+   double powers[RampBlock + 1];
+   RampPowers(ratio, powers);
+   ExponentialRampTail(buffer, start, powers, len);
+}
+
+#ifdef MIX_KERNELS_X86
+
+MIX_KERNELS_TARGET("sse2")
+void ApplyEnvelopeSSE2(float *buffer, const double *envelope, size_t len)
+{
+   size_t i = 0;
+   for (; i + 4 <= len; i += 4) {
+      const auto samples = _mm_loadu_ps(buffer + i);
+      const auto lo = _mm_mul_pd(_mm_cvtps_pd(samples),
+         _mm_loadu_pd(envelope + i));
+      const auto hi = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(samples, samples)),
+         _mm_loadu_pd(envelope + i + 2));
+      _mm_storeu_ps(buffer + i,
+         _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+   }
+   ApplyEnvelopeScalar(buffer + i, envelope + i, len - i);
+}
+
+MIX_KERNELS_TARGET("sse2")
+void MixAddSSE2(float *dest, size_t stride,
+   const float *src, float gain, size_t len)
+{
+   const auto gains = _mm_set1_ps(gain);
+   size_t i = 0;
+   if (stride == 1) {
+      for (; i + 4 <= len; i += 4) {
+         const auto products = _mm_mul_ps(_mm_loadu_ps(src + i), gains);
+         _mm_storeu_ps(dest + i,
+            _mm_add_ps(_mm_loadu_ps(dest + i), products));
+      }
+   }
+   else if (stride == 2) {
+      // Interleaved stereo:  take four frames apart into the channel mixed
+      // into and the other, and put them back together.  The second load
+      // reaches one sample past the last frame, so stop a frame short.
+      for (; i + 4 < len; i += 4) {
+         const auto a = _mm_loadu_ps(dest + 2 * i);
+         const auto b = _mm_loadu_ps(dest + 2 * i + 4);
+         auto mine = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+         const auto others = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+         mine = _mm_add_ps(mine, _mm_mul_ps(_mm_loadu_ps(src + i), gains));
+         _mm_storeu_ps(dest + 2 * i, _mm_unpacklo_ps(mine, others));
+         _mm_storeu_ps(dest + 2 * i + 4, _mm_unpackhi_ps(mine, others));
+      }
+   }
+   MixAddScalar(dest + i * stride, stride, src + i, gain, len - i);
+}
+
+MIX_KERNELS_TARGET("sse2")
+void LinearRampSSE2(double *buffer, double start, double step, size_t len)
+{
+   const auto starts = _mm_set1_pd(start);
+   const auto steps = _mm_set1_pd(step);
+   const auto two = _mm_set1_pd(2.0);
+   // Small integers are exact in double, so counting in a vector matches
+   // the conversions of the scalar loop
+   auto indices = _mm_set_pd(1.0, 0.0);
+   size_t i = 0;
+   for (; i + 2 <= len; i += 2) {
+      _mm_storeu_pd(buffer + i,
+         _mm_add_pd(starts, _mm_mul_pd(indices, steps)));
+      indices = _mm_add_pd(indices, two);
+   }
+   for (; i < len; ++i)
+      buffer[i] = start + static_cast<double>(i) * step;
+}
+
+MIX_KERNELS_TARGET("sse2")
+void ExponentialRampSSE2(
+   double *buffer, double start, double ratio, size_t len)
+{
+   double powers[RampBlock + 1];
+   RampPowers(ratio, powers);
+   const auto p01 = _mm_loadu_pd(powers);
+   const auto p23 = _mm_loadu_pd(powers + 2);
+   const auto p45 = _mm_loadu_pd(powers + 4);
+   const auto p67 = _mm_loadu_pd(powers + 6);
+   double product = start;
+   size_t i = 0;
+   for (; i + RampBlock <= len; i += RampBlock) {
+      if (i > 0)
+         product *= powers[RampBlock];
+      const auto products = _mm_set1_pd(product);
+      _mm_storeu_pd(buffer + i, _mm_mul_pd(products, p01));
+      _mm_storeu_pd(buffer + i + 2, _mm_mul_pd(products, p23));
+      _mm_storeu_pd(buffer + i + 4, _mm_mul_pd(products, p45));
+      _mm_storeu_pd(buffer + i + 6, _mm_mul_pd(products, p67));
+   }
+   if (i > 0 && i < len)
+      product *= powers[RampBlock];
+   ExponentialRampTail(buffer + i, product, powers, len - i);
+}
+
+MIX_KERNELS_TARGET("avx2")
+void ApplyEnvelopeAVX2(float *buffer, const double *envelope, size_t len)
+{
+   size_t i = 0;
+   for (; i + 8 <= len; i += 8) {
+      const auto lo = _mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(buffer + i)),
+         _mm256_loadu_pd(envelope + i));
+      const auto hi = _mm256_mul_pd(
+         _mm256_cvtps_pd(_mm_loadu_ps(buffer + i + 4)),
+         _mm256_loadu_pd(envelope + i + 4));
+      _mm_storeu_ps(buffer + i, _mm256_cvtpd_ps(lo));
+      _mm_storeu_ps(buffer + i + 4, _mm256_cvtpd_ps(hi));
+   }
+   ApplyEnvelopeSSE2(buffer + i, envelope + i, len - i);
+}
+
+MIX_KERNELS_TARGET("avx2")
+void MixAddAVX2(float *dest, size_t stride,
+   const float *src, float gain, size_t len)
+{
+   size_t i = 0;
+   if (stride == 1) {
+      const auto gains = _mm256_set1_ps(gain);
+      for (; i + 8 <= len; i += 8) {
+         const auto products = _mm256_mul_ps(_mm256_loadu_ps(src + i), gains);
+         _mm256_storeu_ps(dest + i,
+            _mm256_add_ps(_mm256_loadu_ps(dest + i), products));
+      }
+   }
+   MixAddSSE2(dest + i * stride, stride, src + i, gain, len - i);
+}
+
+MIX_KERNELS_TARGET("avx2")
+void LinearRampAVX2(double *buffer, double start, double step, size_t len)
+{
+   const auto starts = _mm256_set1_pd(start);
+   const auto steps = _mm256_set1_pd(step);
+   const auto four = _mm256_set1_pd(4.0);
+   auto indices = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+   size_t i = 0;
+   for (; i + 4 <= len; i += 4) {
+      _mm256_storeu_pd(buffer + i,
+         _mm256_add_pd(starts, _mm256_mul_pd(indices, steps)));
+      indices = _mm256_add_pd(indices, four);
+   }
+   for (; i < len; ++i)
+      buffer[i] = start + static_cast<double>(i) * step;
+}
+
+MIX_KERNELS_TARGET("avx2")
+void ExponentialRampAVX2(
+   double *buffer, double start, double ratio, size_t len)
+{
+   double powers[RampBlock + 1];
+   RampPowers(ratio, powers);
+   const auto p0123 = _mm256_loadu_pd(powers);
+   const auto p4567 = _mm256_loadu_pd(powers + 4);
+   double product = start;
+   size_t i = 0;
+   for (; i + RampBlock <= len; i += RampBlock) {
+      if (i > 0)
+         product *= powers[RampBlock];
+      const auto products = _mm256_set1_pd(product);
+      _mm256_storeu_pd(buffer + i, _mm256_mul_pd(products, p0123));
+      _mm256_storeu_pd(buffer + i + 4, _mm256_mul_pd(products, p4567));
+   }
+   if (i > 0 && i < len)
+      product *= powers[RampBlock];
+   ExponentialRampTail(buffer + i, product, powers, len - i);
+}
+
+bool HasSSE2()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+   return true;
+#elif defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 1);
+   return (info[3] >> 26) & 1;
+#else
+   return __builtin_cpu_supports("sse2");
+#endif
+}
+
+bool HasAVX2()
+{
+#ifdef _MSC_VER
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7)
+      return false;
+   __cpuid(info, 1);
+   // The operating system must save the ymm registers too
+   const bool osxsave = (info[2] >> 27) & 1;
+   const bool avx = (info[2] >> 28) & 1;
+   if (!(osxsave && avx) || (_xgetbv(0) & 6) != 6)
+      return false;
+   __cpuidex(info, 7, 0);
+   return (info[1] >> 5) & 1;
+#else
+   return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+#ifdef MIX_KERNELS_NEON
+
+void ApplyEnvelopeNEON(float *buffer, const double *envelope, size_t len)
+{
+   size_t i = 0;
+   for (; i + 4 <= len; i += 4) {
+      const auto samples = vld1q_f32(buffer + i);
+      const auto lo = vmulq_f64(vcvt_f64_f32(vget_low_f32(samples)),
+         vld1q_f64(envelope + i));
+      const auto hi = vmulq_f64(vcvt_high_f64_f32(samples),
+         vld1q_f64(envelope + i + 2));
+      vst1q_f32(buffer + i, vcvt_high_f32_f64(vcvt_f32_f64(lo), hi));
+   }
+   ApplyEnvelopeScalar(buffer + i, envelope + i, len - i);
+}
+
+void MixAddNEON(float *dest, size_t stride,
+   const float *src, float gain, size_t len)
+{
+   const auto gains = vdupq_n_f32(gain);
+   size_t i = 0;
+   // vmulq and vaddq, not vfmaq, which would round only once
+   if (stride == 1) {
+      for (; i + 4 <= len; i += 4) {
+         const auto products = vmulq_f32(vld1q_f32(src + i), gains);
+         vst1q_f32(dest + i, vaddq_f32(vld1q_f32(dest + i), products));
+      }
+   }
+   else if (stride == 2) {
+      // As for SSE2, stop a frame short of reaching past the last
+      for (; i + 4 < len; i += 4) {
+         auto frames = vld2q_f32(dest + 2 * i);
+         frames.val[0] = vaddq_f32(frames.val[0],
+            vmulq_f32(vld1q_f32(src + i), gains));
+         vst2q_f32(dest + 2 * i, frames);
+      }
+   }
+   MixAddScalar(dest + i * stride, stride, src + i, gain, len - i);
+}
+
+void LinearRampNEON(double *buffer, double start, double step, size_t len)
+{
+   const auto starts = vdupq_n_f64(start);
+   const auto steps = vdupq_n_f64(step);
+   const auto two = vdupq_n_f64(2.0);
+   const double first[] = { 0.0, 1.0 };
+   auto indices = vld1q_f64(first);
+   size_t i = 0;
+   for (; i + 2 <= len; i += 2) {
+      vst1q_f64(buffer + i, vaddq_f64(starts, vmulq_f64(indices, steps)));
+      indices = vaddq_f64(indices, two);
+   }
+   for (; i < len; ++i)
+      buffer[i] = start + static_cast<double>(i) * step;
+}
+
+void ExponentialRampNEON(
+   double *buffer, double start, double ratio, size_t len)
+{
+   double powers[RampBlock + 1];
+   RampPowers(ratio, powers);
+   const float64x2_t p[] = { vld1q_f64(powers), vld1q_f64(powers + 2),
+      vld1q_f64(powers + 4), vld1q_f64(powers + 6) };
+   double product = start;
+   size_t i = 0;
+   for (; i + RampBlock <= len; i += RampBlock) {
+      if (i > 0)
+         product *= powers[RampBlock];
+      const auto products = vdupq_n_f64(product);
+      for (size_t j = 0; j < 4; ++j)
+         vst1q_f64(buffer + i + 2 * j, vmulq_f64(products, p[j]));
+   }
+   if (i > 0 && i < len)
+      product *= powers[RampBlock];
+   ExponentialRampTail(buffer + i, product, powers, len - i);
+}
+
+#endif
+
+const Kernels &KernelsOf(Level level)
+{
+   static const Kernels scalar{
+      Level::Scalar, ApplyEnvelopeScalar, MixAddScalar,
+      LinearRampScalar, ExponentialRampScalar };
+   switch (level) {
+#ifdef MIX_KERNELS_X86
+   case Level::SSE2: {
+      static const Kernels sse2{
+         Level::SSE2, ApplyEnvelopeSSE2, MixAddSSE2,
+         LinearRampSSE2, ExponentialRampSSE2 };
+      return sse2;
+   }
+   case Level::AVX2: {
+      static const Kernels avx2{
+         Level::AVX2, ApplyEnvelopeAVX2, MixAddAVX2,
+         LinearRampAVX2, ExponentialRampAVX2 };
+      return avx2;
+   }
+#endif
+#ifdef MIX_KERNELS_NEON
+   case Level::NEON: {
+      static const Kernels neon{
+         Level::NEON, ApplyEnvelopeNEON, MixAddNEON,
+         LinearRampNEON, ExponentialRampNEON };
+      return neon;
+   }
+#endif
+   default:
+      return scalar;
+   }
+}
+
+std::atomic<const Kernels *> &Current()
+{
+   static std::atomic<const Kernels *> current{ &KernelsOf(BestLevel()) };
+   return current;
+}
+
+}
+
+const char *LevelName(Level level)
+{
+   switch (level) {
+   case Level::SSE2:
+      return "SSE2";
+   case Level::AVX2:
+      return "AVX2";
+   case Level::NEON:
+      return "NEON";
+   case Level::Scalar:
+   default:
+      return "scalar";
+   }
+}
+
+bool IsSupported(Level level)
+{
+   switch (level) {
+   case Level::Scalar:
+      return true;
+#ifdef MIX_KERNELS_X86
+   case Level::SSE2:
+      return HasSSE2();
+   case Level::AVX2:
+      return HasSSE2() && HasAVX2();
+#endif
+#ifdef MIX_KERNELS_NEON
+   case Level::NEON:
+      return true;
+#endif
+   default:
+      return false;
+   }
+}
+
+Level BestLevel()
+{
+   static const Level best = []{
+      for (auto level : { Level::AVX2, Level::SSE2, Level::NEON })
+         if (IsSupported(level))
+            return level;
+      return Level::Scalar;
+   }();
+   return best;
+}
+
+Level GetLevel()
+{
+   return Current().load(std::memory_order_relaxed)->level;
+}
+
+bool SetLevel(Level level)
+{
+   if (!IsSupported(level))
+      return false;
+   Current().store(&KernelsOf(level), std::memory_order_relaxed);
+   return true;
+}
+
+void ApplyEnvelope(float *buffer, const double *envelope, size_t len)
+{
+   Current().load(std::memory_order_relaxed)->applyEnvelope(
+      buffer, envelope, len);
+}
+
+void MixAdd(float *dest, size_t stride,
+   const float *src, float gain, size_t len)
+{
+   Current().load(std::memory_order_relaxed)->mixAdd(
+      dest, stride, src, gain, len);
+}
+
+void LinearRamp(double *buffer, double start, double step, size_t len)
+{
+   Current().load(std::memory_order_relaxed)->linearRamp(
+      buffer, start, step, len);
+}
+
+void ExponentialRamp(double *buffer, double start, double ratio, size_t len)
+{
+   Current().load(std::memory_order_relaxed)->exponentialRamp(
+      buffer, start, ratio, len);
+}
+
+}
@@ -0,0 +1,73 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   MixKernels.h
+
+   Inner loops of mixing: envelope evaluation and application, and gain and
+   accumulate, with SSE2, AVX2 and NEON versions chosen at run time.
+
+**********************************************************************/
+
+#ifndef __AUDACITY_MIX_KERNELS__
+#define __AUDACITY_MIX_KERNELS__
+
+#include <cstddef>
+
+/*!
+ Every version gives results identical to the bit to those of the scalar
+ loops:  each product is rounded before it is added, never fused, and
+ envelope values multiply in double precision before rounding to float.
+ So mixes do not change with the machine they are made on.
+ */
+namespace MixKernels {
+
+//! Instruction sets that kernels are written for
+enum class Level : unsigned {
+   Scalar,
+   SSE2,
+   AVX2,
+   NEON,
+};
+
+MATH_API const char *LevelName(Level level);
+
+//! Whether this build and this processor can use the level
+MATH_API bool IsSupported(Level level);
+
+//! The best supported level, chosen on first use of the kernels
+MATH_API Level BestLevel();
+
+MATH_API Level GetLevel();
+
+//! Use a lower level, for comparisons in tests and benchmarks
+/*! @return false, and no change, if the level is not supported */
+MATH_API bool SetLevel(Level level);
+
+//! buffer[i] *= envelope[i], for i in [0, len)
+MATH_API void ApplyEnvelope(float *buffer, const double *envelope, size_t len);
+
+//! dest[i * stride] += src[i] * gain, for i in [0, len)
+/*!
+ When stride is more than 1, the samples of dest between those written may be
+ read and stored again unchanged, so no other thread may write them meanwhile
+ */
+MATH_API void MixAdd(float *dest, size_t stride,
+   const float *src, float gain, size_t len);
+
+//! buffer[i] = start + i * step, for i in [0, len)
+MATH_API void LinearRamp(double *buffer, double start, double step, size_t len);
+
+//! buffer[i] = start * ratio^i, for i in [0, len)
+/*!
+ The powers are products of ratio^(i % 8), computed once, and of a running
+ product multiplied by ratio^8 every eight samples, so rounding errors
+ accumulate eight times more slowly than in a running product per sample
+ */
+MATH_API void ExponentialRamp(
+   double *buffer, double start, double ratio, size_t len);
+
+}
+
+#endif
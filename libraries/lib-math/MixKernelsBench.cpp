@@ -0,0 +1,88 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   MixKernelsBench.cpp
+
+   Measures the kernels of MixKernels in millions of samples per second,
+   at each level that the processor supports:  envelope application, and
+   gain and accumulate into a mono buffer and into one channel of an
+   interleaved stereo buffer, as Mixer does for playback and export.
+
+   usage: mix-kernels-bench [passes [blockSize]]
+
+**********************************************************************/
+
+#include "MixKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <vector>
+
+namespace {
+
+using namespace MixKernels;
+
+template<typename Function>
+double Rate(size_t passes, size_t blockSize, const Function &function)
+{
+   using Clock = std::chrono::steady_clock;
+   const auto start = Clock::now();
+   for (size_t pass = 0; pass < passes; ++pass)
+      function();
+   const std::chrono::duration<double> elapsed = Clock::now() - start;
+   return passes * blockSize / elapsed.count() / 1e6;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+   const size_t passes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+   const size_t blockSize = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4096;
+
+   std::vector<float> source(blockSize), buffer(blockSize),
+      mono(blockSize), stereo(2 * blockSize);
+   std::vector<double> envelope(blockSize);
+   for (size_t i = 0; i < blockSize; ++i) {
+      source[i] = static_cast<float>(sin(2 * M_PI * 440.0 * i / 44100.0));
+      envelope[i] = 1.0 - 0.5 * i / blockSize;
+   }
+
+   printf("%zu passes of %zu samples; best level is %s\n",
+      passes, blockSize, LevelName(BestLevel()));
+   printf("%-8s %14s %14s %14s\n",
+      "level", "envelope", "mix mono", "mix stereo");
+
+   for (auto level : { Level::Scalar, Level::SSE2, Level::AVX2, Level::NEON }) {
+      if (!SetLevel(level))
+         continue;
+
+      // Refill the buffer each pass, so that values neither vanish nor
+      // overflow, and subtract the cost of that
+      const auto copy = Rate(passes, blockSize, [&]{
+         std::copy(source.begin(), source.end(), buffer.begin());
+      });
+      const auto envelopeRate = Rate(passes, blockSize, [&]{
+         std::copy(source.begin(), source.end(), buffer.begin());
+         ApplyEnvelope(buffer.data(), envelope.data(), blockSize);
+      });
+      const auto monoRate = Rate(passes, blockSize, [&]{
+         MixAdd(mono.data(), 1, source.data(), 1e-9f, blockSize);
+      });
+      const auto stereoRate = Rate(passes, blockSize, [&]{
+         MixAdd(stereo.data() + 1, 2, source.data(), 1e-9f, blockSize);
+      });
+
+      printf("%-8s %14.1f %14.1f %14.1f\n", LevelName(level),
+         1 / (1 / envelopeRate - 1 / copy), monoRate, stereoRate);
+   }
+
+   SetLevel(BestLevel());
+   return 0;
+}
@@ -0,0 +1,110 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   OverlapAddFilter.cpp
+
+**********************************************************************/
+
+#include "OverlapAddFilter.h"
+
+#include <algorithm>
+
+#include "BatchedFFT.h"
+#include "WorkStealingPool.h"
+
+OverlapAddFilter::OverlapAddFilter(size_t windowSize, size_t filterLength,
+   const float *filterR, const float *filterI, WorkStealingPool *pPool,
+   unsigned maxWorkers)
+   : mWindowSize{ windowSize }
+   , mFilterLength{ filterLength }
+   , mLump{ windowSize - (filterLength - 1) }
+   , mFilterR{ filterR }
+   , mFilterI{ filterI }
+   , mpPool{ pPool }
+   , mMaxWorkers{ maxWorkers }
+   , mFFT{ GetFFT(windowSize) }
+   , mScratch(!pPool ? 1
+      : maxWorkers > 0 ? std::min(maxWorkers, pPool->GetConcurrency())
+      : pPool->GetConcurrency())
+   , mLast(windowSize, 0.0f)
+   , mBeforeLast(windowSize, 0.0f)
+{
+}
+
+OverlapAddFilter::~OverlapAddFilter() = default;
+
+void OverlapAddFilter::Process(float *buffer, size_t block)
+{
+   if (block == 0)
+      return;
+
+   // Cut the block into lumps, each padded with zeroes to a window
+   const auto nWindows = (block + mLump - 1) / mLump;
+   mWindows.resize(nWindows * mWindowSize);
+   std::vector<float *> windows(nWindows);
+   for (size_t iWindow = 0; iWindow < nWindows; ++iWindow) {
+      const auto start = iWindow * mLump;
+      const auto count = std::min(mLump, block - start);
+      const auto window = windows[iWindow] = &mWindows[iWindow * mWindowSize];
+      std::copy(buffer + start, buffer + start + count, window);
+      std::fill(window + count, window + mWindowSize, 0.0f);
+   }
+
+   // Filter batches of as many windows as the processor does at once
+   const auto lanes = BatchedFFT::Lanes();
+   const auto nBatches = (nWindows + lanes - 1) / lanes;
+   const auto filter = [&](size_t iBatch, unsigned iWorker){
+      auto &scratch = mScratch[iWorker];
+      if (scratch.empty())
+         scratch.resize(BatchedFFT::ScratchSize(mWindowSize));
+      const auto first = iBatch * lanes;
+      BatchedFFT::Filter(*mFFT, mFilterR, mFilterI,
+         windows.data() + first, std::min(lanes, nWindows - first),
+         scratch.data());
+   };
+   if (mpPool && nBatches > 1)
+      mpPool->ForEach(nBatches, filter, mMaxWorkers);
+   else
+      for (size_t iBatch = 0; iBatch < nBatches; ++iBatch)
+         filter(iBatch, 0);
+
+   // Overlap - Add, in order
+   const auto overlap = mFilterLength - 1;
+   size_t count = 0;
+   for (size_t iWindow = 0; iWindow < nWindows; ++iWindow) {
+      const auto start = iWindow * mLump;
+      count = std::min(mLump, block - start);
+      const auto thisWindow = windows[iWindow];
+      const auto lastWindow =
+         iWindow == 0 ? mLast.data() : windows[iWindow - 1];
+      for (size_t j = 0; j < overlap && j < count; ++j)
+         buffer[start + j] = thisWindow[j] + lastWindow[mLump + j];
+      for (auto j = overlap; j < count; ++j)
+         buffer[start + j] = thisWindow[j];
+   }
+
+   // Keep the last two windows for the next block and the tail
+   if (nWindows > 1)
+      std::copy(windows[nWindows - 2], windows[nWindows - 2] + mWindowSize,
+         mBeforeLast.begin());
+   else
+      mBeforeLast.swap(mLast);
+   std::copy(windows[nWindows - 1], windows[nWindows - 1] + mWindowSize,
+      mLast.begin());
+   mLastCount = count;
+}
+
+void OverlapAddFilter::Flush(float *buffer)
+{
+   const auto overlap = mFilterLength - 1;
+   size_t j = 0;
+   // A short last lump leaves some overlap of the window before it
+   if (mLastCount < overlap)
+      for (; j < overlap - mLastCount; ++j)
+         buffer[j] = mLast[mLastCount + j]
+            + mBeforeLast[mLump + mLastCount + j];
+   for (; j < overlap; ++j)
+      buffer[j] = mLast[mLastCount + j];
+}
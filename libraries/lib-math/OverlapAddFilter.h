@@ -0,0 +1,80 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   OverlapAddFilter.h
+
+   Fast convolution of a long signal with a finite impulse response, block
+   by block, filtering the windows of each block in batches and in
+   parallel.
+
+**********************************************************************/
+
+#ifndef __AUDACITY_OVERLAP_ADD_FILTER__
+#define __AUDACITY_OVERLAP_ADD_FILTER__
+
+#include <cstddef>
+#include <vector>
+
+#include "RealFFTf.h"
+
+class WorkStealingPool;
+
+//! Gives the samples that the loop of EffectEqualization::ProcessOne gave,
+//! identical to the bit, but computes its windows concurrently
+/*!
+ Each block is cut into lumps of windowSize - (filterLength - 1) samples,
+ each lump padded to a window and filtered by BatchedFFT, and then the tail
+ of each window is added to the start of the next, in order.  The lumps of
+ one block are independent, so the more samples a block holds, the more
+ windows can be filtered at once.
+ */
+class MATH_API OverlapAddFilter final
+{
+public:
+   /*!
+    @param windowSize a power of two
+    @param filterLength length of the impulse response, less than windowSize
+    @param filterR, filterI frequency response of windowSize / 2 + 1 bins,
+    which must outlive this
+    @param pPool if not null, workers to filter batches of windows; only
+    this may use it while Process() runs
+    @param maxWorkers if not 0, uses no more workers of pPool than this
+    */
+   OverlapAddFilter(size_t windowSize, size_t filterLength,
+      const float *filterR, const float *filterI, WorkStealingPool *pPool,
+      unsigned maxWorkers = 0);
+   ~OverlapAddFilter();
+
+   //! Replaces the block samples of buffer with the filtered signal,
+   //! continuing from previous blocks
+   void Process(float *buffer, size_t block);
+
+   //! Writes the filterLength - 1 samples of the tail of the filtered
+   //! signal, after the last block
+   void Flush(float *buffer);
+
+private:
+   const size_t mWindowSize;
+   const size_t mFilterLength;
+   //! Samples of input per window
+   const size_t mLump;
+   const float *const mFilterR;
+   const float *const mFilterI;
+   WorkStealingPool *const mpPool;
+   const unsigned mMaxWorkers;
+   const HFFT mFFT;
+
+   //! Windows of the current block, contiguous
+   std::vector<float> mWindows;
+   //! Per worker
+   std::vector<std::vector<float>> mScratch;
+
+   //! The last filtered window, and the one before it
+   std::vector<float> mLast, mBeforeLast;
+   //! Input samples in the last lump
+   size_t mLastCount{ 0 };
+};
+
+#endif
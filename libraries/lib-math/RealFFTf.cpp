@@ -38,13 +38,12 @@
 
 #include "RealFFTf.h"
 
+#include <atomic>
 #include <vector>
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
 
-#include <wx/thread.h>
-
 #ifndef M_PI
 #define	M_PI		3.14159265358979323846  /* pi */
 #endif
@@ -53,10 +52,10 @@
 *  Initialize the Sine table and Twiddle pointers (bit-reversed pointers)
 *  for the FFT routine.
 */
-HFFT InitializeFFT(size_t fftlen)
+static std::unique_ptr<FFTParam> InitializeFFT(size_t fftlen)
 {
    int temp;
-   HFFT h{ safenew FFTParam };
+   auto h = std::make_unique<FFTParam>();
 
    /*
    *  FFT size is only half the number of data points
@@ -84,60 +83,56 @@ HFFT InitializeFFT(size_t fftlen)
       h->SinTable[h->BitReversed[i]+1]=(fft_type)-cos(2*M_PI*i/(2*h->Points));
    }
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   // NEW SSE FFT routines work on live data
-   for(size_t i = 0; i < 32; i++)
-      if((1 << i) & fftlen)
-         h->pow2Bits = i;
-#endif
-
    return h;
 }
 
-enum : size_t { MAX_HFFT = 10 };
+namespace {
+// One plan for each power of two, built on first demand and never freed, so
+// that finding one is a single atomic load and needs no lock.  Handles may
+// outlive static destruction, so the plans are deliberately leaked at exit.
+constexpr size_t MaxLog2 = 8 * sizeof(size_t);
+std::atomic<const FFTParam*> sPlans[MaxLog2]{};
 
-// Maintain a pool:
-static std::vector< std::unique_ptr<FFTParam> > hFFTArray(MAX_HFFT);
-wxCriticalSection getFFTMutex;
+// Index into sPlans of a power of two, or MaxLog2 for other lengths
+size_t PlanIndex(size_t fftlen)
+{
+   if (fftlen < 2 || (fftlen & (fftlen - 1)) != 0)
+      return MaxLog2;
+   size_t index = 0;
+   while (fftlen >>= 1)
+      ++index;
+   return index;
+}
+}
 
 /* Get a handle to the FFT tables of the desired length */
 /* This version keeps common tables rather than allocating a NEW table every time */
 HFFT GetFFT(size_t fftlen)
 {
-   // To do:  smarter policy about when to retain in the pool and when to
-   // allocate a unique instance.
-
-   wxCriticalSectionLocker locker{ getFFTMutex };
-   
-   size_t h = 0;
-   auto n = fftlen/2;
-   auto size = hFFTArray.size();
-   for(;
-       (h < size) && hFFTArray[h] && (n != hFFTArray[h]->Points);
-       h++)
-      ;
-   if(h < size) {
-      if(hFFTArray[h] == NULL) {
-         hFFTArray[h].reset( InitializeFFT(fftlen).release() );
-      }
-      return HFFT{ hFFTArray[h].get() };
-   } else {
-      // All buffers used, so fall back to allocating a NEW set of tables
-      return InitializeFFT(fftlen);
+   const auto index = PlanIndex(fftlen);
+   if (index == MaxLog2)
+      // The tables are good only for powers of two; don't share these
+      return HFFT{ InitializeFFT(fftlen).release() };
+
+   auto &slot = sPlans[index];
+   auto plan = slot.load(std::memory_order_acquire);
+   if (!plan) {
+      // Threads may race to build the same plan; the first to finish wins
+      auto built = InitializeFFT(fftlen);
+      if (slot.compare_exchange_strong(plan, built.get(),
+         std::memory_order_acq_rel, std::memory_order_acquire))
+         plan = built.release();
    }
+   return HFFT{ plan };
 }
 
 /* Release a previously requested handle to the FFT tables */
-void FFTDeleter::operator() (FFTParam *hFFT) const
+void FFTDeleter::operator() (const FFTParam *hFFT) const
 {
-   wxCriticalSectionLocker locker{ getFFTMutex };
-
-   auto it = hFFTArray.begin(), end = hFFTArray.end();
-   while (it != end && it->get() != hFFT)
-      ++it;
-   if ( it != end )
-      ;
-   else
+   // Shared plans outlive their handles
+   const auto index = PlanIndex(2 * hFFT->Points);
+   if (index == MaxLog2 ||
+       sPlans[index].load(std::memory_order_acquire) != hFFT)
       delete hFFT;
 }
 
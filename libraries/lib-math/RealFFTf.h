@@ -8,19 +8,18 @@ struct FFTParam {
    ArrayOf<int> BitReversed;
    ArrayOf<fft_type> SinTable;
    size_t Points;
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   int pow2Bits;
-#endif
 };
 
 struct MATH_API FFTDeleter{
-   void operator () (FFTParam *p) const;
+   void operator () (const FFTParam *p) const;
 };
 
+//! Handle to tables that may be shared among threads, and so are read-only
 using HFFT = std::unique_ptr<
-   FFTParam, FFTDeleter
+   const FFTParam, FFTDeleter
 >;
 
+//! Lock-free after the first request of each power of two; thread-safe
 MATH_API HFFT GetFFT(size_t);
 MATH_API void RealFFTf(fft_type *, const FFTParam *);
 MATH_API void InverseRealFFTf(fft_type *, const FFTParam *);
@@ -16,34 +16,212 @@
 
       libsoxr, written by Rob Sykes. LGPL.
 
-   Since Audacity always does resampling on mono streams that are
-   contiguous in memory, this class doesn't support multiple channels
+   Audacity resamples mono streams that are contiguous in memory, or
+   several such streams in lock step (the channels of one track), using
+   libsoxr's split I/O.  This class doesn't support interleaved channels
    or some of the other optional features of some of these resamplers.
 
+   libsoxr may run natively, or in an rlbox sandbox (see
+   sandbox/ResampleSandboxed.h); the audacity_resample_sandbox option
+   chooses the default when configuring.
+
 *//*******************************************************************/
 
 #include "Resample.h"
+#include "ResampleEngine.h"
 #include "Prefs.h"
 #include "Internat.h"
 #include "ComponentInterface.h"
 
+#include <algorithm>
+#include <atomic>
+
 #include <soxr.h>
 
-Resample::Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor)
+ResampleEngine::~ResampleEngine() = default;
+
+namespace {
+
+struct soxr_deleter {
+   void operator () (soxr *p) const { if (p) soxr_delete(p); }
+};
+using soxrHandle = std::unique_ptr<soxr, soxr_deleter>;
+
+//! Runs libsoxr in process
+class NativeResampleEngine final : public ResampleEngine
+{
+public:
+   explicit NativeResampleEngine(const ResampleEngineSpec &spec);
+
+   std::pair<size_t, size_t>
+      Process(double factor,
+              float *const *inBuffers, size_t inBufferLen, bool lastFlag,
+              float *const *outBuffers, size_t outBufferLen) override;
+
+   float *GetInputBuffer(size_t len, unsigned iChannel) override;
+   float *GetOutputBuffer(size_t len, unsigned iChannel) override;
+
+   void Reset() override;
+
+private:
+   soxrHandle mHandle; // constant-rate or variable-rate resampler (XOR per instance)
+   std::vector<Floats> mInBuffers, mOutBuffers; // one of each per channel
+   size_t mInBufferLen{ 0 }, mOutBufferLen{ 0 };
+   const unsigned mNumChannels;
+   const bool mbWantConstRateResampling;
+};
+
+NativeResampleEngine::NativeResampleEngine(const ResampleEngineSpec &spec)
+   : mInBuffers(spec.numChannels)
+   , mOutBuffers(spec.numChannels)
+   , mNumChannels{ spec.numChannels }
+   , mbWantConstRateResampling{ spec.ConstRate() }
 {
-   this->SetMethod(useBestMethod);
    soxr_quality_spec_t q_spec;
-   if (dMinFactor == dMaxFactor)
-   {
-      mbWantConstRateResampling = true; // constant rate resampling
-      q_spec = soxr_quality_spec("\0\1\4\6"[mMethod], 0);
-   }
+   if (mbWantConstRateResampling)
+      // constant rate resampling
+      q_spec = soxr_quality_spec("\0\1\4\6"[spec.method], 0);
    else
-   {
-      mbWantConstRateResampling = false; // variable rate resampling
+      // variable rate resampling
       q_spec = soxr_quality_spec(SOXR_HQ, SOXR_VR);
+   if (mNumChannels > 1) {
+      // One buffer per channel, rather than interleaved
+      const auto io_spec = soxr_io_spec(SOXR_FLOAT32_S, SOXR_FLOAT32_S);
+      mHandle.reset(soxr_create(1, spec.dMinFactor, mNumChannels, 0, &io_spec, &q_spec, 0));
+   }
+   else
+      mHandle.reset(soxr_create(1, spec.dMinFactor, 1, 0, 0, &q_spec, 0));
+}
+
+std::pair<size_t, size_t>
+      NativeResampleEngine::Process(double  factor,
+                                    float  *const *inBuffers,
+                                    size_t  inBufferLen,
+                                    bool    lastFlag,
+                                    float  *const *outBuffers,
+                                    size_t  outBufferLen)
+{
+   size_t idone, odone;
+   if (!mbWantConstRateResampling)
+      soxr_set_io_ratio(mHandle.get(), 1/factor, 0);
+
+   inBufferLen = lastFlag? ~inBufferLen : inBufferLen;
+   if (mNumChannels > 1)
+      // soxr_out_t is a plain void *, even for split output
+      soxr_process(mHandle.get(),
+            inBuffers , inBufferLen , &idone,
+            const_cast<float **>(outBuffers), outBufferLen, &odone);
+   else
+      soxr_process(mHandle.get(),
+            inBuffers[0] , inBufferLen , &idone,
+            outBuffers[0], outBufferLen, &odone);
+   return { idone, odone };
+}
+
+float *NativeResampleEngine::GetInputBuffer(size_t len, unsigned iChannel)
+{
+   if (len > mInBufferLen) {
+      mInBufferLen = len;
+      for (auto &buffer : mInBuffers)
+         buffer.reinit(mInBufferLen);
+   }
+   return mInBuffers[iChannel].get();
+}
+
+float *NativeResampleEngine::GetOutputBuffer(size_t len, unsigned iChannel)
+{
+   if (len > mOutBufferLen) {
+      mOutBufferLen = len;
+      for (auto &buffer : mOutBuffers)
+         buffer.reinit(mOutBufferLen);
+   }
+   return mOutBuffers[iChannel].get();
+}
+
+void NativeResampleEngine::Reset()
+{
+   // With the quality specs used here, soxr_clear restores the ratio given
+   // to soxr_create, so the state is exactly as when created
+   soxr_clear(mHandle.get());
+}
+
+}
+
+std::unique_ptr<ResampleEngine>
+MakeNativeResampleEngine(const ResampleEngineSpec &spec)
+{
+   return std::make_unique<NativeResampleEngine>(spec);
+}
+
+bool Resample::HasBackend(Backend backend)
+{
+   switch (backend) {
+   case Backend::Native:
+      return true;
+#ifdef AUDACITY_RESAMPLE_SANDBOXES
+   case Backend::Noop:
+   case Backend::Wasm2c:
+      return true;
+#endif
+   default:
+      return false;
+   }
+}
+
+auto Resample::DefaultBackend() -> Backend
+{
+#if defined(AUDACITY_RESAMPLE_BACKEND_WASM2C)
+   return Backend::Wasm2c;
+#elif defined(AUDACITY_RESAMPLE_BACKEND_NOOP)
+   return Backend::Noop;
+#else
+   return Backend::Native;
+#endif
+}
+
+namespace {
+std::atomic<bool> sSandboxFullVerify{ false };
+}
+
+void Resample::SetSandboxFullVerify(bool verify)
+{
+   sSandboxFullVerify.store(verify, std::memory_order_relaxed);
+}
+
+bool Resample::GetSandboxFullVerify()
+{
+   return sSandboxFullVerify.load(std::memory_order_relaxed);
+}
+
+Resample::Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor,
+                   unsigned numChannels)
+   : Resample{ DefaultBackend(), useBestMethod, dMinFactor, dMaxFactor, numChannels }
+{
+}
+
+Resample::Resample(Backend backend,
+                   const bool useBestMethod, const double dMinFactor, const double dMaxFactor,
+                   unsigned numChannels)
+   : mNumChannels{ std::max(1u, numChannels) }
+   , mBackend{ backend }
+{
+   this->SetMethod(useBestMethod);
+   const ResampleEngineSpec spec{
+      mMethod, dMinFactor, dMaxFactor, mNumChannels, GetSandboxFullVerify() };
+   switch (backend) {
+#ifdef AUDACITY_RESAMPLE_SANDBOXES
+   case Backend::Noop:
+      mpEngine = MakeNoopResampleEngine(spec);
+      break;
+   case Backend::Wasm2c:
+      mpEngine = MakeWasm2cResampleEngine(spec);
+      break;
+#endif
+   default:
+      mBackend = Backend::Native;
+      mpEngine = MakeNativeResampleEngine(spec);
+      break;
    }
-   mHandle.reset(soxr_create(1, dMinFactor, 1, 0, 0, &q_spec, 0));
 }
 
 Resample::~Resample()
@@ -92,23 +270,35 @@ std::pair<size_t, size_t>
                         float  *outBuffer,
                         size_t  outBufferLen)
 {
-   size_t idone, odone;
-   if (mbWantConstRateResampling)
-   {
-      soxr_process(mHandle.get(),
-            inBuffer , (lastFlag? ~inBufferLen : inBufferLen), &idone,
-            outBuffer,                           outBufferLen, &odone);
-   }
-   else
-   {
-      soxr_set_io_ratio(mHandle.get(), 1/factor, 0);
+   return mpEngine->Process(factor, &inBuffer, inBufferLen, lastFlag,
+      &outBuffer, outBufferLen);
+}
 
-      inBufferLen = lastFlag? ~inBufferLen : inBufferLen;
-      soxr_process(mHandle.get(),
-            inBuffer , inBufferLen , &idone,
-            outBuffer, outBufferLen, &odone);
-   }
-   return { idone, odone };
+std::pair<size_t, size_t>
+      Resample::Process(double  factor,
+                        float  *const *inBuffers,
+                        size_t  inBufferLen,
+                        bool    lastFlag,
+                        float  *const *outBuffers,
+                        size_t  outBufferLen)
+{
+   return mpEngine->Process(factor, inBuffers, inBufferLen, lastFlag,
+      outBuffers, outBufferLen);
+}
+
+float *Resample::GetInputBuffer(size_t len, unsigned iChannel)
+{
+   return mpEngine->GetInputBuffer(len, iChannel);
+}
+
+float *Resample::GetOutputBuffer(size_t len, unsigned iChannel)
+{
+   return mpEngine->GetOutputBuffer(len, iChannel);
+}
+
+void Resample::Reset()
+{
+   mpEngine->Reset();
 }
 
 void Resample::SetMethod(const bool useBestMethod)
@@ -16,16 +16,29 @@
 
 template< typename Enum > class EnumSetting;
 
-struct soxr;
-extern "C" void soxr_delete(soxr*);
-struct soxr_deleter {
-   void operator () (soxr *p) const { if (p) soxr_delete(p); }
-};
-using soxrHandle = std::unique_ptr<soxr, soxr_deleter>;
+class ResampleEngine;
 
 class MATH_API Resample final
 {
  public:
+   //! Where libsoxr runs
+   enum class Backend {
+      Native, //!< in process, unsandboxed
+      Noop,   //!< through rlbox, but without isolation; measures rlbox itself
+      Wasm2c, //!< in a wasm2c sandbox
+   };
+
+   //! Whether this build includes the backend
+   static bool HasBackend(Backend backend);
+   //! The backend chosen when configuring the build (audacity_resample_sandbox)
+   static Backend DefaultBackend();
+
+   //! Whether sandboxed resamplers constructed from now on check the whole
+   //! soxr_t after every call, as a debugging aid and to measure what that
+   //! costs; off unless set
+   static void SetSandboxFullVerify(bool verify);
+   static bool GetSandboxFullVerify();
+
    /// Resamplers may have more than one method, offering a
    /// tradeoff between speed and quality.
    /// Audacity identifies two methods out of all of the choices:
@@ -36,7 +49,14 @@ class MATH_API Resample final
    /// the fast method.
    // dMinFactor and dMaxFactor specify the range of factors for variable-rate resampling.
    // For constant-rate, pass the same value for both.
-   Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor);
+   // numChannels greater than one makes a multi-channel resampler, which
+   // converts all channels in one call with one buffer per channel.
+   Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor,
+            unsigned numChannels = 1);
+   //! Use a particular backend, which must be one that HasBackend()
+   Resample(Backend backend,
+            const bool useBestMethod, const double dMinFactor, const double dMaxFactor,
+            unsigned numChannels = 1);
    ~Resample();
 
    static EnumSetting< int > FastMethodSetting;
@@ -53,7 +73,8 @@ class MATH_API Resample final
     * This function may do nothing if you don't pass a large enough output
     * buffer (i.e. there is no where to put a full block of output data)
     @param factor The scaling factor to resample by.
-    @param inBuffer Buffer of input samples to be processed (mono)
+    @param inBuffer Buffer of input samples to be processed (mono; only for
+    resamplers of one channel)
     @param inBufferLen Length of the input buffer, in samples.
     @param lastFlag Flag to indicate this is the last lot of input samples and
     the buffer needs to be emptied out into the rate converter.
@@ -72,13 +93,51 @@ class MATH_API Resample final
                         float  *outBuffer,
                         size_t  outBufferLen);
 
+   /** @brief Multi-channel processing function.
+
+    As for the mono Process, but with one input and one output buffer for
+    each channel.  All channels consume and produce the same numbers of
+    samples, which are returned.
+   */
+   std::pair<size_t, size_t>
+                Process(double  factor,
+                        float  *const *inBuffers,
+                        size_t  inBufferLen,
+                        bool    lastFlag,
+                        float  *const *outBuffers,
+                        size_t  outBufferLen);
+
+   unsigned GetNumChannels() const { return mNumChannels; }
+   Backend GetBackend() const { return mBackend; }
+
+   /** @brief Buffers that Process can use in place, without marshalling
+
+    The sandboxed backends allocate these in sandbox memory.  A caller that
+    fills GetInputBuffer() and drains GetOutputBuffer() directly, passing
+    pointers into them to Process, saves a copy of every block in and out.
+    Other buffers still work, at the cost of those copies.
+    A call with a greater length than before invalidates earlier pointers.
+    */
+   float *GetInputBuffer(size_t len, unsigned iChannel = 0);
+   float *GetOutputBuffer(size_t len, unsigned iChannel = 0);
+
+   /** @brief Discard all buffered input and output, as if newly constructed
+
+    Keeps the configuration, the buffers above, and for the sandboxed
+    backends, the lease of the sandbox, so that starting again at another
+    position costs much less than constructing another Resample.  Also
+    allows processing again after a call with lastFlag.
+    */
+   void Reset();
+
  protected:
    void SetMethod(const bool useBestMethod);
 
  protected:
    int   mMethod; // resampler-specific enum for resampling method
-   soxrHandle mHandle; // constant-rate or variable-rate resampler (XOR per instance)
-   bool mbWantConstRateResampling;
+   unsigned mNumChannels;
+   Backend mBackend;
+   std::unique_ptr<ResampleEngine> mpEngine; // constant-rate or variable-rate resampler (XOR per instance)
 };
 
 #endif // __AUDACITY_RESAMPLE_H__
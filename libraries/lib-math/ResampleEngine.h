@@ -0,0 +1,66 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   ResampleEngine.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_RESAMPLE_ENGINE_H__
+#define __AUDACITY_RESAMPLE_ENGINE_H__
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+//! What every backend needs to know to create a resampler
+struct ResampleEngineSpec
+{
+   int method; //!< index into Resample's method settings
+   double dMinFactor;
+   double dMaxFactor;
+   unsigned numChannels;
+   //! Sandboxed backends only: check the whole resampler state in the
+   //! sandbox after every call, not only what the host reads of it
+   bool fullVerify{ false };
+
+   bool ConstRate() const { return dMinFactor == dMaxFactor; }
+};
+
+/**
+ \class ResampleEngine
+ \brief Where Resample runs libsoxr: natively, or in one of the sandboxes
+
+ The backends differ only in isolation; Resample forwards to one of them.
+ */
+class MATH_API ResampleEngine
+{
+public:
+   virtual ~ResampleEngine();
+
+   //! See Resample::Process; every engine uses one buffer per channel
+   virtual std::pair<size_t, size_t>
+      Process(double factor,
+              float *const *inBuffers, size_t inBufferLen, bool lastFlag,
+              float *const *outBuffers, size_t outBufferLen) = 0;
+
+   virtual float *GetInputBuffer(size_t len, unsigned iChannel) = 0;
+   virtual float *GetOutputBuffer(size_t len, unsigned iChannel) = 0;
+
+   //! See Resample::Reset
+   virtual void Reset() = 0;
+};
+
+MATH_API std::unique_ptr<ResampleEngine>
+MakeNativeResampleEngine(const ResampleEngineSpec &spec);
+
+#ifdef AUDACITY_RESAMPLE_SANDBOXES
+MATH_API std::unique_ptr<ResampleEngine>
+MakeNoopResampleEngine(const ResampleEngineSpec &spec);
+
+MATH_API std::unique_ptr<ResampleEngine>
+MakeWasm2cResampleEngine(const ResampleEngineSpec &spec);
+#endif
+
+#endif // __AUDACITY_RESAMPLE_ENGINE_H__
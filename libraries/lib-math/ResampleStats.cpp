@@ -0,0 +1,105 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   ResampleStats.cpp
+
+**********************************************************************/
+
+#include "ResampleStats.h"
+
+ResampleSandboxStats &ResampleSandboxStats::Get()
+{
+   static ResampleSandboxStats stats;
+   return stats;
+}
+
+const char *ResampleSandboxStats::Name(Symbol symbol)
+{
+   switch (symbol) {
+   case Symbol::QualitySpec:
+      return "soxr_quality_spec";
+   case Symbol::IoSpec:
+      return "soxr_io_spec";
+   case Symbol::Create:
+      return "soxr_create";
+   case Symbol::SetIoRatio:
+      return "soxr_set_io_ratio";
+   case Symbol::Process:
+      return "soxr_process";
+   case Symbol::Clear:
+      return "soxr_clear";
+   case Symbol::Delete:
+      return "soxr_delete";
+   case Symbol::Error:
+      return "soxr_error";
+   case Symbol::Delay:
+      return "soxr_delay";
+   default:
+      return "";
+   }
+}
+
+uint64_t ResampleSandboxStats::BucketFloorUs(size_t bucket)
+{
+   return bucket == 0 ? 0 : uint64_t{ 1 } << (bucket - 1);
+}
+
+void ResampleSandboxStats::RecordCall(Symbol symbol, uint64_t ns)
+{
+   auto &totals = mSymbols[static_cast<size_t>(symbol)];
+
+   size_t bucket = 0;
+   for (auto us = ns / 1000; us > 0 && bucket + 1 < nBuckets; us >>= 1)
+      ++bucket;
+
+   totals.calls.fetch_add(1, std::memory_order_relaxed);
+   totals.totalNs.fetch_add(ns, std::memory_order_relaxed);
+   totals.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+   auto max = totals.maxNs.load(std::memory_order_relaxed);
+   while (ns > max &&
+      !totals.maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+      ;
+}
+
+void ResampleSandboxStats::RecordMarshalled(size_t bytesIn, size_t bytesOut)
+{
+   if (bytesIn)
+      mBytesIn.fetch_add(bytesIn, std::memory_order_relaxed);
+   if (bytesOut)
+      mBytesOut.fetch_add(bytesOut, std::memory_order_relaxed);
+}
+
+auto ResampleSandboxStats::GetSnapshot() const -> Snapshot
+{
+   // Each counter is read atomically, but not all of them at one instant,
+   // which is good enough for reporting
+   Snapshot result;
+   for (size_t ii = 0; ii < nSymbols; ++ii) {
+      auto &from = mSymbols[ii];
+      auto &to = result.symbols[ii];
+      to.calls = from.calls.load(std::memory_order_relaxed);
+      to.totalNs = from.totalNs.load(std::memory_order_relaxed);
+      to.maxNs = from.maxNs.load(std::memory_order_relaxed);
+      for (size_t bucket = 0; bucket < nBuckets; ++bucket)
+         to.histogram[bucket] =
+            from.histogram[bucket].load(std::memory_order_relaxed);
+   }
+   result.bytesIn = mBytesIn.load(std::memory_order_relaxed);
+   result.bytesOut = mBytesOut.load(std::memory_order_relaxed);
+   return result;
+}
+
+void ResampleSandboxStats::Reset()
+{
+   for (auto &totals : mSymbols) {
+      totals.calls.store(0, std::memory_order_relaxed);
+      totals.totalNs.store(0, std::memory_order_relaxed);
+      totals.maxNs.store(0, std::memory_order_relaxed);
+      for (auto &count : totals.histogram)
+         count.store(0, std::memory_order_relaxed);
+   }
+   mBytesIn.store(0, std::memory_order_relaxed);
+   mBytesOut.store(0, std::memory_order_relaxed);
+}
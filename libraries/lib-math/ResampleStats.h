@@ -0,0 +1,122 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   ResampleStats.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_RESAMPLE_STATS_H__
+#define __AUDACITY_RESAMPLE_STATS_H__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ \class ResampleSandboxStats
+ \brief Counts and times the calls that Resample makes into a soxr sandbox
+
+ Every call across the sandbox boundary is recorded against its soxr
+ symbol, with its wall time in a histogram, and the bytes that the host
+ copies into and out of sandbox memory are totalled.  The counters are
+ process-wide and lock-free; with the native backend they stay at zero.
+ */
+class MATH_API ResampleSandboxStats final
+{
+public:
+   //! The soxr functions that Resample calls in the sandbox
+   enum class Symbol : unsigned {
+      QualitySpec,
+      IoSpec,
+      Create,
+      SetIoRatio,
+      Process,
+      Clear,
+      Delete,
+      Error,
+      Delay,
+      nSymbols
+   };
+   static constexpr size_t nSymbols = static_cast<size_t>(Symbol::nSymbols);
+
+   //! Bucket 0 counts calls shorter than 1 us; bucket k > 0 counts calls of
+   //! [2^(k-1), 2^k) us; the last bucket also counts all longer calls
+   static constexpr size_t nBuckets = 16;
+
+   struct SymbolTotals {
+      uint64_t calls{ 0 };
+      uint64_t totalNs{ 0 };
+      uint64_t maxNs{ 0 };
+      std::array<uint64_t, nBuckets> histogram{};
+   };
+
+   struct Snapshot {
+      std::array<SymbolTotals, nSymbols> symbols;
+      uint64_t bytesIn{ 0 };  //!< copied from host into sandbox memory
+      uint64_t bytesOut{ 0 }; //!< copied from sandbox memory to the host
+   };
+
+   static ResampleSandboxStats &Get();
+
+   //! The name of the soxr function, as in soxr.h
+   static const char *Name(Symbol symbol);
+   //! Lower bound of a histogram bucket, in microseconds
+   static uint64_t BucketFloorUs(size_t bucket);
+
+   void RecordCall(Symbol symbol, uint64_t ns);
+   void RecordMarshalled(size_t bytesIn, size_t bytesOut);
+
+   Snapshot GetSnapshot() const;
+   void Reset();
+
+   //! Records the lifetime of the object against the symbol
+   class CallTimer final
+   {
+   public:
+      explicit CallTimer(Symbol symbol)
+         : mSymbol{ symbol }, mStart{ std::chrono::steady_clock::now() }
+      {}
+      CallTimer(const CallTimer&) = delete;
+      CallTimer &operator =(const CallTimer&) = delete;
+      ~CallTimer()
+      {
+         const auto elapsed = std::chrono::steady_clock::now() - mStart;
+         Get().RecordCall(mSymbol,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+               .count());
+      }
+
+   private:
+      const Symbol mSymbol;
+      const std::chrono::steady_clock::time_point mStart;
+   };
+
+private:
+   ResampleSandboxStats() = default;
+
+   struct AtomicTotals {
+      std::atomic<uint64_t> calls{ 0 };
+      std::atomic<uint64_t> totalNs{ 0 };
+      std::atomic<uint64_t> maxNs{ 0 };
+      std::array<std::atomic<uint64_t>, nBuckets> histogram{};
+   };
+
+   std::array<AtomicTotals, nSymbols> mSymbols;
+   std::atomic<uint64_t> mBytesIn{ 0 };
+   std::atomic<uint64_t> mBytesOut{ 0 };
+};
+
+//! Call fn, which crosses into the sandbox, timing it against symbol
+template<typename Fn>
+auto TimeSandboxCall(ResampleSandboxStats::Symbol symbol, Fn &&fn)
+   -> decltype(fn())
+{
+   ResampleSandboxStats::CallTimer timer{ symbol };
+   return fn();
+}
+
+#endif // __AUDACITY_RESAMPLE_STATS_H__
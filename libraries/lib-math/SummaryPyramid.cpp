@@ -0,0 +1,74 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   SummaryPyramid.cpp
+
+**********************************************************************/
+
+#include "SummaryPyramid.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+bool SummaryPyramid::IsLevel(size_t divisor)
+{
+   for (auto level = MinDivisor; level <= MaxDivisor; level *= Factor)
+      if (divisor == level)
+         return true;
+   return false;
+}
+
+size_t SummaryPyramid::DivisorFor(double samplesPerColumn)
+{
+   if (samplesPerColumn < MinDivisor)
+      return 1;
+   auto divisor = MinDivisor;
+   while (divisor < MaxDivisor && divisor * Factor <= samplesPerColumn)
+      divisor *= Factor;
+   return divisor;
+}
+
+void SummaryPyramid::Summarize(
+   const float *samples, size_t nSamples, size_t divisor, float *dest)
+{
+   for (size_t start = 0; start < nSamples; start += divisor) {
+      const auto count = std::min(divisor, nSamples - start);
+      float min = FLT_MAX, max = -FLT_MAX;
+      double sumsq = 0;
+      for (auto pSample = samples + start, end = pSample + count;
+           pSample != end; ++pSample) {
+         const auto value = *pSample;
+         min = std::min(min, value);
+         max = std::max(max, value);
+         sumsq += value * value;
+      }
+      *dest++ = min;
+      *dest++ = max;
+      *dest++ = static_cast<float>(sqrt(sumsq / count));
+   }
+}
+
+void SummaryPyramid::Reduce(const float *src, size_t srcDivisor,
+   size_t nSamples, size_t factor, float *dest)
+{
+   const auto divisor = srcDivisor * factor;
+   for (size_t start = 0; start < nSamples; start += divisor) {
+      const auto end = std::min(nSamples, start + divisor);
+      float min = FLT_MAX, max = -FLT_MAX;
+      double sumsq = 0;
+      // Weight each mean square by the samples it covers
+      for (auto srcStart = start; srcStart < end; srcStart += srcDivisor) {
+         const auto count = std::min(srcDivisor, end - srcStart);
+         min = std::min(min, src[0]);
+         max = std::max(max, src[1]);
+         sumsq += double(src[2]) * src[2] * count;
+         src += Fields;
+      }
+      *dest++ = min;
+      *dest++ = max;
+      *dest++ = static_cast<float>(sqrt(sumsq / (end - start)));
+   }
+}
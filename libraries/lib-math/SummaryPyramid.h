@@ -0,0 +1,65 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   SummaryPyramid.h
+
+   Levels of min, max and rms summaries of samples, each level four times
+   coarser than the one before, so that drawing at any zoom reads a few
+   frames per pixel column.
+
+**********************************************************************/
+
+#ifndef __AUDACITY_SUMMARY_PYRAMID__
+#define __AUDACITY_SUMMARY_PYRAMID__
+
+#include <cstddef>
+
+/*!
+ A frame of a level holds three floats:  the minimum, the maximum, and the
+ root mean square of the samples it summarizes.  A level is named by its
+ divisor, the number of samples per frame.  The last frame of a level may
+ summarize fewer samples than the divisor.
+ */
+namespace SummaryPyramid {
+
+//! Floats per frame
+constexpr size_t Fields = 3;
+//! Ratio of the divisors of consecutive levels
+constexpr size_t Factor = 4;
+//! Divisor of the finest level
+constexpr size_t MinDivisor = 16;
+//! Divisor of the coarsest level
+constexpr size_t MaxDivisor = 65536;
+
+//! Whether divisor is that of a level
+MATH_API bool IsLevel(size_t divisor);
+
+//! Divisor of the coarsest level with no more samples per frame than
+//! samplesPerColumn, or 1, meaning samples, if there is none
+MATH_API size_t DivisorFor(double samplesPerColumn);
+
+//! How many frames of the level summarize nSamples
+inline size_t Frames(size_t nSamples, size_t divisor)
+{
+   return (nSamples + divisor - 1) / divisor;
+}
+
+//! Writes Frames(nSamples, divisor) frames summarizing the samples
+MATH_API void Summarize(
+   const float *samples, size_t nSamples, size_t divisor, float *dest);
+
+//! Writes Frames(nSamples, srcDivisor * factor) frames, reducing those of a
+//! finer level
+/*!
+ @param src Frames(nSamples, srcDivisor) frames
+ @param nSamples how many samples src summarizes, so that the root mean
+ square of a short last frame is weighted correctly
+ */
+MATH_API void Reduce(const float *src, size_t srcDivisor, size_t nSamples,
+   size_t factor, float *dest);
+
+}
+
+#endif
@@ -0,0 +1,195 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   ResampleBench.cpp
+
+   Measures Resample::Process throughput in blocks per second, under each
+   backend built in: native libsoxr, then libsoxr through the rlbox API
+   with the noop sandbox, then in the wasm2c sandbox.  Native against noop
+   is the cost of the rlbox API; noop against wasm2c is the cost of
+   isolation.  Each workload runs twice: once with caller-owned buffers,
+   and once filling and draining the buffers from Resample::GetInputBuffer
+   and GetOutputBuffer.
+
+   Then it measures seeking in a project of many tracks, as Mixer does when
+   scrubbing or looping: the time from the seek until every track's first
+   block is resampled, by constructing new resamplers as Mixer used to, and
+   by resetting the existing ones.
+
+   Each sandboxed backend runs again with Resample::SetSandboxFullVerify,
+   which restores the check of the whole soxr_t after every call, so that
+   the cost of that check reads off one table.
+
+   usage: resample-bench [blocks [blockSize]]
+
+**********************************************************************/
+
+#include "Resample.h"
+
+#include "Prefs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include <wx/filename.h>
+
+namespace {
+
+// Resample reads its method from preferences, so give it a throwaway file
+class BenchConfig final : public FileConfig
+{
+public:
+   explicit BenchConfig(const wxString &path)
+      : FileConfig{ wxT("resample-bench"), wxEmptyString, path, wxEmptyString,
+         wxCONFIG_USE_LOCAL_FILE }
+   {}
+protected:
+   void Warn() override {}
+};
+
+struct Workload
+{
+   const char *name;
+   bool useBestMethod;
+   double minFactor, maxFactor; // equal for constant rate
+};
+
+double Run(Resample::Backend backend,
+   const Workload &w, size_t blocks, size_t blockSize, bool useArenas)
+{
+   const size_t outSize = static_cast<size_t>(blockSize * w.maxFactor) + 16;
+
+   std::vector<float> source(blockSize), sink(outSize);
+   for (size_t i = 0; i < blockSize; ++i)
+      source[i] = static_cast<float>(sin(2 * M_PI * 440.0 * i / 44100.0));
+
+   Resample resample{ backend, w.useBestMethod, w.minFactor, w.maxFactor };
+   float *const input =
+      useArenas ? resample.GetInputBuffer(blockSize) : source.data();
+   float *const output =
+      useArenas ? resample.GetOutputBuffer(outSize) : sink.data();
+
+   using Clock = std::chrono::steady_clock;
+   const auto start = Clock::now();
+   for (size_t b = 0; b < blocks; ++b) {
+      // A caller of the arenas fills them itself, as Mixer does from its cache
+      if (useArenas)
+         std::copy(source.begin(), source.end(), input);
+      // Sweep the factor across its range when resampling at variable rate
+      const double factor = w.minFactor +
+         (w.maxFactor - w.minFactor) * (b % 100) / 100.0;
+      resample.Process(factor, input, blockSize, b + 1 == blocks,
+         output, outSize);
+   }
+   const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+   return blocks / elapsed.count();
+}
+
+//! Mean milliseconds from a seek until each of nTracks resamplers has
+//! produced its first block
+double Seek(Resample::Backend backend,
+   size_t nTracks, size_t seeks, size_t blockSize, bool reset)
+{
+   const double factor = 48000.0 / 44100;
+   const size_t outSize = static_cast<size_t>(blockSize * factor) + 16;
+   std::vector<float> source(blockSize), sink(outSize);
+   for (size_t i = 0; i < blockSize; ++i)
+      source[i] = static_cast<float>(sin(2 * M_PI * 440.0 * i / 44100.0));
+
+   std::vector<std::unique_ptr<Resample>> resamplers(nTracks);
+   for (auto &pResample : resamplers)
+      pResample =
+         std::make_unique<Resample>(backend, true, factor, factor);
+
+   using Clock = std::chrono::steady_clock;
+   Clock::duration total{};
+   for (size_t s = 0; s < seeks; ++s) {
+      // Play a little before seeking, so that there is state to discard
+      for (auto &pResample : resamplers)
+         pResample->Process(factor, source.data(), blockSize, false,
+            sink.data(), outSize);
+
+      const auto start = Clock::now();
+      for (auto &pResample : resamplers) {
+         if (reset)
+            pResample->Reset();
+         else
+            pResample =
+               std::make_unique<Resample>(backend, true, factor, factor);
+         pResample->Process(factor, source.data(), blockSize, false,
+            sink.data(), outSize);
+      }
+      total += Clock::now() - start;
+   }
+
+   return std::chrono::duration<double, std::milli>(total).count() / seeks;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+   const size_t blocks = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10000;
+   const size_t blockSize = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1024;
+
+   auto config = std::make_unique<BenchConfig>(
+      wxFileName::CreateTempFileName(wxT("resample-bench")));
+   config->Init();
+   InitPreferences(std::move(config));
+
+   const Workload workloads[] = {
+      { "fast 44100->48000", false, 48000.0 / 44100, 48000.0 / 44100 },
+      { "best 44100->48000", true,  48000.0 / 44100, 48000.0 / 44100 },
+      { "best 48000->96000", true,  2.0,             2.0 },
+      { "variable 0.5..2.0", true,  0.5,             2.0 },
+   };
+
+   const struct {
+      Resample::Backend backend;
+      const char *name;
+      bool fullVerify;
+   } backends[] = {
+      { Resample::Backend::Native, "native",                      false },
+      { Resample::Backend::Noop,   "noop sandbox",                false },
+      { Resample::Backend::Noop,   "noop sandbox, full verify",   true },
+      { Resample::Backend::Wasm2c, "wasm2c sandbox",              false },
+      { Resample::Backend::Wasm2c, "wasm2c sandbox, full verify", true },
+   };
+
+   printf("%zu blocks of %zu samples\n", blocks, blockSize);
+   for (const auto &b : backends) {
+      if (!Resample::HasBackend(b.backend))
+         continue;
+      Resample::SetSandboxFullVerify(b.fullVerify);
+      printf("\nResample (%s)\n", b.name);
+      printf("%-20s %18s %18s\n", "", "caller buffers", "resampler buffers");
+      for (const auto &w : workloads)
+         printf("%-20s %11.1f blk/s %11.1f blk/s\n", w.name,
+            Run(b.backend, w, blocks, blockSize, false),
+            Run(b.backend, w, blocks, blockSize, true));
+   }
+
+   constexpr size_t nTracks = 50, seeks = 20;
+   printf("\nSeek to first block of %zu tracks, best 44100->48000\n", nTracks);
+   printf("%-28s %18s %18s\n", "", "new resamplers", "reset resamplers");
+   for (const auto &b : backends) {
+      if (!Resample::HasBackend(b.backend))
+         continue;
+      Resample::SetSandboxFullVerify(b.fullVerify);
+      printf("%-28s %15.2f ms %15.2f ms\n", b.name,
+         Seek(b.backend, nTracks, seeks, blockSize, false),
+         Seek(b.backend, nTracks, seeks, blockSize, true));
+   }
+
+   Resample::SetSandboxFullVerify(false);
+   FinishPreferences();
+   return 0;
+}
@@ -0,0 +1,36 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   ResampleNoop.cpp
+
+   SandboxedResampleEngine over rlbox_noop_sandbox, which calls the
+   in-process libsoxr through the rlbox API.
+
+**********************************************************************/
+
+#define RLBOX_USE_STATIC_CALLS() rlbox_noop_sandbox_lookup_symbol
+
+#include "SoxrSandbox.h"
+#include "rlbox_noop_sandbox.hpp"
+#include "ResampleSandboxed.h"
+
+#include <lib_struct_file.h>
+rlbox_load_structs_from_library(soxr);
+
+template<>
+bool SoxrSandboxPool<rlbox::rlbox_noop_sandbox>::CreateSandbox(
+   Sandbox &sandbox)
+{
+   return sandbox.create_sandbox();
+}
+
+template class SandboxedResampleEngine<rlbox::rlbox_noop_sandbox>;
+
+std::unique_ptr<ResampleEngine>
+MakeNoopResampleEngine(const ResampleEngineSpec &spec)
+{
+   return
+      std::make_unique<SandboxedResampleEngine<rlbox::rlbox_noop_sandbox>>(spec);
+}
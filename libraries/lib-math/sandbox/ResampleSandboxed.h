@@ -4,81 +4,439 @@
    Audacity(R) is copyright (c) 1999-2012 Audacity Team.
    License: GPL v2 or later.  See License.txt.
 
-   Resample.cpp
+   ResampleSandboxed.h
    Dominic Mazzoni, Rob Sykes, Vaughan Johnson
 
-**********************************************************************/
+******************************************************************//**
 
-#ifndef __AUDACITY_RESAMPLE_H__
-#define __AUDACITY_RESAMPLE_H__
+\class SandboxedResampleEngine
+\brief Runs libsoxr for Resample inside an rlbox sandbox.
 
-#include "SampleFormat.h"
+   Each instance leases one sandbox from SoxrSandboxPool for its whole
+   lifetime; its soxr_t and its staging buffers stay resident in that
+   sandbox's memory.  The soxr_t is opaque to the host, which validates
+   only the error and the counts of samples consumed and produced that
+   each call returns; ResampleEngineSpec::fullVerify also has soxr check
+   its error and delay after every call, as a debugging aid.  It always
+   uses split I/O, so all channels of a track cross into the sandbox in
+   one call.
 
-template< typename Enum > class EnumSetting;
+   T_Sbx is the rlbox backend: rlbox_noop_sandbox calls libsoxr directly
+   through the rlbox API, which measures what the API itself costs, and
+   rlbox_wasm2c_sandbox isolates it.  ResampleNoop.cpp and
+   ResampleWasm2c.cpp each instantiate one.
 
-struct soxr;
-extern "C" void soxr_delete(soxr*);
-struct soxr_deleter {
-   void operator () (soxr *p) const { if (p) soxr_delete(p); }
-};
-using soxrHandle = std::unique_ptr<soxr, soxr_deleter>;
+*//*******************************************************************/
+
+#ifndef __AUDACITY_RESAMPLE_SANDBOXED_H__
+#define __AUDACITY_RESAMPLE_SANDBOXED_H__
+
+#include "ResampleEngine.h"
+#include "ResampleStats.h"
+#include "SoxrSandbox.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//! invoke_sandbox_function, counted and timed in ResampleSandboxStats
+#define INVOKE_SOXR(symbol, func, ...) \
+   TimeSandboxCall(ResampleSandboxStats::Symbol::symbol, [&]{ \
+      return sandbox.invoke_sandbox_function(func, __VA_ARGS__); })
+
+// --------------------------
+// validator helper functions
+// --------------------------
+
+/**
+ * return true if the field members of the soxr_quality_spec_t are valid
+ */
+inline bool check_quality_spec(soxr_quality_spec_t const * q_spec) {
+   bool valid_precision = q_spec->precision >= 0.0 && q_spec->precision <= 64;
+   bool valid_phase_response = q_spec->phase_response >= 0.0 && q_spec->phase_response <= 100.0;          
+   bool valid_passband_end = q_spec->passband_end >= 0.0 && q_spec->passband_end <= 1.0;
+   bool valid_stopband_begin = q_spec->stopband_begin > q_spec->passband_end && q_spec->stopband_begin < 1e3;
+   // soxr reports a bad spec by setting e
+   bool valid_e = q_spec->e == NULL;
+   // The low flags, public and internal, and RESET_ON_CLEAR
+   bool valid_flags = (q_spec->flags & ~(0x7Ful | 0x80000000ul)) == 0;
 
-class MATH_API Resample final
+   return valid_precision && valid_phase_response 
+            && valid_passband_end && valid_stopband_begin
+            && valid_e && valid_flags;
+}
+
+/**
+ * return true if the field members of the soxr_io_spec_t are valid
+ */
+inline bool check_io_spec(soxr_io_spec_t const * io_spec) {
+   bool valid_itype = io_spec->itype < 8;
+   bool valid_otype = io_spec->otype < 8;
+   bool valid_scale = io_spec->scale >= 0 && io_spec->scale < 1e3;
+   bool valid_e = io_spec->e == NULL;
+   bool valid_flags = io_spec->flags == 0 || io_spec->flags == 8u;
+
+   return valid_itype && valid_otype && valid_scale && valid_e && valid_flags;
+}
+
+template<typename T_Sbx>
+class SandboxedResampleEngine final : public ResampleEngine
 {
- public:
-   /// Resamplers may have more than one method, offering a
-   /// tradeoff between speed and quality.
-   /// Audacity identifies two methods out of all of the choices:
-   /// a Fast method intended for real-time audio I/O, and a Best
-   /// method intended for mixing and exporting.
-   //
-   /// The first parameter lets you select either the best method or
-   /// the fast method.
-   // dMinFactor and dMaxFactor specify the range of factors for variable-rate resampling.
-   // For constant-rate, pass the same value for both.
-   Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor);
-   ~Resample();
-
-   static EnumSetting< int > FastMethodSetting;
-   static EnumSetting< int > BestMethodSetting;
-
-   /** @brief Main processing function. Resamples from the input buffer to the
-    * output buffer.
-    *
-    * Reads samples from the input buffer, and writes samples to the output
-    * buffer. Stops when either is exhausted, or we reach a convenient block
-    * end, unless lastFlag is set to force emptying the input buffer.
-    * The number of input samples used is returned in inBufferUsed, and the
-    * number of output samples generated is the return value of the function.
-    * This function may do nothing if you don't pass a large enough output
-    * buffer (i.e. there is no where to put a full block of output data)
-    @param factor The scaling factor to resample by.
-    @param inBuffer Buffer of input samples to be processed (mono)
-    @param inBufferLen Length of the input buffer, in samples.
-    @param lastFlag Flag to indicate this is the last lot of input samples and
-    the buffer needs to be emptied out into the rate converter.
-    (unless lastFlag is true, we don't guarantee to process all the samples in
-    the input this time, we may leave some for next time)
-    @param outBuffer Buffer to write output (converted) samples to.
-    @param outBufferLen How big outBuffer is.
-    @return Number of input samples consumed, and number of output samples
-    created by this call
-   */
+public:
+   template<typename T> using Tainted = rlbox::tainted<T, T_Sbx>;
+   template<typename T> using TaintedOpaque = rlbox::tainted_opaque<T, T_Sbx>;
+
+   explicit SandboxedResampleEngine(const ResampleEngineSpec &spec);
+   ~SandboxedResampleEngine() override;
+
    std::pair<size_t, size_t>
-                Process(double  factor,
-                        float  *inBuffer,
+      Process(double factor,
+              float *const *inBuffers, size_t inBufferLen, bool lastFlag,
+              float *const *outBuffers, size_t outBufferLen) override;
+
+   //! Staging buffers in sandbox memory, which Process uses in place
+   float *GetInputBuffer(size_t len, unsigned iChannel) override;
+   float *GetOutputBuffer(size_t len, unsigned iChannel) override;
+
+   //! soxr_clear in the sandbox; the staging buffers stay
+   void Reset() override;
+
+private:
+   //! Grow the sandbox-resident staging buffers to hold at least these lengths
+   void ReserveStaging(size_t inLen, size_t outLen);
+   //! Exit with the message if soxr reported an error
+   static void CheckError(Tainted<soxr_error_t> error, const char *what);
+   //! Check the resident resampler state after a call into the sandbox,
+   //! if mFullVerify
+   void VerifyHandle();
+   //! The tainted pointer to p if [p, p + len) lies within the arena, else null
+   static Tainted<float*> ArenaAt(
+      Tainted<float*> arena, size_t arenaLen, const float *p, size_t len);
+
+   // Leased for the lifetime of this object; everything below lives in it
+   typename SoxrSandboxPool<T_Sbx>::Lease mSandbox;
+   TaintedOpaque<soxr_t> mHandle; // constant-rate or variable-rate resampler (XOR per instance)
+   Tainted<size_t*> mIdone, mOdone; // soxr_process out-parameters
+   // One staging buffer of each per channel, and arrays of pointers to them
+   // for split I/O
+   std::vector<Tainted<float*>> mInStaging, mOutStaging;
+   Tainted<float**> mInPointers, mOutPointers;
+   size_t mInStagingLen{ 0 }, mOutStagingLen{ 0 };
+   // Per channel, whether the last Process wrote to the staging buffer in
+   // place of the caller's, which must then be copied out
+   std::vector<char> mOutStaged;
+
+   const unsigned mNumChannels;
+   const bool mbWantConstRateResampling;
+   const bool mFullVerify;
+};
+
+template<typename T_Sbx>
+SandboxedResampleEngine<T_Sbx>::SandboxedResampleEngine(
+   const ResampleEngineSpec &spec)
+   : mSandbox{ SoxrSandboxPool<T_Sbx>::Get().Acquire() }
+   , mInStaging(spec.numChannels)
+   , mOutStaging(spec.numChannels)
+   , mOutStaged(spec.numChannels)
+   , mNumChannels{ spec.numChannels }
+   , mbWantConstRateResampling{ spec.ConstRate() }
+   , mFullVerify{ spec.fullVerify }
+{
+   auto &sandbox = *mSandbox;
+
+   Tainted<soxr_quality_spec_t> q_spec_tainted;
+   if (mbWantConstRateResampling)
+   {
+      // constant rate resampling
+      // q_spec = soxr_quality_spec("\0\1\4\6"[spec.method], 0);
+      q_spec_tainted = INVOKE_SOXR(QualitySpec, soxr_quality_spec, "\0\1\4\6"[spec.method], 0);
+   }
+   else
+   {
+      // variable rate resampling
+      // q_spec = soxr_quality_spec(SOXR_HQ, SOXR_VR);
+      q_spec_tainted = INVOKE_SOXR(QualitySpec, soxr_quality_spec, SOXR_HQ, SOXR_VR);
+   }
+   q_spec_tainted.copy_and_verify(
+      [](Tainted<soxr_quality_spec_t> tainted) {
+         const auto ret =
+            tainted.unverified_safe_because("Every field is checked next.");
+         if (check_quality_spec(&ret)) {
+            return ret;
+         }
+         printf("ERROR: INVALID soxr_quality_spec_t CAUGHT\n");
+         exit(1);
+      }
+   );
+
+   // Always use split I/O (one buffer per channel), even for one channel,
+   // so that mono and multi-channel calls take the same path
+   auto io_spec_tainted = INVOKE_SOXR(IoSpec, soxr_io_spec, SOXR_FLOAT32_S, SOXR_FLOAT32_S);
+   io_spec_tainted.copy_and_verify(
+      [](Tainted<soxr_io_spec_t> tainted) {
+         const auto ret =
+            tainted.unverified_safe_because("Every field is checked next.");
+         if (check_io_spec(&ret)) {
+            return ret;
+         }
+         printf("ERROR: INVALID soxr_io_spec_t CAUGHT\n");
+         exit(1);
+      }
+   );
+
+   // soxr_create reads the specs through pointers, so they must be in sandbox memory
+   auto q_spec_ptr = sandbox.template malloc_in_sandbox<soxr_quality_spec_t>();
+   *q_spec_ptr = q_spec_tainted;
+   auto io_spec_ptr = sandbox.template malloc_in_sandbox<soxr_io_spec_t>();
+   *io_spec_ptr = io_spec_tainted;
+   // Both specs were copied out to verify them and back in for soxr_create
+   constexpr auto specBytes =
+      sizeof(soxr_quality_spec_t) + sizeof(soxr_io_spec_t);
+   ResampleSandboxStats::Get().RecordMarshalled(specBytes, specBytes);
+
+   // mHandle.reset(soxr_create(1, spec.dMinFactor, mNumChannels, 0, &io_spec, &q_spec, 0));
+   auto handle = INVOKE_SOXR(Create, soxr_create, 1, spec.dMinFactor, mNumChannels, nullptr, io_spec_ptr, q_spec_ptr, nullptr);
+   sandbox.free_in_sandbox(q_spec_ptr);
+   sandbox.free_in_sandbox(io_spec_ptr);
+   if (handle == nullptr) {
+      printf("ERROR: soxr_create FAILED\n");
+      exit(1);
+   }
+   // From here on the host only passes the handle back to soxr
+   mHandle = handle.to_opaque();
+   VerifyHandle();
+
+   // The state stays resident in the sandbox from now on; so do these
+   mIdone = sandbox.template malloc_in_sandbox<size_t>();
+   mOdone = sandbox.template malloc_in_sandbox<size_t>();
+   mInPointers = sandbox.template malloc_in_sandbox<float*>(mNumChannels);
+   mOutPointers = sandbox.template malloc_in_sandbox<float*>(mNumChannels);
+}
+
+template<typename T_Sbx>
+SandboxedResampleEngine<T_Sbx>::~SandboxedResampleEngine()
+{
+   if (!mSandbox)
+      return;
+   auto &sandbox = *mSandbox;
+
+   // Leave the sandbox clean for its next lessee
+   if (rlbox::from_opaque(mHandle) != nullptr)
+      INVOKE_SOXR(Delete, soxr_delete, mHandle);
+   for (auto p : { mIdone, mOdone })
+      if (p != nullptr)
+         sandbox.free_in_sandbox(p);
+   for (auto p : { mInPointers, mOutPointers })
+      if (p != nullptr)
+         sandbox.free_in_sandbox(p);
+   for (auto p : mInStaging)
+      if (p != nullptr)
+         sandbox.free_in_sandbox(p);
+   for (auto p : mOutStaging)
+      if (p != nullptr)
+         sandbox.free_in_sandbox(p);
+}
+
+template<typename T_Sbx>
+void SandboxedResampleEngine<T_Sbx>::ReserveStaging(size_t inLen, size_t outLen)
+{
+   auto &sandbox = *mSandbox;
+   // Grow geometrically so that varying block sizes settle quickly
+   const auto grow = [&](std::vector<Tainted<float*>> &staging,
+      size_t &stagingLen, size_t len)
+   {
+      if (len <= stagingLen)
+         return;
+      stagingLen = std::max(len, 2 * stagingLen);
+      for (auto &p : staging) {
+         if (p != nullptr)
+            sandbox.free_in_sandbox(p);
+         p = sandbox.template malloc_in_sandbox<float>(stagingLen);
+         if (p == nullptr) {
+            printf("ERROR: COULD NOT ALLOCATE SANDBOX STAGING BUFFER\n");
+            exit(1);
+         }
+      }
+   };
+   grow(mInStaging, mInStagingLen, inLen);
+   grow(mOutStaging, mOutStagingLen, outLen);
+}
+
+template<typename T_Sbx>
+float *SandboxedResampleEngine<T_Sbx>::GetInputBuffer(size_t len, unsigned iChannel)
+{
+   ReserveStaging(len, 0);
+   return mInStaging[iChannel].unverified_safe_pointer_because(mInStagingLen,
+      "Plain samples; the host only writes them.");
+}
+
+template<typename T_Sbx>
+float *SandboxedResampleEngine<T_Sbx>::GetOutputBuffer(size_t len, unsigned iChannel)
+{
+   ReserveStaging(0, len);
+   // Any float is an acceptable sample, and Process checks odone against
+   // the length before the caller reads any of it
+   return mOutStaging[iChannel].unverified_safe_pointer_because(mOutStagingLen,
+      "Plain samples, bounded by odone.");
+}
+
+template<typename T_Sbx>
+void SandboxedResampleEngine<T_Sbx>::Reset()
+{
+   auto &sandbox = *mSandbox;
+   // soxr_clear(mHandle.get());
+   CheckError(INVOKE_SOXR(Clear, soxr_clear, mHandle), "soxr_clear");
+   VerifyHandle();
+}
+
+template<typename T_Sbx>
+auto SandboxedResampleEngine<T_Sbx>::ArenaAt(
+   Tainted<float*> arena, size_t arenaLen, const float *p, size_t len)
+   -> Tainted<float*>
+{
+   if (arena == nullptr)
+      return nullptr;
+   auto base = arena.unverified_safe_pointer_because(arenaLen, "Comparing addresses only.");
+   if (p < base || p + len > base + arenaLen)
+      return nullptr;
+   return arena + (p - base);
+}
+
+template<typename T_Sbx>
+void SandboxedResampleEngine<T_Sbx>::CheckError(
+   Tainted<soxr_error_t> error, const char *what)
+{
+   // Only the nullness of the error matters.  The message is sandbox memory,
+   // so it is copied out with its bounds checked before it is printed.
+   if (error == nullptr)
+      return;
+   error.copy_and_verify_string([what](std::string message) {
+      printf("ERROR: %s FAILED. %s\n", what, message.c_str());
+      exit(1);
+   });
+}
+
+template<typename T_Sbx>
+void SandboxedResampleEngine<T_Sbx>::VerifyHandle()
+{
+   if (!mFullVerify)
+      return;
+   auto &sandbox = *mSandbox;
+   // struct soxr is private to soxr.c, so the host cannot copy it out and
+   // check its fields; instead soxr reports, from inside the sandbox, the
+   // error that the struct holds and the delay that all its stages add up to
+   CheckError(INVOKE_SOXR(Error, soxr_error, mHandle), "soxr_error");
+   INVOKE_SOXR(Delay, soxr_delay, mHandle).copy_and_verify([](double delay) {
+      if (!(delay >= 0 && delay < 1e9)) {
+         printf("ERROR: INVALID mHandle CAUGHT\n");
+         exit(1);
+      }
+      return delay;
+   });
+}
+
+template<typename T_Sbx>
+std::pair<size_t, size_t>
+      SandboxedResampleEngine<T_Sbx>::Process(double  factor,
+                        float  *const *inBuffers,
                         size_t  inBufferLen,
                         bool    lastFlag,
-                        float  *outBuffer,
-                        size_t  outBufferLen);
+                        float  *const *outBuffers,
+                        size_t  outBufferLen)
+{
+   auto &sandbox = *mSandbox;
 
- protected:
-   void SetMethod(const bool useBestMethod);
+   // Growing the staging only happens when the lengths exceed it, in which
+   // case no caller pointer can be in the arenas, so it is safe to do first
+   ReserveStaging(inBufferLen, outBufferLen);
 
- protected:
-   int   mMethod; // resampler-specific enum for resampling method
-   soxrHandle mHandle; // constant-rate or variable-rate resampler (XOR per instance)
-   bool mbWantConstRateResampling;
-};
+   // Use the arenas in place when the caller filled them; otherwise marshal
+   // the input into sandbox memory
+   // Count the pointer arrays and the counts too, which always cross
+   size_t bytesIn = 2 * mNumChannels * sizeof(float*);
+   size_t bytesOut = 2 * sizeof(size_t);
+   for (unsigned iChannel = 0; iChannel < mNumChannels; ++iChannel) {
+      auto in = ArenaAt(mInStaging[iChannel], mInStagingLen,
+         inBuffers[iChannel], inBufferLen);
+      if (in == nullptr) {
+         in = mInStaging[iChannel];
+         if (inBufferLen > 0) {
+            memcpy(in.unverified_safe_pointer_because(inBufferLen, "Writing only."),
+                   inBuffers[iChannel], inBufferLen * sizeof(float));
+            bytesIn += inBufferLen * sizeof(float);
+         }
+      }
+      mInPointers[iChannel] = in;
+
+      auto out = ArenaAt(mOutStaging[iChannel], mOutStagingLen,
+         outBuffers[iChannel], outBufferLen);
+      // Channels are independent: one may be in its arena, at an offset,
+      // while another is not
+      mOutStaged[iChannel] = (out == nullptr);
+      if (out == nullptr)
+         out = mOutStaging[iChannel];
+      mOutPointers[iChannel] = out;
+   }
+
+   if (!mbWantConstRateResampling)
+   {
+      // soxr_set_io_ratio(mHandle.get(), 1/factor, 0);
+      CheckError(INVOKE_SOXR(SetIoRatio, soxr_set_io_ratio, mHandle,
+                                 1/factor, 0), "soxr_set_io_ratio");
+      VerifyHandle();
+   }
+
+   // The sandbox's size_t may be narrower (32 bits for wasm2c), so the
+   // flush flag must be complemented at its width to survive the conversion
+   using SandboxSize = typename rlbox::rlbox_sandbox<T_Sbx>::
+      template convert_to_sandbox_equivalent_nonclass_t<size_t>;
+   const size_t inLen = lastFlag
+      ? static_cast<size_t>(
+         static_cast<SandboxSize>(~static_cast<SandboxSize>(inBufferLen)))
+      : inBufferLen;
+   // soxr_process(mHandle.get(),
+   //       inBuffers , inLen       , &idone,
+   //       outBuffers, outBufferLen, &odone);
+   CheckError(INVOKE_SOXR(Process, soxr_process, mHandle,
+                              mInPointers , inLen       , mIdone,
+                              mOutPointers, outBufferLen, mOdone), "soxr_process");
+   VerifyHandle();
+
+   // These two counts are all the host takes from the resampler's state,
+   // and all it needs to trust: they bound every later access to the buffers
+   const size_t idone = (*mIdone).copy_and_verify([&](size_t idone) {
+      if (idone > inBufferLen) {
+         printf("ERROR: INVALID idone CAUGHT\n");
+         exit(1);
+      }
+      return idone;
+   });
+   const size_t odone = (*mOdone).copy_and_verify([&](size_t odone) {
+      if (odone > outBufferLen) {
+         printf("ERROR: INVALID odone CAUGHT\n");
+         exit(1);
+      }
+      return odone;
+   });
+
+   // Marshal the output back out of the channels that were staged; the
+   // caller drains the others from the arenas itself
+   if (odone > 0)
+      for (unsigned iChannel = 0; iChannel < mNumChannels; ++iChannel) {
+         if (!mOutStaged[iChannel])
+            continue;
+         auto out = mOutStaging[iChannel].unverified_safe_pointer_because(
+            odone, "Length checked above.");
+         memcpy(outBuffers[iChannel], out, odone * sizeof(float));
+         bytesOut += odone * sizeof(float);
+      }
+   ResampleSandboxStats::Get().RecordMarshalled(bytesIn, bytesOut);
+
+   return { idone, odone };
+}
+
+#undef INVOKE_SOXR
 
-#endif // __AUDACITY_RESAMPLE_H__
+#endif // __AUDACITY_RESAMPLE_SANDBOXED_H__
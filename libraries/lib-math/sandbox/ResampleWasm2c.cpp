@@ -0,0 +1,34 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   ResampleWasm2c.cpp
+
+   SandboxedResampleEngine over rlbox_wasm2c_sandbox, which runs the
+   wasm2c-compiled libsoxr loaded from SOXR_SANDBOX_PATH.
+
+**********************************************************************/
+
+#include "SoxrSandbox.h"
+#include "rlbox_wasm2c_sandbox.hpp"
+#include "ResampleSandboxed.h"
+
+#include <lib_struct_file.h>
+rlbox_load_structs_from_library(soxr);
+
+template<>
+bool SoxrSandboxPool<rlbox::rlbox_wasm2c_sandbox>::CreateSandbox(
+   Sandbox &sandbox)
+{
+   return sandbox.create_sandbox(SOXR_SANDBOX_PATH, false);
+}
+
+template class SandboxedResampleEngine<rlbox::rlbox_wasm2c_sandbox>;
+
+std::unique_ptr<ResampleEngine>
+MakeWasm2cResampleEngine(const ResampleEngineSpec &spec)
+{
+   return
+      std::make_unique<SandboxedResampleEngine<rlbox::rlbox_wasm2c_sandbox>>(spec);
+}
@@ -0,0 +1,173 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   SoxrSandbox.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_SOXR_SANDBOX_H__
+#define __AUDACITY_SOXR_SANDBOX_H__
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// We're going to use RLBox in a single-threaded environment.
+// Each sandbox is leased by at most one Resample at a time, so no sandbox
+// ever sees invocations from two threads at once.
+#define RLBOX_SINGLE_THREADED_INVOCATIONS
+
+// Includers include the header of their backend after this one, and
+// before ResampleSandboxed.h
+#include "rlbox.hpp"
+
+#include <soxr.h>
+
+//! Where to find the wasm2c-compiled soxr; the build may override it
+#ifndef SOXR_SANDBOX_PATH
+#define SOXR_SANDBOX_PATH "../../../lib-src/libsoxr/sandbox/soxr.so"
+#endif
+
+/**
+ \class SoxrSandboxPool
+ \brief Process-wide pool of long-lived soxr sandboxes of one backend
+
+ Creating a wasm2c sandbox loads the module and maps a new linear memory,
+ which is far too expensive to do per block.  Each Resample leases one
+ sandbox from this pool for its whole lifetime instead, and the sandbox
+ goes back to the pool, still loaded, when the Resample is destroyed.
+
+ T_Sbx is the rlbox backend; each backend's translation unit specializes
+ CreateSandbox() and instantiates the pool it uses.
+ */
+template<typename T_Sbx>
+class SoxrSandboxPool final
+{
+public:
+   using Sandbox = rlbox::rlbox_sandbox<T_Sbx>;
+
+   //! Exclusive use of one sandbox; returns it to the pool on destruction
+   class Lease final
+   {
+   public:
+      Lease() = default;
+      Lease(Lease &&other) = default;
+      Lease &operator =(Lease &&other)
+      {
+         if (this != &other) {
+            if (mpSandbox)
+               SoxrSandboxPool::Get().Release(std::move(mpSandbox));
+            mpSandbox = std::move(other.mpSandbox);
+         }
+         return *this;
+      }
+      ~Lease()
+      {
+         if (mpSandbox)
+            SoxrSandboxPool::Get().Release(std::move(mpSandbox));
+      }
+
+      explicit operator bool() const { return mpSandbox != nullptr; }
+      Sandbox &operator *() const { return *mpSandbox; }
+      Sandbox *operator ->() const { return mpSandbox.get(); }
+
+   private:
+      friend SoxrSandboxPool;
+      explicit Lease(std::unique_ptr<Sandbox> pSandbox)
+         : mpSandbox{ std::move(pSandbox) }
+      {}
+
+      std::unique_ptr<Sandbox> mpSandbox;
+   };
+
+   static SoxrSandboxPool &Get()
+   {
+      static SoxrSandboxPool pool;
+      return pool;
+   }
+
+   SoxrSandboxPool() = default;
+   SoxrSandboxPool(const SoxrSandboxPool&) = delete;
+   SoxrSandboxPool &operator =(const SoxrSandboxPool&) = delete;
+   ~SoxrSandboxPool() { Clear(); }
+
+   //! Reuse an idle sandbox, or create one if none is idle
+   Lease Acquire()
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         if (!mIdle.empty()) {
+            auto pSandbox = std::move(mIdle.back());
+            mIdle.pop_back();
+            return Lease{ std::move(pSandbox) };
+         }
+      }
+
+      // Create outside of the lock; loading the module is the slow part
+      auto pSandbox = std::make_unique<Sandbox>();
+      if (!CreateSandbox(*pSandbox)) {
+         printf("ERROR: could not create soxr sandbox from %s\n",
+            SOXR_SANDBOX_PATH);
+         exit(1);
+      }
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         ++mCreated;
+      }
+      return Lease{ std::move(pSandbox) };
+   }
+
+   //! Destroy all idle sandboxes; leased ones are unaffected
+   void Clear()
+   {
+      decltype(mIdle) idle;
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         idle.swap(mIdle);
+      }
+      for (auto &pSandbox : idle)
+         pSandbox->destroy_sandbox();
+   }
+
+   size_t IdleCount() const
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      return mIdle.size();
+   }
+
+   //! Number of sandboxes created over the lifetime of the pool
+   size_t CreatedCount() const
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      return mCreated;
+   }
+
+   //! Idle sandboxes beyond this many are destroyed rather than kept
+   static constexpr size_t MaxIdle = 32;
+
+private:
+   //! Specialized per backend, which differ in their creation arguments
+   static bool CreateSandbox(Sandbox &sandbox);
+
+   void Release(std::unique_ptr<Sandbox> pSandbox)
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         if (mIdle.size() < MaxIdle) {
+            mIdle.push_back(std::move(pSandbox));
+            return;
+         }
+      }
+      pSandbox->destroy_sandbox();
+   }
+
+   mutable std::mutex mMutex;
+   std::vector<std::unique_ptr<Sandbox>> mIdle;
+   size_t mCreated{ 0 };
+};
+
+#endif // __AUDACITY_SOXR_SANDBOX_H__
@@ -0,0 +1,201 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file BatchedFFTTests.cpp
+ @brief Compare BatchedFFT and OverlapAddFilter, at every level, with the
+ scalar filtering of EffectEqualization
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "BatchedFFT.h"
+#include "OverlapAddFilter.h"
+#include "RealFFTf.h"
+#include "WorkStealingPool.h"
+
+using namespace BatchedFFT;
+
+namespace {
+
+//! Golden copy of EffectEqualization::Filter()
+void GoldenFilter(size_t len, float *buffer, const FFTParam *hFFT,
+   const float *filterR, const float *filterI, float *fftBuffer)
+{
+   float re, im;
+   RealFFTf(buffer, hFFT);
+   fftBuffer[0] = buffer[0] * filterR[0];
+   for (size_t i = 1; i < (len / 2); i++)
+   {
+      re = buffer[hFFT->BitReversed[i]  ];
+      im = buffer[hFFT->BitReversed[i]+1];
+      fftBuffer[2*i  ] = re*filterR[i] - im*filterI[i];
+      fftBuffer[2*i+1] = re*filterI[i] + im*filterR[i];
+   }
+   fftBuffer[1] = buffer[1] * filterR[len/2];
+   InverseRealFFTf(fftBuffer, hFFT);
+   ReorderToTime(hFFT, fftBuffer, buffer);
+}
+
+//! Golden copy of the loop of EffectEqualization::ProcessOne(), reading and
+//! writing a vector instead of tracks
+std::vector<float> GoldenProcess(const std::vector<float> &input,
+   size_t windowSize, size_t mM, size_t idealBlockLen,
+   const float *filterR, const float *filterI)
+{
+   const auto hFFT = GetFFT(windowSize);
+   std::vector<float> fftBuffer(windowSize), output;
+   size_t L = windowSize - (mM - 1);
+   // (ProcessOne's blocks are always longer than the tail)
+   std::vector<float> buffer(std::max(idealBlockLen, mM));
+   std::vector<float> window1(windowSize, 0), window2(windowSize, 0);
+   float *thisWindow = window1.data();
+   float *lastWindow = window2.data();
+   size_t wcopy = 0;
+   size_t s = 0, len = input.size();
+   while (len != 0)
+   {
+      auto block = std::min(idealBlockLen, len);
+      std::copy(input.begin() + s, input.begin() + s + block, buffer.begin());
+      for(size_t i = 0; i < block; i += L)
+      {
+         wcopy = std::min <size_t> (L, block - i);
+         for(size_t j = 0; j < wcopy; j++)
+            thisWindow[j] = buffer[i+j];
+         for(auto j = wcopy; j < windowSize; j++)
+            thisWindow[j] = 0;
+         GoldenFilter(windowSize, thisWindow, hFFT.get(),
+            filterR, filterI, fftBuffer.data());
+         for(size_t j = 0; (j < mM - 1) && (j < wcopy); j++)
+            buffer[i+j] = thisWindow[j] + lastWindow[L + j];
+         for(size_t j = mM - 1; j < wcopy; j++)
+            buffer[i+j] = thisWindow[j];
+         std::swap( thisWindow, lastWindow );
+      }
+      output.insert(output.end(), buffer.begin(), buffer.begin() + block);
+      len -= block;
+      s += block;
+   }
+   if(wcopy < (mM - 1)) {
+      size_t j = 0;
+      for(; j < mM - 1 - wcopy; j++)
+         buffer[j] = lastWindow[wcopy + j] + thisWindow[L + wcopy + j];
+      for( ; j < mM - 1; j++)
+         buffer[j] = lastWindow[wcopy + j];
+   } else {
+      for(size_t j = 0; j < mM - 1; j++)
+         buffer[j] = lastWindow[wcopy + j];
+   }
+   output.insert(output.end(), buffer.begin(), buffer.begin() + mM - 1);
+   return output;
+}
+
+std::vector<float> Random(size_t size, std::mt19937 &engine)
+{
+   std::uniform_real_distribution<float> distribution{ -1.0f, 1.0f };
+   std::vector<float> result(size);
+   for (auto &value : result)
+      value = distribution(engine);
+   return result;
+}
+
+bool Identical(const std::vector<float> &a, const std::vector<float> &b)
+{
+   return a.size() == b.size() &&
+      std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+const Level Levels[] = {
+   Level::Scalar, Level::SSE2, Level::AVX2, Level::AVX512 };
+
+}
+
+TEST_CASE("BatchedFFT::Filter matches EffectEqualization::Filter",
+   "[BatchedFFT]")
+{
+   std::mt19937 engine{ 2718 };
+   for (size_t windowSize : { 4, 64, 2048 }) {
+      const auto hFFT = GetFFT(windowSize);
+      const auto filterR = Random(windowSize / 2 + 1, engine);
+      const auto filterI = Random(windowSize / 2 + 1, engine);
+
+      // Not a multiple of any number of lanes
+      constexpr size_t nWindows = 21;
+      std::vector<std::vector<float>> golden;
+      std::vector<float> fftBuffer(windowSize);
+      for (size_t iWindow = 0; iWindow < nWindows; ++iWindow) {
+         golden.push_back(Random(windowSize, engine));
+      }
+      const auto input = golden;
+      for (auto &window : golden)
+         GoldenFilter(windowSize, window.data(), hFFT.get(),
+            filterR.data(), filterI.data(), fftBuffer.data());
+
+      for (auto level : Levels) {
+         if (!SetLevel(level))
+            continue;
+         INFO(LevelName(level) << ", window " << windowSize);
+         auto windows = input;
+         std::vector<float *> pointers;
+         for (auto &window : windows)
+            pointers.push_back(window.data());
+         std::vector<float> scratch(ScratchSize(windowSize));
+         Filter(*hFFT, filterR.data(), filterI.data(),
+            pointers.data(), nWindows, scratch.data());
+         for (size_t iWindow = 0; iWindow < nWindows; ++iWindow)
+            REQUIRE(Identical(windows[iWindow], golden[iWindow]));
+      }
+   }
+   SetLevel(BestLevel());
+}
+
+TEST_CASE("OverlapAddFilter matches EffectEqualization::ProcessOne",
+   "[BatchedFFT]")
+{
+   std::mt19937 engine{ 31415 };
+   constexpr size_t windowSize = 1024;
+   const auto filterR = Random(windowSize / 2 + 1, engine);
+   const auto filterI = Random(windowSize / 2 + 1, engine);
+   WorkStealingPool pool{ 4 };
+
+   // Short and long filters, blocks of few and many lumps, and signals
+   // that end with short and long last lumps
+   for (size_t mM : { 1, 101, 1001 })
+   for (size_t lumps : { 1, 37 })
+   for (size_t length : { 1, 777, 50000 }) {
+      const auto idealBlockLen = lumps * (windowSize - (mM - 1));
+      const auto input = Random(length, engine);
+      const auto golden = GoldenProcess(input, windowSize, mM,
+         idealBlockLen, filterR.data(), filterI.data());
+      for (auto level : Levels) {
+         if (!SetLevel(level))
+            continue;
+         for (auto pPool : { static_cast<WorkStealingPool*>(nullptr), &pool }) {
+            INFO(LevelName(level) << ", filter " << mM << ", block "
+               << idealBlockLen << ", length " << length
+               << (pPool ? ", threaded" : ""));
+            OverlapAddFilter filter{ windowSize, mM,
+               filterR.data(), filterI.data(), pPool };
+            std::vector<float> output, buffer(idealBlockLen + mM);
+            for (size_t s = 0; s < length; s += idealBlockLen) {
+               const auto block = std::min(idealBlockLen, length - s);
+               std::copy(input.begin() + s, input.begin() + s + block,
+                  buffer.begin());
+               filter.Process(buffer.data(), block);
+               output.insert(output.end(),
+                  buffer.begin(), buffer.begin() + block);
+            }
+            filter.Flush(buffer.data());
+            output.insert(output.end(),
+               buffer.begin(), buffer.begin() + mM - 1);
+            REQUIRE(Identical(output, golden));
+         }
+      }
+   }
+   SetLevel(BestLevel());
+}
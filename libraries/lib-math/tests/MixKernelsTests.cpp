@@ -0,0 +1,154 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file MixKernelsTests.cpp
+ @brief Compare every level of MixKernels with the loops they replace
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "MixKernels.h"
+
+namespace {
+
+using namespace MixKernels;
+
+// The loops as Mixer had them, except that the product is stored first, so
+// that the compiler cannot fuse it with the sum
+void ReferenceApplyEnvelope(float *buffer, const double *envelope, size_t len)
+{
+   for (size_t i = 0; i < len; ++i)
+      buffer[i] *= envelope[i];
+}
+
+void ReferenceMixAdd(float *dest, size_t stride,
+   const float *src, float gain, size_t len)
+{
+   for (size_t j = 0; j < len; j++) {
+      volatile float product = src[j] * gain;
+      *dest += product;
+      dest += stride;
+   }
+}
+
+struct RestoreLevel {
+   ~RestoreLevel() { SetLevel(BestLevel()); }
+};
+
+std::vector<float> RandomFloats(std::mt19937 &engine, size_t len)
+{
+   std::uniform_real_distribution<float> distribution{ -1.5f, 1.5f };
+   std::vector<float> result(len);
+   for (auto &value : result)
+      value = distribution(engine);
+   return result;
+}
+
+bool SameBits(const std::vector<float> &a, const std::vector<float> &b)
+{
+   return a.size() == b.size() && (a.empty() ||
+      0 == memcmp(a.data(), b.data(), a.size() * sizeof(float)));
+}
+
+}
+
+TEST_CASE("MixKernels levels", "[MixKernels]")
+{
+   REQUIRE(IsSupported(Level::Scalar));
+   REQUIRE(IsSupported(BestLevel()));
+   REQUIRE(GetLevel() == BestLevel());
+}
+
+TEST_CASE("ApplyEnvelope matches the scalar loop", "[MixKernels]")
+{
+   RestoreLevel restore;
+   std::mt19937 engine{ 2718 };
+   std::uniform_real_distribution<double> distribution{ 0.0, 4.0 };
+
+   for (auto level : { Level::Scalar, Level::SSE2, Level::AVX2, Level::NEON }) {
+      if (!SetLevel(level))
+         continue;
+      INFO(LevelName(level));
+
+      // Odd lengths and offsets exercise the tails and unaligned loads
+      for (size_t offset = 0; offset < 4; ++offset)
+         for (size_t len = 0; len < 70; ++len) {
+            auto samples = RandomFloats(engine, offset + len);
+            std::vector<double> envelope(offset + len);
+            for (auto &value : envelope)
+               value = distribution(engine);
+
+            auto expected = samples;
+            ReferenceApplyEnvelope(
+               expected.data() + offset, envelope.data() + offset, len);
+            ApplyEnvelope(samples.data() + offset,
+               envelope.data() + offset, len);
+            REQUIRE(SameBits(samples, expected));
+         }
+   }
+}
+
+TEST_CASE("MixAdd matches the scalar loop", "[MixKernels]")
+{
+   RestoreLevel restore;
+   std::mt19937 engine{ 31415 };
+
+   for (auto level : { Level::Scalar, Level::SSE2, Level::AVX2, Level::NEON }) {
+      if (!SetLevel(level))
+         continue;
+      INFO(LevelName(level));
+
+      for (size_t stride = 1; stride <= 3; ++stride)
+         for (size_t channel = 0; channel < stride; ++channel)
+            for (size_t len = 0; len < 70; ++len) {
+               // Exactly as long as the interleaved frames, so that a read
+               // past the end would be found by sanitizers
+               auto dest = RandomFloats(engine, len * stride);
+               const auto src = RandomFloats(engine, len);
+               const float gain = RandomFloats(engine, 1)[0];
+
+               auto expected = dest;
+               if (len > 0) {
+                  ReferenceMixAdd(expected.data() + channel, stride,
+                     src.data(), gain, len);
+                  MixAdd(dest.data() + channel, stride,
+                     src.data(), gain, len);
+               }
+               REQUIRE(SameBits(dest, expected));
+            }
+   }
+}
+
+TEST_CASE("Ramps are the same at every level", "[MixKernels]")
+{
+   RestoreLevel restore;
+
+   for (size_t len = 0; len < 70; ++len) {
+      std::vector<double> linear(len), exponential(len);
+      SetLevel(Level::Scalar);
+      LinearRamp(linear.data(), 0.25, 1.0 / 3, len);
+      ExponentialRamp(exponential.data(), 0.5, 1.001, len);
+      for (size_t i = 0; i < len; ++i) {
+         REQUIRE(linear[i] == Approx(0.25 + i * (1.0 / 3)));
+         REQUIRE(exponential[i] == Approx(0.5 * pow(1.001, i)));
+      }
+
+      for (auto level : { Level::SSE2, Level::AVX2, Level::NEON }) {
+         if (!SetLevel(level))
+            continue;
+         INFO(LevelName(level));
+         std::vector<double> otherLinear(len), otherExponential(len);
+         LinearRamp(otherLinear.data(), 0.25, 1.0 / 3, len);
+         ExponentialRamp(otherExponential.data(), 0.5, 1.001, len);
+         REQUIRE(otherLinear == linear);
+         REQUIRE(otherExponential == exponential);
+      }
+   }
+}
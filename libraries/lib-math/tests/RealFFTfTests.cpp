@@ -0,0 +1,85 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file RealFFTfTests.cpp
+ @brief Check sharing of FFT plans among threads, and their transforms
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "RealFFTf.h"
+
+namespace {
+// Direct power spectrum, to compare with the transform
+std::vector<double> Power(const std::vector<float> &samples)
+{
+   const auto size = samples.size();
+   std::vector<double> result(size / 2 + 1);
+   for (size_t k = 0; k <= size / 2; ++k) {
+      double re = 0, im = 0;
+      for (size_t n = 0; n < size; ++n) {
+         const auto angle = 2 * M_PI * k * n / size;
+         re += samples[n] * cos(angle);
+         im -= samples[n] * sin(angle);
+      }
+      result[k] = re * re + im * im;
+   }
+   return result;
+}
+}
+
+TEST_CASE("GetFFT shares one plan per size among threads", "[RealFFTf]")
+{
+   constexpr size_t nThreads = 8, MinLog2 = 2, MaxLog2 = 20;
+   std::vector<std::vector<const FFTParam*>> found(nThreads);
+   std::vector<std::thread> threads;
+   for (size_t iThread = 0; iThread < nThreads; ++iThread)
+      threads.emplace_back([&found, iThread]{
+         for (auto log2 = MinLog2; log2 <= MaxLog2; ++log2)
+            found[iThread].push_back(GetFFT(size_t(1) << log2).get());
+      });
+   for (auto &thread : threads)
+      thread.join();
+
+   for (auto log2 = MinLog2; log2 <= MaxLog2; ++log2) {
+      const auto pPlan = found[0][log2 - MinLog2];
+      REQUIRE(pPlan->Points == (size_t(1) << log2) / 2);
+      for (const auto &plans : found)
+         REQUIRE(plans[log2 - MinLog2] == pPlan);
+      // The plan outlived its handles
+      REQUIRE(GetFFT(size_t(1) << log2).get() == pPlan);
+   }
+}
+
+TEST_CASE("RealFFTf matches a direct transform", "[RealFFTf]")
+{
+   for (size_t size : { 4, 64, 1024 }) {
+      INFO("size " << size);
+      std::vector<float> samples(size);
+      for (size_t n = 0; n < size; ++n)
+         samples[n] = static_cast<float>(
+            sin(2 * M_PI * 3 * n / size) + 0.25 * cos(2 * M_PI * n / 7));
+      const auto expected = Power(samples);
+
+      const auto hFFT = GetFFT(size);
+      auto buffer = samples;
+      RealFFTf(buffer.data(), hFFT.get());
+      const auto scale = double(size) * size;
+      REQUIRE(buffer[0] * buffer[0] / scale
+         == Approx(expected[0] / scale).margin(1e-5));
+      REQUIRE(buffer[1] * buffer[1] / scale
+         == Approx(expected[size / 2] / scale).margin(1e-5));
+      for (size_t k = 1; k < size / 2; ++k) {
+         const double re = buffer[hFFT->BitReversed[k]];
+         const double im = buffer[hFFT->BitReversed[k] + 1];
+         REQUIRE((re * re + im * im) / scale
+            == Approx(expected[k] / scale).margin(1e-5));
+      }
+   }
+}
@@ -0,0 +1,150 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file ResampleEngineTests.cpp
+ @brief Check that each engine gives the same output wherever the caller's
+ buffers are
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "ResampleEngine.h"
+
+namespace {
+
+constexpr unsigned NumChannels = 2;
+constexpr double Factor = 0.75;
+constexpr size_t TotalLen = 10000;
+constexpr size_t BlockLen = 1024;
+constexpr size_t OutLen = 2048;
+
+enum class Backend { Native, Noop, Wasm2c };
+
+std::unique_ptr<ResampleEngine> MakeEngine(Backend backend)
+{
+   // Medium quality, constant rate
+   const ResampleEngineSpec spec{ 1, Factor, Factor, NumChannels };
+   switch (backend) {
+#ifdef AUDACITY_RESAMPLE_SANDBOXES
+   case Backend::Noop:
+      return MakeNoopResampleEngine(spec);
+   case Backend::Wasm2c:
+      return MakeWasm2cResampleEngine(spec);
+#endif
+   default:
+      return MakeNativeResampleEngine(spec);
+   }
+}
+
+std::vector<std::vector<float>> MakeInput()
+{
+   std::vector<std::vector<float>> input(NumChannels);
+   for (unsigned iChannel = 0; iChannel < NumChannels; ++iChannel) {
+      input[iChannel].resize(TotalLen);
+      for (size_t i = 0; i < TotalLen; ++i)
+         input[iChannel][i] =
+            std::sin(0.01 * (iChannel + 1) * i) * (0.5 + 0.25 * iChannel);
+   }
+   return input;
+}
+
+/*!
+ @param arenaOffsets per channel, where in the engine's own buffers to put
+ the input and output, or -1 to use buffers of the caller
+ */
+std::vector<std::vector<float>> Run(Backend backend,
+   const std::vector<std::vector<float>> &input,
+   const std::vector<int> &arenaOffsets)
+{
+   const auto pEngine = MakeEngine(backend);
+   // Request the same lengths for every channel, so that no request grows
+   // the buffers and invalidates pointers to the others
+   const size_t reserve = std::max(0,
+      *std::max_element(arenaOffsets.begin(), arenaOffsets.end()));
+   std::vector<std::vector<float>> output(NumChannels);
+   std::vector<std::vector<float>> hostIn(NumChannels), hostOut(NumChannels);
+   std::vector<float*> inBuffers(NumChannels), outBuffers(NumChannels);
+   for (unsigned iChannel = 0; iChannel < NumChannels; ++iChannel) {
+      hostIn[iChannel].resize(BlockLen);
+      hostOut[iChannel].resize(OutLen);
+   }
+
+   size_t pos = 0;
+   while (true) {
+      const auto len = std::min(BlockLen, TotalLen - pos);
+      const bool last = (pos + len == TotalLen);
+      for (unsigned iChannel = 0; iChannel < NumChannels; ++iChannel) {
+         const auto offset = arenaOffsets[iChannel];
+         if (offset < 0) {
+            inBuffers[iChannel] = hostIn[iChannel].data();
+            outBuffers[iChannel] = hostOut[iChannel].data();
+         }
+         else {
+            inBuffers[iChannel] =
+               pEngine->GetInputBuffer(reserve + BlockLen, iChannel) + offset;
+            outBuffers[iChannel] =
+               pEngine->GetOutputBuffer(reserve + OutLen, iChannel) + offset;
+         }
+      }
+      for (unsigned iChannel = 0; iChannel < NumChannels; ++iChannel)
+         std::memcpy(inBuffers[iChannel], input[iChannel].data() + pos,
+            len * sizeof(float));
+
+      const auto [idone, odone] = pEngine->Process(Factor,
+         inBuffers.data(), len, last, outBuffers.data(), OutLen);
+      for (unsigned iChannel = 0; iChannel < NumChannels; ++iChannel)
+         output[iChannel].insert(output[iChannel].end(),
+            outBuffers[iChannel], outBuffers[iChannel] + odone);
+      pos += idone;
+      if (last && idone == len && odone == 0)
+         break;
+   }
+   return output;
+}
+
+void CheckLayouts(Backend backend)
+{
+   const auto input = MakeInput();
+   const auto expected = Run(backend, input, { -1, -1 });
+   REQUIRE(expected[0].size() > TotalLen * Factor * 0.9);
+
+   // Each channel in the engine's buffers or not, and at an offset or not
+   const std::vector<std::vector<int>> layouts{
+      { 0, 0 }, { 0, -1 }, { -1, 0 },
+      { 37, -1 }, { -1, 37 }, { 37, 0 }, { 37, 101 },
+   };
+   for (const auto &layout : layouts) {
+      const auto actual = Run(backend, input, layout);
+      for (unsigned iChannel = 0; iChannel < NumChannels; ++iChannel) {
+         INFO("layout " << layout[0] << ", " << layout[1]
+            << "; channel " << iChannel);
+         CHECK(actual[iChannel] == expected[iChannel]);
+      }
+   }
+}
+
+}
+
+TEST_CASE("Native ResampleEngine buffers", "[Resample]")
+{
+   CheckLayouts(Backend::Native);
+}
+
+#ifdef AUDACITY_RESAMPLE_SANDBOXES
+TEST_CASE("Noop sandboxed ResampleEngine buffers", "[Resample]")
+{
+   CheckLayouts(Backend::Noop);
+}
+
+TEST_CASE("Wasm2c sandboxed ResampleEngine buffers", "[Resample]")
+{
+   CheckLayouts(Backend::Wasm2c);
+}
+#endif
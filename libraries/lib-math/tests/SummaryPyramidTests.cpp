@@ -0,0 +1,75 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file SummaryPyramidTests.cpp
+ @brief Compare reduced levels of SummaryPyramid with direct summaries
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <vector>
+
+#include "SummaryPyramid.h"
+
+using namespace SummaryPyramid;
+
+TEST_CASE("SummaryPyramid levels", "[SummaryPyramid]")
+{
+   REQUIRE(!IsLevel(1));
+   REQUIRE(!IsLevel(32));
+   REQUIRE(IsLevel(MinDivisor));
+   REQUIRE(IsLevel(256));
+   REQUIRE(IsLevel(MaxDivisor));
+   REQUIRE(!IsLevel(MaxDivisor * Factor));
+
+   REQUIRE(DivisorFor(0.5) == 1);
+   REQUIRE(DivisorFor(15.9) == 1);
+   REQUIRE(DivisorFor(16) == 16);
+   REQUIRE(DivisorFor(63) == 16);
+   REQUIRE(DivisorFor(64) == 64);
+   REQUIRE(DivisorFor(1000) == 256);
+   REQUIRE(DivisorFor(1e9) == MaxDivisor);
+
+   // Frames per column stay within one factor at every zoom
+   for (double samplesPerColumn = MinDivisor;
+        samplesPerColumn < MaxDivisor * Factor; samplesPerColumn *= 1.3) {
+      const auto framesPerColumn =
+         samplesPerColumn / DivisorFor(samplesPerColumn);
+      REQUIRE(framesPerColumn >= 1);
+      REQUIRE(framesPerColumn < Factor);
+   }
+}
+
+TEST_CASE("Reduced levels match direct summaries", "[SummaryPyramid]")
+{
+   std::mt19937 engine{ 1414 };
+   std::uniform_real_distribution<float> distribution{ -1.0f, 1.0f };
+
+   // Lengths that do and don't fill the last frames
+   for (size_t nSamples : { 1, 15, 16, 1000, 4096, 70001 }) {
+      std::vector<float> samples(nSamples);
+      for (auto &sample : samples)
+         sample = distribution(engine);
+
+      std::vector<float> finer(Fields * Frames(nSamples, MinDivisor));
+      Summarize(samples.data(), nSamples, MinDivisor, finer.data());
+      for (auto divisor = MinDivisor * Factor; divisor <= MaxDivisor;
+           divisor *= Factor) {
+         INFO("samples " << nSamples << ", divisor " << divisor);
+         const auto nFrames = Frames(nSamples, divisor);
+         std::vector<float> reduced(Fields * nFrames), direct(Fields * nFrames);
+         Reduce(finer.data(), divisor / Factor, nSamples, Factor,
+            reduced.data());
+         Summarize(samples.data(), nSamples, divisor, direct.data());
+         for (size_t ii = 0; ii < reduced.size(); ii += Fields) {
+            REQUIRE(reduced[ii] == direct[ii]);
+            REQUIRE(reduced[ii + 1] == direct[ii + 1]);
+            REQUIRE(reduced[ii + 2] == Approx(direct[ii + 2]).epsilon(1e-5));
+         }
+         finer.swap(reduced);
+      }
+   }
+}
@@ -24,14 +24,19 @@
 #include "Mix.h"
 
 #include <cmath>
+#include <optional>
 
 #include "Envelope.h"
+#include "MixKernels.h"
 #include "SampleTrack.h"
 #include "SampleTrackCache.h"
 #include "Prefs.h"
 #include "Resample.h"
+#include "WorkStealingPool.h"
 #include "float_cast.h"
 
+IntSetting MixerThreads{ L"/Performance/MixerThreads", 0 };
+
 Mixer::WarpOptions::WarpOptions(const TrackList &list)
 : envelope(DefaultWarp::Call(list)), minSpeed(0.0), maxSpeed(0.0)
 {
@@ -61,6 +66,22 @@ Mixer::WarpOptions::WarpOptions(double min, double max, double initial)
    }
 }
 
+namespace {
+//! Whether right is the second channel of the two-channel group led by left
+/*! Adjacent Left and Right tracks in the input array are not necessarily
+ channels of one track; only their group in the TrackList says so */
+bool IsStereoPair(const SampleTrack &left, const SampleTrack &right)
+{
+   if (left.GetLinkType() == Track::LinkType::None || !left.HasOwner())
+      return false;
+   const auto channels = TrackList::Channels(&left);
+   if (channels.size() != 2)
+      return false;
+   auto iter = channels.begin();
+   return *iter == &left && *++iter == &right;
+}
+}
+
 Mixer::Mixer(const SampleTrackConstArray &inputTracks,
              bool mayThrow,
              const WarpOptions &warpOptions,
@@ -75,11 +96,11 @@ Mixer::Mixer(const SampleTrackConstArray &inputTracks,
    // This is the number of samples grabbed in one go from a track
    // and placed in a queue, when mixing with resampling.
    // (Should we use SampleTrack::GetBestBlockSize instead?)
+   // The queue itself is the resampler's input buffer, so that a sandboxed
+   // resampler reads it in place.
    , mQueueMaxLen{ 65536 }
-   , mSampleQueue{ mNumInputTracks, mQueueMaxLen }
 
    , mNumChannels{ numOutChannels }
-   , mGains{ mNumChannels }
 
    , mFormat{ outFormat }
    , mRate{ outRate }
@@ -124,24 +145,40 @@ Mixer::Mixer(const SampleTrackConstArray &inputTracks,
       mBuffer[c].Allocate(mInterleavedBufferSize, mFormat);
       mTemp[c].reinit(mInterleavedBufferSize);
    }
-   // PRL:  Bug2536: see other comments below
-   mFloatBuffer = Floats{ mInterleavedBufferSize + 1 };
 
    // But cut the queue into blocks of this finer size
    // for variable rate resampling.  Each block is resampled at some
    // constant rate.
    mProcessLen = 1024;
 
+   // Resample the channels of a stereo track together, in one call
+   for (size_t i = 0; i < mNumInputTracks;) {
+      unsigned nChannels = 1;
+      const auto &track = inputTracks[i];
+      if (track->GetChannel() == Track::LeftChannel &&
+          i + 1 < mNumInputTracks &&
+          inputTracks[i + 1]->GetChannel() == Track::RightChannel &&
+          inputTracks[i + 1]->GetRate() == track->GetRate() &&
+          IsStereoPair(*track, *inputTracks[i + 1]))
+         nChannels = 2;
+      mGroups.push_back({ i, nChannels });
+      i += nChannels;
+   }
+   const auto numGroups = mGroups.size();
+
    // Position in each queue of the start of the next block to resample.
-   mQueueStart.reinit(mNumInputTracks);
+   mQueueStart.reinit(numGroups);
 
    // For each queue, the number of available samples after the queue start.
-   mQueueLen.reinit(mNumInputTracks);
-   mResample.reinit(mNumInputTracks);
-   mMinFactor.resize(mNumInputTracks);
-   mMaxFactor.resize(mNumInputTracks);
-   for (size_t i = 0; i<mNumInputTracks; i++) {
-      double factor = (mRate / mInputTrack[i].GetTrack()->GetRate());
+   mQueueLen.reinit(numGroups);
+   mResample.reinit(numGroups);
+   // Value-initialized, so none is pending
+   mResetPending.reinit(numGroups, true);
+   mMinFactor.resize(numGroups);
+   mMaxFactor.resize(numGroups);
+   for (size_t i = 0; i<numGroups; i++) {
+      const auto track = mInputTrack[mGroups[i].first].GetTrack();
+      double factor = (mRate / track->GetRate());
       if (mEnvelope) {
          // variable rate resampling
          mbVariableRates = true;
@@ -166,8 +203,35 @@ Mixer::Mixer(const SampleTrackConstArray &inputTracks,
 
    MakeResamplers();
 
+   // Tracks that are not resampled are fetched into buffers of their own,
+   // so that all can be fetched before any are mixed
+   mTrackSamples.resize(mNumInputTracks);
+   mTrackBuffers.reinit(mNumInputTracks);
+   for (size_t i = 0; i < numGroups; i++) {
+      const auto &group = mGroups[i];
+      const auto track = mInputTrack[group.first].GetTrack();
+      if (!(mbVariableRates || track->GetRate() != mRate))
+         for (auto j = group.first; j < group.first + group.nChannels; j++)
+            mTrackBuffers[j].reinit(mBufferSize);
+   }
+   mTrackFlags.resize(mNumInputTracks * mNumChannels);
+   mTrackGains.resize(mNumInputTracks * mNumChannels);
+
+   // Groups, and spans of the mix, may be done in parallel on the shared
+   // pool, by up to the number of threads allowed
+   const auto threads = MixerThreads.Read();
+   mMaxWorkers = threads > 0
+      ? static_cast<unsigned>(threads)
+      : WorkStealingPool::DefaultConcurrency();
+
    const auto envLen = std::max(mQueueMaxLen, mInterleavedBufferSize);
-   mEnvValues.reinit(envLen);
+   const auto nEnvValues = std::max<size_t>(1,
+      std::min<size_t>(mNumInputTracks, mMaxWorkers));
+   mEnvValues.resize(nEnvValues);
+   for (auto &envValues : mEnvValues)
+      envValues.reinit(envLen);
+   mParallelGroups.reserve(numGroups);
+   mSameRateTracks.reserve(mNumInputTracks);
 }
 
 Mixer::~Mixer()
@@ -176,41 +240,23 @@ Mixer::~Mixer()
 
 void Mixer::MakeResamplers()
 {
-   for (size_t i = 0; i < mNumInputTracks; i++)
-      mResample[i] = std::make_unique<Resample>(mHighQuality, mMinFactor[i], mMaxFactor[i]);
+   for (size_t i = 0; i < mGroups.size(); i++)
+      mResample[i] = std::make_unique<Resample>(mHighQuality,
+         mMinFactor[i], mMaxFactor[i], mGroups[i].nChannels);
 }
 
-void Mixer::Clear()
+void Mixer::ResetResamplers()
 {
-   for (unsigned int c = 0; c < mNumBuffers; c++) {
-      memset(mTemp[c].get(), 0, mInterleavedBufferSize * sizeof(float));
-   }
+   // Each group resets its own when next it resamples, so that the others
+   // do not reset at all
+   for (size_t i = 0; i < mGroups.size(); i++)
+      mResetPending[i] = true;
 }
 
-static void MixBuffers(unsigned numChannels, int *channelFlags, float *gains,
-                const float *src, Floats *dests,
-                int len, bool interleaved)
+void Mixer::Clear()
 {
-   for (unsigned int c = 0; c < numChannels; c++) {
-      if (!channelFlags[c])
-         continue;
-
-      float *dest;
-      unsigned skip;
-
-      if (interleaved) {
-         dest = dests[0].get() + c;
-         skip = numChannels;
-      } else {
-         dest = dests[c].get();
-         skip = 1;
-      }
-
-      float gain = gains[c];
-      for (int j = 0; j < len; j++) {
-         *dest += src[j] * gain;   // the actual mixing process
-         dest += skip;
-      }
+   for (unsigned int c = 0; c < mNumBuffers; c++) {
+      memset(mTemp[c].get(), 0, mInterleavedBufferSize * sizeof(float));
    }
 }
 
@@ -234,17 +280,37 @@ double ComputeWarpFactor(const Envelope &env, double t0, double t1)
 
 }
 
-size_t Mixer::MixVariableRates(int *channelFlags, SampleTrackCache &cache,
-                                    sampleCount *pos, float *queue,
+size_t Mixer::MixVariableRates(const ChannelGroup &group,
                                     int *queueStart, int *queueLen,
-                                    Resample * pResample)
+                                    Resample * pResample, double *envValues)
 {
-   const auto track = cache.GetTrack().get();
-   const double trackRate = track->GetRate();
+   const auto nChannels = group.nChannels;
+   const auto leader = mInputTrack[group.first].GetTrack().get();
+   const double trackRate = leader->GetRate();
    const double initialWarp = mRate / mSpeed / trackRate;
    const double tstep = 1.0 / trackRate;
    auto sampleSize = SAMPLE_SIZE(floatSample);
 
+   // The channels of the group advance in step
+   sampleCount *const pos = &mSamplePos[group.first];
+
+   // Fill and drain the resampler's own buffers, avoiding copies when it
+   // runs sandboxed.
+   // PRL:  Bug2536: crash in soxr happened on Mac, sometimes, when
+   // mMaxOut - out == 1 and &floatBuffer[out + 1] was an unmapped
+   // address, because soxr, strangely, fetched an 8-byte (misaligned!)
+   // value from &floatBuffer[out], but did nothing with it anyway,
+   // in soxr_output_no_callback.
+   // Now we make the bug go away by allocating a little more space in
+   // the buffer than we need.
+   float *queues[MaxChannelsPerGroup];
+   float *floatBuffers[MaxChannelsPerGroup];
+   for (unsigned c = 0; c < nChannels; ++c) {
+      queues[c] = pResample->GetInputBuffer(mQueueMaxLen, c);
+      floatBuffers[c] =
+         pResample->GetOutputBuffer(mInterleavedBufferSize + 1, c);
+   }
+
    decltype(mMaxOut) out = 0;
 
    /* time is floating point. Sample rate is integer. The number of samples
@@ -258,31 +324,42 @@ size_t Mixer::MixVariableRates(int *channelFlags, SampleTrackCache &cache,
     *       to calculate the position.
     */
 
-   // Find the last sample
-   double endTime = track->GetEndTime();
-   double startTime = track->GetStartTime();
+   // Find the last sample of any channel of the group
+   double endTime = leader->GetEndTime();
+   double startTime = leader->GetStartTime();
+   for (unsigned c = 1; c < nChannels; ++c) {
+      const auto track = mInputTrack[group.first + c].GetTrack().get();
+      endTime = std::max(endTime, track->GetEndTime());
+      startTime = std::min(startTime, track->GetStartTime());
+   }
    const bool backwards = (mT1 < mT0);
    const double tEnd = backwards
       ? std::max(startTime, mT1)
       : std::min(endTime, mT1);
-   const auto endPos = track->TimeToLongSamples(tEnd);
+   const auto endPos = leader->TimeToLongSamples(tEnd);
    // Find the time corresponding to the start of the queue, for use with time track
    double t = ((*pos).as_long_long() +
                (backwards ? *queueLen : - *queueLen)) / trackRate;
 
    while (out < mMaxOut) {
       if (*queueLen < (int)mProcessLen) {
-         // Shift pending portion to start of the buffer
-         memmove(queue, &queue[*queueStart], (*queueLen) * sampleSize);
-         *queueStart = 0;
-
          auto getLen = limitSampleBufferSize(
             mQueueMaxLen - *queueLen,
             backwards ? *pos - endPos : endPos - *pos
          );
 
-         // Nothing to do if past end of play interval
-         if (getLen > 0) {
+         for (unsigned c = 0; c < nChannels; ++c) {
+            auto &cache = mInputTrack[group.first + c];
+            const auto track = cache.GetTrack().get();
+            float *const queue = queues[c];
+
+            // Shift pending portion to start of the buffer
+            memmove(queue, &queue[*queueStart], (*queueLen) * sampleSize);
+
+            // Nothing to do if past end of play interval
+            if (getLen == 0)
+               continue;
+
             if (backwards) {
                auto results =
                   cache.GetFloats(*pos - (getLen - 1), getLen, mMayThrow);
@@ -291,10 +368,9 @@ size_t Mixer::MixVariableRates(int *channelFlags, SampleTrackCache &cache,
                else
                   memset(&queue[*queueLen], 0, sizeof(float) * getLen);
 
-               track->GetEnvelopeValues(mEnvValues.get(),
+               track->GetEnvelopeValues(envValues,
                                         getLen,
                                         (*pos - (getLen- 1)).as_double() / trackRate);
-               *pos -= getLen;
             }
             else {
                auto results = cache.GetFloats(*pos, getLen, mMayThrow);
@@ -303,21 +379,24 @@ size_t Mixer::MixVariableRates(int *channelFlags, SampleTrackCache &cache,
                else
                   memset(&queue[*queueLen], 0, sizeof(float) * getLen);
 
-               track->GetEnvelopeValues(mEnvValues.get(),
+               track->GetEnvelopeValues(envValues,
                                         getLen,
                                         (*pos).as_double() / trackRate);
-
-               *pos += getLen;
             }
 
-            for (decltype(getLen) i = 0; i < getLen; i++) {
-               queue[(*queueLen) + i] *= mEnvValues[i];
-            }
+            MixKernels::ApplyEnvelope(&queue[*queueLen], envValues, getLen);
 
             if (backwards)
                ReverseSamples((samplePtr)&queue[0], floatSample,
                               *queueLen, getLen);
+         }
+         *queueStart = 0;
 
+         if (getLen > 0) {
+            if (backwards)
+               *pos -= getLen;
+            else
+               *pos += getLen;
             *queueLen += getLen;
          }
       }
@@ -331,6 +410,8 @@ size_t Mixer::MixVariableRates(int *channelFlags, SampleTrackCache &cache,
       double factor = initialWarp;
       if (mEnvelope)
       {
+         std::lock_guard<std::mutex> lock{ mWarpMutex };
+
          //TODO-MB: The end time is wrong when the resampler doesn't use all input samples,
          //         as a result of this the warp factor may be slightly wrong, so AudioIO will stop too soon
          //         or too late (resulting in missing sound or inserted silence). This can't be fixed
@@ -344,18 +425,18 @@ size_t Mixer::MixVariableRates(int *channelFlags, SampleTrackCache &cache,
                t, t + (double)thisProcessLen / trackRate);
       }
 
+      // All channels of the group cross into the resampler at once
+      float *inputs[MaxChannelsPerGroup];
+      float *outputs[MaxChannelsPerGroup];
+      for (unsigned c = 0; c < nChannels; ++c) {
+         inputs[c] = &queues[c][*queueStart];
+         outputs[c] = &floatBuffers[c][out];
+      }
       auto results = pResample->Process(factor,
-         &queue[*queueStart],
+         inputs,
          thisProcessLen,
          last,
-         // PRL:  Bug2536: crash in soxr happened on Mac, sometimes, when
-         // mMaxOut - out == 1 and &mFloatBuffer[out + 1] was an unmapped
-         // address, because soxr, strangely, fetched an 8-byte (misaligned!)
-         // value from &mFloatBuffer[out], but did nothing with it anyway,
-         // in soxr_output_no_callback.
-         // Now we make the bug go away by allocating a little more space in
-         // the buffer than we need.
-         &mFloatBuffer[out],
+         outputs,
          mMaxOut - out);
 
       const auto input_used = results.first;
@@ -369,29 +450,22 @@ size_t Mixer::MixVariableRates(int *channelFlags, SampleTrackCache &cache,
       }
    }
 
-   for (size_t c = 0; c < mNumChannels; c++) {
-      if (mApplyTrackGains) {
-         mGains[c] = track->GetChannelGain(c);
-      }
-      else {
-         mGains[c] = 1.0;
-      }
+   for (unsigned c = 0; c < nChannels; ++c) {
+      const auto iTrack = group.first + c;
+      mSamplePos[iTrack] = *pos;
+      mTrackSamples[iTrack] = { floatBuffers[c], out };
    }
 
-   MixBuffers(mNumChannels,
-              channelFlags,
-              mGains.get(),
-              mFloatBuffer.get(),
-              mTemp.get(),
-              out,
-              mInterleaved);
-
    return out;
 }
 
-size_t Mixer::MixSameRate(int *channelFlags, SampleTrackCache &cache,
-                               sampleCount *pos)
+size_t Mixer::MixSameRate(size_t iTrack, double *envValues)
 {
+   auto &cache = mInputTrack[iTrack];
+   sampleCount *const pos = &mSamplePos[iTrack];
+   float *const floatBuffer = mTrackBuffers[iTrack].get();
+   mTrackSamples[iTrack] = { floatBuffer, 0 };
+
    const auto track = cache.GetTrack().get();
    const double t = ( *pos ).as_double() / track->GetRate();
    const double trackEndTime = track->GetEndTime();
@@ -416,39 +490,134 @@ size_t Mixer::MixSameRate(int *channelFlags, SampleTrackCache &cache,
    if (backwards) {
       auto results = cache.GetFloats(*pos - (slen - 1), slen, mMayThrow);
       if (results)
-         memcpy(mFloatBuffer.get(), results, sizeof(float) * slen);
+         memcpy(floatBuffer, results, sizeof(float) * slen);
       else
-         memset(mFloatBuffer.get(), 0, sizeof(float) * slen);
-      track->GetEnvelopeValues(mEnvValues.get(), slen, t - (slen - 1) / mRate);
-      for(decltype(slen) i = 0; i < slen; i++)
-         mFloatBuffer[i] *= mEnvValues[i]; // Track gain control will go here?
-      ReverseSamples((samplePtr)mFloatBuffer.get(), floatSample, 0, slen);
+         memset(floatBuffer, 0, sizeof(float) * slen);
+      track->GetEnvelopeValues(envValues, slen, t - (slen - 1) / mRate);
+      MixKernels::ApplyEnvelope(floatBuffer, envValues, slen);
+      ReverseSamples((samplePtr)floatBuffer, floatSample, 0, slen);
 
       *pos -= slen;
    }
    else {
       auto results = cache.GetFloats(*pos, slen, mMayThrow);
       if (results)
-         memcpy(mFloatBuffer.get(), results, sizeof(float) * slen);
+         memcpy(floatBuffer, results, sizeof(float) * slen);
       else
-         memset(mFloatBuffer.get(), 0, sizeof(float) * slen);
-      track->GetEnvelopeValues(mEnvValues.get(), slen, t);
-      for(decltype(slen) i = 0; i < slen; i++)
-         mFloatBuffer[i] *= mEnvValues[i]; // Track gain control will go here?
+         memset(floatBuffer, 0, sizeof(float) * slen);
+      track->GetEnvelopeValues(envValues, slen, t);
+      MixKernels::ApplyEnvelope(floatBuffer, envValues, slen);
 
       *pos += slen;
    }
 
-   for(size_t c=0; c<mNumChannels; c++)
-      if (mApplyTrackGains)
-         mGains[c] = track->GetChannelGain(c);
-      else
-         mGains[c] = 1.0;
+   mTrackSamples[iTrack].len = slen;
+   return slen;
+}
 
-   MixBuffers(mNumChannels, channelFlags, mGains.get(),
-              mFloatBuffer.get(), mTemp.get(), slen, mInterleaved);
+void Mixer::ComputeChannelFlags(size_t iTrack, int *channelFlags) const
+{
+   const auto track = mInputTrack[iTrack].GetTrack().get();
+   for(size_t j=0; j<mNumChannels; j++)
+      channelFlags[j] = 0;
+
+   if( mMixerSpec ) {
+      //ignore left and right when downmixing is not required
+      for(size_t j = 0; j < mNumChannels; j++ )
+         channelFlags[ j ] = mMixerSpec->mMap[ iTrack ][ j ] ? 1 : 0;
+   }
+   else {
+      switch(track->GetChannel()) {
+      case Track::MonoChannel:
+      default:
+         for(size_t j=0; j<mNumChannels; j++)
+            channelFlags[j] = 1;
+         break;
+      case Track::LeftChannel:
+         channelFlags[0] = 1;
+         break;
+      case Track::RightChannel:
+         if (mNumChannels >= 2)
+            channelFlags[1] = 1;
+         else
+            channelFlags[0] = 1;
+         break;
+      }
+   }
+}
 
-   return slen;
+bool Mixer::Resamples(size_t iGroup) const
+{
+   const auto leader = mInputTrack[mGroups[iGroup].first].GetTrack().get();
+   return mbVariableRates || leader->GetRate() != mRate;
+}
+
+void Mixer::ResampleGroup(size_t iGroup, double *envValues)
+{
+   const auto &group = mGroups[iGroup];
+   if (mResetPending[iGroup]) {
+      mResetPending[iGroup] = false;
+      mResample[iGroup]->Reset();
+   }
+   MixVariableRates(group, &mQueueStart[iGroup], &mQueueLen[iGroup],
+      mResample[iGroup].get(), envValues);
+}
+
+void Mixer::Accumulate(size_t len, WorkStealingPool *pPool)
+{
+   for (size_t i = 0; i < mNumInputTracks; i++) {
+      const auto track = mInputTrack[i].GetTrack().get();
+      ComputeChannelFlags(i, &mTrackFlags[i * mNumChannels]);
+      for (size_t c = 0; c < mNumChannels; c++)
+         mTrackGains[i * mNumChannels + c] =
+            mApplyTrackGains ? track->GetChannelGain(c) : 1.0;
+   }
+
+   // Each output sample is summed over the tracks in their order, by
+   // whichever thread, so the result does not depend on the number of
+   // threads, and equals that of adding in each track just after fetching
+   // it.  A tree of partial sums would round differently.
+   // Split the work into spans of samples, and, unless interleaved, into
+   // channels.
+   constexpr size_t SpanLen = 4096;
+   const size_t nSpans = std::max<size_t>(1, (len + SpanLen - 1) / SpanLen);
+   const size_t nChannelTasks = mInterleaved ? 1 : mNumChannels;
+   auto mix = [&](size_t iTask, unsigned) {
+      const auto begin = (iTask % nSpans) * SpanLen;
+      const auto end = std::min(len, begin + SpanLen);
+      const auto cFirst = mInterleaved ? 0 : iTask / nSpans;
+      const auto cLast = mInterleaved ? mNumChannels : cFirst + 1;
+      for (auto c = cFirst; c < cLast; c++) {
+         float *dest;
+         unsigned skip;
+         if (mInterleaved) {
+            dest = mTemp[0].get() + c;
+            skip = mNumChannels;
+         }
+         else {
+            dest = mTemp[c].get();
+            skip = 1;
+         }
+
+         for (size_t i = 0; i < mNumInputTracks; i++) {
+            if (!mTrackFlags[i * mNumChannels + c])
+               continue;
+            const auto &samples = mTrackSamples[i];
+            const auto trackEnd = std::min(end, samples.len);
+            if (trackEnd > begin)
+               MixKernels::MixAdd(dest + begin * skip, skip,
+                  samples.samples + begin,
+                  mTrackGains[i * mNumChannels + c], trackEnd - begin);
+         }
+      }
+   };
+
+   const auto nTasks = nChannelTasks * nSpans;
+   if (pPool && nTasks > 1)
+      pPool->ForEach(nTasks, mix, mMaxWorkers);
+   else
+      for (size_t iTask = 0; iTask < nTasks; iTask++)
+         mix(iTask, 0);
 }
 
 size_t Mixer::Process(size_t maxToProcess)
@@ -459,48 +628,59 @@ size_t Mixer::Process(size_t maxToProcess)
    //   return 0;
 
    decltype(Process(0)) maxOut = 0;
-   ArrayOf<int> channelFlags{ mNumChannels };
 
    mMaxOut = maxToProcess;
 
-   Clear();
-   for(size_t i=0; i<mNumInputTracks; i++) {
-      const auto track = mInputTrack[i].GetTrack().get();
-      for(size_t j=0; j<mNumChannels; j++)
-         channelFlags[j] = 0;
-
-      if( mMixerSpec ) {
-         //ignore left and right when downmixing is not required
-         for(size_t j = 0; j < mNumChannels; j++ )
-            channelFlags[ j ] = mMixerSpec->mMap[ i ][ j ] ? 1 : 0;
-      }
-      else {
-         switch(track->GetChannel()) {
-         case Track::MonoChannel:
-         default:
-            for(size_t j=0; j<mNumChannels; j++)
-               channelFlags[j] = 1;
-            break;
-         case Track::LeftChannel:
-            channelFlags[0] = 1;
-            break;
-         case Track::RightChannel:
-            if (mNumChannels >= 2)
-               channelFlags[1] = 1;
-            else
-               channelFlags[0] = 1;
-            break;
-         }
+   // Without the shared pool, because another user holds it, or because
+   // only one thread is allowed, all is done on this thread
+   std::optional<WorkStealingPool::SharedLease> lease;
+   if (mMaxWorkers > 1)
+      lease.emplace();
+   const auto pPool = lease ? lease->get() : nullptr;
+
+   // Fetch, apply envelopes and resample each group independently of the
+   // others, into buffers of its own.  Tracks that need no resampling, and
+   // groups that resample natively, are done in parallel.  A sandboxed
+   // resampler must not be called from several threads (see SoxrSandbox.h),
+   // so groups that use one resample on this thread only, afterwards.
+   mParallelGroups.clear();
+   mSameRateTracks.clear();
+   for (size_t g = 0; g < mGroups.size(); g++) {
+      if (Resamples(g)) {
+         if (mResample[g]->GetBackend() == Resample::Backend::Native)
+            mParallelGroups.push_back(g);
+         continue;
       }
-      if (mbVariableRates || track->GetRate() != mRate)
-         maxOut = std::max(maxOut,
-            MixVariableRates(channelFlags.get(), mInputTrack[i],
-               &mSamplePos[i], mSampleQueue[i].get(),
-               &mQueueStart[i], &mQueueLen[i], mResample[i].get()));
+      mResetPending[g] = false;
+      const auto &group = mGroups[g];
+      for (auto i = group.first; i < group.first + group.nChannels; i++)
+         mSameRateTracks.push_back(i);
+   }
+   // Resampling groups first, as they take longest
+   const auto nParallelGroups = mParallelGroups.size();
+   const auto nTasks = nParallelGroups + mSameRateTracks.size();
+   const auto task = [this, nParallelGroups](size_t iTask, unsigned iWorker){
+      const auto envValues = mEnvValues[iWorker].get();
+      if (iTask < nParallelGroups)
+         ResampleGroup(mParallelGroups[iTask], envValues);
       else
-         maxOut = std::max(maxOut,
-            MixSameRate(channelFlags.get(), mInputTrack[i], &mSamplePos[i]));
+         MixSameRate(mSameRateTracks[iTask - nParallelGroups], envValues);
+   };
+   if (pPool && nTasks > 1)
+      pPool->ForEach(nTasks, task, mEnvValues.size());
+   else
+      for (size_t iTask = 0; iTask < nTasks; iTask++)
+         task(iTask, 0);
+
+   for (size_t g = 0; g < mGroups.size(); g++)
+      if (Resamples(g) &&
+          mResample[g]->GetBackend() != Resample::Backend::Native)
+         ResampleGroup(g, mEnvValues[0].get());
+
+   for (size_t i = 0; i < mNumInputTracks; i++) {
+      maxOut = std::max(maxOut, mTrackSamples[i].len);
 
+      const auto track = mInputTrack[i].GetTrack().get();
       double t = mSamplePos[i].as_double() / (double)track->GetRate();
       if (mT0 > mT1)
          // backwards (as possibly in scrubbing)
@@ -509,6 +689,10 @@ size_t Mixer::Process(size_t maxToProcess)
          // forwards (the usual)
          mTime = std::min(std::max(t, mTime), mT1);
    }
+
+   Clear();
+   Accumulate(maxOut, pPool);
+
    if(mInterleaved) {
       for(size_t c=0; c<mNumChannels; c++) {
          CopySamples((constSamplePtr)(mTemp[0].get() + c),
@@ -562,7 +746,7 @@ void Mixer::Restart()
    for(size_t i=0; i<mNumInputTracks; i++)
       mSamplePos[i] = mInputTrack[i].GetTrack()->TimeToLongSamples(mT0);
 
-   for(size_t i=0; i<mNumInputTracks; i++) {
+   for(size_t i=0; i<mGroups.size(); i++) {
       mQueueStart[i] = 0;
       mQueueLen[i] = 0;
    }
@@ -570,7 +754,7 @@ void Mixer::Restart()
    // Bug 1887:  libsoxr 0.1.3, first used in Audacity 2.3.0, crashes with
    // constant rate resampling if you try to reuse the resampler after it has
    // flushed.  Should that be considered a bug in sox?  This works around it:
-   MakeResamplers();
+   ResetResamplers();
 }
 #endif
 
@@ -583,8 +767,10 @@ void Mixer::Reposition(double t, bool bSkipping)
    else
       mTime = std::max(mT0, (std::min(mT1, mTime)));
 
-   for(size_t i=0; i<mNumInputTracks; i++) {
+   for(size_t i=0; i<mNumInputTracks; i++)
       mSamplePos[i] = mInputTrack[i].GetTrack()->TimeToLongSamples(mTime);
+
+   for(size_t i=0; i<mGroups.size(); i++) {
       mQueueStart[i] = 0;
       mQueueLen[i] = 0;
    }
@@ -593,8 +779,11 @@ void Mixer::Reposition(double t, bool bSkipping)
    // constant rate resampling if you try to reuse the resampler after it has
    // flushed.  Should that be considered a bug in sox?  This works around it.
    // (See also bug 1887, and the same work around in Mixer::Restart().)
+   // Clearing is as good as making new resamplers, and for many tracks, or
+   // sandboxed resamplers, much quicker, so that seeking while scrubbing or
+   // looping does not take longer with more tracks.
    if( bSkipping )
-      MakeResamplers();
+      ResetResamplers();
 }
 
 void Mixer::SetTimesAndSpeed(double t0, double t1, double speed, bool bSkipping)
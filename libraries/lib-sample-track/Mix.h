@@ -23,6 +23,8 @@
 #include "GlobalVariable.h"
 #include "SampleFormat.h"
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 class sampleCount;
@@ -32,6 +34,12 @@ class TrackList;
 class SampleTrack;
 using SampleTrackConstArray = std::vector < std::shared_ptr < const SampleTrack > >;
 class SampleTrackCache;
+class IntSetting;
+class WorkStealingPool;
+
+//! How many threads a Mixer may use; 0 for as many as there are cores, 1 to
+//! mix on the calling thread only
+extern SAMPLE_TRACK_API IntSetting MixerThreads;
 
 class SAMPLE_TRACK_API MixerSpec
 {
@@ -133,15 +141,36 @@ class SAMPLE_TRACK_API Mixer {
  private:
 
    void Clear();
-   size_t MixSameRate(int *channelFlags, SampleTrackCache &cache,
-                           sampleCount *pos);
+   size_t MixSameRate(size_t iTrack, double *envValues);
+
+   //! Consecutive input tracks that are resampled together in one call
+   //! (the two channels of a stereo track), sharing one Resample
+   struct ChannelGroup {
+      size_t first;
+      unsigned nChannels;
+   };
+   static constexpr unsigned MaxChannelsPerGroup = 2;
+
+   void ComputeChannelFlags(size_t iTrack, int *channelFlags) const;
 
-   size_t MixVariableRates(int *channelFlags, SampleTrackCache &cache,
-                                sampleCount *pos, float *queue,
+   size_t MixVariableRates(const ChannelGroup &group,
                                 int *queueStart, int *queueLen,
-                                Resample * pResample);
+                                Resample * pResample, double *envValues);
+
+   bool Resamples(size_t iGroup) const;
+   //! Fetch, apply envelopes and resample one group into the output buffers
+   //! of its resampler; only on the thread that calls Process() if the
+   //! resampler is sandboxed
+   void ResampleGroup(size_t iGroup, double *envValues);
+
+   //! Add the fetched samples of all tracks into mTemp, in the order of the
+   //! tracks
+   /*! @param pPool if not null, does spans of the mix in parallel */
+   void Accumulate(size_t len, WorkStealingPool *pPool);
 
    void MakeResamplers();
+   //! Discard what the resamplers buffered, keeping them and their buffers
+   void ResetResamplers();
 
  private:
 
@@ -152,13 +181,17 @@ class SAMPLE_TRACK_API Mixer {
    const BoundedEnvelope *mEnvelope;
    ArrayOf<sampleCount> mSamplePos;
    const bool       mApplyTrackGains;
-   Doubles          mEnvValues;
+   // One for each worker that may fetch tracks or resample in parallel
+   std::vector<Doubles> mEnvValues;
    double           mT0; // Start time
    double           mT1; // Stop time (none if mT0==mT1)
    double           mTime;  // Current time (renamed from mT to mTime for consistency with AudioIO - mT represented warped time there)
+   std::vector<ChannelGroup> mGroups;
+   // These are indexed by group, not by input track
    ArrayOf<std::unique_ptr<Resample>> mResample;
+   //! Whether to reset the resampler before next using it
+   ArrayOf<bool>    mResetPending;
    const size_t     mQueueMaxLen;
-   FloatBuffers     mSampleQueue;
    ArrayOf<int>     mQueueStart;
    ArrayOf<int>     mQueueLen;
    size_t           mProcessLen;
@@ -167,7 +200,6 @@ class SAMPLE_TRACK_API Mixer {
    // Output
    size_t              mMaxOut;
    const unsigned   mNumChannels;
-   Floats           mGains;
    unsigned         mNumBuffers;
    size_t              mBufferSize;
    size_t              mInterleavedBufferSize;
@@ -175,7 +207,30 @@ class SAMPLE_TRACK_API Mixer {
    bool             mInterleaved;
    ArrayOf<SampleBuffer> mBuffer;
    ArrayOf<Floats>  mTemp;
-   Floats           mFloatBuffer;
+
+   //! Where Process() left the samples of one input track, before gains
+   struct TrackSamples {
+      const float *samples{};
+      size_t len{};
+   };
+   std::vector<TrackSamples> mTrackSamples;
+   // Only for tracks that are not resampled; others are left in the output
+   // buffers of their resamplers
+   ArrayOf<Floats>  mTrackBuffers;
+   // Indexed by track, then output channel
+   std::vector<int> mTrackFlags;
+   std::vector<float> mTrackGains;
+
+   // Most workers of the shared pool to use; 1 to mix on the calling thread
+   // only
+   unsigned         mMaxWorkers;
+   // Groups resampled natively, and tracks not resampled, in the current
+   // Process()
+   std::vector<size_t> mParallelGroups;
+   std::vector<size_t> mSameRateTracks;
+   // Guards mEnvelope, which caches its last search, from groups that
+   // resample in parallel
+   std::mutex       mWarpMutex;
    const double     mRate;
    double           mSpeed;
    bool             mHighQuality;
@@ -42,6 +42,10 @@ double SampleTrack::LongSamplesToTime(sampleCount pos) const
    return pos.as_double() / GetRate();
 }
 
+void SampleTrack::Prefetch(sampleCount, size_t) const
+{
+}
+
 WritableSampleTrack::~WritableSampleTrack() = default;
 
 static const Track::TypeInfo &typeInfo2()
@@ -85,6 +85,10 @@ public:
       // contiguous range.
       sampleCount * pNumWithinClips = nullptr) const = 0;
 
+   //! Hint that Get() will be called soon for the range, so that storage
+   //! may be readied in the background; the default does nothing
+   virtual void Prefetch(sampleCount start, size_t len) const;
+
    /** @brief Convert correctly between an (absolute) time in seconds and a number of samples.
     *
     * This method will not give the correct results if used on a relative time (difference of two
@@ -124,6 +124,11 @@ const float *SampleTrackCache::GetFloats(
       }
       wxASSERT(mNValidBuffers < 2 || mBuffers[0].end() == mBuffers[1].start);
 
+      // Reading forward, the block after the cached ones is wanted next;
+      // ready it while the caller works on these
+      if ((fillFirst || fillSecond) && mNValidBuffers > 0)
+         mPTrack->Prefetch(mBuffers[mNValidBuffers - 1].end(), mBufferSize);
+
       samplePtr buffer = nullptr; // will point into mOverlapBuffer
       auto remaining = len;
 
@@ -30,6 +30,10 @@ a draggable point type.
 #include "Envelope.h"
 
 #include <math.h>
+#include <atomic>
+#include <cmath>
+
+#include "MixKernels.h"
 
 #include <wx/wxcrtvararg.h>
 #include <wx/brush.h>
@@ -95,6 +99,7 @@ bool Envelope::ConsistencyCheck()
          std::stable_sort( mEnv.begin(), mEnv.end(),
             []( const EnvPoint &a, const EnvPoint &b )
                { return a.GetT() < b.GetT(); } );
+         InvalidateCaches();
       }
    } while ( disorder );
 
@@ -123,6 +128,7 @@ void Envelope::RescaleValues(double minValue, double maxValue)
       factor = (mEnv[i].GetVal() - oldMinValue) / (oldMaxValue - oldMinValue);
       mEnv[i].SetVal( this, mMinValue + (mMaxValue - mMinValue) * factor );
    }
+   InvalidateCaches();
 
 }
 
@@ -133,6 +139,7 @@ void Envelope::Flatten(double value)
 {
    mEnv.clear();
    mDefaultValue = ClampValue(value);
+   InvalidateCaches();
 }
 
 void Envelope::SetDragPoint(int dragPoint)
@@ -153,6 +160,7 @@ void Envelope::SetDragPointValid(bool valid)
 
       static const double big = std::numeric_limits<double>::max();
       auto size = mEnv.size();
+      InvalidateCaches();
 
       if( size <= 1) {
          // There is only one point - just move it
@@ -202,6 +210,7 @@ void Envelope::MoveDragPoint(double newWhen, double value)
    // points share a time value.
    dragPoint.SetT(tt);
    dragPoint.SetVal( this, value );
+   InvalidateCaches();
 }
 
 void Envelope::ClearDragPoint()
@@ -219,6 +228,7 @@ void Envelope::SetRange(double minValue, double maxValue) {
    mDefaultValue = ClampValue(mDefaultValue);
    for( unsigned int i = 0; i < mEnv.size(); i++ )
       mEnv[i].SetVal( this, mEnv[i].GetVal() ); // this clamps the value to the NEW range
+   InvalidateCaches();
 }
 
 // This is used only during construction of an Envelope by complete or partial
@@ -226,6 +236,7 @@ void Envelope::SetRange(double minValue, double maxValue) {
 void Envelope::AddPointAtEnd( double t, double val )
 {
    mEnv.push_back( EnvPoint{ t, val } );
+   InvalidateCaches();
 
    // Assume copied points were stored by nondecreasing time.
    // Allow no more than two points at exactly the same time.
@@ -322,6 +333,7 @@ bool Envelope::HandleXMLTag(const std::string_view& tag, const AttributesList& a
 
    mEnv.clear();
    mEnv.reserve(numPoints);
+   InvalidateCaches();
    return true;
 }
 
@@ -330,7 +342,10 @@ XMLTagHandler *Envelope::HandleXMLChild(const std::string_view& tag)
    if (tag != "controlpoint")
       return NULL;
 
+   // The point is given its time and value after this returns, and before
+   // anything could use the cache
    mEnv.push_back( EnvPoint{} );
+   InvalidateCaches();
    return &mEnv.back();
 }
 
@@ -356,16 +371,19 @@ void Envelope::WriteXML(XMLWriter &xmlFile) const
 void Envelope::Delete( int point )
 {
    mEnv.erase(mEnv.begin() + point);
+   InvalidateCaches();
 }
 
 void Envelope::Insert(int point, const EnvPoint &p)
 {
    mEnv.insert(mEnv.begin() + point, p);
+   InvalidateCaches();
 }
 
 void Envelope::Insert(double when, double value)
 {
    mEnv.push_back( EnvPoint{ when, value });
+   InvalidateCaches();
 }
 
 /*! @excsafety{No-fail} */
@@ -441,6 +459,7 @@ void Envelope::CollapseRegion( double t0, double t1, double sampleDur )
       else
          point.SetT( point.GetT() - (t1 - t0) );
    }
+   InvalidateCaches();
 
    // See if the discontinuity is removable.
    if ( rightPoint )
@@ -523,6 +542,7 @@ void Envelope::PasteEnvelope( double t0, const Envelope *e, double sampleDur )
       // Bug 1844 was that we also adjusted by the envelope-pasted-from offset.
       point.SetT( point.GetT() + /*otherOffset +*/ t0 );
    }
+   InvalidateCaches();
 
    // Treat removable discontinuities
    // Right edge outward:
@@ -630,6 +650,7 @@ std::pair< int, int > Envelope::ExpandRegion
       auto &point = mEnv[ ii ];
       point.SetT( point.GetT() + tlen );
    }
+   InvalidateCaches();
 
    mTrackLen += tlen;
    
@@ -682,6 +703,7 @@ int Envelope::Reassign(double when, double value)
       return -1;
 
    mEnv[i].SetVal( this, value );
+   InvalidateCaches();
    return 0;
 }
 
@@ -746,7 +768,10 @@ int Envelope::InsertOrReplaceRelative(double when, double value)
    if ( index < range.second )
       // modify existing
       // In case of a discontinuity, ALWAYS CHANGING LEFT LIMIT ONLY!
+   {
       mEnv[ index ].SetVal( this, value );
+      InvalidateCaches();
+   }
    else
      // Add NEW
       Insert( index, EnvPoint { when, value } );
@@ -799,6 +824,7 @@ void Envelope::SetTrackLen( double trackLen, double sampleDur )
    // If more than one point already at the end, keep only the first of them.
    int newLen = std::min( 1 + range.first, range.second );
    mEnv.resize( newLen );
+   InvalidateCaches();
 
    if ( needPoint )
       AddPointAtEnd( mTrackLen, value );
@@ -817,6 +843,7 @@ void Envelope::RescaleTimes( double newLength )
          point.SetT( point.GetT() * ratio );
    }
    mTrackLen = newLength;
+   InvalidateCaches();
 }
 
 // Accessors
@@ -938,109 +965,131 @@ void Envelope::GetValuesRelative
    const auto epsilon = tstep / 2;
    int len = mEnv.size();
 
-   double t = t0;
+   // IF empty envelope THEN default value
+   if (len <= 0) {
+      std::fill(buffer, buffer + std::max(0, bufferLen), mDefaultValue);
+      return;
+   }
+
    double increment = 0;
-   if ( len > 1 && t <= mEnv[0].GetT() && mEnv[0].GetT() == mEnv[1].GetT() )
+   if ( len > 1 && t0 <= mEnv[0].GetT() && mEnv[0].GetT() == mEnv[1].GetT() )
       increment = leftLimit ? -epsilon : epsilon;
 
-   double tprev, vprev, tnext = 0, vnext, vstep = 0;
-
-   for (int b = 0; b < bufferLen; b++) {
-
-      // Get easiest cases out the way first...
-      // IF empty envelope THEN default value
-      if (len <= 0) {
-         buffer[b] = mDefaultValue;
-         t += tstep;
-         continue;
+   // Times of samples are computed from t0, not accumulated, so that each run
+   // below agrees with the test that ends it
+   const auto tplusAt = [&](int b){ return t0 + b * tstep + increment; };
+   const auto before = [&](double tplus){
+      return leftLimit ? tplus <= mEnv[0].GetT() : tplus < mEnv[0].GetT(); };
+   const auto after = [&](double tplus){
+      return leftLimit
+         ? tplus > mEnv[len - 1].GetT() : tplus >= mEnv[len - 1].GetT(); };
+
+   // The length of the run of samples from b for which pred is true, given
+   // that it is true at b and that the samples are in increasing time
+   const auto runLength = [&](int b, auto pred) {
+      if (!(tstep > 0))
+         return 1;
+      // Guess from the times, then correct the guess for rounding
+      int end = bufferLen;
+      for (long long step = 1; ; step *= 2) {
+         const int next = std::min<long long>(bufferLen, b + step);
+         if (next >= bufferLen || !pred(tplusAt(next))) {
+            end = next;
+            break;
+         }
       }
+      // pred holds at b and fails at end (or end is bufferLen); bisect
+      int lo = b;
+      while (end - lo > 1) {
+         const int mid = lo + (end - lo) / 2;
+         if (pred(tplusAt(mid)))
+            lo = mid;
+         else
+            end = mid;
+      }
+      return end - b;
+   };
 
-      auto tplus = t + increment;
+   for (int b = 0; b < bufferLen;) {
+      auto tplus = tplusAt(b);
 
       // IF before envelope THEN first value
-      if ( leftLimit ? tplus <= mEnv[0].GetT() : tplus < mEnv[0].GetT() ) {
-         buffer[b] = mEnv[0].GetVal();
-         t += tstep;
+      if ( before(tplus) ) {
+         const auto n = runLength(b, before);
+         std::fill(buffer + b, buffer + b + n, mEnv[0].GetVal());
+         b += n;
          continue;
       }
       // IF after envelope THEN last value
-      if ( leftLimit
-            ? tplus > mEnv[len - 1].GetT() : tplus >= mEnv[len - 1].GetT() ) {
-         buffer[b] = mEnv[len - 1].GetVal();
-         t += tstep;
+      if ( after(tplus) ) {
+         const auto n = runLength(b, after);
+         std::fill(buffer + b, buffer + b + n, mEnv[len - 1].GetVal());
+         b += n;
          continue;
       }
 
-      // be careful to get the correct limit even in case epsilon == 0
-      if ( b == 0 ||
-           ( leftLimit ? tplus > tnext : tplus >= tnext ) ) {
-
-         // We're beyond our tnext, so find the next one.
-         // Don't just increment lo or hi because we might
-         // be zoomed far out and that could be a large number of
-         // points to move over.  That's why we binary search.
+      // Find the interval.
+      // Don't just increment lo or hi because we might
+      // be zoomed far out and that could be a large number of
+      // points to move over.  That's why we binary search.
 
-         int lo,hi;
-         if ( leftLimit )
-            BinarySearchForTime_LeftLimit( lo, hi, tplus );
-         else
-            BinarySearchForTime( lo, hi, tplus );
-
-         // mEnv[0] is before tplus because of eliminations above, therefore lo >= 0
-         // mEnv[len - 1] is after tplus, therefore hi <= len - 1
-         wxASSERT( lo >= 0 && hi <= len - 1 );
-
-         tprev = mEnv[lo].GetT();
-         tnext = mEnv[hi].GetT();
-
-         if ( hi + 1 < len && tnext == mEnv[ hi + 1 ].GetT() )
-            // There is a discontinuity after this point-to-point interval.
-            // Usually will stop evaluating in this interval when time is slightly
-            // before tNext, then use the right limit.
-            // This is the right intent
-            // in case small roundoff errors cause a sample time to be a little
-            // before the envelope point time.
-            // Less commonly we want a left limit, so we continue evaluating in
-            // this interval until shortly after the discontinuity.
-            increment = leftLimit ? -epsilon : epsilon;
-         else
-            increment = 0;
-
-         vprev = GetInterpolationStartValueAtPoint( lo );
-         vnext = GetInterpolationStartValueAtPoint( hi );
+      int lo,hi;
+      if ( leftLimit )
+         BinarySearchForTime_LeftLimit( lo, hi, tplus );
+      else
+         BinarySearchForTime( lo, hi, tplus );
+
+      // mEnv[0] is before tplus because of eliminations above, therefore lo >= 0
+      // mEnv[len - 1] is after tplus, therefore hi <= len - 1
+      wxASSERT( lo >= 0 && hi <= len - 1 );
+
+      const double tprev = mEnv[lo].GetT();
+      const double tnext = mEnv[hi].GetT();
+
+      if ( hi + 1 < len && tnext == mEnv[ hi + 1 ].GetT() )
+         // There is a discontinuity after this point-to-point interval.
+         // Usually will stop evaluating in this interval when time is slightly
+         // before tNext, then use the right limit.
+         // This is the right intent
+         // in case small roundoff errors cause a sample time to be a little
+         // before the envelope point time.
+         // Less commonly we want a left limit, so we continue evaluating in
+         // this interval until shortly after the discontinuity.
+         increment = leftLimit ? -epsilon : epsilon;
+      else
+         increment = 0;
 
-         // Interpolate, either linear or log depending on mDB.
-         double dt = (tnext - tprev);
-         double to = t - tprev;
-         double v;
-         if (dt > 0.0)
-         {
-            v = (vprev * (dt - to) + vnext * to) / dt;
-            vstep = (vnext - vprev) * tstep / dt;
-         }
-         else
-         {
-            v = vnext;
-            vstep = 0.0;
-         }
+      // The samples up to the next point make one run
+      const auto n = runLength(b, [&](double tplus){
+         // be careful to get the correct limit even in case epsilon == 0
+         return leftLimit ? tplus <= tnext : tplus < tnext; });
 
-         // An adjustment if logarithmic scale.
-         if( mDB )
-         {
-            v = pow(10.0, v);
-            vstep = pow( 10.0, vstep );
-         }
+      const double vprev = GetInterpolationStartValueAtPoint( lo );
+      const double vnext = GetInterpolationStartValueAtPoint( hi );
 
-         buffer[b] = v;
-      } else {
-         if (mDB){
-            buffer[b] = buffer[b - 1] * vstep;
-         }else{
-            buffer[b] = buffer[b - 1] + vstep;
-         }
+      // Interpolate, either linear or log depending on mDB.
+      double dt = (tnext - tprev);
+      double to = (t0 + b * tstep) - tprev;
+      double v, vstep;
+      if (dt > 0.0)
+      {
+         v = (vprev * (dt - to) + vnext * to) / dt;
+         vstep = (vnext - vprev) * tstep / dt;
+      }
+      else
+      {
+         v = vnext;
+         vstep = 0.0;
       }
 
-      t += tstep;
+      // An adjustment if logarithmic scale.
+      if( mDB )
+         MixKernels::ExponentialRamp(
+            buffer + b, pow(10.0, v), pow(10.0, vstep), n);
+      else
+         MixKernels::LinearRamp(buffer + b, v, vstep, n);
+
+      b += n;
    }
 }
 
@@ -1161,8 +1210,74 @@ static double SolveIntegrateInverseInterpolated(double y1, double y2, double tim
    return std::max(0.0, std::min(1.0, res)) * time;
 }
 
-// We should be able to write a very efficient memoizer for this
-// but make sure it gets reset when the envelope is changed.
+void Envelope::InvalidateCaches()
+{
+   std::atomic_store(&mIntegralCache, {});
+}
+
+auto Envelope::GetIntegralCache() const
+   -> std::shared_ptr<const IntegralCache>
+{
+   // Threads that find no cache may each make one; all are the same
+   auto pCache = std::atomic_load(&mIntegralCache);
+   if (pCache)
+      return pCache;
+
+   auto pNewCache = std::make_shared<IntegralCache>();
+   auto &integrals = pNewCache->integrals;
+   auto &inverseIntegrals = pNewCache->inverseIntegrals;
+   const auto count = mEnv.size();
+   integrals.resize(count);
+   inverseIntegrals.resize(count);
+   for (size_t i = 1; i < count; ++i) {
+      // Exactly the terms that the loops of Integral and IntegralOfInverse
+      // add for whole segments
+      const auto &prev = mEnv[i - 1], &point = mEnv[i];
+      const auto dt = point.GetT() - prev.GetT();
+      integrals[i] = integrals[i - 1] +
+         IntegrateInterpolated(prev.GetVal(), point.GetVal(), dt, mDB);
+      const auto inverse =
+         IntegrateInverseInterpolated(prev.GetVal(), point.GetVal(), dt, mDB);
+      if (!(inverse >= 0 && std::isfinite(inverse)))
+         pNewCache->inverseSearchable = false;
+      inverseIntegrals[i] = inverseIntegrals[i - 1] + inverse;
+   }
+
+   pCache = std::move(pNewCache);
+   std::atomic_store(&mIntegralCache, pCache);
+   return pCache;
+}
+
+namespace {
+// Jumps over whole segments are worth it only for more than this many, and
+// shorter integrals, as Mixer asks for, stay exactly as the loops compute
+// them
+constexpr unsigned MinSkip = 16;
+
+// The loops of Integral and IntegralOfInverse add segments one at a time,
+// starting with the one ending at point i, until the one ending at or after
+// t1.  Over many points, add the whole segments from the prefix sums
+// instead, and leave the loop only the last.
+template<typename Integrate>
+void SkipPoints(const EnvArray &env, const std::vector<double> &prefix,
+   Integrate integrate, bool db, double t1,
+   unsigned &i, double &total, double &lastT, double &lastVal)
+{
+   // First point at or after t1, or the end; the caller found point
+   // i + MinSkip before t1
+   const unsigned end = std::lower_bound(
+      env.begin() + i + MinSkip + 1, env.end(), t1,
+      [](const EnvPoint &point, double t){ return point.GetT() < t; })
+         - env.begin();
+   const auto last = end - 1;
+   total += integrate(lastVal, env[i].GetVal(), env[i].GetT() - lastT, db);
+   total += prefix[last] - prefix[i];
+   lastT = env[last].GetT();
+   lastVal = env[last].GetVal();
+   i = end;
+}
+}
+
 double Envelope::Integral( double t0, double t1 ) const
 {
    if(t0 == t1)
@@ -1204,6 +1319,10 @@ double Envelope::Integral( double t0, double t1 ) const
       i = hi; // the point immediately after t0.
    }
 
+   if (count - i > MinSkip && mEnv[i + MinSkip].GetT() < t1)
+      SkipPoints(mEnv, GetIntegralCache()->integrals, IntegrateInterpolated,
+         mDB, t1, i, total, lastT, lastVal);
+
    // loop through the rest of the envelope points until we get to t1
    while (1)
    {
@@ -1267,6 +1386,10 @@ double Envelope::IntegralOfInverse( double t0, double t1 ) const
       i = hi; // the point immediately after t0.
    }
 
+   if (count - i > MinSkip && mEnv[i + MinSkip].GetT() < t1)
+      SkipPoints(mEnv, GetIntegralCache()->inverseIntegrals,
+         IntegrateInverseInterpolated, mDB, t1, i, total, lastT, lastVal);
+
    // loop through the rest of the envelope points until we get to t1
    while (1)
    {
@@ -1347,6 +1470,53 @@ double Envelope::SolveIntegralOfInverse( double t0, double area ) const
             i = hi; // the point immediately after t0.
       }
 
+      // Over many points, find the segment where the area runs out by
+      // searching the cached integrals, and resume the loops below a point
+      // before it (after it, going backwards), in case rounding puts the
+      // search a segment off
+      const bool skipBackward = area < 0 && i > (int)MinSkip;
+      const bool skipForward = area > 0 && i + MinSkip < count;
+      const auto pCache = skipBackward || skipForward
+         ? GetIntegralCache() : nullptr;
+      if (pCache && pCache->inverseSearchable) {
+         const auto &prefix = pCache->inverseIntegrals;
+         if (skipBackward) {
+            const double added =
+               -IntegrateInverseInterpolated(mEnv[i].GetVal(), lastVal, lastT - mEnv[i].GetT(), mDB);
+            if (added > area) {
+               // Last point k with prefix[i] - prefix[k] >= remaining
+               const double remaining = added - area;
+               const int k = std::upper_bound(prefix.begin(),
+                  prefix.begin() + i, prefix[i] - remaining) - prefix.begin()
+                     - 1;
+               const int m = std::max(k, 0) + 2;
+               if (m + (int)MinSkip < i) {
+                  area -= added - (prefix[i] - prefix[m]);
+                  lastT = mEnv[m].GetT();
+                  lastVal = mEnv[m].GetVal();
+                  i = m - 1;
+               }
+            }
+         }
+         else {
+            const double added =
+               IntegrateInverseInterpolated(lastVal, mEnv[i].GetVal(), mEnv[i].GetT() - lastT, mDB);
+            if (added < area) {
+               // First point k with prefix[k] - prefix[i] >= remaining
+               const double remaining = area - added;
+               const int k = std::lower_bound(prefix.begin() + i,
+                  prefix.end(), prefix[i] + remaining) - prefix.begin();
+               const int m = k - 2;
+               if (m > i + (int)MinSkip) {
+                  area -= added + (prefix[m] - prefix[i]);
+                  lastT = mEnv[m].GetT();
+                  lastVal = mEnv[m].GetVal();
+                  i = m + 1;
+               }
+            }
+         }
+      }
+
       if (area < 0) {
          // loop BACKWARDS through the rest of the envelope points until we get to t1
          // (which is less than t0)
@@ -1449,7 +1619,7 @@ void Envelope::testMe()
    checkResult( 10, Integral(0.0,t0), 4.999);
    checkResult( 11, Integral(t0,t1), .001);
 
-   mEnv.clear();
+   Clear();
    InsertOrReplaceRelative( 0.0, 0.0 );
    InsertOrReplaceRelative( 5.0, 1.0 );
    InsertOrReplaceRelative( 10.0, 0.0 );
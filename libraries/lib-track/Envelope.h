@@ -13,6 +13,7 @@
 
 #include <stdlib.h>
 #include <algorithm>
+#include <memory>
 #include <vector>
 
 #include "XMLTagHandler.h"
@@ -33,9 +34,7 @@ public:
    inline EnvPoint( double t, double val ) : mT{ t }, mVal{ val } {}
 
    double GetT() const { return mT; }
-   void SetT(double t) { mT = t; }
    double GetVal() const { return mVal; }
-   inline void SetVal( Envelope *pEnvelope, double val );
 
    bool HandleXMLTag(const std::string_view& tag, const AttributesList& attrs) override
    {
@@ -61,6 +60,12 @@ public:
    }
 
 private:
+   // Only Envelope moves its points, so that it can drop what it caches
+   // about them
+   friend Envelope;
+   void SetT(double t) { mT = t; }
+   inline void SetVal( Envelope *pEnvelope, double val );
+
    double mT {};
    double mVal {};
 
@@ -91,7 +96,7 @@ public:
    double GetTrackLen() const { return mTrackLen; }
 
    bool GetExponential() const { return mDB; }
-   void SetExponential(bool db) { mDB = db; }
+   void SetExponential(bool db) { mDB = db; InvalidateCaches(); }
 
    void Flatten(double value);
 
@@ -167,7 +172,7 @@ public:
 
    bool IsDirty() const;
 
-   void Clear() { mEnv.clear(); }
+   void Clear() { mEnv.clear(); InvalidateCaches(); }
 
    /** \brief Add a point at a particular absolute time coordinate */
    int InsertOrReplace(double when, double value)
@@ -230,6 +235,21 @@ private:
    void BinarySearchForTime_LeftLimit( int &Lo, int &Hi, double t ) const;
    double GetInterpolationStartValueAtPoint( int iPoint ) const;
 
+   //! Integrals of the envelope and of its inverse, from the first point to
+   //! each point, so that integrals over many points take O(log n)
+   struct IntegralCache {
+      std::vector<double> integrals;
+      std::vector<double> inverseIntegrals;
+      //! Whether no segment of the inverse has a negative or undefined
+      //! integral, so that inverseIntegrals can be searched
+      bool inverseSearchable{ true };
+   };
+   //! Made when first needed after the points change; safe to call from
+   //! several threads, as the searches are
+   std::shared_ptr<const IntegralCache> GetIntegralCache() const;
+   //! Must be called whenever points or mDB change
+   void InvalidateCaches();
+
    // The list of envelope control points.
    EnvArray mEnv;
 
@@ -253,6 +273,8 @@ private:
    int mDragPoint { -1 };
 
    mutable int mSearchGuess { -2 };
+
+   mutable std::shared_ptr<const IntegralCache> mIntegralCache;
 };
 
 inline void EnvPoint::SetVal( Envelope *pEnvelope, double val )
@@ -0,0 +1,101 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   License: GPL v2 or later.  See License.txt.
+
+   EnvelopeBench.cpp
+
+   Measures Envelope evaluation for sparse and dense curves, linear and
+   exponential:  GetValues in millions of samples per second, as Mixer and
+   effects ask for gain automation, and Integral, IntegralOfInverse and
+   SolveIntegralOfInverse in thousands of calls per second, over a block, as
+   Mixer does for the time track, and over the whole curve.
+
+   usage: envelope-bench [passes [points]]
+
+**********************************************************************/
+
+#include "Envelope.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr double Length = 600.0;
+constexpr double Rate = 44100.0;
+
+template<typename Function>
+double Throughput(size_t passes, double perPass, const Function &function)
+{
+   using Clock = std::chrono::steady_clock;
+   const auto start = Clock::now();
+   for (size_t pass = 0; pass < passes; ++pass)
+      function(pass);
+   const std::chrono::duration<double> elapsed = Clock::now() - start;
+   return passes * perPass / elapsed.count();
+}
+
+void Measure(const char *name, bool exponential, size_t nPoints,
+   size_t passes)
+{
+   Envelope envelope{ exponential, 0.1, 10.0, 1.0 };
+   envelope.SetTrackLen(Length);
+   std::mt19937 engine{ 1618 };
+   std::uniform_real_distribution<double> distribution{ 0.25, 4.0 };
+   for (size_t i = 0; i < nPoints; ++i)
+      envelope.InsertOrReplace(Length * (i + 0.5) / nPoints,
+         distribution(engine));
+
+   const size_t blockSize = 4096;
+   std::vector<double> buffer(blockSize);
+   const auto blockDuration = blockSize / Rate;
+   const auto nBlocks = static_cast<size_t>(Length / blockDuration);
+   auto blockStart = [&](size_t pass){
+      return (pass * 7919 % nBlocks) * blockDuration;
+   };
+
+   const auto values = Throughput(passes, blockSize / 1e6, [&](size_t pass){
+      envelope.GetValues(buffer.data(), blockSize, blockStart(pass), 1 / Rate);
+   });
+
+   double sink = 0;
+   const auto blockIntegrals = Throughput(passes, 1e-3, [&](size_t pass){
+      const auto t0 = blockStart(pass);
+      sink += envelope.Integral(t0, t0 + blockDuration);
+      sink += envelope.IntegralOfInverse(t0, t0 + blockDuration);
+   });
+   const auto wholeIntegrals = Throughput(passes, 1e-3, [&](size_t pass){
+      const auto t0 = blockStart(pass) / 2;
+      sink += envelope.Integral(t0, t0 + Length / 2);
+      sink += envelope.IntegralOfInverse(t0, t0 + Length / 2);
+   });
+   const auto solves = Throughput(passes, 1e-3, [&](size_t pass){
+      const auto t0 = blockStart(pass) / 2;
+      sink += envelope.SolveIntegralOfInverse(t0, Length / 4);
+   });
+
+   printf("%-12s %6zu %14.1f %14.1f %14.1f %14.1f%s\n", name, nPoints,
+      values, blockIntegrals, wholeIntegrals, solves, sink == 0 ? " " : "");
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+   const size_t passes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+   const size_t dense = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5000;
+
+   printf("%zu passes over a curve of %g seconds\n", passes, Length);
+   printf("%-12s %6s %14s %14s %14s %14s\n", "curve", "points",
+      "values Ms/s", "block k/s", "whole k/s", "solve k/s");
+   for (auto exponential : { false, true }) {
+      const auto name = exponential ? "exponential" : "linear";
+      Measure(name, exponential, 8, passes);
+      Measure(name, exponential, dense, passes);
+   }
+   return 0;
+}
@@ -0,0 +1,162 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file EnvelopeTests.cpp
+ @brief Check the runs of ramps of GetValues, and the cached integrals,
+ against evaluation one sample or a few points at a time
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <vector>
+
+#include "Envelope.h"
+
+namespace {
+
+constexpr double Length = 100.0;
+constexpr size_t NumPoints = 400;
+
+//! Many more points than integrals skip over with the cache, and a
+//! discontinuity (two points at one time) in the middle
+Envelope MakeEnvelope(bool exponential)
+{
+   Envelope env{ exponential, 0.01, 10.0, 1.0 };
+   env.SetTrackLen(Length);
+   std::mt19937 engine{ 7 };
+   std::uniform_real_distribution<double> value{ 0.1, 5.0 };
+   for (size_t i = 0; i < NumPoints; ++i)
+      env.Insert((i + 0.5) * Length / NumPoints, value(engine));
+   const auto middle = env[NumPoints / 2].GetT();
+   env.Insert(NumPoints / 2 + 1, EnvPoint{ middle, value(engine) });
+   return env;
+}
+
+//! Integral over [t0, t1), as the sum of integrals over spans of a few
+//! points each, which do not use the cache
+template<typename Integrate>
+double IntegralInPieces(const Envelope &env, double t0, double t1,
+   const Integrate &integrate)
+{
+   constexpr double Piece = 4 * Length / NumPoints;
+   double total = 0;
+   for (double t = t0; t < t1; t += Piece)
+      total += integrate(env, t, std::min(t1, t + Piece));
+   return total;
+}
+
+double Integral(const Envelope &env, double t0, double t1)
+{
+   return env.Integral(t0, t1);
+}
+
+double IntegralOfInverse(const Envelope &env, double t0, double t1)
+{
+   return env.IntegralOfInverse(t0, t1);
+}
+
+//! Everything computed from the points, so that two envelopes can be
+//! compared exactly
+std::vector<double> Evaluate(const Envelope &env)
+{
+   std::vector<double> results(10000);
+   env.GetValues(results.data(), results.size(), -1.0, 1.02 * Length / 10000);
+   for (const auto &[t0, t1] : {
+      std::pair{ 0.0, Length }, { 3.3, 77.7 }, { 60.0, 1.0 } }) {
+      results.push_back(env.Integral(t0, t1));
+      results.push_back(env.IntegralOfInverse(t0, t1));
+      results.push_back(env.SolveIntegralOfInverse(t0, 0.5 * (t1 - t0)));
+   }
+   return results;
+}
+
+}
+
+TEST_CASE("Envelope::GetValues agrees with GetValue", "[Envelope]")
+{
+   for (const bool exponential : { false, true }) {
+      const auto env = MakeEnvelope(exponential);
+      // Samples before, across and after the points, some landing on the
+      // discontinuity
+      const double t0 = -1.0;
+      const double tstep = 1.0 / 400;
+      std::vector<double> values(1.02 * Length / tstep);
+      env.GetValues(values.data(), values.size(), t0, tstep);
+      for (size_t i = 0; i < values.size(); ++i) {
+         INFO("exponential " << exponential << "; sample " << i);
+         // Ramps are computed from the start of each run, so they may
+         // differ from separate evaluation by rounding only
+         CHECK(values[i] ==
+            Approx(env.GetValue(t0 + i * tstep, tstep)).epsilon(1e-12));
+      }
+   }
+}
+
+TEST_CASE("Envelope integrals agree with and without the cache", "[Envelope]")
+{
+   for (const bool exponential : { false, true }) {
+      INFO("exponential " << exponential);
+      const auto env = MakeEnvelope(exponential);
+      for (const auto &[t0, t1] : {
+         std::pair{ 0.0, Length }, { -5.0, Length + 5.0 }, { 3.3, 77.7 } }) {
+         INFO("from " << t0 << " to " << t1);
+         // The sums add the same segment integrals in another order
+         CHECK(env.Integral(t0, t1) ==
+            Approx(IntegralInPieces(env, t0, t1, Integral)).epsilon(1e-12));
+         const auto area = env.IntegralOfInverse(t0, t1);
+         CHECK(area == Approx(
+            IntegralInPieces(env, t0, t1, IntegralOfInverse)).epsilon(1e-12));
+         CHECK(env.SolveIntegralOfInverse(t0, area) ==
+            Approx(t1).margin(1e-9));
+         CHECK(env.SolveIntegralOfInverse(t1, -area) ==
+            Approx(t0).margin(1e-9));
+      }
+   }
+}
+
+TEST_CASE("Envelope edits drop the cached integrals", "[Envelope]")
+{
+   using Edit = void (*)(Envelope &);
+   const std::vector<std::pair<const char *, Edit>> edits{
+      { "MoveDragPoint", [](Envelope &env){
+         env.SetDragPoint(NumPoints / 4);
+         env.MoveDragPoint(env[NumPoints / 4 + 1].GetT(), 9.0);
+      } },
+      { "ClearDragPoint", [](Envelope &env){
+         env.SetDragPoint(NumPoints / 4);
+         env.SetDragPointValid(false);
+         env.ClearDragPoint();
+      } },
+      { "Reassign", [](Envelope &env){
+         env.Reassign(env[NumPoints / 3].GetT(), 0.02);
+      } },
+      { "InsertOrReplace", [](Envelope &env){
+         env.InsertOrReplace(Length / 3, 8.0);
+      } },
+      { "Delete", [](Envelope &env){ env.Delete(NumPoints / 3); } },
+      { "InsertSpace", [](Envelope &env){ env.InsertSpace(10.0, 5.0); } },
+      { "CollapseRegion", [](Envelope &env){
+         env.CollapseRegion(10.0, 20.0, 1.0 / 44100);
+      } },
+      { "RescaleTimes", [](Envelope &env){ env.RescaleTimes(Length / 2); } },
+      { "RescaleValues", [](Envelope &env){ env.RescaleValues(0.02, 6.0); } },
+      { "SetExponential", [](Envelope &env){
+         env.SetExponential(!env.GetExponential());
+      } },
+   };
+
+   for (const bool exponential : { false, true })
+      for (const auto &[name, edit] : edits) {
+         INFO("exponential " << exponential << "; " << name);
+         auto env = MakeEnvelope(exponential);
+         // Fill the cache, then edit
+         Evaluate(env);
+         edit(env);
+         // A copy starts with no cache, so it computes from the edited points
+         const Envelope fresh{ env };
+         CHECK(Evaluate(env) == Evaluate(fresh));
+      }
+}
@@ -0,0 +1,79 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file LightweightSemaphore.cpp
+
+**********************************************************************/
+#include "LightweightSemaphore.h"
+
+void LightweightSemaphore::Post()
+{
+   // A negative count means a waiter has given up spinning, and sleeps or
+   // is about to; give the post to it
+   if (mCount.fetch_add(1, std::memory_order_release) < 0) {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         ++mWakeups;
+      }
+      mCondition.notify_one();
+   }
+}
+
+bool LightweightSemaphore::TryWait()
+{
+   auto count = mCount.load(std::memory_order_relaxed);
+   while (count > 0)
+      if (mCount.compare_exchange_weak(count, count - 1,
+         std::memory_order_acquire, std::memory_order_relaxed))
+         return true;
+   return false;
+}
+
+void LightweightSemaphore::Wait()
+{
+   if (!SpinWait())
+      SlowWait(nullptr);
+}
+
+bool LightweightSemaphore::WaitUntil(Clock::time_point deadline)
+{
+   return SpinWait() || SlowWait(&deadline);
+}
+
+bool LightweightSemaphore::SpinWait()
+{
+   // Posts often come soon after a waiter arrives; catching them here saves
+   // the posting thread the mutex
+   for (int spin = 0; spin < 1000; ++spin)
+      if (TryWait())
+         return true;
+   return false;
+}
+
+bool LightweightSemaphore::SlowWait(const Clock::time_point *pDeadline)
+{
+   // Claim the next post, which may have come already
+   if (mCount.fetch_sub(1, std::memory_order_acquire) > 0)
+      return true;
+
+   std::unique_lock<std::mutex> lock{ mMutex };
+   auto woken = [this]{ return mWakeups > 0; };
+   if (pDeadline)
+      mCondition.wait_until(lock, *pDeadline, woken);
+   else
+      mCondition.wait(lock, woken);
+
+   if (mWakeups == 0) {
+      // Timed out.  Withdraw the claim, unless a post took it meanwhile, and
+      // then its wakeup is coming
+      auto count = mCount.load(std::memory_order_relaxed);
+      while (count < 0)
+         if (mCount.compare_exchange_weak(count, count + 1,
+            std::memory_order_relaxed))
+            return false;
+      mCondition.wait(lock, woken);
+   }
+   --mWakeups;
+   return true;
+}
@@ -0,0 +1,59 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file LightweightSemaphore.h
+  @brief Counting semaphore that a real-time thread can post cheaply
+
+**********************************************************************/
+#ifndef __AUDACITY_LIGHTWEIGHT_SEMAPHORE__
+#define __AUDACITY_LIGHTWEIGHT_SEMAPHORE__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+/*!
+ The count lives in one atomic.  Post() is a single atomic increment unless
+ some thread is asleep in a wait, and only then locks a mutex to wake it; so
+ a real-time thread, such as the PortAudio callback, can post without
+ blocking, so long as the waiter sleeps rarely compared with the posts.
+ Waits spin briefly before they sleep.
+ */
+class UTILITY_API LightweightSemaphore final
+{
+public:
+   using Clock = std::chrono::steady_clock;
+
+   LightweightSemaphore() = default;
+   LightweightSemaphore(const LightweightSemaphore&) = delete;
+   LightweightSemaphore &operator =(const LightweightSemaphore&) = delete;
+
+   void Post();
+
+   //! Take one post, if there is one, without waiting
+   bool TryWait();
+
+   //! Take one post, waiting as long as needed
+   void Wait();
+
+   //! Take one post, waiting no later than deadline
+   /*! @return whether a post was taken */
+   bool WaitUntil(Clock::time_point deadline);
+
+private:
+   bool SpinWait();
+   bool SlowWait(const Clock::time_point *pDeadline);
+
+   //! Posts not yet taken when positive; sleeping or soon sleeping waiters,
+   //! negated, when negative
+   std::atomic<long> mCount{ 0 };
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   //! Posts destined for waiters that went to sleep
+   long mWakeups{ 0 };
+};
+
+#endif
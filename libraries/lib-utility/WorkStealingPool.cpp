@@ -0,0 +1,192 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file WorkStealingPool.cpp
+
+**********************************************************************/
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+namespace {
+std::mutex &SharedMutex()
+{
+   static std::mutex mutex;
+   return mutex;
+}
+
+// Whether this thread holds the shared pool; trying to lock a mutex that the
+// same thread owns is undefined
+thread_local bool tHoldsShared = false;
+}
+
+unsigned WorkStealingPool::DefaultConcurrency()
+{
+   return std::max(1u, std::thread::hardware_concurrency());
+}
+
+WorkStealingPool::WorkStealingPool(unsigned concurrency)
+   : mQueues(std::max(1u, concurrency))
+{
+   for (unsigned iWorker = 1; iWorker < mQueues.size(); ++iWorker)
+      mThreads.emplace_back([this, iWorker]{ WorkerThread(iWorker); });
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mStop = true;
+   }
+   mStartCondition.notify_all();
+   for (auto &thread : mThreads)
+      thread.join();
+}
+
+WorkStealingPool::SharedLease::SharedLease()
+{
+   if (tHoldsShared)
+      return;
+   mLock = std::unique_lock<std::mutex>{ SharedMutex(), std::try_to_lock };
+   if (!mLock.owns_lock())
+      return;
+   // Never destroyed: its threads sleep until the process ends, and joining
+   // them during static destruction could deadlock where the loader holds a
+   // lock
+   static const auto pPool = new WorkStealingPool;
+   mpPool = pPool;
+   tHoldsShared = true;
+}
+
+WorkStealingPool::SharedLease::~SharedLease()
+{
+   if (mpPool)
+      tHoldsShared = false;
+}
+
+void WorkStealingPool::ForEach(
+   size_t nTasks, const Task &task, unsigned maxWorkers)
+{
+   if (nTasks == 0)
+      return;
+
+   // Deal contiguous runs, so that neighbouring tasks, which often touch
+   // neighbouring data, start on the same worker
+   const size_t nWorkers = maxWorkers > 0
+      ? std::min<size_t>(maxWorkers, mQueues.size())
+      : mQueues.size();
+   for (size_t iWorker = 0; iWorker < nWorkers; ++iWorker) {
+      auto &queue = mQueues[iWorker];
+      std::lock_guard<std::mutex> lock{ queue.mutex };
+      const auto first = nTasks * iWorker / nWorkers;
+      const auto last = nTasks * (iWorker + 1) / nWorkers;
+      for (auto iTask = first; iTask < last; ++iTask)
+         queue.tasks.push_back(iTask);
+   }
+
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mpTask = &task;
+      mActive = nWorkers;
+      mBusy = nWorkers;
+      mException = nullptr;
+      ++mGeneration;
+   }
+   if (!mThreads.empty())
+      mStartCondition.notify_all();
+
+   Work(0);
+
+   std::exception_ptr exception;
+   {
+      // Wait for the others to finish their tasks and leave, so that none
+      // still refers to task after return
+      std::unique_lock<std::mutex> lock{ mMutex };
+      --mBusy;
+      mDoneCondition.wait(lock, [this]{ return mBusy == 0; });
+      mpTask = nullptr;
+      exception = std::move(mException);
+      mException = nullptr;
+   }
+   if (exception)
+      std::rethrow_exception(exception);
+}
+
+void WorkStealingPool::WorkerThread(unsigned iWorker)
+{
+   unsigned long long generation = 0;
+   while (true) {
+      {
+         std::unique_lock<std::mutex> lock{ mMutex };
+         mStartCondition.wait(lock,
+            [&]{ return mStop || mGeneration != generation; });
+         if (mStop)
+            return;
+         generation = mGeneration;
+         // Sit out a ForEach limited to fewer workers; mBusy does not count
+         // this one
+         if (iWorker >= mActive)
+            continue;
+      }
+
+      Work(iWorker);
+
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         --mBusy;
+      }
+      mDoneCondition.notify_all();
+   }
+}
+
+void WorkStealingPool::Work(unsigned iWorker)
+{
+   size_t iTask;
+   while (Take(iWorker, iTask))
+      Run(iTask, iWorker);
+}
+
+bool WorkStealingPool::Take(unsigned iWorker, size_t &iTask)
+{
+   {
+      auto &queue = mQueues[iWorker];
+      std::lock_guard<std::mutex> lock{ queue.mutex };
+      if (!queue.tasks.empty()) {
+         iTask = queue.tasks.front();
+         queue.tasks.pop_front();
+         return true;
+      }
+   }
+
+   // Steal from the back, where the owner will get to last.  Workers read
+   // mActive only between the start and the end of a ForEach, which changes
+   // it before either under mMutex
+   const size_t nWorkers = mActive;
+   for (size_t offset = 1; offset < nWorkers; ++offset) {
+      auto &queue = mQueues[(iWorker + offset) % nWorkers];
+      std::lock_guard<std::mutex> lock{ queue.mutex };
+      if (!queue.tasks.empty()) {
+         iTask = queue.tasks.back();
+         queue.tasks.pop_back();
+         return true;
+      }
+   }
+
+   // Every task was taken at least once, and none are added during ForEach
+   return false;
+}
+
+void WorkStealingPool::Run(size_t iTask, unsigned iWorker)
+{
+   try {
+      (*mpTask)(iTask, iWorker);
+   }
+   catch (...) {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      if (!mException || iTask < mExceptionTask) {
+         mException = std::current_exception();
+         mExceptionTask = iTask;
+      }
+   }
+}
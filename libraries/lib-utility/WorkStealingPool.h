@@ -0,0 +1,118 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file WorkStealingPool.h
+  @brief Fixed set of threads that run a batch of indexed tasks together
+
+**********************************************************************/
+#ifndef __AUDACITY_WORK_STEALING_POOL__
+#define __AUDACITY_WORK_STEALING_POOL__
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "MemoryX.h"
+
+/*!
+ Each call to ForEach() deals the tasks out to the workers in contiguous
+ runs, one run per worker, and the calling thread works as worker 0.  A
+ worker takes tasks from the front of its own run, and when that is empty,
+ steals from the back of the others, so that uneven tasks even out.
+
+ Tasks are identified by index and the worker running a task by its number,
+ so that a task can use scratch space of its worker without locking.  Which
+ worker runs which task varies from call to call; results stay deterministic
+ if each task writes only what its index selects.
+ */
+class UTILITY_API WorkStealingPool final
+{
+public:
+   //! Type of task: arguments are the index of the task and the worker number
+   using Task = std::function<void(size_t iTask, unsigned iWorker)>;
+
+   //! Hardware concurrency, but at least 1
+   static unsigned DefaultConcurrency();
+
+   //! Starts concurrency - 1 threads
+   explicit WorkStealingPool(unsigned concurrency = DefaultConcurrency());
+   ~WorkStealingPool();
+
+   WorkStealingPool(const WorkStealingPool&) = delete;
+   WorkStealingPool &operator =(const WorkStealingPool&) = delete;
+
+   //! Number of workers, including the calling thread
+   unsigned GetConcurrency() const { return mQueues.size(); }
+
+   //! Run task(i, worker) for each i in [0, nTasks), and return when all are
+   //! done
+   /*!
+    If any tasks throw, all tasks still run or finish, then the exception of
+    the lowest task index is rethrown.  Not reentrant: one call at a time.
+    @param maxWorkers if not 0, only workers numbered below it take tasks
+    */
+   void ForEach(size_t nTasks, const Task &task, unsigned maxWorkers = 0);
+
+   //! Exclusive use, while it lasts, of one pool of DefaultConcurrency()
+   //! workers that the whole process shares, started on first use
+   /*!
+    ForEach() is not reentrant, so while one lease holds the pool, leases made
+    meanwhile, in any thread, hold nothing, and their callers should run their
+    tasks themselves.  That also keeps parallel loops nested in tasks serial.
+    */
+   class UTILITY_API SharedLease final {
+   public:
+      SharedLease();
+      ~SharedLease();
+
+      SharedLease(const SharedLease&) = delete;
+      SharedLease &operator =(const SharedLease&) = delete;
+
+      //! The pool, or null if another lease holds it
+      WorkStealingPool *get() const { return mpPool; }
+      WorkStealingPool *operator ->() const { return mpPool; }
+      explicit operator bool() const { return mpPool != nullptr; }
+
+   private:
+      std::unique_lock<std::mutex> mLock;
+      WorkStealingPool *mpPool{ nullptr };
+   };
+
+private:
+   struct Queue {
+      std::mutex mutex;
+      std::deque<size_t> tasks;
+   };
+
+   void WorkerThread(unsigned iWorker);
+   //! Run tasks until none are left to take or steal
+   void Work(unsigned iWorker);
+   bool Take(unsigned iWorker, size_t &iTask);
+   void Run(size_t iTask, unsigned iWorker);
+
+   std::vector<NonInterfering<Queue>> mQueues;
+   std::vector<std::thread> mThreads;
+
+   std::mutex mMutex;
+   std::condition_variable mStartCondition;
+   std::condition_variable mDoneCondition;
+   // Incremented for each ForEach, so that sleeping workers know to start
+   unsigned long long mGeneration{ 0 };
+   bool mStop{ false };
+   // Workers that take tasks in the current ForEach
+   unsigned mActive{ 0 };
+   // Workers still in the current ForEach
+   unsigned mBusy{ 0 };
+   const Task *mpTask{ nullptr };
+
+   std::exception_ptr mException;
+   size_t mExceptionTask{ 0 };
+};
+
+#endif
@@ -81,6 +81,7 @@ time warp info and AudioIOListener and whether the playback is looped.
 #include <math.h>
 #include <stdlib.h>
 #include <algorithm>
+#include <limits>
 #include <numeric>
 #include <optional>
 
@@ -137,6 +138,8 @@ time warp info and AudioIOListener and whether the playback is looped.
 using std::max;
 using std::min;
 
+IntSetting PlaybackPrefetchSeconds{ L"/Performance/PlaybackPrefetchSeconds", 4 };
+
 AudioIO *AudioIO::Get()
 {
    return static_cast< AudioIO* >( AudioIOBase::Get() );
@@ -692,6 +695,16 @@ bool AudioIO::StartPortAudioStream(const AudioIOStartStreamOptions &options,
       std::this_thread::sleep_for(1s);
    }
 
+   if (mPortStreamV19 != NULL && mLastPaError == paNoError) {
+      // The buffer size is unspecified, so allow generously for what the
+      // host may ask of the callback
+      const auto info = Pa_GetStreamInfo(mPortStreamV19);
+      const auto latency = info
+         ? std::max(info->inputLatency, info->outputLatency) : 0.0;
+      ReserveCallbackArena(std::max<unsigned long>(4096,
+         2 * static_cast<unsigned long>(ceil(latency * mRate))));
+   }
+
 
 #if USE_PORTMIXER
 #ifdef __WXMSW__
@@ -733,6 +746,19 @@ wxString AudioIO::LastPaErrorString()
    return wxString::Format(wxT("%d %s."), (int) mLastPaError, Pa_GetErrorText(mLastPaError));
 }
 
+void AudioIoCallback::ReserveCallbackArena(unsigned long maxFramesPerBuffer)
+{
+   // What AudioCallback() and FillOutputBuffers() take:  float buffers for
+   // conversion of input, for the output meter, and for each playback
+   // channel; three arrays of pointers; alignment of each of six allocations
+   const size_t nFloats = maxFramesPerBuffer *
+      (std::max(mNumCaptureChannels, mNumPlaybackChannels)
+         + 2 * mNumPlaybackChannels);
+   const size_t nPointers = 3 * mNumPlaybackChannels;
+   mCallbackArena.Reserve(nFloats * sizeof(float)
+      + nPointers * sizeof(void*) + 6 * RealtimeArena::Alignment);
+}
+
 void AudioIO::SetOwningProject(
    const std::shared_ptr<AudacityProject> &pProject )
 {
@@ -806,6 +832,10 @@ int AudioIO::StartStream(const TransportTracks &tracks,
 
    mLostSamples = 0;
    mLostCaptureIntervals.clear();
+   mOutputUnderflows.store(0, std::memory_order_relaxed);
+   mInputOverflows.store(0, std::memory_order_relaxed);
+   mPlaybackShortfalls.store(0, std::memory_order_relaxed);
+   mBlockCacheTotals = SampleBlockCache::GetTotals();
    mDetectDropouts =
       gPrefs->Read( WarningDialogKey(wxT("DropoutDetected")), true ) != 0;
    auto cleanup = finally ( [this] { ClearRecordingException(); } );
@@ -898,6 +928,9 @@ int AudioIO::StartStream(const TransportTracks &tracks,
    mPlaybackBuffers.reset();
    mScratchBuffers.clear();
    mScratchPointers.clear();
+   mScratchSets.clear();
+   mRealtimeBlocks.clear();
+   mRealtimeBlockPointers.clear();
    mPlaybackMixers.clear();
    mCaptureBuffers.reset();
    mResample.reset();
@@ -1007,15 +1040,21 @@ int AudioIO::StartStream(const TransportTracks &tracks,
    // TrackBufferExchange will ALWAYS get called from the Audio thread.
    mAudioThreadShouldCallTrackBufferExchangeOnce
       .store(true, std::memory_order_release);
+   mAudioThreadWakeup.Post();
 
-   while( mAudioThreadShouldCallTrackBufferExchangeOnce
-      .load(std::memory_order_acquire)) {
+   {
       using namespace std::chrono;
       auto interval = 50ms;
-      if (options.playbackStreamPrimer) {
-         interval = options.playbackStreamPrimer();
+      auto done = [this]{
+         return !mAudioThreadShouldCallTrackBufferExchangeOnce
+            .load(std::memory_order_acquire);
+      };
+      // The primer may need to run repeatedly while the audio thread works
+      while (!done()) {
+         if (options.playbackStreamPrimer)
+            interval = options.playbackStreamPrimer();
+         WaitForAudioThread(done, interval);
       }
-      std::this_thread::sleep_for(interval);
    }
 
    if(mNumPlaybackChannels > 0 || mNumCaptureChannels > 0) {
@@ -1179,22 +1218,38 @@ bool AudioIO::AllocateBuffers(
       {
          if( mNumPlaybackChannels > 0 ) {
             // Allocate output buffers.  For every output track we allocate
-            // a ring buffer of ten seconds
+            // a channel of ring buffer of ten seconds
             auto playbackBufferSize =
                (size_t)lrint(mRate * mPlaybackRingBufferSecs.count());
 
-            // Always make at least one playback buffer
-            mPlaybackBuffers.reinit(
-               std::max<size_t>(1, mPlaybackTracks.size()));
-            // Number of scratch buffers depends on device playback channels
+            // Always make at least one playback channel
+            mPlaybackBuffers = std::make_unique<MultiChannelRingBuffer>(
+               std::max<size_t>(1, mPlaybackTracks.size()),
+               playbackBufferSize);
+            // Number of scratch buffers depends on device playback channels,
+            // and on the threads that may process realtime effects:  a set
+            // for each, of one more than the channels, and stand-ins for
+            // missing channels
             if (mNumPlaybackChannels > 0) {
-               mScratchBuffers.resize(mNumPlaybackChannels * 2);
+               const auto nSets = RealtimeEffectManager::GetConcurrency();
+               const auto setSize = mNumPlaybackChannels * 2;
+               mScratchBuffers.resize(nSets * setSize);
                mScratchPointers.clear();
                for (auto &buffer : mScratchBuffers) {
                   buffer.Allocate(playbackBufferSize, floatSample);
                   mScratchPointers.push_back(
                      reinterpret_cast<float*>(buffer.ptr()));
                }
+               mScratchSets.clear();
+               for (size_t iSet = 0; iSet < nSets; ++iSet)
+                  mScratchSets.push_back(
+                     mScratchPointers.data() + iSet * setSize);
+
+               // At most two blocks of each track in a batch
+               const auto maxBlocks = 2 * mPlaybackTracks.size();
+               mRealtimeBlocks.clear();
+               mRealtimeBlocks.reserve(maxBlocks);
+               mRealtimeBlockPointers.resize(maxBlocks * mNumPlaybackChannels);
             }
             mPlaybackMixers.clear();
             mPlaybackMixers.resize(mPlaybackTracks.size());
@@ -1206,20 +1261,12 @@ bool AudioIO::AllocateBuffers(
             mPlaybackQueueMinimum =
                std::min( mPlaybackQueueMinimum, playbackBufferSize );
 
-            if (mPlaybackTracks.empty())
-               // Make at least one playback buffer
-               mPlaybackBuffers[0] =
-                  std::make_unique<RingBuffer>(floatSample, playbackBufferSize);
-
             for (unsigned int i = 0; i < mPlaybackTracks.size(); i++)
             {
                // Bug 1763 - We must fade in from zero to avoid a click on starting.
                mPlaybackTracks[i]->SetOldChannelGain(0, 0.0);
                mPlaybackTracks[i]->SetOldChannelGain(1, 0.0);
 
-               mPlaybackBuffers[i] =
-                  std::make_unique<RingBuffer>(floatSample, playbackBufferSize);
-
                // use track time for the end time, not real time!
                SampleTrackConstArray mixTracks;
                mixTracks.push_back(mPlaybackTracks[i]);
@@ -1260,6 +1307,15 @@ bool AudioIO::AllocateBuffers(
                (playbackBufferSize + TimeQueueGrainSize - 1)
                   / TimeQueueGrainSize;
             mPlaybackSchedule.mTimeQueue.Resize( timeQueueSize );
+
+            // The callback wakes the audio thread when so few frames remain
+            // ready that FillPlayBuffers will find room to copy
+            const auto capacity = mPlaybackBuffers->AvailForPut();
+            mPlaybackWakeupLevel = capacity -
+               std::min(capacity, mPlaybackSamplesToCopy + 10);
+
+            mPrefetchSeconds = std::max(0, PlaybackPrefetchSeconds.Read());
+            mLastPrefetchTime = -std::numeric_limits<double>::infinity();
          }
 
          if( mNumCaptureChannels > 0 )
@@ -1289,6 +1345,11 @@ bool AudioIO::AllocateBuffers(
                   std::make_unique<Resample>(true, mFactor, mFactor);
                   // constant rate resampling
             }
+
+            // The callback wakes the audio thread when DrainRecordBuffers
+            // will find enough to copy
+            mCaptureWakeupLevel = std::min(captureBufferSize,
+               (size_t)ceil(mMinCaptureSecsToCopy * mRate));
          }
       }
       catch(std::bad_alloc&)
@@ -1325,6 +1386,9 @@ void AudioIO::StartStreamCleanup(bool bOnlyBuffers)
    mPlaybackBuffers.reset();
    mScratchBuffers.clear();
    mScratchPointers.clear();
+   mScratchSets.clear();
+   mRealtimeBlocks.clear();
+   mRealtimeBlockPointers.clear();
    mPlaybackMixers.clear();
    mCaptureBuffers.reset();
    mResample.reset();
@@ -1443,6 +1507,29 @@ void AudioIO::StopStream()
   #endif
 
    if (mPortStreamV19) {
+      const auto blocks = SampleBlockCache::GetTotals() - mBlockCacheTotals;
+      wxLogDebug(wxT("AudioIO::StopStream(): %llu blocks prefetched, "
+            "%.1f%% of them used, %llu evicted unused; "
+            "block cache %llu hits, %llu misses"),
+         (unsigned long long)blocks.prefetched,
+         100 * blocks.PrefetchHitRate(),
+         (unsigned long long)blocks.prefetchEvictions,
+         (unsigned long long)blocks.hits,
+         (unsigned long long)blocks.misses);
+      wxLogDebug(wxT("AudioIO::StopStream(): callback CPU load %.1f%%, "
+            "%lu output underflows, %lu input overflows, "
+            "%lu playback shortfalls, "
+            "callback scratch %lu of %lu bytes, %lu overflows, "
+            "%lu trapped allocations"),
+         100 * Pa_GetStreamCpuLoad( mPortStreamV19 ),
+         mOutputUnderflows.load(std::memory_order_relaxed),
+         mInputOverflows.load(std::memory_order_relaxed),
+         mPlaybackShortfalls.load(std::memory_order_relaxed),
+         static_cast<unsigned long>(mCallbackArena.HighWater()),
+         static_cast<unsigned long>(mCallbackArena.Capacity()),
+         mCallbackArena.Overflows(),
+         RealtimeAllocationTrap::Count());
+
       // DV: Pa_CloseStream will close Pa_AbortStream internally,
       // but it doesn't hurt to do it ourselves.
       // PA_AbortStream will silently fail if stream is stopped.
@@ -1452,6 +1539,7 @@ void AudioIO::StopStream()
       Pa_CloseStream( mPortStreamV19 );
 
       mPortStreamV19 = NULL;
+      mCallbackArena.Release();
    }
 
 
@@ -1490,6 +1578,9 @@ void AudioIO::StopStream()
       mPlaybackBuffers.reset();
       mScratchBuffers.clear();
       mScratchPointers.clear();
+      mScratchSets.clear();
+      mRealtimeBlocks.clear();
+      mRealtimeBlockPointers.clear();
       mPlaybackMixers.clear();
       mPlaybackSchedule.mTimeQueue.Clear();
    }
@@ -1794,8 +1885,11 @@ AudioThread::ExitCode AudioThread::Entry()
 
       gAudioIO->mAudioThreadTrackBufferExchangeLoopActive
          .store(false, std::memory_order_relaxed);
+      gAudioIO->NotifyAudioThreadPass();
 
-      std::this_thread::sleep_until( loopPassStart + interval );
+      // Sleep until the callback or a command needs us, or at most for the
+      // policy's interval, which some policies use to poll for new work
+      gAudioIO->mAudioThreadWakeup.WaitUntil( loopPassStart + interval );
    }
 
    return 0;
@@ -1804,10 +1898,7 @@ AudioThread::ExitCode AudioThread::Entry()
 
 size_t AudioIO::GetCommonlyFreePlayback()
 {
-   auto commonlyAvail = mPlaybackBuffers[0]->AvailForPut();
-   for (unsigned i = 1; i < mPlaybackTracks.size(); ++i)
-      commonlyAvail = std::min(commonlyAvail,
-         mPlaybackBuffers[i]->AvailForPut());
+   auto commonlyAvail = mPlaybackBuffers->AvailForPut();
    // MB: subtract a few samples because the code in TrackBufferExchange has rounding
    // errors
    return commonlyAvail - std::min(size_t(10), commonlyAvail);
@@ -1815,11 +1906,7 @@ size_t AudioIO::GetCommonlyFreePlayback()
 
 size_t AudioIoCallback::GetCommonlyReadyPlayback()
 {
-   auto commonlyAvail = mPlaybackBuffers[0]->AvailForGet();
-   for (unsigned i = 1; i < mPlaybackTracks.size(); ++i)
-      commonlyAvail = std::min(commonlyAvail,
-         mPlaybackBuffers[i]->AvailForGet());
-   return commonlyAvail;
+   return mPlaybackBuffers->AvailForGet();
 }
 
 size_t AudioIO::GetCommonlyAvailCapture()
@@ -1894,6 +1981,11 @@ void AudioIO::FillPlayBuffers()
       // atomic variables, the time queue doesn't.
       mPlaybackSchedule.mTimeQueue.Producer(mPlaybackSchedule, slice);
 
+      // All channels are written in one span, padded with zeroes after what
+      // each mixer produced
+      const auto span = mPlaybackBuffers->Reserve(frames);
+      // wxASSERT(span.size() == frames);
+      // but we can't assert in this thread
       for (size_t i = 0; i < mPlaybackTracks.size(); i++)
       {
          // The mixer here isn't actually mixing: it's just doing
@@ -1906,17 +1998,16 @@ void AudioIO::FillPlayBuffers()
                produced = mPlaybackMixers[i]->Process( toProduce );
             //wxASSERT(produced <= toProduce);
             auto warpedSamples = mPlaybackMixers[i]->GetBuffer();
-            const auto put = mPlaybackBuffers[i]->Put(
-               warpedSamples, floatSample, produced, frames - produced);
-            // wxASSERT(put == frames);
-            // but we can't assert in this thread
-            wxUnusedVar(put);
+            mPlaybackBuffers->Write(span, i,
+               reinterpret_cast<const float*>(warpedSamples),
+               std::min(produced, span.size()));
          }
       }
 
       if (mPlaybackTracks.empty())
-         // Produce silence in the single ring buffer
-         mPlaybackBuffers[0]->Put(nullptr, floatSample, 0, frames);
+         // Produce silence in the single channel
+         mPlaybackBuffers->Write(span, 0, nullptr, 0);
+      mPlaybackBuffers->Commit(span.size());
 
       available -= frames;
       // wxASSERT(available >= 0); // don't assert on this thread
@@ -1929,6 +2020,8 @@ void AudioIO::FillPlayBuffers()
    // two buffers per track, after all the little slices have been written.
    TransformPlayBuffers();
 
+   PrefetchPlayBuffers();
+
    /* The flushing of all the Puts to the RingBuffers is lifted out of the
    do-loop above, and also after transformation of the stream for realtime
    effects.
@@ -1937,17 +2030,42 @@ void AudioIO::FillPlayBuffers()
    indicates the readiness of sample data to the consumer.  That atomic
    also sychronizes the use of the TimeQueue.
    */
-   for (size_t i = 0; i < std::max(size_t{1}, mPlaybackTracks.size()); ++i)
-      mPlaybackBuffers[i]->Flush();
+   mPlaybackBuffers->Flush();
+}
+
+void AudioIO::PrefetchPlayBuffers()
+{
+   // The mixers read sample blocks synchronously in this thread, and a cold
+   // read of the database may stall it; so ask the reader thread of the
+   // database to load the blocks that play will reach next
+   if (mPrefetchSeconds <= 0 || mPlaybackTracks.empty())
+      return;
+
+   // Requests already made still cover most of the lookahead, unless play
+   // jumped
+   const auto time = mPlaybackSchedule.mTimeQueue.GetLastTime();
+   if (std::abs(time - mLastPrefetchTime) < mPrefetchSeconds / 4)
+      return;
+   mLastPrefetchTime = time;
+
+   const auto intervals = mPlaybackSchedule.GetPolicy()
+      .PredictedTrackTimes(mPlaybackSchedule, time, mPrefetchSeconds);
+   for (const auto &[t0, t1] : intervals)
+      for (const auto &pTrack : mPlaybackTracks) {
+         const auto s0 = pTrack->TimeToLongSamples(std::min(t0, t1));
+         const auto s1 = pTrack->TimeToLongSamples(std::max(t0, t1));
+         if (s1 > s0)
+            pTrack->Prefetch(s0, (s1 - s0).as_size_t());
+      }
 }
 
 void AudioIO::TransformPlayBuffers()
 {
    // Transform written but un-flushed samples in the RingBuffers in-place.
 
-   // Avoiding std::vector
-   auto pointers =
-      static_cast<float**>(alloca(mNumPlaybackChannels * sizeof(float*)));
+   // Gather all blocks first, so that tracks may be processed concurrently
+   mRealtimeBlocks.clear();
+   auto pointers = mRealtimeBlockPointers.data();
 
    std::optional<RealtimeEffects::ProcessingScope> pScope;
    if (mpTransportState && mpTransportState->mpRealtimeInitialization)
@@ -1966,34 +2084,29 @@ void AudioIO::TransformPlayBuffers()
          // Loop over the blocks of unflushed data, at most two
          for (unsigned iBlock : {0, 1}) {
             size_t len = 0;
-            size_t iChannel = 0;
-            for (; iChannel < nChannels; ++iChannel) {
+            for (size_t iChannel = 0; iChannel < nChannels; ++iChannel) {
                const auto pair =
-                  mPlaybackBuffers[t + iChannel]->GetUnflushed(iBlock);
-               // Playback RingBuffers have float format: see AllocateBuffers
-               pointers[iChannel] = reinterpret_cast<float*>(pair.first);
-               // The lengths of corresponding unflushed blocks should be
-               // the same for all channels
-               if (len == 0)
-                  len = pair.second;
-               else
-                  assert(len == pair.second);
+                  mPlaybackBuffers->GetUnflushed(t + iChannel, iBlock);
+               pointers[iChannel] = pair.first;
+               // The lengths of corresponding unflushed blocks are the same
+               // for all channels
+               len = pair.second;
             }
 
-            // Are there more output device channels than channels of vt?
-            // Such as when a mono track is processed for stereo play?
-            // Then supply some non-null fake input buffers, because the
-            // various ProcessBlock overrides of effects may crash without it.
-            // But it would be good to find the fixes to make this unnecessary.
-            float **scratch = &mScratchPointers[mNumPlaybackChannels + 1];
-            while (iChannel < mNumPlaybackChannels)
-               pointers[iChannel++] = *scratch++;
-
-            if (len && pScope)
-               pScope->Process(*vt, &pointers[0], mScratchPointers.data(), len);
+            // If there are more output device channels than channels of vt,
+            // the worker that processes the block supplies stand-ins
+            if (len && pScope) {
+               mRealtimeBlocks.push_back({ vt, pointers,
+                  static_cast<unsigned>(nChannels), len });
+               pointers += mNumPlaybackChannels;
+            }
          }
       }
    }
+
+   if (pScope && !mRealtimeBlocks.empty())
+      pScope->ProcessBlocks(mRealtimeBlocks.data(), mRealtimeBlocks.size(),
+         mScratchSets.data(), mScratchSets.size());
 }
 
 void AudioIO::DrainRecordBuffers()
@@ -2482,6 +2595,14 @@ void ClampBuffer(float * pBuffer, unsigned long len){
 };
 
 
+// Declares a pointer to scratch for the callback, from mCallbackArena, or
+// from the stack if the host passes a larger buffer than was reserved; alloca
+// memory lasts until the function returns, even if taken in an inner block
+#define CALLBACK_SCRATCH(type, name, count) \
+   type *name = mCallbackArena.Allocate<type>(count); \
+   if (!name) \
+      name = static_cast<type *>(alloca((count) * sizeof(type)))
+
 // return true, IFF we have fully handled the callback.
 //
 // Mix and copy to PortAudio's output buffer
@@ -2521,12 +2642,16 @@ bool AudioIoCallback::FillOutputBuffers(
 
    // ------ MEMORY ALLOCATION ----------------------
    // These are small structures.
-   WaveTrack **chans = (WaveTrack **) alloca(numPlaybackChannels * sizeof(WaveTrack *));
-   float **tempBufs = (float **) alloca(numPlaybackChannels * sizeof(float *));
+   CALLBACK_SCRATCH(WaveTrack *, chans, numPlaybackChannels);
+   CALLBACK_SCRATCH(float *, tempBufs, numPlaybackChannels);
+   // Where the samples of each channel are read, in place in the ring buffer
+   // unless wrapped around, else copied to tempBufs
+   CALLBACK_SCRATCH(const float *, channelBufs, numPlaybackChannels);
 
    // And these are larger structures....
+   CALLBACK_SCRATCH(float, tempStorage, framesPerBuffer * numPlaybackChannels);
    for (unsigned int c = 0; c < numPlaybackChannels; c++)
-      tempBufs[c] = (float *) alloca(framesPerBuffer * sizeof(float));
+      tempBufs[c] = tempStorage + c * framesPerBuffer;
    // ------ End of MEMORY ALLOCATION ---------------
 
    int chanCnt = 0;
@@ -2534,6 +2659,7 @@ bool AudioIoCallback::FillOutputBuffers(
    // Choose a common size to take from all ring buffers
    const auto toGet =
       std::min<size_t>(framesPerBuffer, GetCommonlyReadyPlayback());
+   const auto span = mPlaybackBuffers->Peek(toGet);
 
    // The drop and dropQuickly booleans are so named for historical reasons.
    // JKC: The original code attempted to be faster by doing nothing on silenced audio.
@@ -2584,25 +2710,28 @@ bool AudioIoCallback::FillOutputBuffers(
 
       if (dropQuickly)
       {
-         len = mPlaybackBuffers[t]->Discard(toGet);
+         // The frames are consumed below, for all channels together
+         len = span.size();
          // keep going here.  
          // we may still need to issue a paComplete.
       }
       else
       {
-         len = mPlaybackBuffers[t]->Get((samplePtr)tempBufs[chanCnt],
-                                                   floatSample,
-                                                   toGet);
+         len = span.size();
          // wxASSERT( len == toGet );
-         if (len < framesPerBuffer)
-            // This used to happen normally at the end of non-looping
-            // plays, but it can also be an anomalous case where the
-            // supply from TrackBufferExchange fails to keep up with the
-            // real-time demand in this thread (see bug 1932).  We
-            // must supply something to the sound card, so pad it with
-            // zeroes and not random garbage.
-            memset((void*)&tempBufs[chanCnt][len], 0,
-               (framesPerBuffer - len) * sizeof(float));
+         // len may be less than framesPerBuffer.  This used to happen
+         // normally at the end of non-looping plays, but it can also be an
+         // anomalous case where the supply from TrackBufferExchange fails to
+         // keep up with the real-time demand in this thread (see bug 1932).
+         // Then only len samples of each channel are added to the output,
+         // which is otherwise zero.
+         if (span.lengths[1] == 0)
+            channelBufs[chanCnt] =
+               mPlaybackBuffers->GetChannel(t) + span.start;
+         else {
+            mPlaybackBuffers->Read(span, t, tempBufs[chanCnt]);
+            channelBufs[chanCnt] = tempBufs[chanCnt];
+         }
          chanCnt++;
       }
 
@@ -2646,12 +2775,12 @@ bool AudioIoCallback::FillOutputBuffers(
             if (vt->GetChannelIgnoringPan() == Track::LeftChannel ||
                   vt->GetChannelIgnoringPan() == Track::MonoChannel )
                AddToOutputChannel( 0, outputMeterFloats, outputFloats,
-                  tempBufs[c], drop, len, vt);
+                  channelBufs[c], drop, len, vt);
 
             if (vt->GetChannelIgnoringPan() == Track::RightChannel ||
                   vt->GetChannelIgnoringPan() == Track::MonoChannel  )
                AddToOutputChannel( 1, outputMeterFloats, outputFloats,
-                  tempBufs[c], drop, len, vt);
+                  channelBufs[c], drop, len, vt);
          }
       }
 
@@ -2667,10 +2796,21 @@ bool AudioIoCallback::FillOutputBuffers(
    // do it here instead (but not if looping or scrubbing)
    // PRL:  Also consume from the single playback ring buffer
    if (numPlaybackTracks == 0) {
-      mMaxFramesOutput = mPlaybackBuffers[0]->Discard(toGet);
+      mMaxFramesOutput = span.size();
       CallbackCheckCompletion(mCallbackReturn, 0);
    }
 
+   // All reading of the channels is done; give the space back to the writer
+   mPlaybackBuffers->Consume(span.size());
+
+   // Wake the audio thread as soon as it can refill
+   const auto ready = mPlaybackBuffers->AvailForGet();
+   if (ready <= mPlaybackWakeupLevel &&
+       ready + span.size() > mPlaybackWakeupLevel)
+      mAudioThreadWakeup.Post();
+   if (numPlaybackTracks > 0 && span.size() < framesPerBuffer)
+      mPlaybackShortfalls.fetch_add(1, std::memory_order_relaxed);
+
    // wxASSERT( maxLen == toGet );
 
    mLastPlaybackTimeMillis = ::wxGetUTCTimeMillis();
@@ -2820,6 +2960,11 @@ void AudioIoCallback::DrainInputBuffers(
       wxUnusedVar(put);
       mCaptureBuffers[t]->Flush();
    }
+
+   // Wake the audio thread as soon as there is enough for it to drain
+   const auto avail = mCaptureBuffers[0]->AvailForGet();
+   if (avail >= mCaptureWakeupLevel && avail < mCaptureWakeupLevel + len)
+      mAudioThreadWakeup.Post();
 }
 
 
@@ -3012,10 +3157,20 @@ int AudioIoCallback::AudioCallback(
    const PaStreamCallbackTimeInfo *timeInfo,
    const PaStreamCallbackFlags statusFlags, void * WXUNUSED(userData) )
 {
+   // All scratch of this callback is given back on return
+   RealtimeArena::Scope arenaScope{ mCallbackArena };
+   // Report any use of the heap, in builds configured to trap it
+   RealtimeAllocationTrap::Scope trapScope;
+
    // Poll tracks for change of state.  User might click mute and solo buttons.
    mbHasSoloTracks = CountSoloingTracks() > 0 ;
    mCallbackReturn = paContinue;
 
+   if (statusFlags & paOutputUnderflow)
+      mOutputUnderflows.fetch_add(1, std::memory_order_relaxed);
+   if (statusFlags & paInputOverflow)
+      mInputOverflows.fetch_add(1, std::memory_order_relaxed);
+
    if (IsPaused()
        // PRL:  Why was this added?  Was it only because of the mysterious
        // initial leading zeroes, now solved by setting mStreamToken early?
@@ -3038,17 +3193,20 @@ int AudioIoCallback::AudioCallback(
    // audio data.  One temporary use is for the InputMeter data.
    const auto numPlaybackChannels = mNumPlaybackChannels;
    const auto numCaptureChannels = mNumCaptureChannels;
-   float *tempFloats = (float *)alloca(framesPerBuffer*sizeof(float)*
-                             MAX(numCaptureChannels,numPlaybackChannels));
+   CALLBACK_SCRATCH(float, tempFloats,
+      framesPerBuffer * MAX(numCaptureChannels,numPlaybackChannels));
 
    bool bVolEmulationActive =
       (outputBuffer && GetMixerOutputVol() != 1.0);
    // outputMeterFloats is the scratch pad for the output meter.
    // we can often reuse the existing outputBuffer and save on allocating
    // something new.
-   float *outputMeterFloats = bVolEmulationActive ?
-         (float *)alloca(framesPerBuffer*numPlaybackChannels * sizeof(float)) :
-         outputBuffer;
+   float *outputMeterFloats = outputBuffer;
+   if (bVolEmulationActive) {
+      CALLBACK_SCRATCH(float, meterFloats,
+         framesPerBuffer * numPlaybackChannels);
+      outputMeterFloats = meterFloats;
+   }
    // ----- END of MEMORY ALLOCATIONS ------------------------------------------
 
    if (inputBuffer && numCaptureChannels) {
@@ -3143,12 +3301,12 @@ int AudioIoCallback::CallbackDoSeek()
    mAudioThreadTrackBufferExchangeLoopRunning
       .store(false, std::memory_order_relaxed);
 
-   while( mAudioThreadTrackBufferExchangeLoopActive
-      .load(std::memory_order_relaxed ) )
-   {
-      using namespace std::chrono;
-      std::this_thread::sleep_for(50ms);
-   }
+   auto inactive = [this]{
+      return !mAudioThreadTrackBufferExchangeLoopActive
+         .load(std::memory_order_relaxed);
+   };
+   while (!WaitForAudioThread(inactive))
+      ;
 
    // Calculate the NEW time position, in the PortAudio callback
    const auto time =
@@ -3158,20 +3316,20 @@ int AudioIoCallback::CallbackDoSeek()
    mSeek = 0.0;
 
 
-   // Reset mixer positions and flush buffers for all tracks
+   // Reset mixer positions for all tracks
    for (size_t i = 0; i < numPlaybackTracks; i++)
    {
       const bool skipping = true;
       mPlaybackMixers[i]->Reposition( time, skipping );
-      const auto toDiscard =
-         mPlaybackBuffers[i]->AvailForGet();
-      const auto discarded =
-         mPlaybackBuffers[i]->Discard( toDiscard );
-      // wxASSERT( discarded == toDiscard );
-      // but we can't assert in this thread
-      wxUnusedVar(discarded);
    }
 
+   // Flush the buffers, of all tracks at once
+   const auto toDiscard = mPlaybackBuffers->AvailForGet();
+   const auto discarded = mPlaybackBuffers->Discard( toDiscard );
+   // wxASSERT( discarded == toDiscard );
+   // but we can't assert in this thread
+   wxUnusedVar(discarded);
+
    mPlaybackSchedule.mTimeQueue.Prime(time);
 
    // Reload the ring buffers
@@ -3180,6 +3338,7 @@ int AudioIoCallback::CallbackDoSeek()
    // Reenable the audio thread
    mAudioThreadTrackBufferExchangeLoopRunning
       .store(true, std::memory_order_relaxed);
+   mAudioThreadWakeup.Post();
 
    return paContinue;
 }
@@ -3208,18 +3367,35 @@ auto AudioIoCallback::AudioIOExtIterator::operator *() const -> AudioIOExt &
 }
 
 
+void AudioIoCallback::NotifyAudioThreadPass()
+{
+   // Lock, so that no waiter misses the notification between its test of
+   // the atomics and its wait
+   { std::lock_guard<std::mutex> lock{ mAudioThreadPassMutex }; }
+   mAudioThreadPassCondition.notify_all();
+}
+
+bool AudioIoCallback::WaitForAudioThread(
+   const std::function<bool()> &predicate, std::chrono::milliseconds timeout)
+{
+   std::unique_lock<std::mutex> lock{ mAudioThreadPassMutex };
+   return mAudioThreadPassCondition.wait_for(lock, timeout, predicate);
+}
+
 void AudioIoCallback::StartAudioThread()
 {
    mAudioThreadTrackBufferExchangeLoopRunning.store(true, std::memory_order_release);
+   mAudioThreadWakeup.Post();
 }
 
 void AudioIoCallback::WaitForAudioThreadStarted()
 {
-   while (mAudioThreadAcknowledge.load(std::memory_order_acquire) != Acknowledge::eStart)
-   {
-      using namespace std::chrono;
-      std::this_thread::sleep_for(50ms);
-   }
+   auto started = [this]{
+      return mAudioThreadAcknowledge.load(std::memory_order_acquire)
+         == Acknowledge::eStart;
+   };
+   while (!WaitForAudioThread(started))
+      ;
    mAudioThreadAcknowledge.store(Acknowledge::eNone, std::memory_order_release);
 }
 
@@ -3234,15 +3410,17 @@ void AudioIoCallback::StartAudioThreadAndWait()
 void AudioIoCallback::StopAudioThread()
 {
    mAudioThreadTrackBufferExchangeLoopRunning.store(false, std::memory_order_release);
+   mAudioThreadWakeup.Post();
 }
 
 void AudioIoCallback::WaitForAudioThreadStopped()
 {
-   while (mAudioThreadAcknowledge.load(std::memory_order_acquire) != Acknowledge::eStop)
-   {
-      using namespace std::chrono;
-      std::this_thread::sleep_for(50ms);
-   }
+   auto stopped = [this]{
+      return mAudioThreadAcknowledge.load(std::memory_order_acquire)
+         == Acknowledge::eStop;
+   };
+   while (!WaitForAudioThread(stopped))
+      ;
    mAudioThreadAcknowledge.store(Acknowledge::eNone, std::memory_order_release);
 }
 
@@ -3257,13 +3435,14 @@ void AudioIoCallback::ProcessOnceAndWait(std::chrono::milliseconds sleepTime)
 {
    mAudioThreadShouldCallTrackBufferExchangeOnce
       .store(true, std::memory_order_release);
+   mAudioThreadWakeup.Post();
 
-   while (mAudioThreadShouldCallTrackBufferExchangeOnce
-      .load(std::memory_order_acquire))
-   {
-      using namespace std::chrono;
-      std::this_thread::sleep_for(sleepTime);
-   }
+   auto done = [this]{
+      return !mAudioThreadShouldCallTrackBufferExchangeOnce
+         .load(std::memory_order_acquire);
+   };
+   while (!WaitForAudioThread(done, sleepTime))
+      ;
 }
 
 
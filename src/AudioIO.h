@@ -18,6 +18,7 @@
 #include "AudioIOBase.h" // to inherit
 #include "PlaybackSchedule.h" // member variable
 
+#include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -25,6 +26,10 @@
 #include <wx/atomic.h> // member variable
 
 #include "PluginProvider.h" // for PluginID
+#include "LightweightSemaphore.h"
+#include "RealtimeArena.h" // member variable
+#include "SampleBlockCache.h" // member variable
+#include "effects/RealtimeEffectManager.h" // member variable
 #include "Observer.h"
 #include "SampleCount.h"
 #include "SampleFormat.h"
@@ -32,6 +37,7 @@
 class wxArrayString;
 class AudioIOBase;
 class AudioIO;
+class MultiChannelRingBuffer;
 class RingBuffer;
 class Mixer;
 class RealtimeEffectState;
@@ -55,6 +61,12 @@ typedef int PaError;
 
 namespace RealtimeEffects { class SuspensionScope; }
 
+class IntSetting;
+
+//! Seconds of play ahead of the mixers, for which the audio thread asks the
+//! project database to read sample blocks in the background; 0 disables
+extern AUDACITY_DLL_API IntSetting PlaybackPrefetchSeconds;
+
 bool ValidateDeviceNames();
 
 enum class Acknowledge { eNone = 0, eStart, eStop };
@@ -264,12 +276,21 @@ public:
    ArrayOf<std::unique_ptr<Resample>> mResample;
    ArrayOf<std::unique_ptr<RingBuffer>> mCaptureBuffers;
    WaveTrackArray      mCaptureTracks;
-   /*! Read by worker threads but unchanging during playback */
-   ArrayOf<std::unique_ptr<RingBuffer>> mPlaybackBuffers;
+   /*! Read by worker threads but unchanging during playback; one channel
+    for each of mPlaybackTracks, or one channel of silence if there are none */
+   std::unique_ptr<MultiChannelRingBuffer> mPlaybackBuffers;
    WaveTrackArray      mPlaybackTracks;
    // Temporary buffers, each as large as the playback buffers
    std::vector<SampleBuffer> mScratchBuffers;
    std::vector<float *> mScratchPointers; //!< pointing into mScratchBuffers
+   //! One set of mScratchPointers for each thread of realtime effects, each
+   //! with stand-ins for channels that tracks lack
+   std::vector<float *const *> mScratchSets;
+   //! Batch of realtime effect processing, reserved so that the audio thread
+   //! does not allocate
+   std::vector<RealtimeEffectManager::Block> mRealtimeBlocks;
+   //! Channel pointers of mRealtimeBlocks
+   std::vector<float *> mRealtimeBlockPointers;
 
    std::vector<std::unique_ptr<Mixer>> mPlaybackMixers;
 
@@ -308,6 +329,44 @@ public:
       
    std::atomic<Acknowledge>  mAudioThreadAcknowledge;
 
+   //! Wakes the audio thread before the end of its sleep interval
+   /*! Posted by the PortAudio callback when the playback buffer drains, or
+    the capture buffers fill, past a watermark, and with each command to the
+    audio thread */
+   LightweightSemaphore mAudioThreadWakeup;
+   //! Notified by the audio thread at the end of each pass, for threads
+   //! waiting on its acknowledgement of a command
+   std::mutex mAudioThreadPassMutex;
+   std::condition_variable mAudioThreadPassCondition;
+   //! Called by the audio thread at the end of each pass
+   void NotifyAudioThreadPass();
+   //! Wait until predicate() is true, testing it after each pass of the
+   //! audio thread, but no longer than timeout
+   /*! @return the last value of predicate() */
+   bool WaitForAudioThread(const std::function<bool()> &predicate,
+      std::chrono::milliseconds timeout = std::chrono::milliseconds(50));
+   /*! Unchanging during playback:  playback frames ready, at or below which
+    the audio thread finds enough free space to fill */
+   size_t              mPlaybackWakeupLevel{ 0 };
+   /*! Unchanging during playback:  capture frames available, at or above
+    which the audio thread drains them */
+   size_t              mCaptureWakeupLevel{ 0 };
+
+   //! Counted since the stream started, by the callback
+   //! @{
+   std::atomic<unsigned long> mOutputUnderflows{ 0 };
+   std::atomic<unsigned long> mInputOverflows{ 0 };
+   //! Callbacks that found fewer playback frames ready than the device
+   //! asked for, including at the end of play
+   std::atomic<unsigned long> mPlaybackShortfalls{ 0 };
+   //! @}
+
+   //! Scratch memory of the callback, reserved when the stream opens, so
+   //! that the callback needs neither heap nor a large stack
+   RealtimeArena       mCallbackArena;
+   //! Not real-time safe; call before the stream starts
+   void ReserveCallbackArena(unsigned long maxFramesPerBuffer);
+
    // Sync start/stop of AudioThread processing
    void StartAudioThreadAndWait();
    void StopAudioThreadAndWait();
@@ -586,6 +645,8 @@ private:
    //! First part of TrackBufferExchange
    void FillPlayBuffers();
    void TransformPlayBuffers();
+   //! Asks for sample blocks that play will reach within mPrefetchSeconds
+   void PrefetchPlayBuffers();
 
    //! Second part of TrackBufferExchange
    void DrainRecordBuffers();
@@ -623,6 +684,13 @@ private:
    PostRecordingAction mPostRecordingAction;
 
    bool mDelayingActions{ false };
+
+   //! Unchanging during playback; 0 if not prefetching
+   double mPrefetchSeconds{ 0 };
+   //! Track time at which the audio thread last prefetched
+   double mLastPrefetchTime{ 0 };
+   //! Snapshot when the stream started, for diagnostics when it stops
+   SampleBlockCache::Totals mBlockCacheTotals;
 };
 
 #endif
@@ -33,7 +33,9 @@ of sample block storage.
 #include <wx/valtext.h>
 #include <wx/intl.h>
 
+#include "Mix.h"
 #include "SampleBlock.h"
+#include "SampleBlockCache.h"
 #include "ShuttleGui.h"
 #include "Project.h"
 #include "WaveClip.h"
@@ -41,7 +43,9 @@ of sample block storage.
 #include "Sequence.h"
 #include "Prefs.h"
 #include "ProjectRate.h"
+#include "ResampleStats.h"
 #include "ViewInfo.h"
+#include "WorkStealingPool.h"
 
 #include "FileNames.h"
 #include "SelectFile.h"
@@ -68,6 +72,8 @@ private:
    void OnClear( wxCommandEvent &event );
    void OnClose( wxCommandEvent &event );
 
+   void PrintSandboxStats();
+   void PrintBlockCacheTotals();
    void Printf(const TranslatableString &str);
    void HoldPrint(bool hold);
    void FlushPrint();
@@ -85,6 +91,8 @@ private:
 
    bool      mBlockDetail;
    bool      mEditDetail;
+   bool      mResampleDetail;
+   bool      mMixDetail;
 
    wxTextCtrl  *mText;
 
@@ -157,6 +165,8 @@ BenchmarkDialog::BenchmarkDialog(
 
    mBlockDetail = false;
    mEditDetail = false;
+   mResampleDetail = false;
+   mMixDetail = false;
 
    HoldPrint(false);
 
@@ -225,6 +235,16 @@ void BenchmarkDialog::MakeBenchmarkDialog()
          .AddCheckBox(XXO("Show detailed info about each editing operation"),
                            false);
 
+      //
+      S.Validator<wxGenericValidator>(&mResampleDetail)
+         .AddCheckBox(XXO("Resample the test data and show sandbox call statistics"),
+                           false);
+
+      //
+      S.Validator<wxGenericValidator>(&mMixDetail)
+         .AddCheckBox(XXO("Mix copies of the test data down as export does, on one thread and on all"),
+                           false);
+
       //
       mText = S.Id(StaticTextID)
          /* i18n-hint noun */
@@ -293,6 +313,52 @@ void BenchmarkDialog::OnClear(wxCommandEvent & WXUNUSED(event))
    mText->Clear();
 }
 
+void BenchmarkDialog::PrintSandboxStats()
+{
+   const auto stats = ResampleSandboxStats::Get().GetSnapshot();
+
+   Printf( XO("Resampler sandbox calls:\n") );
+   for (size_t ii = 0; ii < ResampleSandboxStats::nSymbols; ++ii) {
+      const auto &totals = stats.symbols[ii];
+      if (totals.calls == 0)
+         continue;
+      const auto symbol =
+         ResampleSandboxStats::Name(ResampleSandboxStats::Symbol(ii));
+      Printf( XO("%s: %llu calls, %.3f ms total, %.1f us mean, %.1f us max\n")
+         .Format( symbol,
+            (unsigned long long)totals.calls,
+            totals.totalNs / 1.0e6,
+            totals.totalNs / 1.0e3 / totals.calls,
+            totals.maxNs / 1.0e3 ) );
+      for (size_t bucket = 0; bucket < ResampleSandboxStats::nBuckets; ++bucket)
+         if (totals.histogram[bucket] > 0)
+            Printf( XO("   >= %llu us: %llu\n")
+               .Format(
+                  (unsigned long long)ResampleSandboxStats::BucketFloorUs(bucket),
+                  (unsigned long long)totals.histogram[bucket] ) );
+   }
+   Printf( XO("Bytes marshalled into the sandbox: %llu, out of it: %llu\n")
+      .Format( (unsigned long long)stats.bytesIn,
+         (unsigned long long)stats.bytesOut ) );
+}
+
+void BenchmarkDialog::PrintBlockCacheTotals()
+{
+   const auto totals = SampleBlockCache::GetTotals();
+   Printf( XO("Sample block cache: %llu hits, %llu misses\n")
+      .Format( (unsigned long long)totals.hits,
+         (unsigned long long)totals.misses ) );
+   Printf( XO("Bytes read from the database: %llu for %llu requested (read amplification %.2f)\n")
+      .Format( (unsigned long long)totals.bytesRead,
+         (unsigned long long)totals.bytesRequested,
+         totals.ReadAmplification() ) );
+   if (totals.prefetched > 0)
+      Printf( XO("Blocks prefetched: %llu, %.1f%% used, %llu evicted unused\n")
+         .Format( (unsigned long long)totals.prefetched,
+            100 * totals.PrefetchHitRate(),
+            (unsigned long long)totals.prefetchEvictions ) );
+}
+
 void BenchmarkDialog::Printf(const TranslatableString &str)
 {
    auto s = str.Translation();
@@ -526,6 +592,7 @@ void BenchmarkDialog::OnRun( wxCommandEvent & WXUNUSED(event))
    wxTheApp->Yield();
 
    bad = 0;
+   SampleBlockCache::ResetTotals();
    timer.Start();
    for (uint64_t i = 0; i < nChunks; i++) {
       v = small1[i];
@@ -546,11 +613,13 @@ void BenchmarkDialog::OnRun( wxCommandEvent & WXUNUSED(event))
    elapsed = timer.Time();
 
    Printf( XO("Time to check all data: %ld ms\n").Format( elapsed ) );
+   PrintBlockCacheTotals();
    Printf( XO("Reading data again...\n") );
 
    wxTheApp->Yield();
    FlushPrint();
 
+   SampleBlockCache::ResetTotals();
    timer.Start();
 
    for (uint64_t i = 0; i < nChunks; i++) {
@@ -564,10 +633,76 @@ void BenchmarkDialog::OnRun( wxCommandEvent & WXUNUSED(event))
    elapsed = timer.Time();
 
    Printf( XO("Time to check all data (2): %ld ms\n").Format( elapsed ) );
+   PrintBlockCacheTotals();
 
    Printf( XO("At 44100 Hz, %d bytes per sample, the estimated number of\n simultaneous tracks that could be played at once: %.1f\n" )
       .Format( SAMPLE_SIZE(SampleFormat), (nChunks*chunkSize/44100.0)/(elapsed/1000.0) ) );
 
+   if (mResampleDetail) {
+      Printf( XO("Resampling all data...\n") );
+      wxTheApp->Yield();
+      FlushPrint();
+
+      // The track's rate is 1, so this doubles its length
+      ResampleSandboxStats::Get().Reset();
+      timer.Start();
+      t->Resample(2);
+      elapsed = timer.Time();
+
+      Printf( XO("Time to resample all data: %ld ms\n").Format( elapsed ) );
+      PrintSandboxStats();
+   }
+
+   if (mMixDetail) {
+      // Copies of the track, at various gains and pans, resampled to twice
+      // the rate and mixed to interleaved stereo
+      constexpr int nCopies = 16;
+      constexpr size_t bufferSize = 65536;
+      SampleTrackConstArray copies;
+      for (int i = 0; i < nCopies; ++i) {
+         auto copy = std::static_pointer_cast<WaveTrack>(t->Duplicate());
+         copy->SetGain(1.0f / (1 + i % 4));
+         copy->SetPan(((i % 5) - 2) / 2.0f);
+         copies.push_back(copy);
+      }
+
+      // Returns a hash of the output, to compare runs without keeping them
+      auto mixDown = [&](int threads, long &ms) {
+         MixerThreads.Write(threads);
+         Mixer mixer{ copies, false, Mixer::WarpOptions{ nullptr },
+            0, t->GetEndTime(), 2, bufferSize, true,
+            2 * t->GetRate(), floatSample };
+         uint64_t hash = 14695981039346656037ull;
+         timer.Start();
+         while (auto len = mixer.Process(bufferSize)) {
+            auto bytes = mixer.GetBuffer();
+            for (size_t i = 0; i < len * 2 * sizeof(float); ++i)
+               hash = (hash ^ static_cast<unsigned char>(bytes[i])) *
+                  1099511628211ull;
+         }
+         ms = timer.Time();
+         return hash;
+      };
+
+      Printf( XO("Mixing %d tracks...\n").Format( nCopies ) );
+      wxTheApp->Yield();
+      FlushPrint();
+
+      long serialMs, parallelMs;
+      const auto serialHash = mixDown(1, serialMs);
+      const auto threads = WorkStealingPool::DefaultConcurrency();
+      const auto parallelHash = mixDown(threads, parallelMs);
+
+      Printf( XO("Time to mix on 1 thread: %ld ms\n").Format( serialMs ) );
+      Printf( XO("Time to mix on %u threads: %ld ms\n")
+         .Format( threads, parallelMs ) );
+      if (serialHash != parallelHash) {
+         Printf( XO("Mixes on 1 and %u threads differ\n").Format( threads ) );
+         goto fail;
+      }
+      Printf( XO("Mixes are identical\n") );
+   }
+
    goto success;
 
  fail:
@@ -13,6 +13,8 @@ Paul Licameli -- split from ProjectFileIO.cpp
 
 #include "sqlite3.h"
 
+#include <cstdint>
+
 #include <wx/string.h>
 
 #include "AudacityLogger.h"
@@ -26,6 +28,16 @@ Paul Licameli -- split from ProjectFileIO.cpp
 
 #define AUDACITY_PROJECT_PAGE_SIZE 65536
 
+// Let sqlite map this much of the project file, so that reading part of a
+// blob through an incremental handle touches only the pages it needs,
+// instead of copying every page through the page cache.  Keep address space
+// for the rest of the program on 32 bit systems.
+#if UINTPTR_MAX > 0xffffffffu
+#define AUDACITY_PROJECT_MMAP_SIZE 2147418112
+#else
+#define AUDACITY_PROJECT_MMAP_SIZE 268435456
+#endif
+
 #define xstr(a) str(a)
 #define str(a) #a
 
@@ -39,7 +51,8 @@ static const char* SafeConfig =
    "PRAGMA <schema>.locking_mode = SHARED;"
    "PRAGMA <schema>.synchronous = NORMAL;"
    "PRAGMA <schema>.journal_mode = WAL;"
-   "PRAGMA <schema>.wal_autocheckpoint = 0;";
+   "PRAGMA <schema>.wal_autocheckpoint = 0;"
+   "PRAGMA <schema>.mmap_size = " xstr(AUDACITY_PROJECT_MMAP_SIZE) ";";
 
 // Configuration to provide "Fast" connections
 static const char *FastConfig =
@@ -48,6 +61,13 @@ static const char *FastConfig =
    "PRAGMA <schema>.synchronous = OFF;"
    "PRAGMA <schema>.journal_mode = OFF;";
 
+// Configuration for attached databases that must survive an interrupted copy
+static const char *DurableConfig =
+   "PRAGMA <schema>.busy_timeout = 5000;"
+   "PRAGMA <schema>.locking_mode = SHARED;"
+   "PRAGMA <schema>.synchronous = NORMAL;"
+   "PRAGMA <schema>.journal_mode = DELETE;";
+
 DBConnection::DBConnection(
    const std::weak_ptr<AudacityProject> &pProject,
    const std::shared_ptr<DBConnectionErrors> &pErrors,
@@ -58,6 +78,8 @@ DBConnection::DBConnection(
 {
    mDB = nullptr;
    mCheckpointDB = nullptr;
+   mWriterDB = nullptr;
+   mReaderDB = nullptr;
    mBypass = false;
 }
 
@@ -148,9 +170,34 @@ int DBConnection::Open(const FilePath fileName)
    mCheckpointStop = false;
    mCheckpointPending = false;
    mCheckpointActive = false;
+
+   // Initialize writer controls
+   mWriterStop = false;
+   mWriterRC = SQLITE_OK;
+   mWriterMessage.clear();
+   mNextBlockID = 0;
+
+   // Initialize reader controls
+   mReaderStop = false;
+
    rc = OpenStepByStep( fileName );
    if ( rc != SQLITE_OK)
    {
+      StopReader();
+      StopWriter();
+
+      if (mReaderDB)
+      {
+         sqlite3_close(mReaderDB);
+         mReaderDB = nullptr;
+      }
+
+      if (mWriterDB)
+      {
+         sqlite3_close(mWriterDB);
+         mWriterDB = nullptr;
+      }
+
       if (mCheckpointDB)
       {
          sqlite3_close(mCheckpointDB);
@@ -227,6 +274,57 @@ int DBConnection::OpenStepByStep(const FilePath fileName)
 
    // Install our checkpoint hook
    sqlite3_wal_hook(mDB, CheckpointHook, this);
+
+   rc = sqlite3_open(name, &mWriterDB);
+   if (rc != SQLITE_OK)
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::OpenStepByStep::open_writer");
+
+      wxLogMessage("Failed to open writer connection to %s: %d, %s\n",
+         fileName,
+         rc,
+         sqlite3_errstr(rc));
+      return rc;
+   }
+
+   rc = ModeConfig(mWriterDB, "main", SafeConfig);
+   if (rc != SQLITE_OK) {
+      SetDBError(XO("Failed to set safe mode on writer connection to %s").Format(fileName));
+      return rc;
+   }
+
+   // Contention with the primary connection outside of its transactions is
+   // brief, so let sqlite wait it out.  WriteBatch waits for the
+   // transactions themselves, without polling.
+   sqlite3_busy_timeout(mWriterDB, 100);
+
+   // Commits of the writer connection grow the WAL too
+   sqlite3_wal_hook(mWriterDB, CheckpointHook, this);
+
+   db = mWriterDB;
+   mWriterThread = std::thread(
+      [this, db, fileName]{ WriterThread(db, fileName); });
+
+   rc = sqlite3_open_v2(name, &mReaderDB, SQLITE_OPEN_READONLY, nullptr);
+   if (rc != SQLITE_OK)
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::OpenStepByStep::open_reader");
+
+      wxLogMessage("Failed to open reader connection to %s: %d, %s\n",
+         fileName,
+         rc,
+         sqlite3_errstr(rc));
+      return rc;
+   }
+
+   // Reads are only ahead of need, so don't wait long on contention
+   sqlite3_busy_timeout(mReaderDB, 100);
+
+   db = mReaderDB;
+   mReaderThread = std::thread([this, db]{ ReaderThread(db); });
+
    return rc;
 }
 
@@ -241,9 +339,15 @@ bool DBConnection::Close()
       return true;
    }
 
-   // Uninstall our checkpoint hook so that no additional checkpoints
+   // Abandon reads ahead, and commit the deferred writes, which may request
+   // one more checkpoint
+   StopReader();
+   StopWriter();
+
+   // Uninstall our checkpoint hooks so that no additional checkpoints
    // are sent our way.  (Though this shouldn't really happen.)
    sqlite3_wal_hook(mDB, nullptr, nullptr);
+   sqlite3_wal_hook(mWriterDB, nullptr, nullptr);
 
    // Display a progress dialog if there's active or pending checkpoints
    if (mCheckpointPending || mCheckpointActive)
@@ -307,6 +411,31 @@ bool DBConnection::Close()
 
    // Not much we can do if the closes fail, so just report the error
 
+   // Close the reader connection
+   rc = sqlite3_close(mReaderDB);
+   if (rc != SQLITE_OK)
+   {
+      wxLogMessage("Failed to close reader connection for %s\n"
+                   "\tError: %s\n",
+                   sqlite3_db_filename(mReaderDB, nullptr),
+                   sqlite3_errmsg(mReaderDB));
+   }
+   mReaderDB = nullptr;
+
+   // Close the writer connection
+   rc = sqlite3_close(mWriterDB);
+   if (rc != SQLITE_OK)
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::Close::close_writer");
+
+      wxLogMessage("Failed to close writer connection for %s\n"
+                   "\tError: %s\n",
+                   sqlite3_db_filename(mWriterDB, nullptr),
+                   sqlite3_errmsg(mWriterDB));
+   }
+   mWriterDB = nullptr;
+
    // Close the checkpoint connection
    rc = sqlite3_close(mCheckpointDB);
    if (rc != SQLITE_OK)
@@ -362,6 +491,11 @@ int DBConnection::FastMode(const char *schema /* = "main" */)
    return ModeConfig(mDB, schema, FastConfig);
 }
 
+int DBConnection::DurableMode(const char *schema /* = "main" */)
+{
+   return ModeConfig(mDB, schema, DurableConfig);
+}
+
 int DBConnection::SetPageSize(const char* schema)
 {
    // First of all - let's check if the database is empty.
@@ -587,6 +721,439 @@ int DBConnection::CheckpointHook(void *data, sqlite3 *db, const char *schema, in
    return SQLITE_OK;
 }
 
+void DBConnection::DeferWrite(DeferredWrite write)
+{
+   // Writes queued at once, beyond which producers wait for the disk, so
+   // that the data of pending blocks can't exhaust memory
+   constexpr size_t MaxDeferredWrites = 256;
+
+   {
+      std::unique_lock<std::mutex> lock(mWriterMutex);
+      if (OwnsTransaction())
+      {
+         // The writer thread can't write until the transaction ends, and
+         // the write belongs in the transaction anyway
+         lock.unlock();
+         std::vector<DeferredWrite> writes;
+         writes.push_back(std::move(write));
+         WriteInTransaction(writes);
+         return;
+      }
+
+      mWriterIdleCondition.wait(lock,
+                                [&]
+                                {
+                                   return mWriterRC != SQLITE_OK ||
+                                      mDeferredWrites.size() < MaxDeferredWrites;
+                                });
+      if (mWriterRC == SQLITE_OK)
+      {
+         mDeferredWrites.push_back(std::move(write));
+         mWriterCondition.notify_one();
+         return;
+      }
+   }
+
+   // An earlier write failed, so don't let more data pile up behind it
+   FlushDeferredWrites();
+}
+
+void DBConnection::FlushDeferredWrites()
+{
+   int rc;
+   wxString message;
+
+   {
+      std::unique_lock<std::mutex> lock(mWriterMutex);
+      if (OwnsTransaction())
+      {
+         // The writer thread would wait for this thread's transaction
+         // forever.  Take back what it has not written, and write it here
+         // instead, as part of that transaction.
+         mWriterYield = true;
+         mWriterCondition.notify_one();
+         mWriterIdleCondition.wait(lock, [&]{ return mWritesInFlight == 0; });
+         std::vector<DeferredWrite> writes(
+            std::make_move_iterator(mDeferredWrites.begin()),
+            std::make_move_iterator(mDeferredWrites.end()));
+         mDeferredWrites.clear();
+         mWriterYield = false;
+         mWriterIdleCondition.notify_all();
+         lock.unlock();
+
+         WriteInTransaction(writes);
+         return;
+      }
+
+      mWriterIdleCondition.wait(lock,
+                                [&]
+                                {
+                                   return mWriterRC != SQLITE_OK ||
+                                      (mDeferredWrites.empty() &&
+                                       mWritesInFlight == 0);
+                                });
+      rc = mWriterRC;
+      message = mWriterMessage;
+   }
+
+   if (rc != SQLITE_OK)
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::FlushDeferredWrites");
+
+      SetError(XO("Failed to write sample blocks"), Verbatim(message), rc);
+      ThrowException( true );
+   }
+}
+
+bool DBConnection::OwnsTransaction() const
+{
+   return mTransactionDepth > 0 &&
+      mTransactionOwner == std::this_thread::get_id();
+}
+
+void DBConnection::WriteInTransaction(std::vector<DeferredWrite> &writes)
+{
+   int rc = SQLITE_OK;
+   for (auto &write : writes)
+   {
+      if (rc == SQLITE_OK)
+      {
+         rc = write.write(mDB);
+      }
+      if (rc == SQLITE_OK)
+      {
+         if (write.committed)
+         {
+            write.committed();
+         }
+      }
+   }
+
+   if (rc != SQLITE_OK)
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::WriteInTransaction");
+
+      SetDBError(XO("Failed to write sample blocks"));
+      ThrowException( true );
+   }
+}
+
+void DBConnection::EnterTransaction()
+{
+   {
+      std::lock_guard<std::mutex> guard(mWriterMutex);
+      if (mTransactionDepth > 0)
+      {
+         ++mTransactionDepth;
+         return;
+      }
+   }
+
+   // Writes deferred before the transaction are no part of it
+   FlushDeferredWrites();
+
+   std::lock_guard<std::mutex> guard(mWriterMutex);
+   if (mTransactionDepth++ == 0)
+   {
+      mTransactionOwner = std::this_thread::get_id();
+   }
+}
+
+void DBConnection::LeaveTransaction()
+{
+   std::lock_guard<std::mutex> guard(mWriterMutex);
+   wxASSERT(mTransactionDepth > 0);
+   if (mTransactionDepth > 0 && --mTransactionDepth == 0)
+   {
+      // Let the writer thread have the database again
+      mTransactionOwner = {};
+      mWriterCondition.notify_one();
+   }
+}
+
+long long DBConnection::ReserveBlockID()
+{
+   std::lock_guard<std::mutex> guard(mBlockIDMutex);
+
+   // Continue from the largest id ever used, as AUTOINCREMENT of the
+   // blockid column would, so that no id is reused even if its row was
+   // deleted.  Inserting a larger explicit id updates sqlite_sequence too.
+   if (mNextBlockID == 0)
+   {
+      sqlite3_stmt *stmt = nullptr;
+      int rc = sqlite3_prepare_v2(mDB,
+         "SELECT MAX("
+         "  IFNULL((SELECT MAX(blockid) FROM sampleblocks), 0),"
+         "  IFNULL((SELECT seq FROM sqlite_sequence"
+         "          WHERE name = 'sampleblocks'), 0));", -1, &stmt, 0);
+      if (rc == SQLITE_OK)
+      {
+         rc = sqlite3_step(stmt);
+         if (rc == SQLITE_ROW)
+         {
+            mNextBlockID = sqlite3_column_int64(stmt, 0) + 1;
+         }
+      }
+      sqlite3_finalize(stmt);
+
+      if (mNextBlockID == 0)
+      {
+         ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+         ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::ReserveBlockID");
+
+         ThrowException( false );
+      }
+   }
+
+   return mNextBlockID++;
+}
+
+void DBConnection::WriterThread(sqlite3 *db, const FilePath &fileName)
+{
+   // Most writes to take into one transaction.  While one batch commits,
+   // the next accumulates, so under load batches grow by themselves.
+   constexpr size_t MaxBatch = 64;
+
+   while (true)
+   {
+      std::vector<DeferredWrite> batch;
+      {
+         // Wait for work or the stop signal.  While the primary connection
+         // has a transaction open, leave the writes queued; its owner may
+         // take them, or they wait for it to end.
+         std::unique_lock<std::mutex> lock(mWriterMutex);
+         mWriterCondition.wait(lock,
+                               [&]
+                               {
+                                  return (!mDeferredWrites.empty() &&
+                                          !mWriterYield &&
+                                          mTransactionDepth == 0) ||
+                                     mWriterStop;
+                               });
+
+         // Requested to stop, and all is written or can't be, so bail
+         if (mDeferredWrites.empty() || mWriterRC != SQLITE_OK)
+         {
+            break;
+         }
+
+         while (!mDeferredWrites.empty() && batch.size() < MaxBatch)
+         {
+            batch.push_back(std::move(mDeferredWrites.front()));
+            mDeferredWrites.pop_front();
+         }
+         mWritesInFlight = batch.size();
+      }
+
+      int rc = WriteBatch(db, batch);
+
+      if (rc == SQLITE_OK)
+      {
+         for (auto &write : batch)
+         {
+            if (write.committed)
+            {
+               write.committed();
+            }
+         }
+      }
+      else if (rc != SQLITE_BUSY)
+      {
+         ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+         ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::WriterThread");
+
+         wxLogMessage("Failed to write deferred sample blocks to %s\n"
+                      "\tErrCode: %d\n"
+                      "\tErrMsg: %s",
+                      fileName,
+                      rc,
+                      sqlite3_errmsg(db));
+      }
+
+      {
+         std::lock_guard<std::mutex> guard(mWriterMutex);
+         mWritesInFlight = 0;
+         if (rc != SQLITE_OK)
+         {
+            // Put the writes back, so that their data stay readable, and so
+            // that a yield gives them to the thread that asked for it
+            mDeferredWrites.insert(mDeferredWrites.begin(),
+               std::make_move_iterator(batch.begin()),
+               std::make_move_iterator(batch.end()));
+            if (rc != SQLITE_BUSY)
+            {
+               mWriterRC = rc;
+               mWriterMessage = sqlite3_errmsg(db);
+            }
+         }
+         mWriterIdleCondition.notify_all();
+      }
+
+      if (rc != SQLITE_OK && rc != SQLITE_BUSY)
+      {
+         // Stop the audio, as a failed checkpoint does
+         GuardedCall(
+            [&fileName] {
+            throw FileException{ FileException::Cause::Write, fileName }; },
+            SimpleGuard<void>{},
+            [this](AudacityException * e) {
+               // This executes in the main thread.
+               if (mCallback)
+                  mCallback();
+               if (e)
+                  e->DelayedHandlerAction();
+            }
+         );
+      }
+   }
+}
+
+int DBConnection::WriteBatch(sqlite3 *db, std::vector<DeferredWrite> &batch)
+{
+   // A transaction of the primary connection may have opened since the
+   // batch was taken.  It may last long, so rather than retry, sleep until
+   // it ends, or give up the batch (returning SQLITE_BUSY) if the thread
+   // that opened it wants to do the writes itself.  Other contentions are
+   // brief, and the busy timeout waits them out.
+   int rc;
+   while ((rc = sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr))
+          == SQLITE_BUSY)
+   {
+      std::unique_lock<std::mutex> lock(mWriterMutex);
+      mWriterCondition.wait(lock,
+                            [&]
+                            {
+                               return mTransactionDepth == 0 || mWriterYield;
+                            });
+      if (mWriterYield)
+      {
+         return rc;
+      }
+   }
+   if (rc != SQLITE_OK)
+   {
+      return rc;
+   }
+
+   for (auto &write : batch)
+   {
+      rc = write.write(db);
+      if (rc != SQLITE_OK)
+      {
+         sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+         // Don't mistake a failed write for contention
+         return rc == SQLITE_BUSY ? SQLITE_ERROR : rc;
+      }
+   }
+
+   // Holding the write lock, the commit contends only with readers
+   // for the WAL index, briefly, so retry after each busy timeout
+   do
+   {
+      rc = sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+   }
+   while (rc == SQLITE_BUSY);
+   if (rc != SQLITE_OK)
+   {
+      sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+   }
+   return rc;
+}
+
+void DBConnection::StopWriter()
+{
+   // Tell the writer thread to finish what's queued and shut down
+   {
+      std::lock_guard<std::mutex> guard(mWriterMutex);
+      mWriterStop = true;
+      mWriterCondition.notify_one();
+   }
+
+   // And wait for it to do so
+   if (mWriterThread.joinable())
+   {
+      mWriterThread.join();
+   }
+
+   std::lock_guard<std::mutex> guard(mWriterMutex);
+   if (!mDeferredWrites.empty())
+   {
+      wxLogMessage("Discarding %d deferred sample block writes to %s\n",
+                   (int)mDeferredWrites.size(),
+                   sqlite3_db_filename(mWriterDB, nullptr));
+      mDeferredWrites.clear();
+   }
+   mWriterIdleCondition.notify_all();
+}
+
+void DBConnection::DeferRead(DeferredRead read)
+{
+   // Reads ahead are only hints; when they come faster than the disk, the
+   // oldest are still the most useful
+   constexpr size_t MaxDeferredReads = 256;
+
+   std::lock_guard<std::mutex> guard(mReaderMutex);
+   if (mReaderStop || mDeferredReads.size() >= MaxDeferredReads)
+   {
+      return;
+   }
+   mDeferredReads.push_back(std::move(read));
+   mReaderCondition.notify_one();
+}
+
+void DBConnection::ReaderThread(sqlite3 *db)
+{
+   while (true)
+   {
+      DeferredRead read;
+      {
+         // Wait for work or the stop signal
+         std::unique_lock<std::mutex> lock(mReaderMutex);
+         mReaderCondition.wait(lock,
+                               [&]
+                               {
+                                  return !mDeferredReads.empty() || mReaderStop;
+                               });
+
+         if (mReaderStop)
+         {
+            break;
+         }
+
+         read = std::move(mDeferredReads.front());
+         mDeferredReads.pop_front();
+      }
+
+      try
+      {
+         read(db);
+      }
+      catch (...)
+      {
+         // Whoever wanted the data will read it again, and report failure
+      }
+   }
+}
+
+void DBConnection::StopReader()
+{
+   // Tell the reader thread to shut down, abandoning what's queued
+   {
+      std::lock_guard<std::mutex> guard(mReaderMutex);
+      mReaderStop = true;
+      mDeferredReads.clear();
+      mReaderCondition.notify_one();
+   }
+
+   // And wait for it to do so
+   if (mReaderThread.joinable())
+   {
+      mReaderThread.join();
+   }
+}
+
 // Install an implementation of TransactionScope
 #include "TransactionScope.h"
 
@@ -617,6 +1184,9 @@ bool DBConnectionTransactionScopeImpl::TransactionStart(const wxString &name)
 {
    char *errmsg = nullptr;
 
+   // Sample blocks made in the transaction must be rolled back with it
+   mConnection.EnterTransaction();
+
    int rc = sqlite3_exec(mConnection.DB(),
                          wxT("SAVEPOINT ") + name + wxT(";"),
                          nullptr,
@@ -634,6 +1204,9 @@ bool DBConnectionTransactionScopeImpl::TransactionStart(const wxString &name)
       sqlite3_free(errmsg);
    }
 
+   if (rc != SQLITE_OK)
+      mConnection.LeaveTransaction();
+
    return rc == SQLITE_OK;
 }
 
@@ -658,6 +1231,9 @@ bool DBConnectionTransactionScopeImpl::TransactionCommit(const wxString &name)
       sqlite3_free(errmsg);
    }
 
+   if (rc == SQLITE_OK)
+      mConnection.LeaveTransaction();
+
    return rc == SQLITE_OK;
 }
 
@@ -14,11 +14,13 @@ Paul Licameli -- split from ProjectFileIO.h
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include "ClientData.h"
 #include "Identifier.h"
@@ -59,6 +61,7 @@ public:
 
    int SafeMode(const char *schema = "main");
    int FastMode(const char* schema = "main");
+   int DurableMode(const char *schema = "main");
    int SetPageSize(const char* schema = "main");
 
    bool Assign(sqlite3 *handle);
@@ -85,6 +88,54 @@ public:
    void SetBypass( bool bypass );
    bool ShouldBypass();
 
+   //! A write that the writer thread performs on its own connection, in a
+   //! transaction it may share with other deferred writes
+   struct DeferredWrite
+   {
+      //! Binds and steps statements on the given connection
+      /*! Returns an sqlite3 result code; any but SQLITE_OK rolls back */
+      std::function<int(sqlite3 *db)> write;
+      //! Called in the writer thread once the transaction is committed
+      std::function<void()> committed;
+   };
+
+   //! Queue a write for the writer thread
+   /*! Waits only while the queue is at its high-water mark.  In the thread
+    that opened a transaction with EnterTransaction, writes at once instead,
+    inside that transaction.
+    @throws FileException if this or an earlier deferred write failed */
+   void DeferWrite(DeferredWrite write);
+
+   //! Wait until the writer thread has committed all deferred writes
+   /*! In the thread that opened a transaction, does the queued writes itself,
+    inside that transaction, because the writer can't while it is open.
+    @throws FileException if a deferred write failed */
+   void FlushDeferredWrites();
+
+   //! TransactionScope calls this before it makes a savepoint on the
+   //! primary connection
+   /*! Until the matching LeaveTransaction, the writer thread leaves the
+    database to that transaction, and the writes deferred by the calling
+    thread go into the transaction, so that a rollback undoes them.  When no
+    transaction was open, first commits what is queued, so that a rollback
+    does not undo that.
+    @throws FileException if a deferred write failed */
+   void EnterTransaction();
+   //! TransactionScope calls this when a savepoint is released, or could
+   //! not be made
+   void LeaveTransaction();
+
+   //! Id for a new row in sampleblocks, which may be inserted later
+   long long ReserveBlockID();
+
+   //! A read that the reader thread performs on its own connection, as to
+   //! load blobs before they are wanted; errors are not reported
+   using DeferredRead = std::function<void(sqlite3 *db)>;
+
+   //! Queue a read for the reader thread, unless too many are queued
+   //! already; never waits for the disk
+   void DeferRead(DeferredRead read);
+
    //! Just set stored errors
    void SetError(
       const TranslatableString &msg,
@@ -104,6 +155,17 @@ private:
    void CheckpointThread(sqlite3 *db, const FilePath &fileName);
    static int CheckpointHook(void *data, sqlite3 *db, const char *schema, int pages);
 
+   void WriterThread(sqlite3 *db, const FilePath &fileName);
+   int WriteBatch(sqlite3 *db, std::vector<DeferredWrite> &batch);
+   void StopWriter();
+   //! Whether this thread opened the current transaction; lock mWriterMutex
+   bool OwnsTransaction() const;
+   //! Do writes on the primary connection, inside the open transaction
+   void WriteInTransaction(std::vector<DeferredWrite> &writes);
+
+   void ReaderThread(sqlite3 *db);
+   void StopReader();
+
 private:
    std::weak_ptr<AudacityProject> mpProject;
    sqlite3 *mDB;
@@ -116,6 +178,32 @@ private:
    std::atomic_bool mCheckpointPending{ false };
    std::atomic_bool mCheckpointActive{ false };
 
+   sqlite3 *mWriterDB;
+   std::thread mWriterThread;
+   std::condition_variable mWriterCondition;
+   std::condition_variable mWriterIdleCondition;
+   std::mutex mWriterMutex;
+   std::deque<DeferredWrite> mDeferredWrites;
+   size_t mWritesInFlight{ 0 };
+   bool mWriterStop{ false };
+   bool mWriterYield{ false };
+   // Transactions open on the primary connection, with the thread that
+   // opened the outermost
+   int mTransactionDepth{ 0 };
+   std::thread::id mTransactionOwner;
+   int mWriterRC{ 0 }; // SQLITE_OK
+   wxString mWriterMessage;
+
+   sqlite3 *mReaderDB;
+   std::thread mReaderThread;
+   std::condition_variable mReaderCondition;
+   std::mutex mReaderMutex;
+   std::deque<DeferredRead> mDeferredReads;
+   bool mReaderStop{ false };
+
+   std::mutex mBlockIDMutex;
+   long long mNextBlockID{ 0 }; // 0 until read from the database
+
    std::mutex mStatementMutex;
    using StatementIndex = std::pair<enum StatementID, std::thread::id>;
    std::map<StatementIndex, sqlite3_stmt *> mStatements;
@@ -124,6 +124,19 @@ bool PlaybackPolicy::RepositionPlayback(
    return true;
 }
 
+auto PlaybackPolicy::PredictedTrackTimes( const PlaybackSchedule &schedule,
+   double trackTime, double lookahead ) const -> Intervals
+{
+   const auto end = schedule.mT1;
+   if (schedule.ReversedTime()) {
+      if (trackTime > end)
+         return { { trackTime, std::max(end, trackTime - lookahead) } };
+   }
+   else if (trackTime < end)
+      return { { trackTime, std::min(end, trackTime + lookahead) } };
+   return {};
+}
+
 bool PlaybackPolicy::Looping(const PlaybackSchedule &) const
 {
    return false;
@@ -381,6 +394,32 @@ bool NewDefaultPlaybackPolicy::RepositionPlayback(
    return false;
 }
 
+auto NewDefaultPlaybackPolicy::PredictedTrackTimes(
+   const PlaybackSchedule &schedule, double trackTime, double lookahead ) const
+   -> Intervals
+{
+   // This executes in the TrackBufferExchange thread, which also writes
+   // mLastPlaySpeed
+   lookahead *= mLastPlaySpeed;
+   if (RevertToOldDefault(schedule))
+      return PlaybackPolicy::PredictedTrackTimes(
+         schedule, trackTime, lookahead);
+
+   // Play to the end of the loop, then from its start, but predict no more
+   // than once around
+   const auto t0 = schedule.mT0, t1 = schedule.mT1;
+   lookahead = std::min(lookahead, t1 - t0);
+   Intervals result;
+   if (trackTime < t1) {
+      const auto end = std::min(t1, trackTime + lookahead);
+      result.emplace_back(trackTime, end);
+      lookahead -= end - trackTime;
+   }
+   if (lookahead > 0)
+      result.emplace_back(t0, t0 + lookahead);
+   return result;
+}
+
 bool NewDefaultPlaybackPolicy::Looping( const PlaybackSchedule & ) const
 {
    return mLoopEnabled;
@@ -151,6 +151,21 @@ public:
       size_t available //!< how many more samples may be buffered
    );
 
+   //! Intervals of track time, each ordered in the direction of play
+   using Intervals = std::vector<std::pair<double, double>>;
+
+   //! AudioIO::FillPlayBuffers calls this to find sample blocks to read ahead of the mixers
+   /*!
+    Default implementation predicts play from trackTime toward schedule.mT1.
+    The result is only a hint for prefetching, so warping of time may be
+    ignored.
+    @param trackTime where the mixers are now
+    @param lookahead how many seconds of play to predict
+    @return intervals in the order they will be played
+    */
+   virtual Intervals PredictedTrackTimes( const PlaybackSchedule &schedule,
+      double trackTime, double lookahead ) const;
+
    //! @section To be removed
 
    virtual bool Looping( const PlaybackSchedule &schedule ) const;
@@ -359,6 +374,9 @@ public:
       PlaybackSchedule &schedule, const Mixers &playbackMixers,
       size_t frames, size_t available ) override;
 
+   Intervals PredictedTrackTimes( const PlaybackSchedule &schedule,
+      double trackTime, double lookahead ) const override;
+
    bool Looping( const PlaybackSchedule & ) const override;
 
 private:
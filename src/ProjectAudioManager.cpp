@@ -15,6 +15,7 @@ Paul Licameli split from ProjectManager.cpp
 #include <wx/frame.h>
 #include <wx/statusbr.h>
 #include <algorithm>
+#include <cmath>
 
 #include "AudioIO.h"
 #include "BasicUI.h"
@@ -126,6 +127,9 @@ public:
       PlaybackSchedule &schedule, const Mixers &playbackMixers,
       size_t frames, size_t available) override;
 
+   Intervals PredictedTrackTimes( const PlaybackSchedule &schedule,
+      double trackTime, double lookahead ) const override;
+
 private:
    double GapStart() const
    { return mReversed ? mGapLeft + mGapLength : mGapLeft; }
@@ -286,6 +290,28 @@ bool CutPreviewPlaybackPolicy::RepositionPlayback( PlaybackSchedule &,
    }
    return true;
 }
+
+auto CutPreviewPlaybackPolicy::PredictedTrackTimes( const PlaybackSchedule &,
+   double trackTime, double lookahead ) const -> Intervals
+{
+   Intervals result;
+   // Play to the gap, then from its far side to the end
+   auto predict = [&](double from, double to){
+      if (lookahead <= 0 || AtOrBefore(to, from))
+         return;
+      const auto step = mReversed ? -lookahead : lookahead;
+      const auto end = AtOrBefore(to, from + step) ? to : from + step;
+      result.emplace_back(from, end);
+      lookahead -= std::abs(end - from);
+   };
+   if (AtOrBefore(trackTime, GapStart())) {
+      predict(trackTime, GapStart());
+      predict(GapEnd(), mEnd);
+   }
+   else
+      predict(trackTime, mEnd);
+   return result;
+}
 }
 
 int ProjectAudioManager::PlayPlayRegion(const SelectedRegion &selectedRegion,
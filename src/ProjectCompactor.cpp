@@ -0,0 +1,257 @@
+/*!********************************************************************
+
+Audacity: A Digital Audio Editor
+
+@file ProjectCompactor.cpp
+@brief Implement ProjectCompactor
+
+**********************************************************************/
+
+#include "ProjectCompactor.h"
+
+#include <algorithm>
+#include <sqlite3.h>
+
+#include <wx/log.h>
+
+#include "MemoryX.h"
+
+// The destination keeps a rollback journal, so that what was committed
+// survives a crash or power loss to be resumed later
+static const char *DestinationConfig =
+   "PRAGMA main.busy_timeout = 5000;"
+   "PRAGMA main.synchronous = NORMAL;"
+   "PRAGMA main.journal_mode = DELETE;";
+
+// Delete blocks that the source no longer has, or that differ from the block
+// of the same id in the source, as if the destination were left from some
+// other project of the same name
+static const char *DeleteStaleBlocks =
+   "DELETE FROM main.sampleblocks"
+   "  WHERE NOT EXISTS"
+   "  ("
+   "    SELECT 1 FROM source.sampleblocks AS s"
+   "    WHERE s.blockid = main.sampleblocks.blockid"
+   "      AND s.sampleformat IS main.sampleblocks.sampleformat"
+   "      AND s.summin IS main.sampleblocks.summin"
+   "      AND s.summax IS main.sampleblocks.summax"
+   "      AND s.sumrms IS main.sampleblocks.sumrms"
+   "      AND length(s.samples) IS length(main.sampleblocks.samples)"
+   "  );";
+
+// length() of a blob does not read its overflow pages, so this is cheap
+// even for projects of many gigabytes
+static const char *ListBlocks =
+   "SELECT s.blockid,"
+   "       length(s.samples) + length(s.summary256) + length(s.summary64k),"
+   "       d.blockid IS NOT NULL"
+   "  FROM source.sampleblocks AS s"
+   "  LEFT JOIN main.sampleblocks AS d ON d.blockid = s.blockid"
+   "  ORDER BY s.blockid;";
+
+static const char *CopyBlock =
+   "INSERT INTO main.sampleblocks"
+   "  SELECT * FROM source.sampleblocks"
+   "  WHERE blockid = ?1;";
+
+ProjectCompactor::ProjectCompactor(const FilePath &source,
+   const FilePath &dest, std::vector<SampleBlockID> blockids)
+: mSource{ source }
+, mDest{ dest }
+, mBlockIDs{ std::move(blockids) }
+, mStart{ std::chrono::steady_clock::now() }
+{
+   std::sort(mBlockIDs.begin(), mBlockIDs.end());
+   mThread = std::thread([this]{ Run(); });
+}
+
+ProjectCompactor::~ProjectCompactor()
+{
+   Cancel();
+   if (mThread.joinable())
+      mThread.join();
+}
+
+void ProjectCompactor::Cancel()
+{
+   mCancel = true;
+}
+
+bool ProjectCompactor::IsDone() const
+{
+   return mDone;
+}
+
+bool ProjectCompactor::Wait()
+{
+   if (mThread.joinable())
+      mThread.join();
+   return mRC == SQLITE_OK;
+}
+
+auto ProjectCompactor::GetProgress() const -> Progress
+{
+   Progress result;
+   result.blocksDone = mBlocksDone.load(std::memory_order_relaxed);
+   result.blocksTotal = mBlocksTotal.load(std::memory_order_relaxed);
+   result.bytesDone = mBytesDone.load(std::memory_order_relaxed);
+   result.bytesTotal = mBytesTotal.load(std::memory_order_relaxed);
+   result.bytesCopied = mBytesCopied.load(std::memory_order_relaxed);
+
+   using namespace std::chrono;
+   const auto ns = mDone
+      ? mElapsedNs.load()
+      : duration_cast<nanoseconds>(steady_clock::now() - mStart).count();
+   result.seconds = ns / 1e9;
+   return result;
+}
+
+void ProjectCompactor::Run()
+{
+   sqlite3 *db = nullptr;
+   auto done = finally([&]
+   {
+      if (db)
+      {
+         // Detach, if attached, and close; neither matters to what was
+         // committed
+         sqlite3_exec(db, "DETACH DATABASE source;", nullptr, nullptr, nullptr);
+         sqlite3_close(db);
+      }
+
+      using namespace std::chrono;
+      mElapsedNs = duration_cast<nanoseconds>(steady_clock::now() - mStart)
+         .count();
+      mDone = true;
+   });
+
+   int rc = sqlite3_open(mDest.ToUTF8(), &db);
+   if (rc == SQLITE_OK)
+      rc = sqlite3_exec(db, DestinationConfig, nullptr, nullptr, nullptr);
+   if (rc == SQLITE_OK)
+   {
+      // Bug 2793: Quotes in name need escaping for sqlite3.
+      wxString dbName = mSource;
+      dbName.Replace("'", "''");
+      wxString sql;
+      sql.Printf("ATTACH DATABASE '%s' AS source;", dbName.ToUTF8());
+      rc = sqlite3_exec(db, sql.ToUTF8(), nullptr, nullptr, nullptr);
+   }
+   if (rc == SQLITE_OK)
+      rc = Copy(db);
+
+   mRC = rc;
+   if (rc != SQLITE_OK && rc != SQLITE_INTERRUPT)
+   {
+      mMessage = db ? wxString::FromUTF8(sqlite3_errmsg(db)) : wxString{};
+      wxLogMessage("Failed to copy sample blocks from %s to %s\n"
+                   "\tErrCode: %d\n"
+                   "\tErrMsg: %s",
+                   mSource,
+                   mDest,
+                   rc,
+                   mMessage);
+   }
+}
+
+int ProjectCompactor::Copy(sqlite3 *db)
+{
+   int rc = sqlite3_exec(db, DeleteStaleBlocks, nullptr, nullptr, nullptr);
+   if (rc != SQLITE_OK)
+      return rc;
+
+   // Find the wanted blocks that are still to be copied, and their sizes
+   BlockSizes todo;
+   {
+      sqlite3_stmt *stmt = nullptr;
+      auto cleanup = finally([&]{ sqlite3_finalize(stmt); });
+
+      rc = sqlite3_prepare_v2(db, ListBlocks, -1, &stmt, nullptr);
+      if (rc != SQLITE_OK)
+         return rc;
+
+      unsigned long long blocksTotal = 0, blocksDone = 0;
+      unsigned long long bytesTotal = 0, bytesDone = 0;
+      while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+      {
+         const SampleBlockID blockid = sqlite3_column_int64(stmt, 0);
+         if (!std::binary_search(mBlockIDs.begin(), mBlockIDs.end(), blockid))
+            continue;
+
+         const long long bytes = sqlite3_column_int64(stmt, 1);
+         ++blocksTotal;
+         bytesTotal += bytes;
+         if (sqlite3_column_int(stmt, 2))
+         {
+            ++blocksDone;
+            bytesDone += bytes;
+         }
+         else
+            todo.emplace_back(blockid, bytes);
+      }
+      if (rc != SQLITE_DONE)
+         return rc;
+
+      mBlocksTotal = blocksTotal;
+      mBlocksDone = blocksDone;
+      mBytesTotal = bytesTotal;
+      mBytesDone = bytesDone;
+   }
+
+   sqlite3_stmt *stmt = nullptr;
+   auto cleanup = finally([&]{ sqlite3_finalize(stmt); });
+
+   rc = sqlite3_prepare_v2(db, CopyBlock, -1, &stmt, nullptr);
+   if (rc != SQLITE_OK)
+      return rc;
+
+   // Commit often enough that an interruption loses little, and that the
+   // source is never read in a long transaction, which would keep its
+   // checkpoints from finishing
+   constexpr size_t BatchSize = 32;
+
+   for (auto first = todo.cbegin(), end = todo.cend(); first != end;)
+   {
+      if (mCancel)
+         return SQLITE_INTERRUPT;
+
+      auto last = first + std::min<size_t>(BatchSize, end - first);
+      rc = CopyBatch(db, stmt, first, last);
+      if (rc != SQLITE_OK)
+         return rc;
+      first = last;
+   }
+
+   return SQLITE_OK;
+}
+
+int ProjectCompactor::CopyBatch(sqlite3 *db, sqlite3_stmt *stmt,
+   BlockSizes::const_iterator first, BlockSizes::const_iterator last)
+{
+   // A failure leaves the transaction open; closing the connection rolls it
+   // back, after the error message is taken
+   int rc = sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+   if (rc != SQLITE_OK)
+      return rc;
+
+   unsigned long long bytes = 0;
+   for (auto iter = first; iter != last; ++iter)
+   {
+      sqlite3_bind_int64(stmt, 1, iter->first);
+      rc = sqlite3_step(stmt);
+      if (rc != SQLITE_DONE)
+         return rc;
+      sqlite3_reset(stmt);
+      bytes += iter->second;
+   }
+
+   rc = sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+   if (rc != SQLITE_OK)
+      return rc;
+
+   mBlocksDone += last - first;
+   mBytesDone += bytes;
+   mBytesCopied += bytes;
+
+   return SQLITE_OK;
+}
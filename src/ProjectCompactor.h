@@ -0,0 +1,120 @@
+/*!********************************************************************
+
+Audacity: A Digital Audio Editor
+
+@file ProjectCompactor.h
+@brief Declare ProjectCompactor, which copies the live sample blocks of a
+project file into a new file in a background thread
+
+**********************************************************************/
+
+#ifndef __AUDACITY_PROJECT_COMPACTOR__
+#define __AUDACITY_PROJECT_COMPACTOR__
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Identifier.h"
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+using SampleBlockID = long long;
+
+/**
+ \class ProjectCompactor
+ \brief Copies sample blocks from a project file to the file that will
+ replace it when compacting, without holding up the main thread
+
+ The worker opens its own connections and reads the source only in short
+ transactions, so the project may still be edited and played meanwhile.
+ Blocks are committed to the destination in batches, and blocks that the
+ destination already holds from an interrupted run are not copied again.
+ Block ids are never reused and blocks never change once inserted, so a
+ block found in the destination is good if its format, summaries and size
+ still match the source; others are deleted.
+
+ The project document and blocks inserted after the set of ids was taken
+ are left for the caller to copy when it completes the new file.
+ */
+class ProjectCompactor final
+{
+public:
+   struct Progress
+   {
+      unsigned long long blocksDone{ 0 };
+      unsigned long long blocksTotal{ 0 };
+      //! Including blocks that an interrupted run already copied
+      unsigned long long bytesDone{ 0 };
+      unsigned long long bytesTotal{ 0 };
+      //! Copied by this run only
+      unsigned long long bytesCopied{ 0 };
+      double seconds{ 0 };
+
+      double MegabytesPerSecond() const
+      { return seconds > 0 ? bytesCopied / (1024.0 * 1024.0) / seconds : 0; }
+   };
+
+   //! Starts the worker thread
+   /*! @param dest must already exist, with the project schema installed */
+   ProjectCompactor(const FilePath &source, const FilePath &dest,
+      std::vector<SampleBlockID> blockids);
+   //! Cancels and waits for the worker
+   ~ProjectCompactor();
+
+   ProjectCompactor(const ProjectCompactor&) = delete;
+   ProjectCompactor &operator =(const ProjectCompactor&) = delete;
+
+   const FilePath &GetSource() const { return mSource; }
+   const FilePath &GetDestination() const { return mDest; }
+
+   //! The worker stops after the block it is copying; what it committed stays
+   void Cancel();
+
+   bool IsDone() const;
+
+   //! Waits for the worker; true if it copied all the blocks
+   bool Wait();
+
+   Progress GetProgress() const;
+
+   //! Valid after Wait()
+   int GetLastRC() const { return mRC; }
+   //! Valid after Wait()
+   const wxString &GetLastMessage() const { return mMessage; }
+
+private:
+   //! Ids of blocks to copy, and their sizes in bytes
+   using BlockSizes = std::vector<std::pair<SampleBlockID, long long>>;
+
+   void Run();
+   int Copy(sqlite3 *db);
+   int CopyBatch(sqlite3 *db, sqlite3_stmt *stmt,
+      BlockSizes::const_iterator first, BlockSizes::const_iterator last);
+
+   const FilePath mSource;
+   const FilePath mDest;
+   //! Ascending, so that copies land in the order that blocks were made
+   std::vector<SampleBlockID> mBlockIDs;
+
+   std::thread mThread;
+   std::atomic_bool mCancel{ false };
+   std::atomic_bool mDone{ false };
+
+   const std::chrono::steady_clock::time_point mStart;
+   std::atomic<long long> mElapsedNs{ 0 };
+   std::atomic<unsigned long long> mBlocksDone{ 0 };
+   std::atomic<unsigned long long> mBlocksTotal{ 0 };
+   std::atomic<unsigned long long> mBytesDone{ 0 };
+   std::atomic<unsigned long long> mBytesTotal{ 0 };
+   std::atomic<unsigned long long> mBytesCopied{ 0 };
+
+   // Written by the worker only, and read after it is joined
+   int mRC{ 0 };
+   wxString mMessage;
+};
+
+#endif
@@ -25,6 +25,7 @@ Paul Licameli split from AudacityProject.cpp
 #include "CodeConversions.h"
 #include "DBConnection.h"
 #include "Project.h"
+#include "ProjectCompactor.h"
 #include "ProjectHistory.h"
 #include "ProjectSerializer.h"
 #include "ProjectWindows.h"
@@ -629,6 +630,10 @@ bool ProjectFileIO::OpenConnection(FilePath fileName /* = {}  */)
 
 bool ProjectFileIO::CloseConnection()
 {
+   // Stop any background copy of blocks; it resumes from what it committed
+   // when next started
+   mpCompactor.reset();
+
    auto &curConn = CurrConn();
    if (!curConn)
       return false;
@@ -651,6 +656,9 @@ void ProjectFileIO::SaveConnection()
    // Should do nothing in proper usage, but be sure not to leak a connection:
    DiscardConnection();
 
+   // The background copy is of the file that is put aside
+   mpCompactor.reset();
+
    mPrevConn = std::move(CurrConn());
    mPrevFileName = mFileName;
    mPrevTemporary = mTemporary;
@@ -984,21 +992,9 @@ bool ProjectFileIO::DeleteBlocks(const BlockIDs &blockids, bool complement)
    return true;
 }
 
-bool ProjectFileIO::CopyTo(const FilePath &destpath,
-   const TranslatableString &msg,
-   bool isTemporary,
-   bool prune /* = false */,
-   const std::vector<const TrackList *> &tracks /* = {} */)
+bool ProjectFileIO::GetBlockIDs(bool prune,
+   const std::vector<const TrackList *> &tracks, BlockIDs &blockids)
 {
-   auto pConn = CurrConn().get();
-   if (!pConn)
-      return false;
-
-   // Get access to the active tracklist
-   auto pProject = &mProject;
-
-   SampleBlockIDSet blockids;
-
    // Collect all active blockids
    if (prune)
    {
@@ -1023,6 +1019,34 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
       }
    }
 
+   return true;
+}
+
+bool ProjectFileIO::CopyTo(const FilePath &destpath,
+   const TranslatableString &msg,
+   bool isTemporary,
+   bool prune /* = false */,
+   const std::vector<const TrackList *> &tracks /* = {} */,
+   bool incremental /* = false */)
+{
+   auto pConn = CurrConn().get();
+   if (!pConn)
+      return false;
+
+   // Blocks still queued for the writer thread must be copied too
+   if (!FlushDeferredWrites(*pConn))
+      return false;
+
+   // Get access to the active tracklist
+   auto pProject = &mProject;
+
+   SampleBlockIDSet blockids;
+   if (!GetBlockIDs(prune, tracks, blockids))
+   {
+      // Error message already captured.
+      return false;
+   }
+
    // Create the project doc
    ProjectSerializer doc;
    WriteXMLHeader(doc);
@@ -1033,6 +1057,7 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
    bool success = false;
    int rc = SQLITE_OK;
    ProgressResult res = ProgressResult::Success;
+   bool cancelled = false;
 
    // Cleanup in case things go awry
    auto cleanup = finally([&]
@@ -1069,7 +1094,10 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
          sqlite3_exec(db, "DETACH DATABASE outbound;", nullptr, nullptr, nullptr);
 
          // RemoveProject not necessary to clean up attached database
-         wxRemoveFile(destpath);
+         // Keep what an incremental copy has so far, if the user stopped it,
+         // so that it resumes from there
+         if (!(incremental && cancelled))
+            wxRemoveFile(destpath);
       }
    });
 
@@ -1093,7 +1121,21 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
    //
    // NOTE:  Between the above attach and setting the mode here, a normal DELETE
    //        mode journal will be used and will briefly appear in the filesystem.
-   if ( pConn->FastMode("outbound") != SQLITE_OK)
+   //
+   // An incremental copy keeps the journal, so that what it has committed
+   // is good to resume from even if it is interrupted.
+   if (incremental)
+   {
+      if (pConn->DurableMode("outbound") != SQLITE_OK)
+      {
+         SetDBError(
+            XO("Unable to switch to journaling mode")
+         );
+
+         return false;
+      }
+   }
+   else if ( pConn->FastMode("outbound") != SQLITE_OK)
    {
       SetDBError(
          XO("Unable to switch to fast journaling mode")
@@ -1158,6 +1200,53 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
       // to delete the database anyway.
       sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
 
+      // Blocks never change once written, and their ids are not reused, so
+      // copy only what the destination lacks, and drop what is not wanted
+      if (incremental)
+      {
+         BlockIDs present;
+         auto cb = [&present](int cols, char **vals, char **){
+            SampleBlockID blockid;
+            wxString{ vals[0] }.ToLongLong(&blockid);
+            present.insert(blockid);
+            return 0;
+         };
+
+         if (!Query("SELECT blockid FROM outbound.sampleblocks;", cb))
+         {
+            // Error message already captured.
+            return false;
+         }
+
+         auto removeFunction = finally([&]
+         {
+            // Remove our function, whether it was successfully defined or not.
+            sqlite3_create_function(db, "inset", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, nullptr, nullptr, nullptr);
+         });
+
+         const void *p = &blockids;
+         rc = sqlite3_create_function(db, "inset", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, const_cast<void*>(p), InSet, nullptr, nullptr);
+         if (rc == SQLITE_OK)
+            rc = sqlite3_exec(db,
+               "DELETE FROM outbound.sampleblocks WHERE NOT inset(blockid);",
+               nullptr, nullptr, nullptr);
+         if (rc != SQLITE_OK)
+         {
+            ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+            ADD_EXCEPTION_CONTEXT(
+               "sqlite3.context", "ProjectGileIO::CopyTo.prune");
+
+            SetDBError(
+               XO("Failed to update the project file.")
+            );
+            return false;
+         }
+
+         for (auto blockid : present)
+            blockids.erase(blockid);
+         total = blockids.size();
+      }
+
       // Copy sample blocks from the main DB to the outbound DB
       for (auto blockid : blockids)
       {
@@ -1205,6 +1294,7 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
          {
             // Note that we're not setting success, so the finally
             // block above will take care of cleaning up
+            cancelled = true;
             return false;
          }
       }
@@ -1243,6 +1333,18 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
    return true;
 }
 
+bool ProjectFileIO::FlushDeferredWrites(DBConnection &conn)
+{
+   // Non-throwing, it returns true for success; the error is already set
+   try {
+      conn.FlushDeferredWrites();
+      return true;
+   }
+   catch ( const AudacityException & ) {
+      return false;
+   }
+}
+
 bool ProjectFileIO::ShouldCompact(const std::vector<const TrackList *> &tracks)
 {
    SampleBlockIDSet active;
@@ -1291,6 +1393,16 @@ bool ProjectFileIO::ShouldCompact(const std::vector<const TrackList *> &tracks)
    return true;
 }
 
+double ProjectFileIO::GetFreePageRatio()
+{
+   int64_t freePages = 0, pages = 0;
+   if (!GetValue("PRAGMA freelist_count;", freePages, true) ||
+       !GetValue("PRAGMA page_count;", pages, true) ||
+       pages <= 0)
+      return 0;
+   return static_cast<double>(freePages) / pages;
+}
+
 Connection &ProjectFileIO::CurrConn()
 {
    auto &connectionPtr = ConnectionPtr::Get( mProject );
@@ -1483,6 +1595,10 @@ void ProjectFileIO::Compact(
    // at project close time will still occur.
    mHadUnused = true;
 
+   wxString origName = mFileName;
+   wxString backName = origName + "_compact_back";
+   wxString tempName = origName + "_compact_temp";
+
    // If forcing compaction, bypass inspection.
    if (!force)
    {
@@ -1503,20 +1619,40 @@ void ProjectFileIO::Compact(
             (void) AutoSaveDelete();
          }
 
+         // Nor is what a background copy made so far worth keeping
+         mpCompactor.reset();
+         if (wxFileExists(tempName) && !wxRemoveFile(tempName))
+            wxLogWarning(wxT("Failed to delete temporary file...ignoring"));
+
          return;
       }
    }
 
-   wxString origName = mFileName;
-   wxString backName = origName + "_compact_back";
-   wxString tempName = origName + "_compact_temp";
+   // Let the background thread copy most of the blocks, resuming what an
+   // earlier run left; the rest are copied below, with the document.
+   bool incremental = false;
+   switch (WaitForCompactor(tracks, tempName))
+   {
+   case ProgressResult::Success:
+      incremental = true;
+      break;
+   case ProgressResult::Failed:
+      // Start over with a full copy
+      if (wxFileExists(tempName))
+         wxRemoveFile(tempName);
+      break;
+   default:
+      // The user stopped; keep what was copied for next time
+      return;
+   }
 
    // Copy the original database to a new database. Only prune sample blocks if
    // we have a tracklist.
    // REVIEW: Compact can fail on the CopyTo with no error messages.  That's OK?
    // LLL: We could display an error message or just ignore the failure and allow
    // the file to be compacted the next time it's saved.
-   if (CopyTo(tempName, XO("Compacting project"), IsTemporary(), !tracks.empty(), tracks))
+   if (CopyTo(tempName, XO("Compacting project"), IsTemporary(),
+      !tracks.empty(), tracks, incremental))
    {
       // Must close the database to rename it
       if (CloseConnection())
@@ -1606,6 +1742,105 @@ void ProjectFileIO::Compact(
    return;
 }
 
+void ProjectFileIO::CompactInBackground(
+   const std::vector<const TrackList *> &tracks)
+{
+   // As ShouldCompact, wait until a fifth of the file is unused.  The free
+   // list is counted in the file header, so it costs little to check after
+   // every save.
+   constexpr double MinFreePageRatio = 0.2;
+
+   if (mpCompactor || !HasConnection() || IsTemporary() ||
+       GetFreePageRatio() < MinFreePageRatio ||
+       !ShouldCompact(tracks))
+      return;
+
+   (void) StartCompactor(tracks, mFileName + "_compact_temp");
+}
+
+bool ProjectFileIO::StartCompactor(
+   const std::vector<const TrackList *> &tracks, const FilePath &tempName)
+{
+   auto pConn = CurrConn().get();
+   if (!pConn)
+      return false;
+
+   // The background thread reads the file through a connection of its own,
+   // which sees only committed blocks
+   if (!FlushDeferredWrites(*pConn))
+      return false;
+
+   BlockIDs blockids;
+   if (!GetBlockIDs(!tracks.empty(), tracks, blockids))
+      return false;
+
+   // Create the destination with the schema, or keep the blocks that an
+   // interrupted copy left in it.  If that file can't be used, start over.
+   auto prepare = [&]{
+      sqlite3 *db = nullptr;
+      auto cleanup = finally([&]{ sqlite3_close(db); });
+      return sqlite3_open(tempName.ToUTF8(), &db) == SQLITE_OK &&
+         InstallSchema(db, "main");
+   };
+   if (!prepare())
+   {
+      if (!wxFileExists(tempName) || !wxRemoveFile(tempName) || !prepare())
+      {
+         wxLogWarning(wxT("Compaction failed to create %s"), tempName);
+         return false;
+      }
+   }
+
+   mpCompactor = std::make_unique<ProjectCompactor>(mFileName, tempName,
+      std::vector<SampleBlockID>{ blockids.begin(), blockids.end() });
+   return true;
+}
+
+ProgressResult ProjectFileIO::WaitForCompactor(
+   const std::vector<const TrackList *> &tracks, const FilePath &tempName)
+{
+   if (mpCompactor && (mpCompactor->GetSource() != mFileName ||
+                       mpCompactor->GetDestination() != tempName))
+      mpCompactor.reset();
+
+   if (!mpCompactor && !StartCompactor(tracks, tempName))
+      return ProgressResult::Failed;
+
+   /* i18n-hint: This title appears on a dialog that indicates the progress
+      in doing something.*/
+   ProgressDialog progress(XO("Progress"), XO("Compacting project"));
+
+   while (!mpCompactor->IsDone())
+   {
+      using namespace std::chrono;
+      std::this_thread::sleep_for(50ms);
+
+      const auto status = mpCompactor->GetProgress();
+      const auto result = progress.Update(
+         static_cast<wxLongLong_t>(status.bytesDone),
+         std::max<wxLongLong_t>(1, status.bytesTotal),
+         /* i18n-hint: Progress of copying sample blocks when compacting a
+            project, and the speed in megabytes per second */
+         XO("%llu of %llu blocks, %.1f MB/s")
+            .Format(status.blocksDone, status.blocksTotal,
+               status.MegabytesPerSecond()));
+      if (result != ProgressResult::Success)
+      {
+         // Blocks already committed stay in the file, for the next try
+         mpCompactor.reset();
+         return result;
+      }
+   }
+
+   const bool success = mpCompactor->Wait();
+   if (!success)
+      wxLogWarning(wxT("Compaction failed to copy blocks to %s: %s"),
+         tempName, mpCompactor->GetLastMessage());
+   mpCompactor.reset();
+
+   return success ? ProgressResult::Success : ProgressResult::Failed;
+}
+
 bool ProjectFileIO::WasCompacted()
 {
    return mWasCompacted;
@@ -1896,6 +2131,10 @@ bool ProjectFileIO::WriteDoc(const char *table,
 {
    auto db = DB();
 
+   // Don't save a document that refers to blocks not yet in the database
+   if (!FlushDeferredWrites(*CurrConn()))
+      return false;
+
    TransactionScope transaction(mProject, "UpdateProject");
 
    int rc;
@@ -2623,6 +2862,10 @@ int64_t ProjectFileIO::GetDiskUsage(DBConnection &conn, SampleBlockID blockid /*
 {
    sqlite3_stmt* stmt = nullptr;
 
+   // Measure blocks still queued for the writer thread too
+   if (!FlushDeferredWrites(conn))
+      return 0;
+
    if (blockid == 0)
    {
       static const char* statement =
@@ -27,13 +27,17 @@ struct sqlite3_value;
 
 class AudacityProject;
 class DBConnection;
+class ProjectCompactor;
 struct DBConnectionErrors;
 class ProjectSerializer;
 class SqliteSampleBlock;
 class TrackList;
 class WaveTrack;
 
-namespace BasicUI{ class WindowPlacement; }
+namespace BasicUI{
+   class WindowPlacement;
+   enum class ProgressResult : unsigned;
+}
 
 using WaveTrackArray = std::vector < std::shared_ptr < WaveTrack > >;
 
@@ -180,6 +184,23 @@ public:
    void Compact(
       const std::vector<const TrackList *> &tracks, bool force = false);
 
+   //! If compacting would be worth it, start copying the blocks of the
+   //! tracks to the compacted file in a background thread, for Compact() to
+   //! finish later
+   /*! Does nothing unless free pages, as left by deleted blocks, are a large
+    part of the file; only then is it worth asking ShouldCompact, which visits
+    every block.
+
+    The copy keeps a rollback journal, with the settings that DurableMode
+    gives the destination when Compact() finishes it with CopyTo.  So what
+    the thread commits survives an interruption, and a hot journal that one
+    leaves is rolled back by whichever of the two opens the file next.
+    Compact() stops the thread before CopyTo attaches the file, so the two
+    never write it at once.  The thread reads the project through its own
+    connection, which sees only committed blocks, so blocks saved after it
+    started are left for CopyTo. */
+   void CompactInBackground(const std::vector<const TrackList *> &tracks);
+
    // The last compact check did actually compact the project file if true
    bool WasCompacted();
 
@@ -250,9 +271,18 @@ private:
    // Write project or autosave XML (binary) documents
    bool WriteDoc(const char *table, const ProjectSerializer &autosave, const char *schema = "main");
 
+   // Wait for the writer thread of the connection to commit deferred block
+   // inserts; false if that failed
+   static bool FlushDeferredWrites(DBConnection &conn);
+
    // Application defined function to verify blockid exists is in set of blockids
    static void InSet(sqlite3_context *context, int argc, sqlite3_value **argv);
 
+   // Collect the ids of blocks used by the tracks if prune, else all ids in
+   // the project file
+   bool GetBlockIDs(bool prune,
+      const std::vector<const TrackList *> &tracks, BlockIDs &blockids);
+
    // Return a database connection if successful, which caller must close
    bool CopyTo(const FilePath &destpath,
       const TranslatableString &msg,
@@ -261,9 +291,23 @@ private:
       const std::vector<const TrackList *> &tracks = {} /*!<
          First track list (or if none, then the project's track list) are tracks to write into document blob;
          That list, plus any others, contain tracks whose sample blocks must be kept
+      */,
+      bool incremental = false /*!<
+         Keep blocks already in the destination, and delete those not wanted;
+         keep the destination if the user cancels
       */
    );
 
+   // Start the background copy of blocks into tempName
+   bool StartCompactor(
+      const std::vector<const TrackList *> &tracks, const FilePath &tempName);
+
+   // Start the background copy if it is not running, and wait for it with a
+   // progress dialog.  Success means tempName is ready for an incremental
+   // CopyTo(); Failed, that it is not
+   BasicUI::ProgressResult WaitForCompactor(
+      const std::vector<const TrackList *> &tracks, const FilePath &tempName);
+
    //! Just set stored errors
    void SetError(const TranslatableString & msg,
        const TranslatableString& libraryError = {},
@@ -275,6 +319,8 @@ private:
        int errorCode = -1);
 
    bool ShouldCompact(const std::vector<const TrackList *> &tracks);
+   //! Fraction of the pages of the project file that are on the free list
+   double GetFreePageRatio();
 
    // Gets values from SQLite B-tree structures
    static unsigned int get2(const unsigned char *ptr);
@@ -310,6 +356,9 @@ private:
    Connection mPrevConn;
    FilePath mPrevFileName;
    bool mPrevTemporary;
+
+   // Copies blocks for Compact() in the background
+   std::unique_ptr<ProjectCompactor> mpCompactor;
 };
 
 class wxTopLevelWindow;
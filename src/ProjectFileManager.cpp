@@ -345,6 +345,8 @@ bool ProjectFileManager::DoSave(const FilePath & fileName, const bool fromSaveAs
       }
    }
 
+   // Saving a temporary project moves its file rather than copying it
+   const bool wasTemporary = projectFileIO.IsTemporary();
    bool success = projectFileIO.SaveProject(fileName, mLastSavedTracks.get());
    if (!success)
    {
@@ -384,6 +386,13 @@ bool ProjectFileManager::DoSave(const FilePath & fileName, const bool fromSaveAs
    if (pBackupProject)
       pBackupProject->Discard();
 
+   // If much of the file is now unused, start copying what is used into the
+   // compacted file, so that compacting at close has little left to do.
+   // Not after a Save As of a named project, which copied the blocks into a
+   // new file, with no unused space.
+   if (!fromSaveAs || wasTemporary)
+      projectFileIO.CompactInBackground({ mLastSavedTracks.get() });
+
    return true;
 }
 
@@ -0,0 +1,244 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RealtimeArena.cpp
+
+*******************************************************************//*!
+
+\class RealtimeArena
+\brief Bump allocator of scratch memory for the PortAudio callback, sized
+  when the stream opens, so that the callback never calls the heap.
+
+*//*******************************************************************/
+
+#include "RealtimeArena.h"
+
+#include <algorithm>
+#include <atomic>
+
+RealtimeArena::RealtimeArena() = default;
+RealtimeArena::~RealtimeArena() = default;
+
+void RealtimeArena::Reserve(size_t bytes)
+{
+   const auto lines = (bytes + Alignment - 1) / Alignment;
+   if (lines * Alignment != mCapacity) {
+      mStorage.reset();
+      mStorage = std::make_unique<Line[]>(lines);
+      mCapacity = lines * Alignment;
+   }
+   mUsed = 0;
+   mHighWater = 0;
+   mOverflows = 0;
+}
+
+void RealtimeArena::Release()
+{
+   mStorage.reset();
+   mCapacity = mUsed = mHighWater = 0;
+   mOverflows = 0;
+}
+
+void *RealtimeArena::AllocateBytes(size_t bytes)
+{
+   const auto rounded = (bytes + Alignment - 1) / Alignment * Alignment;
+   if (rounded > mCapacity - mUsed) {
+      ++mOverflows;
+      return nullptr;
+   }
+   const auto result = reinterpret_cast<std::byte*>(mStorage.get()) + mUsed;
+   mUsed += rounded;
+   mHighWater = std::max(mHighWater, mUsed);
+   return result;
+}
+
+#ifdef AUDACITY_RT_ALLOC_TRAP
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <execinfo.h>
+#include <unistd.h>
+#define HAVE_BACKTRACE
+#endif
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+thread_local bool tArmed = false;
+std::atomic<unsigned long> sCount{ 0 };
+
+#ifdef HAVE_BACKTRACE
+// The first call of backtrace() may load a library, which allocates; do that
+// at startup and not in a trap
+const int sPreloadBacktrace = []{
+   void *frame;
+   return backtrace(&frame, 1);
+}();
+#endif
+
+void Trap(const char *what, size_t bytes)
+{
+   if (!tArmed)
+      return;
+   // No reports about the reporting
+   tArmed = false;
+   ++sCount;
+   fprintf(stderr, "Real-time allocation trap: %s of %lu bytes\n",
+      what, static_cast<unsigned long>(bytes));
+#ifdef HAVE_BACKTRACE
+   void *frames[64];
+   const auto nFrames = backtrace(frames, 64);
+   backtrace_symbols_fd(frames, nFrames, STDERR_FILENO);
+#endif
+   tArmed = true;
+}
+
+void *Allocate(size_t bytes)
+{
+   Trap("operator new", bytes);
+   return malloc(std::max<size_t>(bytes, 1));
+}
+
+void *AllocateAligned(size_t bytes, std::align_val_t alignment)
+{
+   Trap("aligned operator new", bytes);
+   const auto align = std::max(static_cast<size_t>(alignment), sizeof(void*));
+   bytes = std::max<size_t>(bytes, 1);
+#ifdef _WIN32
+   return _aligned_malloc(bytes, align);
+#else
+   void *result = nullptr;
+   return posix_memalign(&result, align, bytes) == 0 ? result : nullptr;
+#endif
+}
+
+void Deallocate(void *p)
+{
+   if (p)
+      Trap("operator delete", 0);
+   free(p);
+}
+
+void DeallocateAligned(void *p)
+{
+   if (p)
+      Trap("aligned operator delete", 0);
+#ifdef _WIN32
+   _aligned_free(p);
+#else
+   free(p);
+#endif
+}
+
+void *AllocateOrThrow(size_t bytes)
+{
+   if (auto result = Allocate(bytes))
+      return result;
+   throw std::bad_alloc{};
+}
+
+void *AllocateAlignedOrThrow(size_t bytes, std::align_val_t alignment)
+{
+   if (auto result = AllocateAligned(bytes, alignment))
+      return result;
+   throw std::bad_alloc{};
+}
+}
+
+// Replacements of the global allocation functions, which see every use of
+// new and delete, including those within the standard library
+void *operator new(size_t bytes)
+{ return AllocateOrThrow(bytes); }
+void *operator new[](size_t bytes)
+{ return AllocateOrThrow(bytes); }
+void *operator new(size_t bytes, const std::nothrow_t &) noexcept
+{ return Allocate(bytes); }
+void *operator new[](size_t bytes, const std::nothrow_t &) noexcept
+{ return Allocate(bytes); }
+void *operator new(size_t bytes, std::align_val_t alignment)
+{ return AllocateAlignedOrThrow(bytes, alignment); }
+void *operator new[](size_t bytes, std::align_val_t alignment)
+{ return AllocateAlignedOrThrow(bytes, alignment); }
+void *operator new(size_t bytes, std::align_val_t alignment,
+   const std::nothrow_t &) noexcept
+{ return AllocateAligned(bytes, alignment); }
+void *operator new[](size_t bytes, std::align_val_t alignment,
+   const std::nothrow_t &) noexcept
+{ return AllocateAligned(bytes, alignment); }
+
+void operator delete(void *p) noexcept
+{ Deallocate(p); }
+void operator delete[](void *p) noexcept
+{ Deallocate(p); }
+void operator delete(void *p, size_t) noexcept
+{ Deallocate(p); }
+void operator delete[](void *p, size_t) noexcept
+{ Deallocate(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{ Deallocate(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{ Deallocate(p); }
+void operator delete(void *p, std::align_val_t) noexcept
+{ DeallocateAligned(p); }
+void operator delete[](void *p, std::align_val_t) noexcept
+{ DeallocateAligned(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept
+{ DeallocateAligned(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept
+{ DeallocateAligned(p); }
+void operator delete(void *p, std::align_val_t,
+   const std::nothrow_t &) noexcept
+{ DeallocateAligned(p); }
+void operator delete[](void *p, std::align_val_t,
+   const std::nothrow_t &) noexcept
+{ DeallocateAligned(p); }
+
+bool RealtimeAllocationTrap::Enabled()
+{
+   return true;
+}
+
+unsigned long RealtimeAllocationTrap::Count()
+{
+   return sCount.load(std::memory_order_relaxed);
+}
+
+RealtimeAllocationTrap::Scope::Scope()
+   : mWasArmed{ tArmed }
+{
+   tArmed = true;
+}
+
+RealtimeAllocationTrap::Scope::~Scope()
+{
+   tArmed = mWasArmed;
+}
+
+#else
+
+bool RealtimeAllocationTrap::Enabled()
+{
+   return false;
+}
+
+unsigned long RealtimeAllocationTrap::Count()
+{
+   return 0;
+}
+
+RealtimeAllocationTrap::Scope::Scope()
+   : mWasArmed{ false }
+{
+}
+
+RealtimeAllocationTrap::Scope::~Scope()
+{
+}
+
+#endif
@@ -0,0 +1,94 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RealtimeArena.h
+
+*******************************************************************/
+
+#ifndef __AUDACITY_REALTIME_ARENA__
+#define __AUDACITY_REALTIME_ARENA__
+
+#include <cstddef>
+#include <memory>
+
+//! Preallocated scratch memory for one pass of a real-time thread
+/*!
+ Reserve() allocates, outside of the real-time thread; Allocate() only bumps
+ an offset and never touches the heap, and returns null when the reservation
+ is exhausted, so that the caller can fall back on the stack.  A Scope frees
+ everything allocated during its lifetime.  Only one thread may allocate.
+ */
+class RealtimeArena final {
+public:
+   //! Alignment of every allocation, so that no two share a cache line
+   static constexpr size_t Alignment = 64;
+
+   RealtimeArena();
+   ~RealtimeArena();
+   RealtimeArena(const RealtimeArena&) = delete;
+   RealtimeArena &operator =(const RealtimeArena&) = delete;
+
+   //! Not real-time safe; discards all allocations
+   void Reserve(size_t bytes);
+   //! Not real-time safe; frees the storage
+   void Release();
+
+   //! Real-time safe; null if the reservation is exhausted
+   void *AllocateBytes(size_t bytes);
+
+   template<typename T> T *Allocate(size_t count)
+   { return static_cast<T*>(AllocateBytes(count * sizeof(T))); }
+
+   //! Rewinds the arena on destruction
+   class Scope {
+   public:
+      explicit Scope(RealtimeArena &arena)
+         : mArena{ arena }, mMark{ arena.mUsed } {}
+      ~Scope() { mArena.mUsed = mMark; }
+      Scope(const Scope&) = delete;
+      Scope &operator =(const Scope&) = delete;
+   private:
+      RealtimeArena &mArena;
+      const size_t mMark;
+   };
+
+   size_t Capacity() const { return mCapacity; }
+   //! Most bytes in use at once since the last Reserve()
+   size_t HighWater() const { return mHighWater; }
+   //! Allocations refused since the last Reserve()
+   unsigned long Overflows() const { return mOverflows; }
+
+private:
+   struct alignas(Alignment) Line { std::byte bytes[Alignment]; };
+   std::unique_ptr<Line[]> mStorage;
+   size_t mCapacity{ 0 };
+   size_t mUsed{ 0 };
+   size_t mHighWater{ 0 };
+   unsigned long mOverflows{ 0 };
+};
+
+//! In builds configured with rt_alloc_trap, reports heap allocation and
+//! deallocation through operator new and delete, with the call stack, on
+//! any thread while a Scope is alive there
+namespace RealtimeAllocationTrap {
+
+//! Whether this build traps at all
+bool Enabled();
+
+//! Count of reports since the program started
+unsigned long Count();
+
+class Scope {
+public:
+   Scope();
+   ~Scope();
+   Scope(const Scope&) = delete;
+   Scope &operator =(const Scope&) = delete;
+private:
+   const bool mWasArmed;
+};
+
+}
+
+#endif
@@ -28,6 +28,9 @@
 #include "RingBuffer.h"
 #include "Dither.h"
 
+#include <algorithm>
+#include <cstdint>
+
 RingBuffer::RingBuffer(sampleFormat format, size_t size)
    : mBufferSize{ std::max<size_t>(size, 64) }
    , mFormat{ format }
@@ -221,3 +224,165 @@ size_t RingBuffer::Discard(size_t samplesToDiscard)
 
    return samplesToDiscard;
 }
+
+/*!
+\class MultiChannelRingBuffer
+\brief Holds streamed audio samples of several channels, all with the same
+  count of samples, with one pair of atomic positions for all.
+
+  The writer reserves a span of frames, fills it for each channel in place or
+  with Write, and commits; the reader peeks at a span of frames, reads it in
+  place or with Read, and consumes.  Synchronization is the same as for
+  RingBuffer.
+*/
+
+namespace {
+// Floats in a cache line
+constexpr size_t LineFloats = 64 / sizeof(float);
+
+size_t RoundUpToLine(size_t count)
+{
+   return (count + LineFloats - 1) / LineFloats * LineFloats;
+}
+}
+
+MultiChannelRingBuffer::MultiChannelRingBuffer(size_t nChannels, size_t size)
+   : mnChannels{ std::max<size_t>(nChannels, 1) }
+   , mBufferSize{ std::max<size_t>(size, 64) }
+   , mStride{ RoundUpToLine(mBufferSize) }
+   , mStorage{ std::make_unique<float[]>(mnChannels * mStride + LineFloats) }
+   , mBuffer{ mStorage.get() + (LineFloats -
+      reinterpret_cast<uintptr_t>(mStorage.get()) / sizeof(float)
+         % LineFloats) % LineFloats }
+{
+}
+
+MultiChannelRingBuffer::~MultiChannelRingBuffer()
+{
+}
+
+size_t MultiChannelRingBuffer::Filled( size_t start, size_t end ) const
+{
+   return (end + mBufferSize - start) % mBufferSize;
+}
+
+size_t MultiChannelRingBuffer::Free( size_t start, size_t end ) const
+{
+   return std::max<size_t>(mBufferSize - Filled( start, end ), 4) - 4;
+}
+
+auto MultiChannelRingBuffer::MakeSpan( size_t start, size_t frames ) const
+   -> Span
+{
+   const auto len0 = std::min( frames, mBufferSize - start );
+   return { start, { len0, frames - len0 } };
+}
+
+//
+// For the writer only:
+// As for RingBuffer, but the reservation of a span does not yet change
+// mWritten; Commit does
+//
+
+size_t MultiChannelRingBuffer::AvailForPut()
+{
+   auto start = mStart.load( std::memory_order_relaxed );
+   return Free( start, mWritten );
+}
+
+auto MultiChannelRingBuffer::Reserve(size_t frames) -> Span
+{
+   // Acquire, so that any reading done before Consume() happens-before the
+   // reuse of the space
+   auto start = mStart.load( std::memory_order_acquire );
+   return MakeSpan( mWritten, std::min( frames, Free( start, mWritten ) ) );
+}
+
+void MultiChannelRingBuffer::Write(
+   const Span &span, size_t iChannel, const float *src, size_t len)
+{
+   auto dest = GetChannel(iChannel);
+   auto pos = span.start;
+   for (auto block : span.lengths) {
+      const auto copied = std::min( len, block );
+      if (copied)
+         std::copy(src, src + copied, dest + pos);
+      std::fill(dest + pos + copied, dest + pos + block, 0.0f);
+      src += copied;
+      len -= copied;
+      pos = 0;
+   }
+}
+
+void MultiChannelRingBuffer::Commit(size_t frames)
+{
+   mWritten = (mWritten + frames) % mBufferSize;
+}
+
+std::pair<float*, size_t>
+MultiChannelRingBuffer::GetUnflushed(size_t iChannel, unsigned iBlock)
+{
+   auto end = mEnd.load(std::memory_order_relaxed);
+   const auto span = MakeSpan( end, Filled( end, mWritten ) );
+   const auto size = span.lengths[iBlock ? 1 : 0];
+   if (!size)
+      return { nullptr, 0 };
+   return { GetChannel(iChannel) + (iBlock ? 0 : span.start), size };
+}
+
+void MultiChannelRingBuffer::Flush()
+{
+   // Atomically update the end pointer with release, so the nonatomic writes
+   // just done to the buffer don't get reordered after
+   mEnd.store(mWritten, std::memory_order_release);
+}
+
+//
+// For the reader only:
+//
+
+size_t MultiChannelRingBuffer::AvailForGet()
+{
+   auto end = mEnd.load( std::memory_order_relaxed ); // get away with it here
+   auto start = mStart.load( std::memory_order_relaxed );
+   return Filled( start, end );
+}
+
+auto MultiChannelRingBuffer::Peek(size_t frames) -> Span
+{
+   // Must match the writer's release with acquire for well defined reads of
+   // the buffer
+   auto end = mEnd.load( std::memory_order_acquire );
+   auto start = mStart.load( std::memory_order_relaxed );
+   return MakeSpan( start, std::min( frames, Filled( start, end ) ) );
+}
+
+void MultiChannelRingBuffer::Read(
+   const Span &span, size_t iChannel, float *dest)
+{
+   const auto src = GetChannel(iChannel);
+   dest = std::copy(
+      src + span.start, src + span.start + span.lengths[0], dest);
+   std::copy(src, src + span.lengths[1], dest);
+}
+
+void MultiChannelRingBuffer::Consume(size_t frames)
+{
+   auto start = mStart.load( std::memory_order_relaxed );
+   // Communicate to writer that we have consumed some data,
+   // with nonrelaxed ordering
+   mStart.store( (start + frames) % mBufferSize, std::memory_order_release );
+}
+
+size_t MultiChannelRingBuffer::Discard(size_t framesToDiscard)
+{
+   auto end = mEnd.load( std::memory_order_relaxed ); // get away with it here
+   auto start = mStart.load( std::memory_order_relaxed );
+   framesToDiscard = std::min( framesToDiscard, Filled( start, end ) );
+
+   // Communicate to writer that we have skipped some data, and that's all
+   mStart.store((start + framesToDiscard) % mBufferSize,
+                std::memory_order_relaxed);
+
+   return framesToDiscard;
+}
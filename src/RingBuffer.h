@@ -13,6 +13,7 @@
 
 #include "SampleFormat.h"
 #include <atomic>
+#include <memory>
 
 class RingBuffer final : public NonInterferingBase {
  public:
@@ -58,4 +59,83 @@ class RingBuffer final : public NonInterferingBase {
    const SampleBuffer  mBuffer;
 };
 
+//! Holds streamed float samples of several channels in step, for one writer
+//! and one reader
+/*!
+ Unlike an array of RingBuffer, all channels share one pair of indices, so
+ that each side touches two atomics per exchange whatever the number of
+ channels, and both sides may work directly in the storage, with no copying
+ through temporary buffers.  Storage is planar, each channel aligned to its
+ own cache lines.
+ */
+class MultiChannelRingBuffer final : public NonInterferingBase {
+ public:
+   //! Consecutive frames in the ring, in at most two contiguous pieces:  the
+   //! second, if not empty, starts at the beginning of the storage
+   struct Span {
+      size_t start{ 0 };
+      size_t lengths[2]{ 0, 0 };
+      size_t size() const { return lengths[0] + lengths[1]; }
+   };
+
+   MultiChannelRingBuffer(size_t nChannels, size_t size);
+   ~MultiChannelRingBuffer();
+
+   size_t Channels() const { return mnChannels; }
+
+   //! Start of the storage of one channel; a Span indexes into it
+   float *GetChannel(size_t iChannel)
+   { return mBuffer + iChannel * mStride; }
+
+   //
+   // For the writer only:
+   //
+
+   size_t AvailForPut();
+   //! Place for the next frames after those written, fewer if not all are
+   //! free; fill it for every channel, then Commit
+   Span Reserve(size_t frames);
+   //! Copy len samples, then zeroes, into one channel of span
+   void Write(const Span &span, size_t iChannel, const float *src, size_t len);
+   //! Count frames, from the start of the last reservation, as written
+   void Commit(size_t frames);
+   //! Get access to written but unflushed data of one channel, which is in
+   //! at most two blocks
+   std::pair<float*, size_t> GetUnflushed(size_t iChannel, unsigned iBlock);
+   //! Flush after a sequence of Commit calls to let consumer see
+   void Flush();
+
+   //
+   // For the reader only:
+   //
+
+   size_t AvailForGet();
+   //! Place of at most the next frames that are ready; read them in place,
+   //! for any channels, then Consume
+   Span Peek(size_t frames);
+   //! Copy one channel of span to contiguous memory
+   void Read(const Span &span, size_t iChannel, float *dest);
+   //! Release frames, from the start of the last Peek, to the writer
+   void Consume(size_t frames);
+   size_t Discard(size_t frames);
+
+ private:
+   size_t Filled( size_t start, size_t end ) const;
+   size_t Free( size_t start, size_t end ) const;
+   Span MakeSpan( size_t start, size_t frames ) const;
+
+   size_t mWritten{0};
+
+   // Align the two atomics to avoid false sharing
+   NonInterfering< std::atomic<size_t> > mStart{ 0 }, mEnd{ 0 };
+
+   const size_t mnChannels;
+   const size_t mBufferSize;
+   //! Floats from the start of one channel to the next
+   const size_t mStride;
+   const std::unique_ptr<float[]> mStorage;
+   //! Start of the first channel, within mStorage at a cache line boundary
+   float *const mBuffer;
+};
+
 #endif /*  __AUDACITY_RING_BUFFER__ */
@@ -55,6 +55,10 @@ SampleBlockPtr SampleBlockFactory::CreateFromXML(
 
 SampleBlock::~SampleBlock() = default;
 
+void SampleBlock::Prefetch()
+{
+}
+
 size_t SampleBlock::GetSamples(samplePtr dest,
                    sampleFormat destformat,
                    size_t sampleoffset,
@@ -69,6 +69,10 @@ public:
    //! Non-throwing, should fill with zeroes on failure
    virtual bool
       GetSummary64k(float *dest, size_t frameoffset, size_t numframes) = 0;
+   //! Non-throwing, should fill with zeroes on failure
+   /*! @param divisor samples per frame, any level of SummaryPyramid */
+   virtual bool GetSummary(size_t divisor,
+      float *dest, size_t frameoffset, size_t numframes) = 0;
 
    /// Gets extreme values for the specified region
    // If !mayThrow and there is an error, ignores it and returns zeroes.
@@ -81,6 +85,10 @@ public:
    // That may be appropriate when only attempting to display samples, not edit.
    MinMaxRMS GetMinMaxRMS(bool mayThrow = true) const;
 
+   //! Hint that the samples will be wanted soon, so that they may be
+   //! readied in the background; the default does nothing
+   virtual void Prefetch();
+
    virtual size_t GetSpaceUsage() const = 0;
 
    virtual void SaveXML(XMLWriter &xmlFile) = 0;
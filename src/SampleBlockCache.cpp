@@ -0,0 +1,191 @@
+/**********************************************************************
+
+Audacity: A Digital Audio Editor
+
+SampleBlockCache.cpp
+
+**********************************************************************/
+
+#include "SampleBlockCache.h"
+
+#include "Prefs.h"
+
+#include <algorithm>
+
+IntSetting SampleBlockCacheMB{ L"/Performance/SampleBlockCacheMB", 64 };
+
+std::atomic<uint64_t> SampleBlockCache::sHits{ 0 };
+std::atomic<uint64_t> SampleBlockCache::sMisses{ 0 };
+std::atomic<uint64_t> SampleBlockCache::sBytesRequested{ 0 };
+std::atomic<uint64_t> SampleBlockCache::sBytesRead{ 0 };
+std::atomic<uint64_t> SampleBlockCache::sPrefetched{ 0 };
+std::atomic<uint64_t> SampleBlockCache::sPrefetchHits{ 0 };
+std::atomic<uint64_t> SampleBlockCache::sPrefetchEvictions{ 0 };
+
+SampleBlockCache::SampleBlockCache()
+   : SampleBlockCache{
+      static_cast<size_t>(std::max(0, SampleBlockCacheMB.Read())) << 20 }
+{
+}
+
+SampleBlockCache::SampleBlockCache(size_t budgetBytes)
+   : mBudget{ budgetBytes }
+{
+}
+
+auto SampleBlockCache::Find(SampleBlockID id, Kind kind) -> Blob
+{
+   if (mBudget == 0)
+      return {};
+
+   std::lock_guard<std::mutex> lock{ mMutex };
+   auto iter = mIndex.find({ id, kind });
+   if (iter == mIndex.end()) {
+      sMisses.fetch_add(1, std::memory_order_relaxed);
+      return {};
+   }
+   sHits.fetch_add(1, std::memory_order_relaxed);
+   if (auto &prefetched = iter->second->prefetched) {
+      prefetched = false;
+      sPrefetchHits.fetch_add(1, std::memory_order_relaxed);
+   }
+   mEntries.splice(mEntries.begin(), mEntries, iter->second);
+   return iter->second->blob;
+}
+
+bool SampleBlockCache::Contains(SampleBlockID id, Kind kind) const
+{
+   if (mBudget == 0)
+      return false;
+
+   std::lock_guard<std::mutex> lock{ mMutex };
+   return mIndex.count({ id, kind }) > 0;
+}
+
+void SampleBlockCache::Insert(
+   SampleBlockID id, Kind kind, const void *data, size_t bytes,
+   bool prefetched)
+{
+   if (bytes > mBudget)
+      return;
+
+   // Copy outside of the lock
+   auto pBytes = static_cast<const char *>(data);
+   auto blob = std::make_shared<const std::vector<char>>(pBytes, pBytes + bytes);
+   DoInsert(id, kind, std::move(blob), prefetched);
+}
+
+void SampleBlockCache::Insert(SampleBlockID id, Kind kind, Blob blob)
+{
+   if (!blob || blob->size() > mBudget)
+      return;
+   DoInsert(id, kind, std::move(blob), false);
+}
+
+void SampleBlockCache::DoInsert(
+   SampleBlockID id, Kind kind, Blob blob, bool prefetched)
+{
+   const auto bytes = blob->size();
+   std::lock_guard<std::mutex> lock{ mMutex };
+   const Key key{ id, kind };
+   // Another thread may have missed and inserted the same blob meanwhile
+   if (auto iter = mIndex.find(key); iter != mIndex.end())
+      Erase(iter->second);
+   Evict(bytes);
+   mEntries.push_front({ key, std::move(blob), prefetched });
+   mIndex.emplace(key, mEntries.begin());
+   mUsage += bytes;
+   if (prefetched)
+      sPrefetched.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SampleBlockCache::Invalidate(SampleBlockID id)
+{
+   if (mBudget == 0)
+      return;
+
+   std::lock_guard<std::mutex> lock{ mMutex };
+   for (auto kind : { Kind::Samples, Kind::Summary256, Kind::Summary64k,
+      Kind::Summary16, Kind::Summary64, Kind::Summary1k, Kind::Summary4k,
+      Kind::Summary16k })
+      if (auto iter = mIndex.find({ id, kind }); iter != mIndex.end())
+         Erase(iter->second);
+}
+
+void SampleBlockCache::Clear()
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   mIndex.clear();
+   mEntries.clear();
+   mUsage = 0;
+}
+
+size_t SampleBlockCache::GetUsage() const
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   return mUsage;
+}
+
+auto SampleBlockCache::GetTotals() -> Totals
+{
+   return {
+      sHits.load(std::memory_order_relaxed),
+      sMisses.load(std::memory_order_relaxed),
+      sBytesRequested.load(std::memory_order_relaxed),
+      sBytesRead.load(std::memory_order_relaxed),
+      sPrefetched.load(std::memory_order_relaxed),
+      sPrefetchHits.load(std::memory_order_relaxed),
+      sPrefetchEvictions.load(std::memory_order_relaxed)
+   };
+}
+
+auto SampleBlockCache::Totals::operator -(const Totals &earlier) const
+   -> Totals
+{
+   return {
+      hits - earlier.hits,
+      misses - earlier.misses,
+      bytesRequested - earlier.bytesRequested,
+      bytesRead - earlier.bytesRead,
+      prefetched - earlier.prefetched,
+      prefetchHits - earlier.prefetchHits,
+      prefetchEvictions - earlier.prefetchEvictions
+   };
+}
+
+void SampleBlockCache::ResetTotals()
+{
+   sHits.store(0, std::memory_order_relaxed);
+   sMisses.store(0, std::memory_order_relaxed);
+   sBytesRequested.store(0, std::memory_order_relaxed);
+   sBytesRead.store(0, std::memory_order_relaxed);
+   sPrefetched.store(0, std::memory_order_relaxed);
+   sPrefetchHits.store(0, std::memory_order_relaxed);
+   sPrefetchEvictions.store(0, std::memory_order_relaxed);
+}
+
+void SampleBlockCache::RecordRead(size_t bytesRequested, size_t bytesRead)
+{
+   sBytesRequested.fetch_add(bytesRequested, std::memory_order_relaxed);
+   if (bytesRead)
+      sBytesRead.fetch_add(bytesRead, std::memory_order_relaxed);
+}
+
+void SampleBlockCache::Evict(size_t bytes)
+{
+   // Precondition: mMutex is locked, and bytes <= mBudget
+   while (!mEntries.empty() && mUsage + bytes > mBudget) {
+      const auto last = std::prev(mEntries.end());
+      if (last->prefetched)
+         sPrefetchEvictions.fetch_add(1, std::memory_order_relaxed);
+      Erase(last);
+   }
+}
+
+void SampleBlockCache::Erase(List::iterator iter)
+{
+   // Precondition: mMutex is locked
+   mUsage -= iter->blob->size();
+   mIndex.erase(iter->key);
+   mEntries.erase(iter);
+}
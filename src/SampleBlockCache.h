@@ -0,0 +1,152 @@
+/**********************************************************************
+
+Audacity: A Digital Audio Editor
+
+SampleBlockCache.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_SAMPLE_BLOCK_CACHE__
+#define __AUDACITY_SAMPLE_BLOCK_CACHE__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+class IntSetting;
+
+using SampleBlockID = long long;
+
+//! Megabytes of sample block data that each project keeps decoded in memory
+extern AUDACITY_DLL_API IntSetting SampleBlockCacheMB;
+
+/**
+ \class SampleBlockCache
+ \brief Least-recently-used cache of whole sample and summary blobs
+
+ Reading part of a block from the project database still steps a statement
+ that loads the entire blob, and playback, drawing and effects read the same
+ blocks over and over.  The cache keeps the blobs, exactly as they are
+ stored, up to a budget of bytes, and evicts the least recently used when
+ that is exceeded.
+
+ Blocks never change once committed, and block ids are not reused within a
+ session, so an entry stays good as long as it is cached.  ~SqliteSampleBlock
+ drops the entries of its block only to free their memory sooner.  The cache
+ may be used from the audio thread and the main thread at once.
+ */
+class AUDACITY_DLL_API SampleBlockCache final
+{
+public:
+   //! Which of the columns of a block row a blob holds, or which level of
+   //! SummaryPyramid that is not stored but made from a finer level
+   enum class Kind : unsigned {
+      Samples,
+      Summary256,
+      Summary64k,
+      Summary16,
+      Summary64,
+      Summary1k,
+      Summary4k,
+      Summary16k,
+   };
+
+   using Blob = std::shared_ptr<const std::vector<char>>;
+
+   //! Process-wide counts of lookups, and of bytes that blocks were asked
+   //! for against bytes they read from the database to answer
+   struct Totals {
+      uint64_t hits{ 0 };
+      uint64_t misses{ 0 };
+      uint64_t bytesRequested{ 0 };
+      uint64_t bytesRead{ 0 };
+      //! Blobs inserted ahead of need, and how many of those were then
+      //! found, or evicted before they were found
+      uint64_t prefetched{ 0 };
+      uint64_t prefetchHits{ 0 };
+      uint64_t prefetchEvictions{ 0 };
+
+      //! Bytes read per byte requested
+      double ReadAmplification() const
+      { return bytesRequested ? double(bytesRead) / bytesRequested : 0.0; }
+
+      //! Fraction of prefetched blobs that were used
+      double PrefetchHitRate() const
+      { return prefetched ? double(prefetchHits) / prefetched : 0.0; }
+
+      //! Difference of counts since an earlier snapshot
+      Totals operator -(const Totals &earlier) const;
+   };
+
+   //! Budget is read from SampleBlockCacheMB
+   SampleBlockCache();
+   explicit SampleBlockCache(size_t budgetBytes);
+   SampleBlockCache(const SampleBlockCache&) = delete;
+   SampleBlockCache &operator =(const SampleBlockCache&) = delete;
+
+   //! Counts a hit or a miss, and makes the entry the most recently used
+   /*! @return null on a miss */
+   Blob Find(SampleBlockID id, Kind kind);
+
+   //! Whether the blob is present, without counting a hit or a miss, or
+   //! changing the order of use
+   bool Contains(SampleBlockID id, Kind kind) const;
+
+   //! Copies the bytes, unless they alone exceed the budget
+   /*! @param prefetched whether no reader is waiting for the blob yet; the
+    first Find() of it then counts as a prefetch hit */
+   void Insert(SampleBlockID id, Kind kind, const void *data, size_t bytes,
+      bool prefetched = false);
+
+   //! Shares the blob, unless it alone exceeds the budget
+   void Insert(SampleBlockID id, Kind kind, Blob blob);
+
+   //! Drops all blobs of the block
+   void Invalidate(SampleBlockID id);
+
+   void Clear();
+
+   size_t GetBudget() const { return mBudget; }
+   size_t GetUsage() const;
+
+   static Totals GetTotals();
+   static void ResetTotals();
+   static void RecordRead(size_t bytesRequested, size_t bytesRead);
+
+private:
+   using Key = std::pair<SampleBlockID, Kind>;
+   struct Entry {
+      Key key;
+      Blob blob;
+      bool prefetched;
+   };
+   //! Most recently used first
+   using List = std::list<Entry>;
+
+   void DoInsert(SampleBlockID id, Kind kind, Blob blob, bool prefetched);
+   void Evict(size_t bytes);
+   void Erase(List::iterator iter);
+
+   const size_t mBudget;
+
+   mutable std::mutex mMutex;
+   List mEntries;
+   std::map<Key, List::iterator> mIndex;
+   size_t mUsage{ 0 };
+
+   static std::atomic<uint64_t> sHits;
+   static std::atomic<uint64_t> sMisses;
+   static std::atomic<uint64_t> sBytesRequested;
+   static std::atomic<uint64_t> sBytesRead;
+   static std::atomic<uint64_t> sPrefetched;
+   static std::atomic<uint64_t> sPrefetchHits;
+   static std::atomic<uint64_t> sPrefetchEvictions;
+};
+
+#endif
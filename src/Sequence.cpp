@@ -992,6 +992,27 @@ int Sequence::FindBlock(sampleCount pos) const
 {
    wxASSERT(pos >= 0 && pos < mNumSamples);
 
+   // Streaming readers stay in a block for many calls, then go to the next
+   const auto hint = mBlockHint.load(std::memory_order_relaxed);
+   for (auto b : { hint, hint + 1 }) {
+      if (b >= mBlock.size())
+         break;
+      const SeqBlock &block = mBlock[b];
+      if (pos >= block.start &&
+          pos < block.start + block.sb->GetSampleCount()) {
+         if (b != hint)
+            mBlockHint.store(b, std::memory_order_relaxed);
+         return b;
+      }
+   }
+
+   const auto result = SearchBlock(pos);
+   mBlockHint.store(result, std::memory_order_relaxed);
+   return result;
+}
+
+int Sequence::SearchBlock(sampleCount pos) const
+{
    if (pos == 0)
       return 0;
 
@@ -1037,6 +1058,21 @@ int Sequence::FindBlock(sampleCount pos) const
    return rval;
 }
 
+void Sequence::Prefetch(sampleCount start, sampleCount len) const
+{
+   // Clip the range to the sequence
+   const auto end = std::min(start + len, mNumSamples);
+   start = std::max<sampleCount>(start, 0);
+   if (start >= end)
+      return;
+
+   // Don't disturb the hint of the reader, which is behind
+   const auto numBlocks = mBlock.size();
+   for (size_t b = SearchBlock(start);
+        b < numBlocks && mBlock[b].start < end; ++b)
+      mBlock[b].sb->Prefetch();
+}
+
 //static
 bool Sequence::Read(samplePtr buffer, sampleFormat format,
                     const SeqBlock &b, size_t blockRelativeStart, size_t len,
@@ -12,6 +12,7 @@
 #define __AUDACITY_SEQUENCE__
 
 
+#include <atomic>
 #include <vector>
 #include <functional>
 
@@ -93,6 +94,10 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    bool Get(samplePtr buffer, sampleFormat format,
             sampleCount start, size_t len, bool mayThrow) const;
 
+   //! Hint that the samples will be read soon, so that the blocks holding
+   //! them may be readied in the background
+   void Prefetch(sampleCount start, sampleCount len) const;
+
    // Note that len is not size_t, because nullptr may be passed for buffer, in
    // which case, silence is inserted, possibly a large amount.
    void SetSamples(constSamplePtr buffer, sampleFormat format,
@@ -201,6 +206,10 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
 
    bool          mErrorOpening{ false };
 
+   //! Where the last FindBlock() ended, which streaming readers, reading
+   //! forward, find again or pass to the next; only a hint, and so relaxed
+   mutable std::atomic<size_t> mBlockHint{ 0 };
+
    //
    // Private methods
    //
@@ -224,6 +233,9 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
                         constSamplePtr buffer,
                         size_t len);
 
+   //! Search by interpolation, ignoring mBlockHint
+   int SearchBlock(sampleCount pos) const;
+
    bool Get(int b,
             samplePtr buffer,
             sampleFormat format,
@@ -237,6 +249,8 @@ public:
    // Public methods
    //
 
+   //! Constant time when pos is in the block found last or the next,
+   //! as when reading forward
    int FindBlock(sampleCount pos) const;
 
    static bool Read(samplePtr buffer, sampleFormat format,
@@ -18,6 +18,8 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 #include "XMLTagHandler.h"
 
 #include "SampleBlock.h" // to inherit
+#include "SampleBlockCache.h"
+#include "SummaryPyramid.h"
 #include "UndoManager.h"
 #include "WaveTrack.h"
 
@@ -26,6 +28,94 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 
 class SqliteSampleBlockFactory;
 
+//! Contents of a block whose row the writer thread has not yet inserted
+struct PendingBlock
+{
+   SampleBlockID id;
+   sampleFormat format;
+   double sumMin;
+   double sumMax;
+   double sumRms;
+
+   ArrayOf<char> samples;
+   size_t sampleBytes;
+   ArrayOf<char> summary256;
+   size_t summary256Bytes;
+   ArrayOf<char> summary64k;
+   size_t summary64kBytes;
+
+   //! Guarded by the mutex of PendingBlocks
+   mutable bool started{ false };
+
+   std::pair<const char *, size_t> Blob(SampleBlockCache::Kind kind) const
+   {
+      switch (kind) {
+      case SampleBlockCache::Kind::Summary256:
+         return { summary256.get(), summary256Bytes };
+      case SampleBlockCache::Kind::Summary64k:
+         return { summary64k.get(), summary64kBytes };
+      default:
+         return { samples.get(), sampleBytes };
+      }
+   }
+};
+
+//! Blocks of one factory that are queued for insertion
+/*! Shared with the deferred writes, which may outlive the factory */
+class PendingBlocks final
+{
+public:
+   enum CancelResult { NotPending, Cancelled, Started };
+
+   void Add(const std::shared_ptr<const PendingBlock> &pBlock)
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mBlocks[pBlock->id] = pBlock;
+   }
+
+   std::shared_ptr<const PendingBlock> Find(SampleBlockID id) const
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      auto iter = mBlocks.find(id);
+      return iter == mBlocks.end() ? nullptr : iter->second;
+   }
+
+   //! Called by the writer; false if the block was deleted meanwhile
+   bool Start(const PendingBlock &block)
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      if (!mBlocks.count(block.id))
+         return false;
+      block.started = true;
+      return true;
+   }
+
+   //! Called when the block's row is committed
+   void Remove(SampleBlockID id)
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mBlocks.erase(id);
+   }
+
+   //! Called when the block is deleted; its row is not inserted if it is
+   //! not yet started
+   CancelResult Cancel(SampleBlockID id)
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      auto iter = mBlocks.find(id);
+      if (iter == mBlocks.end())
+         return NotPending;
+      if (iter->second->started)
+         return Started;
+      mBlocks.erase(iter);
+      return Cancelled;
+   }
+
+private:
+   mutable std::mutex mMutex;
+   std::map<SampleBlockID, std::shared_ptr<const PendingBlock>> mBlocks;
+};
+
 ///\brief Implementation of @ref SampleBlock using Sqlite database
 class SqliteSampleBlock final : public SampleBlock
 {
@@ -57,6 +147,8 @@ public:
 
    bool GetSummary256(float *dest, size_t frameoffset, size_t numframes) override;
    bool GetSummary64k(float *dest, size_t frameoffset, size_t numframes) override;
+   bool GetSummary(size_t divisor,
+      float *dest, size_t frameoffset, size_t numframes) override;
    double GetSumMin() const;
    double GetSumMax() const;
    double GetSumRms() const;
@@ -67,6 +159,8 @@ public:
    /// Gets extreme values for the entire block
    MinMaxRMS DoGetMinMaxRMS() const override;
 
+   void Prefetch() override;
+
    size_t GetSpaceUsage() const override;
    void SaveXML(XMLWriter &xmlFile) override;
 
@@ -77,21 +171,51 @@ private:
                    size_t frameoffset,
                    size_t numframes,
                    DBConnection::StatementID id,
-                   const char *sql);
+                   const char *sql,
+                   SampleBlockCache::Kind kind);
+   //! Whole level of the summary pyramid that is not stored, made from the
+   //! nearest finer level and cached
+   /*! @return null on failure to read the finer level */
+   SampleBlockCache::Blob GetDerivedSummary(size_t divisor);
    size_t GetBlob(void *dest,
                   sampleFormat destformat,
                   sqlite3_stmt *stmt,
                   sampleFormat srcformat,
                   size_t srcoffset,
-                  size_t srcbytes);
+                  size_t srcbytes,
+                  SampleBlockCache::Kind kind);
+   //! Reads just the window through an incremental blob handle
+   size_t GetBlobRange(void *dest,
+                       sampleFormat destformat,
+                       SampleBlockCache::Kind kind,
+                       sampleFormat srcformat,
+                       size_t srcoffset,
+                       size_t srcbytes);
+   //! Size of the stored blob, known without reading it
+   size_t BlobBytes(SampleBlockCache::Kind kind) const;
+   static size_t CopyBlob(void *dest,
+                          sampleFormat destformat,
+                          const char *src,
+                          size_t blobbytes,
+                          sampleFormat srcformat,
+                          size_t srcoffset,
+                          size_t srcbytes);
 
    enum {
       fields = 3, /* min, max, rms */
       bytesPerFrame = fields * sizeof(float),
    };
+
+   //! Read only the requested window when the blob is more than this many
+   //! times larger
+   static constexpr size_t PartialReadRatio = 4;
    Sizes SetSizes( size_t numsamples, sampleFormat srcformat );
    void CalcSummary(Sizes sizes);
 
+   //! Insert the row for the block, in the writer thread or while flushing
+   /*! Returns an sqlite3 result code */
+   static int Insert(sqlite3 *db, const PendingBlock &block);
+
 private:
    //! This must never be called for silent blocks
    /*! @post return value is not null */
@@ -173,6 +297,15 @@ private:
    using AllBlocksMap =
       std::map< SampleBlockID, std::weak_ptr< SqliteSampleBlock > >;
    AllBlocksMap mAllBlocks;
+
+   //! Blobs recently read by the blocks of this factory
+   /*! Shared with the deferred reads, which may outlive the factory */
+   const std::shared_ptr<SampleBlockCache> mpCache{
+      std::make_shared<SampleBlockCache>() };
+
+   //! Blocks created by this factory whose rows are not yet inserted
+   const std::shared_ptr<PendingBlocks> mpPending{
+      std::make_shared<PendingBlocks>() };
 };
 
 SqliteSampleBlockFactory::SqliteSampleBlockFactory( AudacityProject &project )
@@ -306,6 +439,13 @@ SqliteSampleBlock::~SqliteSampleBlock()
 {
    DeletionCallback::Call(*this);
 
+   // The global DeletionCallback slot is taken over by the progress indicator
+   // during purges, so the cache of the factory is told directly.  Ids are
+   // not reused within the session, so this only frees the memory that the
+   // entries of the deleted block would hold until evicted.
+   if (mpFactory)
+      mpFactory->mpCache->Invalidate(mBlockID);
+
    if (IsSilent()) {
       // The block object was constructed but failed to Load() or Commit().
       // Or it's a silent block with no row in the database.
@@ -388,7 +528,44 @@ size_t SqliteSampleBlock::DoGetSamples(samplePtr dest,
                   stmt,
                   mSampleFormat,
                   sampleoffset * SAMPLE_SIZE(mSampleFormat),
-                  numsamples * SAMPLE_SIZE(mSampleFormat)) / SAMPLE_SIZE(mSampleFormat);
+                  numsamples * SAMPLE_SIZE(mSampleFormat),
+                  SampleBlockCache::Kind::Samples) / SAMPLE_SIZE(mSampleFormat);
+}
+
+void SqliteSampleBlock::Prefetch()
+{
+   // Only blocks with rows in the database, not already in memory
+   if (IsSilent() || !mValid || !mpFactory)
+      return;
+   const auto &pCache = mpFactory->mpCache;
+   if (pCache->GetBudget() < mSampleBytes ||
+       pCache->Contains(mBlockID, SampleBlockCache::Kind::Samples) ||
+       mpFactory->mpPending->Find(mBlockID))
+      return;
+
+   auto &pConnection = mpFactory->mppConnection->mpConnection;
+   if (!pConnection)
+      return;
+
+   pConnection->DeferRead([pCache, id = mBlockID](sqlite3 *db){
+      // Another reader may have loaded the blob meanwhile
+      constexpr auto kind = SampleBlockCache::Kind::Samples;
+      if (pCache->Contains(id, kind))
+         return;
+
+      sqlite3_stmt *stmt = nullptr;
+      if (sqlite3_prepare_v2(db,
+            "SELECT samples FROM sampleblocks WHERE blockid = ?1;",
+            -1, &stmt, nullptr) != SQLITE_OK)
+         return;
+      // A block deleted meanwhile has no row, and its id is not reused
+      // within the session, so a late insertion is harmless
+      if (sqlite3_bind_int64(stmt, 1, id) == SQLITE_OK &&
+          sqlite3_step(stmt) == SQLITE_ROW)
+         pCache->Insert(id, kind, sqlite3_column_blob(stmt, 0),
+            static_cast<size_t>(sqlite3_column_bytes(stmt, 0)), true);
+      sqlite3_finalize(stmt);
+   });
 }
 
 void SqliteSampleBlock::SetSamples(constSamplePtr src,
@@ -409,7 +586,8 @@ bool SqliteSampleBlock::GetSummary256(float *dest,
                                       size_t numframes)
 {
    return GetSummary(dest, frameoffset, numframes, DBConnection::GetSummary256,
-      "SELECT summary256 FROM sampleblocks WHERE blockid = ?1;");
+      "SELECT summary256 FROM sampleblocks WHERE blockid = ?1;",
+      SampleBlockCache::Kind::Summary256);
 }
 
 bool SqliteSampleBlock::GetSummary64k(float *dest,
@@ -417,14 +595,113 @@ bool SqliteSampleBlock::GetSummary64k(float *dest,
                                       size_t numframes)
 {
    return GetSummary(dest, frameoffset, numframes, DBConnection::GetSummary64k,
-      "SELECT summary64k FROM sampleblocks WHERE blockid = ?1;");
+      "SELECT summary64k FROM sampleblocks WHERE blockid = ?1;",
+      SampleBlockCache::Kind::Summary64k);
+}
+
+bool SqliteSampleBlock::GetSummary(size_t divisor,
+                                   float *dest,
+                                   size_t frameoffset,
+                                   size_t numframes)
+{
+   if (divisor == 256)
+      return GetSummary256(dest, frameoffset, numframes);
+   if (divisor == 65536)
+      return GetSummary64k(dest, frameoffset, numframes);
+
+   // Non-throwing, it returns true for success
+   bool silent = IsSilent();
+   if (!silent && SummaryPyramid::IsLevel(divisor)) {
+      try {
+         if (auto blob = GetDerivedSummary(divisor)) {
+            CopyBlob(dest, floatSample, blob->data(), blob->size(),
+               floatSample, frameoffset * bytesPerFrame,
+               numframes * bytesPerFrame);
+            return true;
+         }
+      }
+      catch ( const AudacityException & ) {
+      }
+   }
+   memset(dest, 0, 3 * numframes * sizeof( float ));
+   // Return true for success only if we didn't catch
+   return silent;
+}
+
+namespace {
+SampleBlockCache::Kind DerivedSummaryKind(size_t divisor)
+{
+   switch (divisor) {
+   case 16:
+      return SampleBlockCache::Kind::Summary16;
+   case 64:
+      return SampleBlockCache::Kind::Summary64;
+   case 1024:
+      return SampleBlockCache::Kind::Summary1k;
+   case 4096:
+      return SampleBlockCache::Kind::Summary4k;
+   default:
+      wxASSERT(divisor == 16384);
+      return SampleBlockCache::Kind::Summary16k;
+   }
+}
+}
+
+SampleBlockCache::Blob SqliteSampleBlock::GetDerivedSummary(size_t divisor)
+{
+   // Only the levels 256 and 64k are in the project file, so that files
+   // stay compatible; the others are as quick to make from the next finer
+   // level as to read, and take little room in the cache
+   using namespace SummaryPyramid;
+   const auto kind = DerivedSummaryKind(divisor);
+   auto &cache = *mpFactory->mpCache;
+   if (auto blob = cache.Find(mBlockID, kind))
+      return blob;
+
+   if (!mValid)
+   {
+      Load(mBlockID);
+   }
+
+   const auto finerDivisor = divisor / Factor;
+   std::vector<char> bytes(Frames(mSampleCount, divisor) * bytesPerFrame);
+   const auto dest = reinterpret_cast<float *>(bytes.data());
+   if (divisor == MinDivisor)
+   {
+      Floats samples{ mSampleCount };
+      DoGetSamples(reinterpret_cast<samplePtr>(samples.get()), floatSample,
+         0, mSampleCount);
+      Summarize(samples.get(), mSampleCount, divisor, dest);
+   }
+   else if (finerDivisor == 256)
+   {
+      // Read only the frames that summarize samples, not the padding
+      const auto frames = Frames(mSampleCount, finerDivisor);
+      Floats finer{ frames * fields };
+      if (!GetSummary256(finer.get(), 0, frames))
+         return {};
+      Reduce(finer.get(), finerDivisor, mSampleCount, Factor, dest);
+   }
+   else
+   {
+      const auto finer = GetDerivedSummary(finerDivisor);
+      if (!finer)
+         return {};
+      Reduce(reinterpret_cast<const float *>(finer->data()), finerDivisor,
+         mSampleCount, Factor, dest);
+   }
+
+   auto result = std::make_shared<const std::vector<char>>(std::move(bytes));
+   cache.Insert(mBlockID, kind, result);
+   return result;
 }
 
 bool SqliteSampleBlock::GetSummary(float *dest,
                                    size_t frameoffset,
                                    size_t numframes,
                                    DBConnection::StatementID id,
-                                   const char *sql)
+                                   const char *sql,
+                                   SampleBlockCache::Kind kind)
 {
    // Non-throwing, it returns true for success
    bool silent = IsSilent();
@@ -440,7 +717,8 @@ bool SqliteSampleBlock::GetSummary(float *dest,
                      stmt,
                      floatSample,
                      frameoffset * fields * SAMPLE_SIZE(floatSample),
-                     numframes * fields * SAMPLE_SIZE(floatSample));
+                     numframes * fields * SAMPLE_SIZE(floatSample),
+                     kind);
          return true;
       }
       catch ( const AudacityException & ) {
@@ -536,7 +814,8 @@ size_t SqliteSampleBlock::GetBlob(void *dest,
                                   sqlite3_stmt *stmt,
                                   sampleFormat srcformat,
                                   size_t srcoffset,
-                                  size_t srcbytes)
+                                  size_t srcbytes,
+                                  SampleBlockCache::Kind kind)
 {
    auto db = DB();
 
@@ -547,8 +826,30 @@ size_t SqliteSampleBlock::GetBlob(void *dest,
       Load(mBlockID);
    }
 
+   if (auto pBlock = mpFactory->mpPending->Find(mBlockID))
+   {
+      SampleBlockCache::RecordRead(srcbytes, 0);
+      const auto &blob = pBlock->Blob(kind);
+      return CopyBlob(dest, destformat, blob.first, blob.second,
+         srcformat, srcoffset, srcbytes);
+   }
+
+   auto &cache = *mpFactory->mpCache;
+   if (auto blob = cache.Find(mBlockID, kind))
+   {
+      SampleBlockCache::RecordRead(srcbytes, 0);
+      return CopyBlob(dest, destformat, blob->data(), blob->size(),
+         srcformat, srcoffset, srcbytes);
+   }
+
+   // Stepping the statement reads the whole blob.  When the window is a
+   // small part of it, as when scrubbing or drawing zoomed in, read only
+   // the window instead, and don't cache
+   if (srcbytes * PartialReadRatio < BlobBytes(kind))
+      return GetBlobRange(dest, destformat, kind, srcformat,
+         srcoffset, srcbytes);
+
    int rc;
-   size_t minbytes = 0;
 
    // Bind statement parameters
    // Might return SQLITE_MISUSE which means it's our mistake that we violated
@@ -588,17 +889,116 @@ size_t SqliteSampleBlock::GetBlob(void *dest,
    }
 
    // Retrieve returned data
-   samplePtr src = (samplePtr) sqlite3_column_blob(stmt, 0);
+   auto src = (const char *) sqlite3_column_blob(stmt, 0);
    size_t blobbytes = (size_t) sqlite3_column_bytes(stmt, 0);
 
+   // The whole blob was read anyway; keep it for the next reader
+   SampleBlockCache::RecordRead(srcbytes, blobbytes);
+   cache.Insert(mBlockID, kind, src, blobbytes);
+
+   CopyBlob(dest, destformat, src, blobbytes, srcformat, srcoffset, srcbytes);
+
+   // Clear statement bindings and rewind statement
+   sqlite3_clear_bindings(stmt);
+   sqlite3_reset(stmt);
+
+   return srcbytes;
+}
+
+size_t SqliteSampleBlock::GetBlobRange(void *dest,
+                                       sampleFormat destformat,
+                                       SampleBlockCache::Kind kind,
+                                       sampleFormat srcformat,
+                                       size_t srcoffset,
+                                       size_t srcbytes)
+{
+   auto db = DB();
+
+   const char *column =
+        kind == SampleBlockCache::Kind::Summary256 ? "summary256"
+      : kind == SampleBlockCache::Kind::Summary64k ? "summary64k"
+      : "samples";
+
+   // Open a read-only handle on the blob; with the connection's mmap_size,
+   // reading through it touches only the pages of the window
+   sqlite3_blob *blob = nullptr;
+   int rc = sqlite3_blob_open(db, "main", "sampleblocks", column, mBlockID,
+      0, &blob);
+   auto cleanup = finally([blob]{ sqlite3_blob_close(blob); });
+   if (rc != SQLITE_OK)
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::GetBlobRange::open");
+
+      wxLogDebug(wxT("SqliteSampleBlock::GetBlobRange - SQLITE error %s"), sqlite3_errmsg(db));
+
+      Conn()->ThrowException( false );
+   }
+
+   size_t blobbytes = (size_t) sqlite3_blob_bytes(blob);
    srcoffset = std::min(srcoffset, blobbytes);
-   minbytes = std::min(srcbytes, blobbytes - srcoffset);
+   size_t minbytes = std::min(srcbytes, blobbytes - srcoffset);
+
+   // Read straight into the destination if no conversion is needed
+   ArrayOf<char> buffer;
+   char *window = (char *) dest;
+   if (destformat != srcformat)
+   {
+      buffer.reinit(minbytes);
+      window = buffer.get();
+   }
 
-   if (srcoffset != 0)
+   rc = minbytes == 0 ? SQLITE_OK :
+      sqlite3_blob_read(blob, window, (int) minbytes, (int) srcoffset);
+   if (rc != SQLITE_OK)
    {
-      srcoffset += 0;
+      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::GetBlobRange::read");
+
+      wxLogDebug(wxT("SqliteSampleBlock::GetBlobRange - SQLITE error %s"), sqlite3_errmsg(db));
+
+      Conn()->ThrowException( false );
+   }
+
+   SampleBlockCache::RecordRead(srcbytes, minbytes);
+
+   if (destformat != srcformat)
+   {
+      return CopyBlob(dest, destformat, window, minbytes, srcformat, 0,
+         srcbytes);
+   }
+
+   if (srcbytes - minbytes)
+   {
+      memset((char *) dest + minbytes, 0, srcbytes - minbytes);
    }
 
+   return srcbytes;
+}
+
+size_t SqliteSampleBlock::BlobBytes(SampleBlockCache::Kind kind) const
+{
+   switch (kind) {
+   case SampleBlockCache::Kind::Summary256:
+      return ((mSampleCount + 65535) / 65536) * 256 * bytesPerFrame;
+   case SampleBlockCache::Kind::Summary64k:
+      return ((mSampleCount + 65535) / 65536) * bytesPerFrame;
+   default:
+      return mSampleBytes;
+   }
+}
+
+size_t SqliteSampleBlock::CopyBlob(void *dest,
+                                   sampleFormat destformat,
+                                   const char *src,
+                                   size_t blobbytes,
+                                   sampleFormat srcformat,
+                                   size_t srcoffset,
+                                   size_t srcbytes)
+{
+   srcoffset = std::min(srcoffset, blobbytes);
+   size_t minbytes = std::min(srcbytes, blobbytes - srcoffset);
+
    /*
     Will dithering happen in CopySamples?  Answering this as of 3.0.3 by
     examining all uses.
@@ -648,10 +1048,6 @@ size_t SqliteSampleBlock::GetBlob(void *dest,
       memset(dest, 0, srcbytes - minbytes);
    }
 
-   // Clear statement bindings and rewind statement
-   sqlite3_clear_bindings(stmt);
-   sqlite3_reset(stmt);
-
    return srcbytes;
 }
 
@@ -725,69 +1121,80 @@ void SqliteSampleBlock::Load(SampleBlockID sbid)
 
 void SqliteSampleBlock::Commit(Sizes sizes)
 {
-   const auto mSummary256Bytes = sizes.first;
-   const auto mSummary64kBytes = sizes.second;
+   auto pConn = Conn();
+
+   // The id is known now, but the row is inserted later, by the writer
+   // thread of the connection, so that no caller waits on the disk.
+   // Until then, reads of the block are served from the pending data.
+   auto pBlock = std::make_shared<PendingBlock>();
+   pBlock->id = pConn->ReserveBlockID();
+   pBlock->format = mSampleFormat;
+   pBlock->sumMin = mSumMin;
+   pBlock->sumMax = mSumMax;
+   pBlock->sumRms = mSumRms;
+   pBlock->samples = std::move(mSamples);
+   pBlock->sampleBytes = mSampleBytes;
+   pBlock->summary256 = std::move(mSummary256);
+   pBlock->summary256Bytes = sizes.first;
+   pBlock->summary64k = std::move(mSummary64k);
+   pBlock->summary64kBytes = sizes.second;
+
+   auto pPending = mpFactory->mpPending;
+   pPending->Add(pBlock);
+
+   mBlockID = pBlock->id;
+   mValid = true;
 
-   auto db = DB();
+   pConn->DeferWrite({
+      [pPending, pBlock](sqlite3 *db){
+         return pPending->Start(*pBlock) ? Insert(db, *pBlock) : SQLITE_OK;
+      },
+      [pPending, id = pBlock->id]{ pPending->Remove(id); }
+   });
+}
+
+int SqliteSampleBlock::Insert(sqlite3 *db, const PendingBlock &block)
+{
    int rc;
 
-   // Prepare and cache statement...automatically finalized at DB close
-   sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::InsertSampleBlock,
-      "INSERT INTO sampleblocks (sampleformat, summin, summax, sumrms,"
+   // Not prepared through DBConnection, which caches statements only for
+   // the primary connection
+   sqlite3_stmt *stmt = nullptr;
+   rc = sqlite3_prepare_v2(db,
+      "INSERT INTO sampleblocks (blockid, sampleformat, summin, summax, sumrms,"
       "                          summary256, summary64k, samples)"
-      "                         VALUES(?1,?2,?3,?4,?5,?6,?7);");
+      "                         VALUES(?1,?2,?3,?4,?5,?6,?7,?8);", -1, &stmt, 0);
+   if (rc != SQLITE_OK)
+   {
+      return rc;
+   }
+
+   auto cleanup = finally([stmt]{ sqlite3_finalize(stmt); });
 
    // Bind statement parameters
    // Might return SQLITE_MISUSE which means it's our mistake that we violated
    // preconditions; should return SQL_OK which is 0
-   if (sqlite3_bind_int(stmt, 1, mSampleFormat) ||
-       sqlite3_bind_double(stmt, 2, mSumMin) ||
-       sqlite3_bind_double(stmt, 3, mSumMax) ||
-       sqlite3_bind_double(stmt, 4, mSumRms) ||
-       sqlite3_bind_blob(stmt, 5, mSummary256.get(), mSummary256Bytes, SQLITE_STATIC) ||
-       sqlite3_bind_blob(stmt, 6, mSummary64k.get(), mSummary64kBytes, SQLITE_STATIC) ||
-       sqlite3_bind_blob(stmt, 7, mSamples.get(), mSampleBytes, SQLITE_STATIC))
+   if (sqlite3_bind_int64(stmt, 1, block.id) ||
+       sqlite3_bind_int(stmt, 2, block.format) ||
+       sqlite3_bind_double(stmt, 3, block.sumMin) ||
+       sqlite3_bind_double(stmt, 4, block.sumMax) ||
+       sqlite3_bind_double(stmt, 5, block.sumRms) ||
+       sqlite3_bind_blob(stmt, 6, block.summary256.get(), block.summary256Bytes, SQLITE_STATIC) ||
+       sqlite3_bind_blob(stmt, 7, block.summary64k.get(), block.summary64kBytes, SQLITE_STATIC) ||
+       sqlite3_bind_blob(stmt, 8, block.samples.get(), block.sampleBytes, SQLITE_STATIC))
    {
-
-      ADD_EXCEPTION_CONTEXT(
-         "sqlite3.rc", std::to_string(sqlite3_errcode(Conn()->DB())));
-      ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::Commit::bind");
-
-
       wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
    }
- 
+
    // Execute the statement
    rc = sqlite3_step(stmt);
    if (rc != SQLITE_DONE)
    {
-      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
-      ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::Commit::step");
-
-      wxLogDebug(wxT("SqliteSampleBlock::Commit - SQLITE error %s"), sqlite3_errmsg(db));
-
-      // Clear statement bindings and rewind statement
-      sqlite3_clear_bindings(stmt);
-      sqlite3_reset(stmt);
-
-      // Just showing the user a simple message, not the library error too
-      // which isn't internationalized
-      Conn()->ThrowException( true );
+      wxLogDebug(wxT("SqliteSampleBlock::Insert - SQLITE error %s"), sqlite3_errmsg(db));
+      return rc;
    }
 
-   // Retrieve returned data
-   mBlockID = sqlite3_last_insert_rowid(db);
-
-   // Reset local arrays
-   mSamples.reset();
-   mSummary256.reset();
-   mSummary64k.reset();
-
-   // Clear statement bindings and rewind statement
-   sqlite3_clear_bindings(stmt);
-   sqlite3_reset(stmt);
-
-   mValid = true;
+   return SQLITE_OK;
 }
 
 void SqliteSampleBlock::Delete()
@@ -797,6 +1204,19 @@ void SqliteSampleBlock::Delete()
 
    wxASSERT(!IsSilent());
 
+   switch (mpFactory->mpPending->Cancel(mBlockID))
+   {
+   case PendingBlocks::Cancelled:
+      // The row was never inserted
+      return;
+   case PendingBlocks::Started:
+      // The row is being inserted; let that finish, then delete it
+      Conn()->FlushDeferredWrites();
+      break;
+   default:
+      break;
+   }
+
    // Prepare and cache statement...automatically finalized at DB close
    sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::DeleteSampleBlock,
       "DELETE FROM sampleblocks WHERE blockid = ?1;");
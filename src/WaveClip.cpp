@@ -127,6 +127,11 @@ bool WaveClip::GetSamples(samplePtr buffer, sampleFormat format,
    return mSequence->Get(buffer, format, start + TimeToSamples(mTrimLeft), len, mayThrow);
 }
 
+void WaveClip::Prefetch(sampleCount start, sampleCount len) const
+{
+   mSequence->Prefetch(start + TimeToSamples(mTrimLeft), len);
+}
+
 /*! @excsafety{Strong} */
 void WaveClip::SetSamples(constSamplePtr buffer, sampleFormat format,
                    sampleCount start, size_t len)
@@ -780,8 +785,10 @@ void WaveClip::Resample(int rate, BasicUI::ProgressDialog *progress)
    ::Resample resample(true, factor, factor); // constant rate resampling
 
    const size_t bufsize = 65536;
-   Floats inBuffer{ bufsize };
-   Floats outBuffer{ bufsize };
+   // Read and write the resampler's own buffers, so that a sandboxed
+   // resampler needs no copies
+   float *const inBuffer = resample.GetInputBuffer(bufsize);
+   float *const outBuffer = resample.GetOutputBuffer(bufsize);
    sampleCount pos = 0;
    bool error = false;
    int outGenerated = 0;
@@ -801,14 +808,14 @@ void WaveClip::Resample(int rate, BasicUI::ProgressDialog *progress)
 
       bool isLast = ((pos + inLen) == numSamples);
 
-      if (!mSequence->Get((samplePtr)inBuffer.get(), floatSample, pos, inLen, true))
+      if (!mSequence->Get((samplePtr)inBuffer, floatSample, pos, inLen, true))
       {
          error = true;
          break;
       }
 
-      const auto results = resample.Process(factor, inBuffer.get(), inLen, isLast,
-                                            outBuffer.get(), bufsize);
+      const auto results = resample.Process(factor, inBuffer, inLen, isLast,
+                                            outBuffer, bufsize);
       outGenerated = results.second;
 
       pos += results.first;
@@ -819,7 +826,7 @@ void WaveClip::Resample(int rate, BasicUI::ProgressDialog *progress)
          break;
       }
 
-      newSequence->Append((samplePtr)outBuffer.get(), floatSample,
+      newSequence->Append((samplePtr)outBuffer, floatSample,
                           outGenerated);
 
       if (progress)
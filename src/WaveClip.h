@@ -199,6 +199,8 @@ public:
 
    bool GetSamples(samplePtr buffer, sampleFormat format,
                    sampleCount start, size_t len, bool mayThrow = true) const;
+   //! Hint that GetSamples() will be called soon for the range
+   void Prefetch(sampleCount start, sampleCount len) const;
    void SetSamples(constSamplePtr buffer, sampleFormat format,
                    sampleCount start, size_t len);
 
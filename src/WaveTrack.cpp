@@ -1783,6 +1783,24 @@ sampleCount WaveTrack::GetBlockStart(sampleCount s) const
    return -1;
 }
 
+void WaveTrack::Prefetch(sampleCount start, size_t len) const
+{
+   if (len == 0)
+      return;
+
+   const auto end = start + len;
+   for (const auto &clip : mClips)
+   {
+      const auto clipStart = clip->GetPlayStartSample();
+      const auto clipEnd = clip->GetPlayEndSample();
+      if (clipEnd > start && clipStart < end)
+      {
+         const auto inclipStart = std::max(start, clipStart) - clipStart;
+         clip->Prefetch(inclipStart, std::min(end, clipEnd) - clipStart - inclipStart);
+      }
+   }
+}
+
 size_t WaveTrack::GetBestBlockSize(sampleCount s) const
 {
    auto bestBlockSize = GetMaxBlockSize();
@@ -292,6 +292,8 @@ private:
 
    sampleCount GetBlockStart(sampleCount t) const override;
 
+   void Prefetch(sampleCount start, size_t len) const override;
+
    // These return a nonnegative number of samples meant to size a memory buffer
    size_t GetBestBlockSize(sampleCount t) const override;
    size_t GetMaxBlockSize() const override;
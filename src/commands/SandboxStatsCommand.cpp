@@ -0,0 +1,89 @@
+/**********************************************************************
+
+   Audacity - A Digital Audio Editor
+   Copyright 1999-2018 Audacity Team
+   License: wxwidgets
+
+******************************************************************//**
+
+\file SandboxStatsCommand.cpp
+\brief Definitions for SandboxStatsCommand class
+
+*//*******************************************************************/
+
+
+#include "SandboxStatsCommand.h"
+
+#include "LoadCommands.h"
+#include "CommandContext.h"
+#include "ResampleStats.h"
+#include "../Shuttle.h"
+#include "../ShuttleGui.h"
+
+const ComponentInterfaceSymbol SandboxStatsCommand::Symbol
+{ XO("Sandbox Stats") };
+
+namespace{ BuiltinCommandsModule::Registration< SandboxStatsCommand > reg; }
+
+template<bool Const>
+bool SandboxStatsCommand::VisitSettings( SettingsVisitorBase<Const> & S ){
+   S.Define( mbReset, wxT("Reset"), false );
+   return true;
+}
+
+bool SandboxStatsCommand::VisitSettings( SettingsVisitor & S )
+   { return VisitSettings<false>(S); }
+
+bool SandboxStatsCommand::VisitSettings( ConstSettingsVisitor & S )
+   { return VisitSettings<true>(S); }
+
+void SandboxStatsCommand::PopulateOrExchange(ShuttleGui & S)
+{
+   S.AddSpace(0, 5);
+
+   S.StartMultiColumn(2, wxALIGN_CENTER);
+   {
+      S.TieCheckBox(XXO("Reset after reporting"), mbReset);
+   }
+   S.EndMultiColumn();
+}
+
+bool SandboxStatsCommand::Apply(const CommandContext & context)
+{
+   auto &stats = ResampleSandboxStats::Get();
+   const auto snapshot = stats.GetSnapshot();
+   if (mbReset)
+      stats.Reset();
+
+   context.StartStruct();
+   context.StartField( "functions" );
+   context.StartArray();
+   for (size_t ii = 0; ii < ResampleSandboxStats::nSymbols; ++ii) {
+      const auto &totals = snapshot.symbols[ii];
+      context.StartStruct();
+      context.AddItem(
+         ResampleSandboxStats::Name(ResampleSandboxStats::Symbol(ii)), "name" );
+      context.AddItem( totals.calls, "calls" );
+      context.AddItem( totals.totalNs / 1.0e3, "total_us" );
+      context.AddItem( totals.maxNs / 1.0e3, "max_us" );
+      // Counts of calls, by the lower bound of their durations in us
+      context.StartField( "histogram" );
+      context.StartArray();
+      for (size_t bucket = 0; bucket < ResampleSandboxStats::nBuckets; ++bucket) {
+         context.StartStruct();
+         context.AddItem( ResampleSandboxStats::BucketFloorUs(bucket), "min_us" );
+         context.AddItem( totals.histogram[bucket], "calls" );
+         context.EndStruct();
+      }
+      context.EndArray();
+      context.EndField();
+      context.EndStruct();
+   }
+   context.EndArray();
+   context.EndField();
+   context.AddItem( snapshot.bytesIn, "bytes_in" );
+   context.AddItem( snapshot.bytesOut, "bytes_out" );
+   context.EndStruct();
+
+   return true;
+}
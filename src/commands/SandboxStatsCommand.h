@@ -0,0 +1,47 @@
+/**********************************************************************
+
+   Audacity - A Digital Audio Editor
+   Copyright 1999-2018 Audacity Team
+   License: wxwidgets
+
+******************************************************************//**
+
+\file SandboxStatsCommand.h
+\brief Contains definition of SandboxStatsCommand class.
+
+*//***************************************************************//**
+
+\class SandboxStatsCommand
+\brief Command to report the calls that resampling made into the soxr
+sandbox: counts and latency histograms per function, and bytes marshalled
+
+*//*******************************************************************/
+
+#ifndef __SANDBOX_STATS_COMMAND__
+#define __SANDBOX_STATS_COMMAND__
+
+#include "CommandType.h"
+#include "Command.h"
+
+class SandboxStatsCommand final : public AudacityCommand
+{
+public:
+   static const ComponentInterfaceSymbol Symbol;
+
+   // ComponentInterface overrides
+   ComponentInterfaceSymbol GetSymbol() const override {return Symbol;};
+   TranslatableString GetDescription() const override {return XO("Reports calls into the resampler sandbox.");};
+   template<bool Const> bool VisitSettings( SettingsVisitorBase<Const> &S );
+   bool VisitSettings( SettingsVisitor & S ) override;
+   bool VisitSettings( ConstSettingsVisitor & S ) override;
+   void PopulateOrExchange(ShuttleGui & S) override;
+   bool Apply(const CommandContext & context) override;
+
+   // AudacityCommand overrides
+   ManualPageID ManualPage() override {return L"Extra_Menu:_Scriptables_II#sandbox_stats";}
+public:
+   bool mbReset;
+};
+
+
+#endif /* End of include guard: __SANDBOX_STATS_COMMAND__ */
@@ -139,6 +139,23 @@ unsigned EffectAmplify::GetAudioOutCount() const
    return 1;
 }
 
+//! ProcessBlock() only reads the ratio, so that tracks may share the effect
+struct EffectAmplify::Instance : StatefulPerTrackEffect::Instance
+{
+   using StatefulPerTrackEffect::Instance::Instance;
+   std::shared_ptr<PerTrackEffect::Instance> Clone() const override
+   {
+      return std::make_shared<Instance>(GetEffect());
+   }
+};
+
+std::shared_ptr<EffectInstance>
+EffectAmplify::MakeInstance(EffectSettings &) const
+{
+   // Cheat with const-cast, as StatefulPerTrackEffect::MakeInstance does
+   return std::make_shared<Instance>(const_cast<EffectAmplify&>(*this));
+}
+
 size_t EffectAmplify::ProcessBlock(EffectSettings &,
    const float *const *inBlock, float *const *outBlock, size_t blockLen)
 {
@@ -61,6 +61,12 @@ struct EffectEcho::Instance
 
    bool ProcessFinalize(void) override;
 
+   //! The history is per instance, so tracks may be echoed at once
+   std::shared_ptr<PerTrackEffect::Instance> Clone() const override
+   {
+      return std::make_shared<Instance>(mProcessor);
+   }
+
    Floats history;
    size_t histPos;
    size_t histLen;
@@ -57,6 +57,7 @@
 #include "LoadEffects.h"
 
 #include <math.h>
+#include <optional>
 #include <vector>
 
 #include <wx/setup.h> // for wxUSE_* macros
@@ -108,6 +109,8 @@
 #include "XMLFileReader.h"
 #include "AllThemeResources.h"
 #include "float_cast.h"
+#include "OverlapAddFilter.h"
+#include "WorkStealingPool.h"
 
 #if wxUSE_ACCESSIBILITY
 #include "../widgets/WindowAccessible.h"
@@ -115,10 +118,7 @@
 
 #include "../widgets/FileDialog/FileDialog.h"
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-#include "Equalization48x.h"
-#endif
-
+IntSetting EqualizationThreads{ L"/Performance/EqualizationThreads", 0 };
 
 enum
 {
@@ -136,14 +136,6 @@ enum
    ID_Curve,
    ID_Manage,
    ID_Delete,
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   ID_DefaultMath,
-   ID_SSE,
-   ID_SSEThreaded,
-   ID_AVX,
-   ID_AVXThreaded,
-   ID_Bench,
-#endif
    ID_Slider,   // needs to come last
 };
 
@@ -235,20 +227,10 @@ BEGIN_EVENT_TABLE(EffectEqualization, wxEvtHandler)
    EVT_RADIOBUTTON(ID_Graphic, EffectEqualization::OnGraphicMode)
    EVT_CHECKBOX(ID_Linear, EffectEqualization::OnLinFreq)
    EVT_CHECKBOX(ID_Grid, EffectEqualization::OnGridOnOff)
-
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   EVT_RADIOBUTTON(ID_DefaultMath, EffectEqualization::OnProcessingRadio)
-   EVT_RADIOBUTTON(ID_SSE, EffectEqualization::OnProcessingRadio)
-   EVT_RADIOBUTTON(ID_SSEThreaded, EffectEqualization::OnProcessingRadio)
-   EVT_RADIOBUTTON(ID_AVX, EffectEqualization::OnProcessingRadio)
-   EVT_RADIOBUTTON(ID_AVXThreaded, EffectEqualization::OnProcessingRadio)
-   EVT_BUTTON(ID_Bench, EffectEqualization::OnBench)
-#endif
 END_EVENT_TABLE()
 
 EffectEqualization::EffectEqualization(int Options)
-   : mFFTBuffer{ windowSize }
-   , mFilterFuncR{ windowSize }
+   : mFilterFuncR{ windowSize }
    , mFilterFuncI{ windowSize }
 {
    Parameters().Reset(*this);
@@ -260,8 +242,6 @@ EffectEqualization::EffectEqualization(int Options)
    mPanel = NULL;
    mMSlider = NULL;
 
-   hFFT = GetFFT(windowSize);
-
    SetLinearEffectFlag(true);
 
    mCurveName = CurveName.def;
@@ -308,16 +288,6 @@ EffectEqualization::EffectEqualization(int Options)
    mWhenSliders[NUMBER_OF_BANDS] = 1.;
    mEQVals[NUMBER_OF_BANDS] = 0.;
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   bool useSSE;
-   GetPrivateConfig(CurrentSettingsGroup(), wxT("/SSE/GUI"), useSSE, false);
-   if(useSSE && !mEffectEqualization48x)
-      mEffectEqualization48x = std::make_unique<EffectEqualization48x>();
-   else if(!useSSE)
-      mEffectEqualization48x.reset();
-   mBench=false;
-#endif
-
    // We expect these Hi and Lo frequencies to be overridden by Init().
    // Don't use inputTracks().  See bug 2321.
 #if 0
@@ -629,20 +599,20 @@ bool EffectEqualization::Init()
 
 bool EffectEqualization::Process(EffectInstance &, EffectSettings &)
 {
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   if(mEffectEqualization48x) {
-      if(mBench) {
-         mBench=false;
-         return mEffectEqualization48x->Benchmark(this);
-      }
-      else
-         return mEffectEqualization48x->Process(this);
-   }
-#endif
    this->CopyInputTracks(); // Set up mOutputTracks.
    CalcFilter();
    bool bGoodResult = true;
 
+   // The windows of each block are filtered in parallel, one track at a time,
+   // on the pool that the process shares, held until all tracks are done;
+   // if another user holds it, all is done on this thread
+   const auto threads = EqualizationThreads.Read();
+   const auto maxWorkers = threads > 0 ? static_cast<unsigned>(threads) : 0u;
+   std::optional<WorkStealingPool::SharedLease> lease;
+   if (maxWorkers != 1)
+      lease.emplace();
+   const auto pPool = lease ? lease->get() : nullptr;
+
    int count = 0;
    for( auto track : mOutputTracks->Selected< WaveTrack >() ) {
       double trackStart = track->GetStartTime();
@@ -655,7 +625,7 @@ bool EffectEqualization::Process(EffectInstance &, EffectSettings &)
          auto end = track->TimeToLongSamples(t1);
          auto len = end - start;
 
-         if (!ProcessOne(count, track, start, len))
+         if (!ProcessOne(count, track, start, len, pPool, maxWorkers))
          {
             bGoodResult = false;
             break;
@@ -1009,62 +979,6 @@ EffectEqualization::PopulateOrExchange(
    }
    S.EndMultiColumn();
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   if (mEffectEqualization48x)
-   {
-      // -------------------------------------------------------------------
-      // ROW 6: Processing routine selection
-      // -------------------------------------------------------------------
-
-      // Column 1 is blank
-      S.AddSpace(1, 1);
-
-      S.StartHorizontalLay();
-      {
-         S.AddUnits(XO("&Processing: "));
-
-         // update the control state
-         int mathPath = EffectEqualization48x::GetMathPath();
-         int value =
-            (mathPath & MATH_FUNCTION_SSE)
-            ? (mathPath & MATH_FUNCTION_THREADED)
-               ? 2
-               : 1
-            : false // (mathPath & MATH_FUNCTION_AVX) // not implemented
-               ? (mathPath & MATH_FUNCTION_THREADED)
-                  ? 4
-                  : 3
-               : 0;
-
-         mMathProcessingType[0] = S.Id(ID_DefaultMath)
-            .AddRadioButton(XXO("D&efault"),
-                            0, value);
-         mMathProcessingType[1] = S.Id(ID_SSE)
-            .Disable(!EffectEqualization48x::GetMathCaps()->SSE)
-            .AddRadioButtonToGroup(XXO("&SSE"),
-                                   1, value);
-         mMathProcessingType[2] = S.Id(ID_SSEThreaded)
-            .Disable(!EffectEqualization48x::GetMathCaps()->SSE)
-            .AddRadioButtonToGroup(XXO("SSE &Threaded"),
-                                   2, value);
-         mMathProcessingType[3] = S.Id(ID_AVX)
-            // not implemented
-            .Disable(true /* !EffectEqualization48x::GetMathCaps()->AVX */)
-            .AddRadioButtonToGroup(XXO("A&VX"),
-                                   3, value);
-         mMathProcessingType[4] = S.Id(ID_AVXThreaded)
-            // not implemented
-            .Disable(true /* !EffectEqualization48x::GetMathCaps()->AVX */)
-            .AddRadioButtonToGroup(XXO("AV&X Threaded"),
-                                   4, value);
-         S.Id(ID_Bench).AddButton(XXO("&Bench"));
-      }
-      S.EndHorizontalLay();
-
-      // Column 3 is blank
-      S.AddSpace(1, 1);
-   }
-#endif
 
    mUIParent->SetAutoLayout(false);
    if( mOptions != kEqOptionGraphic)
@@ -1174,7 +1088,9 @@ void EffectEqualization::UpdateRuler()
 // EffectEqualization implementation
 
 bool EffectEqualization::ProcessOne(int count, WaveTrack * t,
-                                    sampleCount start, sampleCount len)
+                                    sampleCount start, sampleCount len,
+                                    WorkStealingPool *pPool,
+                                    unsigned maxWorkers)
 {
    // create a NEW WaveTrack to hold all of the output, including 'tails' each end
    auto output = t->EmptyCopy();
@@ -1189,19 +1105,15 @@ bool EffectEqualization::ProcessOne(int count, WaveTrack * t,
 
    Floats buffer{ idealBlockLen };
 
-   Floats window1{ windowSize };
-   Floats window2{ windowSize };
-   float *thisWindow = window1.get();
-   float *lastWindow = window2.get();
+   // Filters the lumps of L samples of each block, and overlaps and adds
+   // them, with the windows of a block in batches and in parallel
+   OverlapAddFilter filter{ windowSize, mM,
+      mFilterFuncR.get(), mFilterFuncI.get(), pPool, maxWorkers };
 
    auto originalLen = len;
 
-   for(size_t i = 0; i < windowSize; i++)
-      lastWindow[i] = 0;
-
    TrackProgress(count, 0.);
    bool bLoopSuccess = true;
-   size_t wcopy = 0;
    int offset = (mM - 1) / 2;
 
    while (len != 0)
@@ -1210,24 +1122,7 @@ bool EffectEqualization::ProcessOne(int count, WaveTrack * t,
 
       t->GetFloats(buffer.get(), s, block);
 
-      for(size_t i = 0; i < block; i += L)   //go through block in lumps of length L
-      {
-         wcopy = std::min <size_t> (L, block - i);
-         for(size_t j = 0; j < wcopy; j++)
-            thisWindow[j] = buffer[i+j];   //copy the L (or remaining) samples
-         for(auto j = wcopy; j < windowSize; j++)
-            thisWindow[j] = 0;   //this includes the padding
-
-         Filter(windowSize, thisWindow);
-
-         // Overlap - Add
-         for(size_t j = 0; (j < mM - 1) && (j < wcopy); j++)
-            buffer[i+j] = thisWindow[j] + lastWindow[L + j];
-         for(size_t j = mM - 1; j < wcopy; j++)
-            buffer[i+j] = thisWindow[j];
-
-         std::swap( thisWindow, lastWindow );
-      }  //next i, lump of this block
+      filter.Process(buffer.get(), block);
 
       output->Append((samplePtr)buffer.get(), floatSample, block);
       len -= block;
@@ -1243,21 +1138,8 @@ bool EffectEqualization::ProcessOne(int count, WaveTrack * t,
 
    if(bLoopSuccess)
    {
-      // mM-1 samples of 'tail' left in lastWindow, get them now
-      if(wcopy < (mM - 1)) {
-         // Still have some overlap left to process
-         // (note that lastWindow and thisWindow have been exchanged at this point
-         //  so that 'thisWindow' is really the window prior to 'lastWindow')
-         size_t j = 0;
-         for(; j < mM - 1 - wcopy; j++)
-            buffer[j] = lastWindow[wcopy + j] + thisWindow[L + wcopy + j];
-         // And fill in the remainder after the overlap
-         for( ; j < mM - 1; j++)
-            buffer[j] = lastWindow[wcopy + j];
-      } else {
-         for(size_t j = 0; j < mM - 1; j++)
-            buffer[j] = lastWindow[wcopy + j];
-      }
+      // mM-1 samples of 'tail' left in the last windows, get them now
+      filter.Flush(buffer.get());
       output->Append((samplePtr)buffer.get(), floatSample, mM - 1);
       output->Flush();
 
@@ -1435,31 +1317,6 @@ bool EffectEqualization::CalcFilter()
    return TRUE;
 }
 
-void EffectEqualization::Filter(size_t len, float *buffer)
-{
-   float re,im;
-   // Apply FFT
-   RealFFTf(buffer, hFFT.get());
-   //FFT(len, false, inr, NULL, outr, outi);
-
-   // Apply filter
-   // DC component is purely real
-   mFFTBuffer[0] = buffer[0] * mFilterFuncR[0];
-   for(size_t i = 1; i < (len / 2); i++)
-   {
-      re=buffer[hFFT->BitReversed[i]  ];
-      im=buffer[hFFT->BitReversed[i]+1];
-      mFFTBuffer[2*i  ] = re*mFilterFuncR[i] - im*mFilterFuncI[i];
-      mFFTBuffer[2*i+1] = re*mFilterFuncI[i] + im*mFilterFuncR[i];
-   }
-   // Fs/2 component is purely real
-   mFFTBuffer[1] = buffer[1] * mFilterFuncR[len/2];
-
-   // Inverse FFT and normalization
-   InverseRealFFTf(mFFTBuffer.get(), hFFT.get());
-   ReorderToTime(hFFT.get(), mFFTBuffer.get(), buffer);
-}
-
 //
 // Load external curves with fallback to default, then message
 //
@@ -2925,35 +2782,6 @@ void EffectEqualization::OnLinFreq(wxCommandEvent & WXUNUSED(event))
    ForceRecalc();
 }
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-
-void EffectEqualization::OnProcessingRadio(wxCommandEvent & event)
-{
-   int testEvent=event.GetId();
-   switch(testEvent)
-   {
-   case ID_DefaultMath: EffectEqualization48x::SetMathPath(MATH_FUNCTION_ORIGINAL);
-      break;
-   case ID_SSE: EffectEqualization48x::SetMathPath(MATH_FUNCTION_SSE);
-      break;
-   case ID_SSEThreaded: EffectEqualization48x::SetMathPath(MATH_FUNCTION_THREADED | MATH_FUNCTION_SSE);
-      break;
-   case ID_AVX: testEvent = 2;
-      break;
-   case ID_AVXThreaded: testEvent = 2;
-      break;
-   }
-
-};
-
-void EffectEqualization::OnBench( wxCommandEvent & event)
-{
-   mBench=true;
-   // OnOk(event);
-}
-
-#endif
-
 //----------------------------------------------------------------------------
 // EqualizationPanel
 //----------------------------------------------------------------------------
@@ -90,9 +90,7 @@ public:
 
 using EQCurveArray = std::vector<EQCurve>;
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-class EffectEqualization48x;
-#endif
+class WorkStealingPool;
 
 class EffectEqualization : public StatefulEffect,
                            public XMLTagHandler
@@ -152,9 +150,9 @@ private:
    enum {loFreqI=20};
 
    bool ProcessOne(int count, WaveTrack * t,
-                   sampleCount start, sampleCount len);
+                   sampleCount start, sampleCount len,
+                   WorkStealingPool *pPool, unsigned maxWorkers);
    bool CalcFilter();
-   void Filter(size_t len, float *buffer);
    
    void Flatten();
    void ForceRecalc();
@@ -205,14 +203,9 @@ private:
    void OnInvert( wxCommandEvent & event );
    void OnGridOnOff( wxCommandEvent & event );
    void OnLinFreq( wxCommandEvent & event );
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   void OnProcessingRadio( wxCommandEvent & event );
-   void OnBench( wxCommandEvent & event );
-#endif
 
    int mOptions;
-   HFFT hFFT;
-   Floats mFFTBuffer, mFilterFuncR, mFilterFuncI;
+   Floats mFilterFuncR, mFilterFuncI;
    size_t mM;
    wxString mCurveName;
    bool mLin;
@@ -241,12 +234,6 @@ private:
    std::unique_ptr<Envelope> mLogEnvelope, mLinEnvelope;
    Envelope *mEnvelope;
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   bool mBench;
-   std::unique_ptr<EffectEqualization48x> mEffectEqualization48x;
-   friend class EffectEqualization48x;
-#endif
-
    wxSizer *szrC;
    wxSizer *szrG;
    wxSizer *szrV;
@@ -276,11 +263,6 @@ private:
    wxSlider *mdBMaxSlider;
    wxSlider *mSliders[NUMBER_OF_BANDS];
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   wxRadioButton *mMathProcessingType[5]; // default, sse, sse threaded, AVX, AVX threaded (note AVX is not implemented yet
-   wxBoxSizer *szrM;
-#endif
-
    const EffectParameterMethods& Parameters() const override;
 
    DECLARE_EVENT_TABLE()
@@ -24,6 +24,12 @@
 #include "../SyncLock.h"
 #include "ViewInfo.h"
 #include "../WaveTrack.h"
+#include "Prefs.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
 
 PerTrackEffect::Instance::~Instance() = default;
 
@@ -48,6 +54,13 @@ sampleCount PerTrackEffect::Instance::GetLatency(const EffectSettings &)
    return 0;
 }
 
+auto PerTrackEffect::Instance::Clone() const -> std::shared_ptr<Instance>
+{
+   return nullptr;
+}
+
+IntSetting PerTrackEffectThreads{ L"/Performance/PerTrackEffectThreads", 0 };
+
 PerTrackEffect::~PerTrackEffect() = default;
 
 bool PerTrackEffect::DoPass1() const
@@ -78,37 +91,116 @@ bool PerTrackEffect::Process(
    return bGoodResult;
 }
 
+//! A (mono or stereo) track to process
+struct PerTrackEffect::TrackJob {
+   WaveTrack *left{};
+   WaveTrack *right{};
+   ChannelName map[3]{};
+   unsigned numChannels{ 0 };
+   sampleCount start{ 0 };
+   sampleCount len{ 0 };
+};
+
+//! Buffers of one instance, reused from track to track
+struct PerTrackEffect::Buffers {
+   FloatBuffers inBuffer, outBuffer;
+   ArrayOf<float *> inBufPos, outBufPos;
+   size_t bufferSize{ 0 };
+   size_t blockSize{ 0 };
+   //! Whether the second input buffer was cleared for a mono track
+   bool clear{ false };
+};
+
+//! The processing of one track, in steps, so that reading and writing of
+//! the track, on the main thread, are apart from the computation, which
+//! may be on another
+class PerTrackEffect::TrackRunner
+{
+public:
+   TrackRunner(const PerTrackEffect &effect, Instance &instance,
+      EffectSettings &settings, const TrackJob &track, Buffers &buffers);
+
+   //! Whether there are no more input or delayed samples
+   bool Done() const { return inputRemaining == 0 && delayRemaining == 0; }
+
+   //! Fraction of the track processed, for the progress display
+   double Fraction() const;
+
+   //! Refills the input buffers, if they are used up
+   void Read();
+
+   //! Processes blocks until the input buffers need refilling, or the output
+   //! buffers are full, or Done()
+   /*!
+    @param stop if not null, called after each block; returns true to cancel
+    @return false if cancelled or the instance threw
+    */
+   bool Run(const std::function<bool()> &stop);
+
+   //! Writes out the output buffers, if full
+   void Write();
+
+   //! After Done(), writes the remaining output, and for a generator,
+   //! replaces the selection with what it made
+   void Finish();
+
+private:
+   void Put();
+
+   const PerTrackEffect &effect;
+   Instance &instance;
+   EffectSettings &settings;
+   WaveTrack *const left;
+   WaveTrack *const right;
+   const sampleCount start;
+   const sampleCount len;
+   FloatBuffers &inBuffer;
+   FloatBuffers &outBuffer;
+   ArrayOf<float *> &inBufPos;
+   ArrayOf<float *> &outBufPos;
+   const size_t bufferSize;
+   const size_t blockSize;
+   const unsigned numChannels;
+
+   const bool isGenerator;
+   const bool isProcessor;
+   const unsigned chans;
+   sampleCount inPos;
+   sampleCount outPos;
+   sampleCount inputRemaining;
+   sampleCount curDelay{ 0 };
+   sampleCount delayRemaining{ 0 };
+   size_t inputBufferCnt{ 0 };
+   size_t outputBufferCnt{ 0 };
+   bool cleared{ false };
+   std::shared_ptr<WaveTrack> genLeft, genRight;
+   sampleCount genLength{ 0 };
+};
+
 bool PerTrackEffect::ProcessPass(Instance &instance, EffectSettings &settings)
 {
    const auto duration = settings.extra.GetDuration();
    bool bGoodResult = true;
    bool isGenerator = GetType() == EffectTypeGenerate;
 
-   FloatBuffers inBuffer, outBuffer;
-   ArrayOf<float *> inBufPos, outBufPos;
-   ChannelName map[3];
-   size_t bufferSize = 0;
-   size_t blockSize = 0;
-   int count = 0;
-   bool clear = false;
+   std::vector<TrackJob> tracks;
 
    // It's possible that the number of channels the effect expects changed based on
    // the parameters (the Audacity Reverb effect does when the stereo width is 0).
    const auto numAudioIn = GetAudioInCount();
-   const auto numAudioOut = GetAudioOutCount();
    const bool multichannel = numAudioIn > 1;
    auto range = multichannel
       ? mOutputTracks->Leaders()
       : mOutputTracks->Any();
-   range.VisitWhile( bGoodResult,
+   range.Visit(
       [&](WaveTrack *left, const Track::Fallthrough &fallthrough) {
          if (!left->GetSelected())
             return fallthrough();
 
-         sampleCount len = 0;
-         sampleCount start = 0;
-         unsigned numChannels = 0;
-         WaveTrack *right{};
+         TrackJob track;
+         track.left = left;
+         auto &map = track.map;
+         auto &numChannels = track.numChannels;
 
          // Iterate either over one track which could be any channel,
          // or if multichannel, then over all channels of left,
@@ -127,82 +219,58 @@ bool PerTrackEffect::ProcessPass(Instance &instance, EffectSettings &settings)
                break;
             if (numChannels == 2) {
                // TODO: more-than-two-channels
-               right = channel;
-               clear = false;
+               track.right = channel;
                // Ignore other channels
                break;
             }
          }
 
-         if (!isGenerator) {
-            GetBounds(*left, right, &start, &len);
-            mSampleCnt = len;
-         }
-         else
-            mSampleCnt = left->TimeToLongSamples(duration);
-
-         // Let the client know the sample rate
-         instance.SetSampleRate(left->GetRate());
-
-         // Get the block size the client wants to use
-         auto max = left->GetMaxBlockSize() * 2;
-         blockSize = instance.SetBlockSize(max);
-
-         // Calculate the buffer size to be at least the max rounded up to the clients
-         // selected block size.
-         const auto prevBufferSize = bufferSize;
-         bufferSize = ((max + (blockSize - 1)) / blockSize) * blockSize;
-
-         // If the buffer size has changed, then (re)allocate the buffers
-         if (prevBufferSize != bufferSize) {
-            // Always create the number of input buffers the client expects even if we don't have
-            // the same number of channels.
-            inBufPos.reinit( numAudioIn );
-            inBuffer.reinit( numAudioIn, bufferSize );
-
-            // We won't be using more than the first 2 buffers, so clear the rest (if any)
-            for (size_t i = 2; i < numAudioIn; i++)
-               for (size_t j = 0; j < bufferSize; j++)
-                  inBuffer[i][j] = 0.0;
-
-            // Always create the number of output buffers the client expects even if we don't have
-            // the same number of channels.
-            outBufPos.reinit( numAudioOut );
-            // Output buffers get an extra blockSize worth to give extra room if
-            // the plugin adds latency
-            outBuffer.reinit( numAudioOut, bufferSize + blockSize );
-         }
+         if (!isGenerator)
+            GetBounds(*left, track.right, &track.start, &track.len);
 
-         // (Re)Set the input buffer positions
-         for (size_t i = 0; i < numAudioIn; i++)
-            inBufPos[i] = inBuffer[i].get();
+         tracks.push_back(track);
+      },
+      [&](Track *t) {
+         if (SyncLock::IsSyncLockSelected(t))
+            t->SyncLockAdjust(mT1, mT0 + duration);
+      }
+   );
 
-         // (Re)Set the output buffer positions
-         for (size_t i = 0; i < numAudioOut; i++)
-            outBufPos[i] = outBuffer[i].get();
+   // Instances that can clone themselves process several tracks at once
+   std::vector<std::shared_ptr<Instance>> clones;
+   if (tracks.size() > 1) {
+      const auto threads = PerTrackEffectThreads.Read();
+      const auto concurrency = std::min<size_t>(tracks.size(), threads > 0
+         ? static_cast<unsigned>(threads)
+         : WorkStealingPool::DefaultConcurrency());
+      while (clones.size() + 1 < concurrency) {
+         auto pClone = instance.Clone();
+         if (!pClone)
+            break;
+         clones.push_back(std::move(pClone));
+      }
+   }
 
-         // Clear unused input buffers
-         if (!right && !clear && numAudioIn > 1) {
-            for (size_t j = 0; j < bufferSize; j++)
-               inBuffer[1][j] = 0.0;
-            clear = true;
-         }
+   if (clones.empty()) {
+      Buffers buffers;
+      int count = 0;
+      for (const auto &track : tracks) {
+         PrepareTrack(instance, settings, track, buffers);
 
          // Go process the track(s)
-         bGoodResult = ProcessTrack(instance, settings,
-            count, map, left, right, start, len,
-            inBuffer, outBuffer, inBufPos, outBufPos, bufferSize, blockSize,
-            numChannels);
+         bGoodResult = ProcessTrack(instance, settings, count, track, buffers);
          if (!bGoodResult)
-            return;
+            break;
 
          count++;
-      },
-      [&](Track *t) {
-         if (SyncLock::IsSyncLockSelected(t))
-            t->SyncLockAdjust(mT1, mT0 + duration);
       }
-   );
+   }
+   else {
+      std::vector<Instance *> instances{ &instance };
+      for (const auto &pClone : clones)
+         instances.push_back(pClone.get());
+      bGoodResult = ProcessTracksConcurrently(instances, settings, tracks);
+   }
 
    if (bGoodResult && GetType() == EffectTypeGenerate)
       mT1 = mT0 + duration;
@@ -210,23 +278,79 @@ bool PerTrackEffect::ProcessPass(Instance &instance, EffectSettings &settings)
    return bGoodResult;
 }
 
+void PerTrackEffect::PrepareTrack(Instance &instance,
+   EffectSettings &settings, const TrackJob &track, Buffers &buffers)
+{
+   const auto left = track.left;
+   auto &inBuffer = buffers.inBuffer;
+   auto &outBuffer = buffers.outBuffer;
+   auto &bufferSize = buffers.bufferSize;
+   const auto numAudioIn = GetAudioInCount();
+   const auto numAudioOut = GetAudioOutCount();
+
+   if (track.right)
+      buffers.clear = false;
+
+   if (GetType() != EffectTypeGenerate)
+      mSampleCnt = track.len;
+   else
+      mSampleCnt = left->TimeToLongSamples(settings.extra.GetDuration());
+
+   // Let the client know the sample rate
+   instance.SetSampleRate(left->GetRate());
+
+   // Get the block size the client wants to use
+   auto max = left->GetMaxBlockSize() * 2;
+   const auto blockSize = buffers.blockSize = instance.SetBlockSize(max);
+
+   // Calculate the buffer size to be at least the max rounded up to the clients
+   // selected block size.
+   const auto prevBufferSize = bufferSize;
+   bufferSize = ((max + (blockSize - 1)) / blockSize) * blockSize;
+
+   // If the buffer size has changed, then (re)allocate the buffers
+   if (prevBufferSize != bufferSize) {
+      // Always create the number of input buffers the client expects even if we don't have
+      // the same number of channels.
+      buffers.inBufPos.reinit( numAudioIn );
+      inBuffer.reinit( numAudioIn, bufferSize );
+
+      // We won't be using more than the first 2 buffers, so clear the rest (if any)
+      for (size_t i = 2; i < numAudioIn; i++)
+         for (size_t j = 0; j < bufferSize; j++)
+            inBuffer[i][j] = 0.0;
+
+      // Always create the number of output buffers the client expects even if we don't have
+      // the same number of channels.
+      buffers.outBufPos.reinit( numAudioOut );
+      // Output buffers get an extra blockSize worth to give extra room if
+      // the plugin adds latency
+      outBuffer.reinit( numAudioOut, bufferSize + blockSize );
+   }
+
+   // (Re)Set the input buffer positions
+   for (size_t i = 0; i < numAudioIn; i++)
+      buffers.inBufPos[i] = inBuffer[i].get();
+
+   // (Re)Set the output buffer positions
+   for (size_t i = 0; i < numAudioOut; i++)
+      buffers.outBufPos[i] = outBuffer[i].get();
+
+   // Clear unused input buffers
+   if (!track.right && !buffers.clear && numAudioIn > 1) {
+      for (size_t j = 0; j < bufferSize; j++)
+         inBuffer[1][j] = 0.0;
+      buffers.clear = true;
+   }
+}
+
 bool PerTrackEffect::ProcessTrack(Instance &instance, EffectSettings &settings,
-   int count,
-   ChannelNames map,
-   WaveTrack *left,
-   WaveTrack *right,
-   sampleCount start,
-   sampleCount len,
-   FloatBuffers &inBuffer,
-   FloatBuffers &outBuffer,
-   ArrayOf< float * > &inBufPos,
-   ArrayOf< float *> &outBufPos, size_t bufferSize, size_t blockSize,
-   unsigned numChannels) const
+   int count, const TrackJob &track, Buffers &buffers) const
 {
    bool rc = true;
 
    // Give the plugin a chance to initialize
-   if (!instance.ProcessInitialize(settings, len, map))
+   if (!instance.ProcessInitialize(settings, track.len, track.map))
       return false;
 
    { // Start scope for cleanup
@@ -237,6 +361,175 @@ bool PerTrackEffect::ProcessTrack(Instance &instance, EffectSettings &settings,
          rc = false;
    } );
 
+   TrackRunner runner{ *this, instance, settings, track, buffers };
+   const auto stop = [&]{
+      return track.numChannels > 1
+         ? TrackGroupProgress(count, runner.Fraction())
+         : TrackProgress(count, runner.Fraction());
+   };
+
+   // Call the effect until we run out of input or delayed samples
+   while (!runner.Done()) {
+      runner.Read();
+      if (!runner.Run(stop)) {
+         rc = false;
+         break;
+      }
+      runner.Write();
+   }
+
+   if (rc)
+      runner.Finish();
+
+   } // End scope for cleanup
+   return rc;
+}
+
+bool PerTrackEffect::ProcessTracksConcurrently(
+   const std::vector<Instance *> &instances,
+   EffectSettings &settings, const std::vector<TrackJob> &tracks)
+{
+   bool rc = true;
+   const auto nInstances = instances.size();
+   std::vector<Buffers> buffers(nInstances);
+   std::vector<std::unique_ptr<TrackRunner>> runners(nInstances);
+   // Index in tracks of the track of each runner
+   std::vector<size_t> trackIndices(nInstances);
+
+   { // Start scope for cleanup
+   auto cleanup = finally( [&] {
+      // Allow the plugins to cleanup, after a cancellation or failure
+      for (size_t i = 0; i < nInstances; ++i)
+         if (runners[i]) {
+            runners[i].reset();
+            if (!instances[i]->ProcessFinalize())
+               rc = false;
+         }
+   } );
+
+   size_t nextTrack = 0, nFinished = 0;
+   double fraction = 0;
+   std::vector<size_t> active;
+   std::vector<char> failed(nInstances);
+   // Set when any task fails, or the user cancels, so that the others stop
+   // at their next block and do not finish their buffers
+   std::atomic<bool> stopped{ false };
+   const auto task = [&](size_t iTask, unsigned iWorker){
+      const auto i = active[iTask];
+      // Only worker 0, which is the calling thread, may poll the progress
+      // display, at the fraction reached before the turn
+      const auto stop = [&]{
+         if (stopped.load(std::memory_order_relaxed))
+            return true;
+         if (iWorker == 0 && TotalProgress(fraction / tracks.size())) {
+            stopped.store(true, std::memory_order_relaxed);
+            return true;
+         }
+         return false;
+      };
+      if (!runners[i]->Run(stop)) {
+         failed[i] = 1;
+         stopped.store(true, std::memory_order_relaxed);
+      }
+   };
+   while (rc) {
+      // Give each idle instance the next track
+      for (size_t i = 0; i < nInstances && nextTrack < tracks.size(); ++i) {
+         if (runners[i])
+            continue;
+         const auto &track = tracks[nextTrack];
+         auto &myInstance = *instances[i];
+         PrepareTrack(myInstance, settings, track, buffers[i]);
+         // Give the plugin a chance to initialize
+         if (!myInstance.ProcessInitialize(settings, track.len, track.map)) {
+            rc = false;
+            break;
+         }
+         runners[i] = std::make_unique<TrackRunner>(
+            *this, myInstance, settings, track, buffers[i]);
+         trackIndices[i] = nextTrack++;
+      }
+      if (!rc)
+         break;
+
+      // Runners, in the order of their tracks, so that the tracks are
+      // written in the same order however the workers are scheduled
+      active.clear();
+      for (size_t i = 0; i < nInstances; ++i)
+         if (runners[i])
+            active.push_back(i);
+      if (active.empty())
+         break;
+      std::sort(active.begin(), active.end(), [&](size_t i, size_t j){
+         return trackIndices[i] < trackIndices[j];
+      });
+
+      // Only the computation is on the workers, which are leased for each
+      // turn, so that others may have them while this reads and writes
+      for (auto i : active)
+         runners[i]->Read();
+      std::fill(failed.begin(), failed.end(), 0);
+      {
+         WorkStealingPool::SharedLease lease;
+         if (lease && active.size() > 1)
+            lease->ForEach(active.size(), task, nInstances);
+         else
+            for (size_t iTask = 0; iTask < active.size(); iTask++)
+               task(iTask, 0);
+      }
+
+      fraction = nFinished;
+      for (auto i : active) {
+         if (failed[i]) {
+            rc = false;
+            break;
+         }
+         auto &runner = *runners[i];
+         runner.Write();
+         if (runner.Done()) {
+            runner.Finish();
+            runners[i].reset();
+            // Allow the plugin to cleanup
+            if (!instances[i]->ProcessFinalize())
+               rc = false;
+            ++nFinished;
+            fraction += 1.0;
+         }
+         else
+            fraction += runner.Fraction();
+      }
+      if (rc && TotalProgress(fraction / tracks.size()))
+         rc = false;
+   }
+
+   } // End scope for cleanup
+   return rc;
+}
+
+PerTrackEffect::TrackRunner::TrackRunner(const PerTrackEffect &effect,
+   Instance &instance, EffectSettings &settings,
+   const TrackJob &track, Buffers &buffers)
+   : effect{ effect }
+   , instance{ instance }
+   , settings{ settings }
+   , left{ track.left }
+   , right{ track.right }
+   , start{ track.start }
+   , len{ track.len }
+   , inBuffer{ buffers.inBuffer }
+   , outBuffer{ buffers.outBuffer }
+   , inBufPos{ buffers.inBufPos }
+   , outBufPos{ buffers.outBufPos }
+   , bufferSize{ buffers.bufferSize }
+   , blockSize{ buffers.blockSize }
+   , numChannels{ track.numChannels }
+   , isGenerator{ effect.GetType() == EffectTypeGenerate }
+   , isProcessor{ effect.GetType() == EffectTypeProcess }
+   , chans{ std::min<unsigned>(effect.GetAudioOutCount(), numChannels) }
+   , inPos{ start }
+   , outPos{ start }
+   , inputRemaining{ len }
+{
    // For each input block of samples, we pass it to the effect along with a
    // variable output location.  This output location is simply a pointer into a
    // much larger buffer.  This reduces the number of calls required to add the
@@ -250,25 +543,13 @@ bool PerTrackEffect::ProcessTrack(Instance &instance, EffectSettings &settings,
    // there is no further input data to process, the loop continues to call the
    // effect with an empty input buffer until the effect has had a chance to
    // return all of the remaining delayed samples.
-   auto inPos = start;
-   auto outPos = start;
-   auto inputRemaining = len;
-   decltype(instance.GetLatency(settings)) curDelay = 0, delayRemaining = 0;
-   decltype(blockSize) curBlockSize = 0;
-   decltype(bufferSize) inputBufferCnt = 0;
-   decltype(bufferSize) outputBufferCnt = 0;
-   bool cleared = false;
-   auto chans = std::min<unsigned>(GetAudioOutCount(), numChannels);
-   std::shared_ptr<WaveTrack> genLeft, genRight;
-   decltype(len) genLength = 0;
-   bool isGenerator = GetType() == EffectTypeGenerate;
-   bool isProcessor = GetType() == EffectTypeProcess;
    double genDur = 0;
    if (isGenerator) {
       const auto duration = settings.extra.GetDuration();
-      if (IsPreviewing()) {
+      if (effect.IsPreviewing()) {
          gPrefs->Read(wxT("/AudioIO/EffectsPreviewLen"), &genDur, 6.0);
-         genDur = std::min(duration, CalcPreviewInputLength(settings, genDur));
+         genDur = std::min(duration,
+            effect.CalcPreviewInputLength(settings, genDur));
       }
       else
          genDur = duration;
@@ -282,27 +563,54 @@ bool PerTrackEffect::ProcessTrack(Instance &instance, EffectSettings &settings,
       if (right)
          genRight = right->EmptyCopy();
    }
+}
 
-   // Call the effect until we run out of input or delayed samples
-   while (inputRemaining != 0 || delayRemaining != 0) {
-      // Still working on the input samples
-      if (inputRemaining != 0) {
-         // Need to refill the input buffers
-         if (inputBufferCnt == 0) {
-            // Calculate the number of samples to get
-            inputBufferCnt =
-               limitSampleBufferSize( bufferSize, inputRemaining );
+double PerTrackEffect::TrackRunner::Fraction() const
+{
+   return (inPos - start).as_double() /
+      (isGenerator ? genLength : len).as_double();
+}
 
-            // Fill the input buffers
-            left->GetFloats(inBuffer[0].get(), inPos, inputBufferCnt);
-            if (right)
-               right->GetFloats(inBuffer[1].get(), inPos, inputBufferCnt);
+void PerTrackEffect::TrackRunner::Read()
+{
+   // Need to refill the input buffers
+   if (inputRemaining == 0 || inputBufferCnt != 0)
+      return;
+
+   // Calculate the number of samples to get
+   inputBufferCnt =
+      limitSampleBufferSize( bufferSize, inputRemaining );
+
+   // Fill the input buffers
+   left->GetFloats(inBuffer[0].get(), inPos, inputBufferCnt);
+   if (right)
+      right->GetFloats(inBuffer[1].get(), inPos, inputBufferCnt);
+
+   // Ready the next input while the effect processes this
+   const auto nextPos = inPos + inputBufferCnt;
+   const auto nextCnt = limitSampleBufferSize(
+      bufferSize, inputRemaining - inputBufferCnt);
+   left->Prefetch(nextPos, nextCnt);
+   if (right)
+      right->Prefetch(nextPos, nextCnt);
+
+   // Reset the input buffer positions
+   for (size_t i = 0; i < numChannels; i++)
+      inBufPos[i] = inBuffer[i].get();
+}
 
-            // Reset the input buffer positions
-            for (size_t i = 0; i < numChannels; i++)
-               inBufPos[i] = inBuffer[i].get();
-         }
+bool PerTrackEffect::TrackRunner::Run(const std::function<bool()> &stop)
+{
+   // Call the effect until we run out of input or delayed samples
+   while (!Done()) {
+      // Need Read() first
+      if (inputRemaining != 0 && inputBufferCnt == 0)
+         return true;
 
+      size_t curBlockSize = 0;
+
+      // Still working on the input samples
+      if (inputRemaining != 0) {
          // Calculate the number of samples to process
          curBlockSize = blockSize;
          if (curBlockSize > inputRemaining) {
@@ -417,88 +725,75 @@ bool PerTrackEffect::ProcessTrack(Instance &instance, EffectSettings &settings,
          for (size_t i = 0; i < chans; i++)
             outBufPos[i] += curBlockSize;
       }
-      // Output buffers have filled
-      else {
-         if (isProcessor) {
-            // Write them out
-            left->Set((samplePtr) outBuffer[0].get(), floatSample, outPos, outputBufferCnt);
-            if (right) {
-               if (chans >= 2)
-                  right->Set((samplePtr) outBuffer[1].get(), floatSample, outPos, outputBufferCnt);
-               else
-                  right->Set((samplePtr) outBuffer[0].get(), floatSample, outPos, outputBufferCnt);
-            }
-         }
-         else if (isGenerator) {
-            genLeft->Append((samplePtr) outBuffer[0].get(), floatSample, outputBufferCnt);
-            if (genRight)
-               genRight->Append((samplePtr) outBuffer[1].get(), floatSample, outputBufferCnt);
-         }
 
-         // Reset the output buffer positions
-         for (size_t i = 0; i < chans; i++)
-            outBufPos[i] = outBuffer[i].get();
+      if (stop && stop())
+         return false;
 
-         // Bump to the next track position
-         outPos += outputBufferCnt;
-         outputBufferCnt = 0;
-      }
+      // Output buffers have filled; need Write()
+      if (outputBufferCnt >= bufferSize)
+         return true;
+   }
+   return true;
+}
 
-      if (numChannels > 1) {
-         if (TrackGroupProgress(count,
-               (inPos - start).as_double() /
-               (isGenerator ? genLength : len).as_double())) {
-            rc = false;
-            break;
-         }
-      }
-      else {
-         if (TrackProgress(count,
-               (inPos - start).as_double() /
-               (isGenerator ? genLength : len).as_double())) {
-            rc = false;
-            break;
-         }
+void PerTrackEffect::TrackRunner::Write()
+{
+   // Output buffers have filled
+   if (outputBufferCnt < bufferSize)
+      return;
+
+   Put();
+
+   // Reset the output buffer positions
+   for (size_t i = 0; i < chans; i++)
+      outBufPos[i] = outBuffer[i].get();
+
+   // Bump to the next track position
+   outPos += outputBufferCnt;
+   outputBufferCnt = 0;
+}
+
+void PerTrackEffect::TrackRunner::Put()
+{
+   if (isProcessor) {
+      // Write them out
+      left->Set((samplePtr) outBuffer[0].get(), floatSample, outPos, outputBufferCnt);
+      if (right) {
+         if (chans >= 2)
+            right->Set((samplePtr) outBuffer[1].get(), floatSample, outPos, outputBufferCnt);
+         else
+            right->Set((samplePtr) outBuffer[0].get(), floatSample, outPos, outputBufferCnt);
       }
    }
+   else if (isGenerator) {
+      genLeft->Append((samplePtr) outBuffer[0].get(), floatSample, outputBufferCnt);
+      if (genRight)
+         genRight->Append((samplePtr) outBuffer[1].get(), floatSample, outputBufferCnt);
+   }
+}
 
+void PerTrackEffect::TrackRunner::Finish()
+{
    // Put any remaining output
-   if (rc && outputBufferCnt) {
-      if (isProcessor) {
-         left->Set((samplePtr) outBuffer[0].get(), floatSample, outPos, outputBufferCnt);
-         if (right) {
-            if (chans >= 2)
-               right->Set((samplePtr) outBuffer[1].get(), floatSample, outPos, outputBufferCnt);
-            else
-               right->Set((samplePtr) outBuffer[0].get(), floatSample, outPos, outputBufferCnt);
-         }
-      }
-      else if (isGenerator) {
-         genLeft->Append((samplePtr) outBuffer[0].get(), floatSample, outputBufferCnt);
-         if (genRight)
-            genRight->Append((samplePtr) outBuffer[1].get(), floatSample, outputBufferCnt);
-      }
-   }
+   if (outputBufferCnt)
+      Put();
 
-   if (rc && isGenerator) {
-      auto pProject = FindProject();
+   if (isGenerator) {
+      auto pProject = effect.FindProject();
 
       // Transfer the data from the temporary tracks to the actual ones
       genLeft->Flush();
       // mT1 gives us the NEW selection. We want to replace up to GetSel1().
       auto &selectedRegion = ViewInfo::Get( *pProject ).selectedRegion;
       auto t1 = selectedRegion.t1();
-      PasteTimeWarper warper{ t1, mT0 + genLeft->GetEndTime() };
-      left->ClearAndPaste(mT0, t1, genLeft.get(), true, true,
+      PasteTimeWarper warper{ t1, effect.mT0 + genLeft->GetEndTime() };
+      left->ClearAndPaste(effect.mT0, t1, genLeft.get(), true, true,
          &warper);
 
       if (genRight) {
          genRight->Flush();
-         right->ClearAndPaste(mT0, selectedRegion.t1(),
+         right->ClearAndPaste(effect.mT0, selectedRegion.t1(),
             genRight.get(), true, true, nullptr /* &warper */);
       }
    }
-
-   } // End scope for cleanup
-   return rc;
 }
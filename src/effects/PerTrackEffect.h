@@ -16,6 +16,7 @@
 
 #include "Effect.h" // to inherit
 #include "MemoryX.h"
+#include <vector>
 
 using FloatBuffers = ArraysOf<float>;
 
@@ -27,6 +28,11 @@ using FloatBuffers = ArraysOf<float>;
    MakeInstance(), which must be a subclass of PerTrackEffect::Instance.
    Also uses GetLatency() to determine how many leading output samples to
    discard and how many extra samples to produce.
+
+   If the instance can Clone() itself, several tracks are processed at once,
+   each by its own instance on a worker thread, up to
+   /Performance/PerTrackEffectThreads (0 for the hardware concurrency).
+   Tracks are still read, written and reported in order on the main thread.
  */
 class PerTrackEffect
    : public Effect
@@ -63,6 +69,16 @@ public:
       //! Default implementation returns zero
       virtual sampleCount GetLatency(const EffectSettings &settings);
 
+      //! Another instance, to process other tracks at the same time, or null
+      /*!
+       Default implementation returns null, so that tracks are processed one
+       at a time.  Override only if ProcessBlock() and GetLatency() of two
+       instances may run at once on different threads; the other functions
+       are called on the main thread, SetSampleRate() and SetBlockSize()
+       before each track.
+       */
+      virtual std::shared_ptr<Instance> Clone() const;
+
    protected:
       const PerTrackEffect &mProcessor;
    };
@@ -78,18 +94,20 @@ protected:
    sampleCount    mSampleCnt{};
 
 private:
+   struct TrackJob;
+   struct Buffers;
+   class TrackRunner;
+
    bool ProcessPass(Instance &instance, EffectSettings &settings);
+   //! Sets the sample rate and block size of the instance, and sizes the
+   //! buffers, for the track
+   void PrepareTrack(Instance &instance, EffectSettings &settings,
+      const TrackJob &track, Buffers &buffers);
    bool ProcessTrack(Instance &instance, EffectSettings &settings,
-      int count,
-      ChannelNames map,
-      WaveTrack *left,
-      WaveTrack *right,
-      sampleCount start,
-      sampleCount len,
-      FloatBuffers &inBuffer,
-      FloatBuffers &outBuffer,
-      ArrayOf< float * > &inBufPos,
-      ArrayOf< float *> &outBufPos, size_t bufferSize, size_t blockSize,
-      unsigned mNumChannels) const;
+      int count, const TrackJob &track, Buffers &buffers) const;
+   //! Processes the tracks in turns, a buffer of each of as many tracks as
+   //! instances at once, and writes them in order
+   bool ProcessTracksConcurrently(const std::vector<Instance *> &instances,
+      EffectSettings &settings, const std::vector<TrackJob> &tracks);
 };
 #endif
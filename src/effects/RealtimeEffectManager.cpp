@@ -14,12 +14,19 @@
 #include "RealtimeEffectState.h"
 
 #include <memory>
+#include "Prefs.h"
 #include "Project.h"
 #include "Track.h"
+#include "WorkStealingPool.h"
 
+#include <algorithm>
 #include <atomic>
+#include <optional>
+#include <wx/log.h>
 #include <wx/time.h>
 
+IntSetting RealtimeEffectThreads{ L"/Performance/RealtimeEffectThreads", 1 };
+
 static const AttachedProjectObjects::RegisteredFactory manager
 {
    [](AudacityProject &project)
@@ -52,6 +59,14 @@ bool RealtimeEffectManager::IsActive() const noexcept
    return mActive;
 }
 
+unsigned RealtimeEffectManager::GetConcurrency()
+{
+   const auto threads = RealtimeEffectThreads.Read();
+   return threads > 0
+      ? static_cast<unsigned>(threads)
+      : WorkStealingPool::DefaultConcurrency();
+}
+
 void RealtimeEffectManager::Initialize(double rate)
 {
    // Remember the rate
@@ -61,6 +76,12 @@ void RealtimeEffectManager::Initialize(double rate)
    mChans.clear();
    mRates.clear();
    mGroupLeaders.clear();
+   mLoads.clear();
+
+   // Independent chains of different tracks may run in the threads of the
+   // shared pool; start them now, if it is free, and not in the audio thread
+   if (GetConcurrency() > 1)
+      WorkStealingPool::SharedLease{};
 
    // RealtimeAdd/RemoveEffect() needs to know when we're active so it can
    // initialize newly added effects
@@ -83,6 +104,10 @@ void RealtimeEffectManager::AddTrack(Track &track, unsigned chans, float rate)
    mGroupLeaders.push_back(leader);
    mChans.insert({leader, chans});
    mRates.insert({leader, rate});
+   mLoads.insert({leader, {}});
+   // Allow for two blocks of each group in a batch, so that the audio
+   // thread does not allocate
+   mRunStarts.reserve(2 * mGroupLeaders.size() + 1);
 
    VisitGroup(*leader,
       [&](RealtimeEffectState & state, bool) {
@@ -101,10 +126,21 @@ void RealtimeEffectManager::Finalize() noexcept
 
    VisitAll([](RealtimeEffectState &state, bool){ state.Finalize(); });
 
+   // Report where the time went, so that expensive chains can be found
+   for (auto leader : mGroupLeaders) {
+      const auto &load = mLoads[leader];
+      if (load.audioSeconds > 0)
+         wxLogDebug(wxT("Realtime effects of track %s: "
+               "average load %.1f%%, peak %.1f%%"),
+            leader->GetName(),
+            100 * load.busySeconds / load.audioSeconds, 100 * load.peak);
+   }
+
    // Reset processor parameters
    mGroupLeaders.clear();
    mChans.clear();
    mRates.clear();
+   mLoads.clear();
 
    // No longer active
    mActive = false;
@@ -180,23 +216,120 @@ size_t RealtimeEffectManager::Process(Track &track,
    if (mSuspended)
       return numSamples;
 
-   auto chans = mChans[&track];
-
    // Remember when we started so we can calculate the amount of latency we
    // are introducing
    auto start = std::chrono::steady_clock::now();
 
+   // The chain of the track, then the per-project chain, as in ProcessBlocks
+   const auto pChans = mChans.find(&track);
+   const auto nBuffers = pChans == mChans.end() ? 0u : pChans->second;
+   ProcessGroup(track, RealtimeEffectList::Get(track),
+      buffers, nBuffers, scratch, numSamples);
+   ProcessGroup(track, RealtimeEffectList::Get(mProject),
+      buffers, nBuffers, scratch, numSamples);
+
+   // Remember the latency
+   auto end = std::chrono::steady_clock::now();
+   mLatency = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+
+   //
+   // This is wrong...needs to handle tails
+   //
+   return numSamples;
+}
+
+//
+// This will be called in a different thread than the main GUI thread.
+//
+void RealtimeEffectManager::ProcessBlocks(const Block *blocks, size_t nBlocks,
+   float *const *const *scratch, unsigned nScratch)
+{
+   // Protect...
+   std::lock_guard<std::mutex> guard(mLock);
+
+   // Can be suspended because of the audio stream being paused or because effects
+   // have been suspended, so allow the samples to pass as-is.
+   if (mSuspended)
+      return;
+
+   auto start = std::chrono::steady_clock::now();
+
+   // Each run of blocks of one track is one task, because the chain of the
+   // track must see its blocks in order
+   mRunStarts.clear();
+   for (size_t iBlock = 0; iBlock < nBlocks; ++iBlock)
+      if (iBlock == 0 || blocks[iBlock].pTrack != blocks[iBlock - 1].pTrack)
+         mRunStarts.push_back(iBlock);
+   mRunStarts.push_back(nBlocks);
+   const auto nRuns = mRunStarts.size() - 1;
+
+   // Each worker has its own scratch and stand-ins
+   const auto processRun = [&](size_t iRun, unsigned iWorker){
+      for (auto iBlock = mRunStarts[iRun]; iBlock < mRunStarts[iRun + 1];
+         ++iBlock) {
+         auto &block = blocks[iBlock];
+         ProcessGroup(*block.pTrack, RealtimeEffectList::Get(*block.pTrack),
+            block.buffers, block.nBuffers, scratch[iWorker],
+            block.numSamples);
+      }
+   };
+   // Never wait for the pool here; if it is busy, run the chains in turn
+   std::optional<WorkStealingPool::SharedLease> lease;
+   if (nScratch > 1 && nRuns > 1)
+      lease.emplace();
+   const auto pPool = lease ? lease->get() : nullptr;
+   if (pPool)
+      pPool->ForEach(nRuns, processRun, nScratch);
+   else
+      for (size_t iRun = 0; iRun < nRuns; ++iRun)
+         processRun(iRun, 0);
+   lease.reset();
+
+   // States of the per-project list may not be called for several groups at
+   // once, so they follow, in this thread
+   auto &masterStates = RealtimeEffectList::Get(mProject);
+   for (size_t iBlock = 0; iBlock < nBlocks; ++iBlock) {
+      auto &block = blocks[iBlock];
+      ProcessGroup(*block.pTrack, masterStates,
+         block.buffers, block.nBuffers, scratch[0], block.numSamples);
+   }
+
+   // Remember the latency
+   auto end = std::chrono::steady_clock::now();
+   mLatency = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+}
+
+void RealtimeEffectManager::ProcessGroup(Track &track,
+   RealtimeEffectList &states, float *const *buffers, unsigned nBuffers,
+   float *const *scratch, size_t numSamples)
+{
+   // Only find, never insert, because several workers may be here at once
+   const auto pChans = mChans.find(&track);
+   if (pChans == mChans.end())
+      return;
+   const auto chans = pChans->second;
+
+   auto start = std::chrono::steady_clock::now();
+
    // Allocate the in and out buffer arrays
    const auto ibuf =
       static_cast<float **>(alloca(chans * sizeof(float *)));
    const auto obuf =
       static_cast<float **>(alloca(chans * sizeof(float *)));
+   const auto bufs =
+      static_cast<float **>(alloca(chans * sizeof(float *)));
+
+   // Supply non-null stand-ins for channels that the caller lacks, because
+   // the various ProcessBlock overrides of effects may crash without them;
+   // they follow the scratch buffers, so that each worker has its own
+   for (unsigned int i = 0; i < chans; i++)
+      bufs[i] = i < nBuffers ? buffers[i] : scratch[chans + 1 + i - nBuffers];
 
    // And populate the input with the buffers we've been given while allocating
    // NEW output buffers
    for (unsigned int i = 0; i < chans; i++)
    {
-      ibuf[i] = buffers[i];
+      ibuf[i] = bufs[i];
       obuf[i] = scratch[i];
    }
 
@@ -204,7 +337,7 @@ size_t RealtimeEffectManager::Process(Track &track,
    // output of one effect as the input to the next effect
    // Tracks how many processors were called
    size_t called = 0;
-   VisitGroup(track,
+   states.Visit(
       [&](RealtimeEffectState &state, bool bypassed)
       {
          if (bypassed)
@@ -223,16 +356,18 @@ size_t RealtimeEffectManager::Process(Track &track,
    // is odd.
    if (called & 1)
       for (unsigned int i = 0; i < chans; i++)
-         memcpy(buffers[i], ibuf[i], numSamples * sizeof(float));
-
-   // Remember the latency
-   auto end = std::chrono::steady_clock::now();
-   mLatency = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+         memcpy(bufs[i], ibuf[i], numSamples * sizeof(float));
+
+   // Account the time against the duration of the samples
+   const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+   const auto audioSeconds = numSamples / mRates.find(&track)->second;
+   auto &load = mLoads.find(&track)->second;
+   load.busySeconds += elapsed.count();
+   load.audioSeconds += audioSeconds;
+   if (audioSeconds > 0)
+      load.peak = std::max(load.peak, elapsed.count() / audioSeconds);
 
-   //
-   // This is wrong...needs to handle tails
-   //
-   return numSamples;
 }
 
 //
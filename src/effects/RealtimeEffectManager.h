@@ -22,10 +22,18 @@
 #include "PluginProvider.h" // for PluginID
 
 class AudacityProject;
+class IntSetting;
 class RealtimeEffectList;
 class RealtimeEffectState;
 class Track;
 
+//! How many threads may process realtime effects of different tracks at
+//! once; 0 for as many as there are cores, 1 to process them in turn
+/*! More than one requires the effects of tracks to be safe for concurrent
+ calls of RealtimeProcess() with different groups; per-project effects are
+ called in one thread only */
+extern AUDACITY_DLL_API IntSetting RealtimeEffectThreads;
+
 namespace RealtimeEffects {
    class InitializationScope;
    class SuspensionScope;
@@ -38,6 +46,20 @@ class AUDACITY_DLL_API RealtimeEffectManager final
 public:
    using Latency = std::chrono::microseconds;
 
+   //! One stretch of samples of one track, for a batch of processing
+   struct Block {
+      Track *pTrack; //!< a leader that was given to AddTrack
+      float *const *buffers; //!< nBuffers of them
+      //! At most the channels given to AddTrack; stand-ins from the scratch
+      //! of the worker make up the rest
+      unsigned nBuffers;
+      size_t numSamples; //!< length of each buffer
+   };
+
+   //! Number of sets of scratch buffers that processing of a batch of blocks
+   //! may use, as read from RealtimeEffectThreads
+   static unsigned GetConcurrency();
+
    RealtimeEffectManager(AudacityProject &project);
    ~RealtimeEffectManager();
 
@@ -86,8 +108,18 @@ private:
    /*! @copydoc ProcessScope::Process */
    size_t Process(Track &track,
       float *const *buffers, float *const *scratch, size_t numSamples);
+   /*! @copydoc ProcessScope::ProcessBlocks */
+   void ProcessBlocks(const Block *blocks, size_t nBlocks,
+      float *const *const *scratch, unsigned nScratch);
    void ProcessEnd() noexcept;
 
+   //! Pass the samples of one group through one list of states, with no
+   //! lock; the list of the track may be processed in a worker thread, but
+   //! for one group at a time, and the per-project list in one thread only
+   void ProcessGroup(Track &track, RealtimeEffectList &states,
+      float *const *buffers, unsigned nBuffers, float *const *scratch,
+      size_t numSamples);
+
    RealtimeEffectManager(const RealtimeEffectManager&) = delete;
    RealtimeEffectManager &operator=(const RealtimeEffectManager&) = delete;
 
@@ -114,6 +146,20 @@ private:
    std::vector<Track *> mGroupLeaders; //!< all are non-null
    std::unordered_map<Track *, unsigned> mChans;
    std::unordered_map<Track *, double> mRates;
+
+   //! Time spent in the chain of each group, against the time of the audio
+   struct ChainLoad {
+      double busySeconds{ 0 };
+      double audioSeconds{ 0 };
+      double peak{ 0 };
+   };
+   //! Entries are added only in the main thread, and each is updated only by
+   //! the worker processing its group
+   std::unordered_map<Track *, ChainLoad> mLoads;
+
+   //! Where runs of blocks of the same track begin, in ProcessBlocks;
+   //! capacity reserved in the main thread
+   std::vector<size_t> mRunStarts;
 };
 
 namespace RealtimeEffects {
@@ -210,6 +256,26 @@ public:
          return numSamples; // consider them trivially processed
    }
 
+   //! Process a batch of blocks of several tracks, the chains of the
+   //! tracks concurrently if RealtimeEffectThreads allows, then the
+   //! per-project chain in this thread
+   /*!
+    Blocks of the same track must be consecutive, and are processed in order.
+    */
+   void ProcessBlocks(const RealtimeEffectManager::Block *blocks,
+      size_t nBlocks,
+      float *const *const *scratch, /*!< nScratch sets, one for each worker,
+         each of twice as many buffers as the most channels given to
+         AddTrack:  temporary buffers, one more, and stand-ins for the
+         channels that blocks lack */
+      unsigned nScratch
+   )
+   {
+      if (auto pProject = mwProject.lock())
+         RealtimeEffectManager::Get(*pProject)
+            .ProcessBlocks(blocks, nBlocks, scratch, nScratch);
+   }
+
 private:
    std::weak_ptr<AudacityProject> mwProject;
 };
@@ -311,7 +311,10 @@ size_t RealtimeEffectState::Process(Track &track,
    unsigned indx = 0;
    unsigned ondx = 0;
 
-   auto processor = mGroups[&track];
+   // Only find, never insert:  a state in the per-project list may process
+   // several groups at once
+   const auto pGroup = mGroups.find(&track);
+   auto processor = pGroup == mGroups.end() ? 0 : pGroup->second;
 
    // Call the client until we run out of input or output channels
    while (ichans > 0 && ochans > 0)
@@ -867,6 +867,8 @@ struct LadspaEffect::Instance
 
    sampleCount GetLatency(const EffectSettings &settings) override;
 
+   std::shared_ptr<PerTrackEffect::Instance> Clone() const override;
+
    bool RealtimeInitialize(EffectSettings &settings) override;
    bool RealtimeAddProcessor(
       EffectSettings &settings, unsigned numChannels, float sampleRate)
@@ -940,6 +942,18 @@ sampleCount LadspaEffect::Instance::GetLatency(const EffectSettings &settings)
    return 0;
 }
 
+auto LadspaEffect::Instance::Clone() const
+   -> std::shared_ptr<PerTrackEffect::Instance>
+{
+   // Each instance runs its own handle of the plugin, but all connect their
+   // output controls, latency among them, to the same settings, so only
+   // plugins without them may process tracks at once
+   auto &effect = GetEffect();
+   if (effect.mNumOutputControls > 0 || effect.mLatencyPort >= 0)
+      return nullptr;
+   return std::make_shared<Instance>(mProcessor);
+}
+
 bool LadspaEffect::Instance::ProcessInitialize(
    EffectSettings &settings, sampleCount, ChannelNames)
 {
@@ -17,6 +17,7 @@
 #include "SampleBlock.h"
 #include "SampleCount.h"
 #include "Sequence.h"
+#include "SummaryPyramid.h"
 
 namespace {
 
@@ -27,9 +28,7 @@ struct MinMaxSumsq
       min = FLT_MAX, max = -FLT_MAX, sumsq = 0.0f;
       while (count--) {
          float v;
-         switch (divisor) {
-         default:
-         case 1:
+         if (divisor == 1) {
             // array holds samples
             v = *pv++;
             if (v < min)
@@ -37,9 +36,8 @@ struct MinMaxSumsq
             if (v > max)
                max = v;
             sumsq += v * v;
-            break;
-         case 256:
-         case 65536:
+         }
+         else {
             // array holds triples of min, max, and rms values
             v = *pv++;
             if (v < min)
@@ -49,7 +47,6 @@ struct MinMaxSumsq
                max = v;
             v = *pv++;
             sumsq += v * v;
-            break;
          }
       }
    }
@@ -133,13 +130,11 @@ bool GetWaveDisplay(const Sequence &sequence,
       if (nextPixel == len)
          whereNext = s1;
 
-      // Decide the summary level
+      // Decide the summary level, so that each column reads at least one
+      // and fewer than SummaryPyramid::Factor frames, at any zoom
       const double samplesPerPixel =
          (whereNext - whereNow).as_double() / (nextPixel - pixel);
-      const int divisor =
-           (samplesPerPixel >= 65536) ? 65536
-         : (samplesPerPixel >= 256) ? 256
-         : 1;
+      const int divisor = SummaryPyramid::DivisorFor(samplesPerPixel);
 
       int blockStatus = b;
 
@@ -166,27 +161,16 @@ bool GetWaveDisplay(const Sequence &sequence,
       }
 
       // Read from the block file or its summary
-      switch (divisor) {
-      default:
-      case 1:
+      if (divisor == 1)
          // Read samples
          // no-throw for display operations!
          sequence.Read(
             (samplePtr)temp.get(), floatSample, seqBlock, startPosition, num, false);
-         break;
-      case 256:
-         // Read triples
-         // Ignore the return value.
-         // This function fills with zeroes if read fails
-         seqBlock.sb->GetSummary256(temp.get(), startPosition, num);
-         break;
-      case 65536:
+      else
          // Read triples
          // Ignore the return value.
          // This function fills with zeroes if read fails
-         seqBlock.sb->GetSummary64k(temp.get(), startPosition, num);
-         break;
-      }
+         seqBlock.sb->GetSummary(divisor, temp.get(), startPosition, num);
       
       auto filePosition = startPosition;
 
@@ -10,13 +10,23 @@
 
 #include "SpectrumCache.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include "BasicUI.h"
+#include "Prefs.h"
 #include "RealFFTf.h"
 #include "SampleTrackCache.h"
 #include "../../../../prefs/SpectrogramSettings.h"
 #include "Spectrum.h"
 #include "WaveClipUtilities.h"
 #include "WaveTrack.h"
+#include "WorkStealingPool.h"
 
 class WaveTrack;
 
@@ -466,12 +476,405 @@ void SpecCache::Populate
    }
 }
 
+IntSetting SpectrogramThreads{ L"/Performance/SpectrogramThreads", 0 };
+
+namespace {
+//! Columns that are computed, and cached, together
+constexpr long long TileColumns = 64;
+//! Tiles either side of the view to compute ahead of scrolling, and to keep
+constexpr long long TileMargin = 2;
+//! Bytes of the finished tiles of one clip, beyond which those farthest
+//! from view are dropped
+constexpr size_t TileBudget = 64 << 20;
+
+long long FloorDivide(long long numerator, long long denominator)
+{
+   const auto quotient = numerator / denominator;
+   return quotient * denominator > numerator ? quotient - 1 : quotient;
+}
+}
+
+//! Spectrum columns of one clip, in tiles, for one zoom and one version of
+//! the clip and of its settings
+/*!
+ Columns are numbered from the start of the sequence of the clip, not from
+ the view, so that scrolling finds the same columns again.  Only the main
+ thread changes the map of tiles; SpecTileEngine computes their contents,
+ reading from a copy of the track, so that edits meanwhile are harmless.
+ Successive tiles of a clip share the copy while the clip stays the same.
+ */
+struct SpecTiles final : std::enable_shared_from_this<SpecTiles>
+{
+   struct Tile {
+      SpecCache columns;
+      //! Set by the engine when all columns are computed
+      std::atomic<bool> done{ false };
+   };
+
+   SpecTiles(const WaveClip &clip, std::shared_ptr<const SampleTrack> pTrack,
+      const SpectrogramSettings &settings, int dirty, double pixelsPerSecond);
+   //! Cancels the work outstanding, waiting for columns in progress
+   ~SpecTiles();
+
+   //! Whether the clip is as it was when pTrack was copied
+   bool SameClip(const WaveClip &clip, int dirty) const;
+   bool Matches(const WaveClip &clip, const SpectrogramSettings &settings,
+      int dirty, double pixelsPerSecond) const;
+
+   //! Sample position of a column, as fillWhere would find it
+   sampleCount Where(long long column) const
+   {
+      return sampleCount(floor(1.0 + column * samplesPerPixel));
+   }
+
+   //! The tile, requested now if not before
+   Tile &Request(long long index);
+
+   //! Withdraws requests for tiles outside of [first, last], and drops
+   //! finished tiles outside of it, farthest first, while over the budget
+   void Trim(long long first, long long last);
+
+   const unsigned long long serial;
+   const int dirty;
+   const double pixelsPerSecond;
+   const double rate;
+   const double samplesPerPixel;
+   const double offset;
+   const sampleCount numSamples;
+   //! A copy, which the engine may use while the original changes
+   const SpectrogramSettings settings;
+   const std::shared_ptr<const SampleTrack> pTrack;
+   const size_t nBins;
+   std::vector<float> gainFactors;
+
+   std::map<long long, std::unique_ptr<Tile>> tiles;
+   //! Called in the main thread
+   std::function<void()> onReady;
+
+   std::atomic<bool> cancelled{ false };
+   //! Whether a call of onReady is already pending
+   std::atomic<bool> notifying{ false };
+};
+
+namespace {
+//! One thread, which computes the most recently requested tile first,
+//! dividing its columns among the workers of the shared WorkStealingPool
+class SpecTileEngine final
+{
+public:
+   static SpecTileEngine &Get()
+   {
+      // Leaked, so that its thread is not joined during static destruction
+      static const auto pEngine = new SpecTileEngine;
+      return *pEngine;
+   }
+
+   void Enqueue(SpecTiles &tiles, SpecTiles::Tile &tile)
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mJobs.push_back({ &tiles, &tile });
+      }
+      mCondition.notify_all();
+   }
+
+   //! @return whether the tile was still waiting, and now is not
+   bool Withdraw(const SpecTiles::Tile &tile)
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      const auto end = mJobs.end();
+      const auto iter = std::find_if(mJobs.begin(), end,
+         [&](const Job &job){ return job.pTile == &tile; });
+      if (iter == end)
+         return false;
+      mJobs.erase(iter);
+      return true;
+   }
+
+   //! Withdraws all tiles of the set, and waits while one is in progress
+   void Cancel(SpecTiles &tiles)
+   {
+      tiles.cancelled.store(true, std::memory_order_relaxed);
+      std::unique_lock<std::mutex> lock{ mMutex };
+      mJobs.erase(std::remove_if(mJobs.begin(), mJobs.end(),
+         [&](const Job &job){ return job.pTiles == &tiles; }), mJobs.end());
+      mCondition.wait(lock, [&]{ return mpCurrent != &tiles; });
+   }
+
+private:
+   SpecTileEngine()
+      : mThread{ [this]{ Run(); } }
+   {
+   }
+
+   void Run()
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      while (true) {
+         mCondition.wait(lock, [this]{ return !mJobs.empty(); });
+         const auto job = mJobs.back();
+         mJobs.pop_back();
+         mpCurrent = job.pTiles;
+         lock.unlock();
+         Compute(*job.pTiles, *job.pTile);
+         lock.lock();
+         mpCurrent = nullptr;
+         mCondition.notify_all();
+      }
+   }
+
+   void Compute(SpecTiles &tiles, SpecTiles::Tile &tile)
+   {
+      const auto &settings = tiles.settings;
+      const auto scratchSize = settings.WindowSize() * settings.ZeroPaddingFactor();
+      const auto threads = SpectrogramThreads.Read();
+      const auto maxWorkers = threads > 0 ? static_cast<unsigned>(threads) : 0u;
+      std::optional<WorkStealingPool::SharedLease> lease;
+      if (maxWorkers != 1)
+         lease.emplace();
+      const auto pPool = lease ? lease->get() : nullptr;
+      const auto nWorkers = pPool ? pPool->GetConcurrency() : 1u;
+      std::vector<std::unique_ptr<SampleTrackCache>> caches(nWorkers);
+      std::vector<std::vector<float>> scratch(nWorkers);
+      auto &columns = tile.columns;
+      try {
+         const auto task = [&](size_t iColumn, unsigned iWorker){
+            if (tiles.cancelled.load(std::memory_order_relaxed))
+               return;
+            auto &pCache = caches[iWorker];
+            if (!pCache) {
+               pCache = std::make_unique<SampleTrackCache>(tiles.pTrack);
+               scratch[iWorker].resize(scratchSize);
+            }
+            columns.CalculateOneSpectrum(settings, *pCache, iColumn,
+               tiles.numSamples, tiles.offset, tiles.rate,
+               tiles.pixelsPerSecond, 0, TileColumns, tiles.gainFactors,
+               scratch[iWorker].data(), columns.freq.data());
+         };
+         if (pPool)
+            pPool->ForEach(TileColumns, task, maxWorkers);
+         else
+            for (size_t iColumn = 0; iColumn < static_cast<size_t>(TileColumns);
+                 ++iColumn)
+               task(iColumn, 0);
+      }
+      catch (...) {
+         // Drawing never fails; show whatever was computed
+      }
+      if (tiles.cancelled.load(std::memory_order_relaxed))
+         return;
+
+      tile.done.store(true, std::memory_order_release);
+      if (!tiles.notifying.exchange(true))
+         BasicUI::CallAfter([wTiles = tiles.weak_from_this()]{
+            if (auto pTiles = wTiles.lock()) {
+               pTiles->notifying.store(false);
+               if (pTiles->onReady)
+                  pTiles->onReady();
+            }
+         });
+   }
+
+   struct Job {
+      SpecTiles *pTiles;
+      SpecTiles::Tile *pTile;
+   };
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   //! Most recent last
+   std::vector<Job> mJobs;
+   const SpecTiles *mpCurrent{};
+
+   std::thread mThread;
+};
+
+unsigned long long sTilesSerial = 0;
+}
+
+SpecTiles::SpecTiles(const WaveClip &clip,
+   std::shared_ptr<const SampleTrack> pTrack_,
+   const SpectrogramSettings &settings_, int dirty_, double pixelsPerSecond_)
+   : serial{ ++sTilesSerial }
+   , dirty{ dirty_ }
+   , pixelsPerSecond{ pixelsPerSecond_ }
+   , rate{ clip.GetRate() }
+   , samplesPerPixel{ rate / pixelsPerSecond }
+   , offset{ clip.GetSequenceStartTime() }
+   , numSamples{ clip.GetSequenceSamplesCount() }
+   , settings{ settings_ }
+   , pTrack{ std::move(pTrack_) }
+   , nBins{ settings.NBins() }
+{
+   settings.CacheWindows();
+   if (settings.algorithm != SpectrogramSettings::algPitchEAC)
+      ComputeSpectrogramGainFactors(
+         settings.WindowSize() * settings.ZeroPaddingFactor(),
+         rate, settings.frequencyGain, gainFactors);
+}
+
+SpecTiles::~SpecTiles()
+{
+   SpecTileEngine::Get().Cancel(*this);
+}
+
+bool SpecTiles::SameClip(const WaveClip &clip, int dirty_) const
+{
+   // Trimming doesn't change the columns, which count from the start of the
+   // sequence
+   return
+      dirty == dirty_ &&
+      rate == clip.GetRate() &&
+      offset == clip.GetSequenceStartTime() &&
+      numSamples == clip.GetSequenceSamplesCount();
+}
+
+bool SpecTiles::Matches(const WaveClip &clip,
+   const SpectrogramSettings &other, int dirty_, double pixelsPerSecond_) const
+{
+   return
+      SameClip(clip, dirty_) &&
+      pixelsPerSecond == pixelsPerSecond_ &&
+      settings.algorithm == other.algorithm &&
+      settings.windowType == other.windowType &&
+      settings.WindowSize() == other.WindowSize() &&
+      settings.ZeroPaddingFactor() == other.ZeroPaddingFactor() &&
+      settings.frequencyGain == other.frequencyGain;
+}
+
+auto SpecTiles::Request(long long index) -> Tile &
+{
+   auto &pTile = tiles[index];
+   if (!pTile) {
+      pTile = std::make_unique<Tile>();
+      auto &columns = pTile->columns;
+      const auto first = index * TileColumns;
+      columns.Grow(TileColumns, settings, pixelsPerSecond,
+         first / pixelsPerSecond);
+      for (long long ii = 0; ii <= TileColumns; ++ii)
+         columns.where[ii] = Where(first + ii);
+      SpecTileEngine::Get().Enqueue(*this, *pTile);
+   }
+   return *pTile;
+}
+
+void SpecTiles::Trim(long long first, long long last)
+{
+   auto &engine = SpecTileEngine::Get();
+   size_t bytes = 0;
+   // Pairs of distance from the range, and index
+   std::vector<std::pair<long long, long long>> finished;
+   for (auto iter = tiles.begin(); iter != tiles.end();) {
+      const auto index = iter->first;
+      const auto distance =
+         index < first ? first - index : index > last ? index - last : 0;
+      const auto &tile = *iter->second;
+      if (tile.done.load(std::memory_order_acquire)) {
+         bytes += tile.columns.freq.size() * sizeof(float);
+         if (distance > 0)
+            finished.emplace_back(distance, index);
+      }
+      else if (distance > 0 && engine.Withdraw(tile)) {
+         // Scrolled away before its turn came
+         iter = tiles.erase(iter);
+         continue;
+      }
+      ++iter;
+   }
+
+   std::sort(finished.begin(), finished.end(), std::greater<>{});
+   for (const auto &[distance, index] : finished) {
+      if (bytes <= TileBudget)
+         break;
+      const auto iter = tiles.find(index);
+      bytes -= iter->second->columns.freq.size() * sizeof(float);
+      tiles.erase(iter);
+   }
+}
+
+bool WaveClipSpectrumCache::GetTiledSpectrogram(const WaveClip &clip,
+   SampleTrackCache &waveTrackCache, const SpectrogramSettings &settings,
+   size_t numPixels, double t0, double pixelsPerSecond,
+   std::function<void()> onReady)
+{
+   if (!mpTiles || !mpTiles->Matches(clip, settings, mDirty, pixelsPerSecond))
+   {
+      // A change only of zoom or of settings keeps the copy of the track
+      auto pTrack = mpTiles && mpTiles->SameClip(clip, mDirty)
+         ? mpTiles->pTrack
+         : std::static_pointer_cast<const SampleTrack>(
+            waveTrackCache.GetTrack()->Duplicate());
+      // Destroying the old tiles cancels their work
+      mpTiles.reset();
+      mpTiles = std::make_shared<SpecTiles>(clip, std::move(pTrack),
+         settings, mDirty, pixelsPerSecond);
+   }
+   auto &tiles = *mpTiles;
+   tiles.onReady = std::move(onReady);
+
+   const auto firstColumn = std::llround(t0 * pixelsPerSecond);
+   if (mShownComplete && mShownTiles == tiles.serial &&
+       mShownColumn == firstColumn && mSpecCache->len == numPixels)
+      //hit cache completely
+      return false;
+
+   // The engine takes the most recent request first:  so request the
+   // margins, within the clip, and then the view, from right to left
+   const auto endColumn = firstColumn + static_cast<long long>(numPixels);
+   const auto firstTile = FloorDivide(firstColumn, TileColumns);
+   const auto lastTile = FloorDivide(endColumn - 1, TileColumns);
+   const auto lastClipTile = FloorDivide(
+      std::llround(tiles.numSamples.as_double() / tiles.samplesPerPixel),
+      TileColumns);
+   for (auto index = std::min(lastTile + TileMargin, lastClipTile);
+        index > lastTile; --index)
+      tiles.Request(index);
+   for (auto index = std::max(firstTile - TileMargin, 0LL);
+        index < firstTile; ++index)
+      tiles.Request(index);
+   for (auto index = lastTile; index >= firstTile; --index)
+      tiles.Request(index);
+   tiles.Trim(firstTile - TileMargin, lastTile + TileMargin);
+
+   // Copy the finished columns into the view
+   mSpecCache->Grow(numPixels, settings, pixelsPerSecond, t0);
+   mSpecCache->leftTrim = clip.GetTrimLeft();
+   mSpecCache->rightTrim = clip.GetTrimRight();
+   mSpecCache->dirty = mDirty;
+   const auto nBins = tiles.nBins;
+   bool complete = true;
+   for (size_t xx = 0; xx < numPixels;) {
+      const auto column = firstColumn + static_cast<long long>(xx);
+      const auto index = FloorDivide(column, TileColumns);
+      const auto &tile = tiles.Request(index);
+      const auto inTile = column - index * TileColumns;
+      const auto count = std::min<size_t>(TileColumns - inTile, numPixels - xx);
+      const auto dest = &mSpecCache->freq[nBins * xx];
+      if (tile.done.load(std::memory_order_acquire))
+         std::copy_n(&tile.columns.freq[nBins * inTile], nBins * count, dest);
+      else {
+         complete = false;
+         std::fill_n(dest, nBins * count, -160.0f);
+      }
+      xx += count;
+   }
+   for (size_t xx = 0; xx <= numPixels; ++xx)
+      mSpecCache->where[xx] =
+         tiles.Where(firstColumn + static_cast<long long>(xx));
+
+   mShownTiles = tiles.serial;
+   mShownColumn = firstColumn;
+   mShownComplete = complete;
+   return true;
+}
+
 bool WaveClipSpectrumCache::GetSpectrogram(const WaveClip &clip,
    SampleTrackCache &waveTrackCache,
    const float *& spectrogram,
    const sampleCount *& where,
    size_t numPixels,
-   double t0, double pixelsPerSecond)
+   double t0, double pixelsPerSecond,
+   std::function<void()> onReady)
 {
    t0 += clip.GetTrimLeft();
 
@@ -480,6 +883,19 @@ bool WaveClipSpectrumCache::GetSpectrogram(const WaveClip &clip,
    const SpectrogramSettings &settings = track->GetSpectrogramSettings();
    const auto rate = clip.GetRate();
 
+   if (settings.algorithm != SpectrogramSettings::algReassignment) {
+      const auto updated = GetTiledSpectrogram(clip, waveTrackCache,
+         settings, numPixels, t0, pixelsPerSecond, std::move(onReady));
+      spectrogram = &mSpecCache->freq[0];
+      where = &mSpecCache->where[0];
+      return updated;
+   }
+
+   // Time reassignment moves power between columns, so that columns can't
+   // be computed independently; compute them here, all at once
+   mpTiles.reset();
+   mShownComplete = false;
+
    //Trim offset comparison failure forces spectrogram cache rebuild
    //and skip copying "unchanged" data after clip border was trimmed.
    bool match =
@@ -617,4 +1033,6 @@ void WaveClipSpectrumCache::Invalidate()
 {
    // Invalidate the spectrum display cache
    mSpecCache = std::make_unique<SpecCache>();
+   mpTiles.reset();
+   mShownComplete = false;
 }
@@ -11,16 +11,23 @@
 #ifndef __AUDACITY_WAVECLIP_SPECTRUM_CACHE__
 #define __AUDACITY_WAVECLIP_SPECTRUM_CACHE__
 
+class IntSetting;
 class sampleCount;
 class SpectrogramSettings;
 class SampleTrackCache;
+struct SpecTiles;
 
+#include <functional>
 #include <vector>
 #include "MemoryX.h"
 #include "WaveClip.h" // to inherit WaveClipListener
 
 using Floats = ArrayOf<float>;
 
+//! Most threads that compute spectrogram columns in the background, when
+//! the shared WorkStealingPool is free; 0 for as many as the processor has
+extern AUDACITY_DLL_API IntSetting SpectrogramThreads;
+
 class AUDACITY_DLL_API SpecCache {
 public:
 
@@ -119,11 +126,34 @@ struct WaveClipSpectrumCache final : WaveClipListener
    void Invalidate() override; // NOFAIL-GUARANTEE
 
    /** Getting high-level data for screen display */
+   /*!
+    Except for the reassignment algorithm, columns are computed in tiles on
+    worker threads; columns of tiles not yet done are filled with -160 dB,
+    and onReady is called in the main thread, later, when more are done.
+    Tiles stay cached while the zoom, the settings and the clip stay the
+    same, so that scrolling computes only new tiles; a change of any of
+    those cancels the work outstanding.
+    @return whether the spectrogram changed since the last call
+    */
    bool GetSpectrogram(const WaveClip &clip, SampleTrackCache &cache,
                        const float *& spectrogram,
                        const sampleCount *& where,
                        size_t numPixels,
-                       double t0, double pixelsPerSecond);
+                       double t0, double pixelsPerSecond,
+                       std::function<void()> onReady = {});
+
+private:
+   bool GetTiledSpectrogram(const WaveClip &clip, SampleTrackCache &cache,
+                            const SpectrogramSettings &settings,
+                            size_t numPixels,
+                            double t0, double pixelsPerSecond,
+                            std::function<void()> onReady);
+
+   std::shared_ptr<SpecTiles> mpTiles;
+   //! What mSpecCache last showed:  serial number of the tiles, first column
+   unsigned long long mShownTiles{ 0 };
+   long long mShownColumn{ 0 };
+   bool mShownComplete{ false };
 };
 
 #endif
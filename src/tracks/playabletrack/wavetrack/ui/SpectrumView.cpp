@@ -28,6 +28,7 @@ Paul Licameli split from WaveTrackView.cpp
 #include "NumberScale.h"
 #include "../../../../TrackArt.h"
 #include "../../../../TrackArtist.h"
+#include "../../../../TrackPanel.h"
 #include "../../../../TrackPanelDrawingContext.h"
 #include "ViewInfo.h"
 #include "../../../../WaveClip.h"
@@ -415,10 +416,19 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
    bool updated;
    {
       const double pps = averagePixelsPerSample * rate;
+      // Columns still computing draw as silence; redraw as they come
+      auto onReady = [
+         wProject = artist->parent->GetProject()->weak_from_this(),
+         id = track->GetId()
+      ]{
+         if (auto pProject = wProject.lock())
+            TrackPanel::Get(*pProject).RefreshTrack(
+               TrackList::Get(*pProject).FindById(id));
+      };
       updated = WaveClipSpectrumCache::Get( *clip ).GetSpectrogram( *clip,
          waveTrackCache, freq, where,
          (size_t)hiddenMid.width,
-         t0, pps);
+         t0, pps, std::move(onReady));
    }
    auto nBins = settings.NBins();
 